@@ -0,0 +1,624 @@
+/**
+ * An adaptive radix tree dictionary: nodes branch on one byte through child
+ * blocks of 4, 16, 48 or 256 entries, and single child paths are compressed
+ * into the node below them.
+ */
+#include "AdaptiveRadixTree.hpp"
+#include "TrieStats.hpp"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+const unsigned int AdaptiveRadixTree::NIL;
+
+/* Returns the calling thread's stack of nodes left to visit. Every search
+ * empties it before returning, so its memory is reused from one query to the
+ * next.
+ */
+static vector<pair<unsigned int, unsigned int>>& threadStack() {
+    thread_local vector<pair<unsigned int, unsigned int>> stack;
+    return stack;
+}
+
+/* Constructor.
+ * @param k Number of completions we need. Max size of heap.
+ * @param tree Tree whose word pool holds the ids
+ */
+AdaptiveRadixTree::Search::Search(unsigned int k,
+                                  const AdaptiveRadixTree* tree)
+    : numCompletions(k), threshold(0), pq(IdComp(tree)), stack(threadStack()) {
+    stack.clear();
+}
+
+/* Constructor.
+ * Initializes an empty tree.
+ */
+AdaptiveRadixTree::AdaptiveRadixTree() : root(NIL) { wordStarts.push_back(0); }
+
+/* Inserts a word into the tree with a given frequency. Walks down matching
+ * the compressed paths, and either ends the word at the node it stops in,
+ * splits a path it leaves part way or hangs a new leaf from a node.
+ * @param word Word to insert into the tree
+ * @param freq Frequency of the word
+ * @return True if we successfully inserted. Otherwise, false.
+ */
+bool AdaptiveRadixTree::insert(string_view word, unsigned int freq) {
+    if (word.empty()) {
+        return false;
+    }
+    if (root == NIL) {
+        root = newLeaf(word, 0, freq);
+        return true;
+    }
+
+    // new nodes may grow the arena, so nodes are looked up by index only
+    insertPath.clear();
+    unsigned int curr = root;
+    unsigned int parent = NIL;
+    unsigned char parentKey = 0;
+    unsigned int depth = 0;  // bytes of the word above curr
+    while (true) {
+        insertPath.push_back(curr);
+        unsigned int pathLength = nodes[curr].pathLength;
+        const char* path =
+            wordPool.data() + wordStarts[nodes[curr].pathWord] + depth;
+        unsigned int limit =
+            std::min<size_t>(pathLength, word.length() - depth);
+        unsigned int matched = 0;
+        while (matched < limit && path[matched] == word[depth + matched]) {
+            matched++;
+        }
+
+        if (matched < pathLength) {
+            // the word leaves the path part way: the matched part moves into
+            // a new node above, branching to the old node and the word
+            unsigned char oldKey = path[matched];
+            unsigned int split = nodes.size();
+            nodes.push_back(ArtNode{nodes[curr].maxFreq, 0, NIL,
+                                    nodes[curr].pathWord, matched, NIL, 0,
+                                    NODE4});
+            nodes[curr].pathLength -= matched + 1;
+            addChild(split, oldKey, curr);
+            if (depth + matched == word.length()) {
+                nodes[split].wordId = addWord(word);
+                nodes[split].freq = freq;
+            } else {
+                unsigned int leaf = newLeaf(word, depth + matched + 1, freq);
+                addChild(split, word[depth + matched], leaf);
+            }
+            if (parent == NIL) {
+                root = split;
+            } else {
+                setChild(parent, parentKey, split);
+            }
+            insertPath.back() = split;
+            break;
+        }
+
+        depth += pathLength;
+        if (depth == word.length()) {  // the word ends at this node
+            if (nodes[curr].wordId != NIL) {
+                return false;  // duplicate word
+            }
+            nodes[curr].wordId = addWord(word);
+            nodes[curr].freq = freq;
+            break;
+        }
+        unsigned char key = word[depth];
+        unsigned int child = findChild(nodes[curr], key);
+        if (child == NIL) {
+            unsigned int leaf = newLeaf(word, depth + 1, freq);
+            addChild(curr, key, leaf);
+            break;
+        }
+        parent = curr;
+        parentKey = key;
+        curr = child;
+        depth++;
+    }
+
+    // update maxFreq of every node on the way
+    for (unsigned int step : insertPath) {
+        nodes[step].maxFreq = std::max(nodes[step].maxFreq, freq);
+    }
+    return true;
+}
+
+/* Inserts a whole set of words at once, in sorted order so each node is
+ * filled while it is still in cache. Empty and duplicate words are skipped
+ * and the first duplicate wins.
+ * @param entries (word, freq) pairs to insert
+ * @return Number of words inserted
+ */
+unsigned int AdaptiveRadixTree::bulkInsert(vector<entry> entries) {
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const entry& a, const entry& b) {
+                         return a.first < b.first;
+                     });
+    unsigned int inserted = 0;
+    for (const entry& e : entries) {
+        inserted += insert(e.first, e.second);
+    }
+    return inserted;
+}
+
+/* Finds a query word in the tree.
+ * @param word Query word to find in tree
+ * @return True if we found the word. False otherwise.
+ */
+bool AdaptiveRadixTree::find(string word) const {
+    TRIE_STAT_QUERY();
+    unsigned int curr = root;
+    unsigned int depth = 0;
+    while (curr != NIL && !word.empty()) {
+        const ArtNode& node = nodes[curr];
+        if (word.length() - depth < node.pathLength ||
+            memcmp(wordPool.data() + wordStarts[node.pathWord] + depth,
+                   word.data() + depth, node.pathLength) != 0) {
+            return false;
+        }
+        depth += node.pathLength;
+        if (depth == word.length()) {
+            return node.wordId != NIL;
+        }
+        curr = findChild(node, word[depth]);
+        depth++;
+        TRIE_STAT_ADD(WALK_NODES, 1);
+    }
+    return false;
+}
+
+/* Finds up to numCompletions of most frequent completions of a prefix. Walks
+ * to the node whose subtree holds the words with the prefix, then visits the
+ * subtree in alphabetical order, skipping nodes whose maxFreq can not beat
+ * the heap.
+ * @param prefix Prefix to complete
+ * @param numCompletions Number of words to find
+ * @return vector of numCompletions words with most frequency with prefix
+ */
+vector<string> AdaptiveRadixTree::predictCompletions(
+    string prefix, unsigned int numCompletions) const {
+    TRIE_STAT_QUERY();
+
+    // find the node the prefix ends in, which may be part way down its path
+    unsigned int curr = root;
+    unsigned int depth = 0;
+    bool exact = false;  // whether the prefix ends right at curr's end
+    while (curr != NIL) {
+        const ArtNode& node = nodes[curr];
+        unsigned int length =
+            std::min<size_t>(node.pathLength, prefix.length() - depth);
+        if (memcmp(wordPool.data() + wordStarts[node.pathWord] + depth,
+                   prefix.data() + depth, length) != 0) {
+            return vector<string>();
+        }
+        depth += length;
+        if (depth == prefix.length()) {
+            exact = length == node.pathLength;
+            break;
+        }
+        curr = findChild(node, prefix[depth]);
+        depth++;
+        TRIE_STAT_ADD(WALK_NODES, 1);
+    }
+    if (curr == NIL || numCompletions == 0) {
+        return vector<string>();
+    }
+
+    // the prefix itself is offered whatever its maxFreq, like in
+    // DictionaryTrie. A node the prefix ends inside is a completion instead.
+    Search search(numCompletions, this);
+    if (exact) {
+        const ArtNode& start = nodes[curr];
+        if (start.wordId != NIL) {
+            offerWord(search, start);
+        }
+        pushChildren(search, start, 0);
+    } else {
+        search.stack.push_back(make_pair(curr, 0));
+    }
+    while (!search.stack.empty()) {
+        const ArtNode& node = nodes[search.stack.back().first];
+        search.stack.pop_back();
+        if (node.maxFreq <= search.threshold) {
+            TRIE_STAT_ADD(SUBTREES_PRUNED, 1);
+            continue;  // nothing in the subtree can get in
+        }
+        TRIE_STAT_ADD(NODES_VISITED, 1);
+        if (node.wordId != NIL) {
+            offerWord(search, node);
+        }
+        pushChildren(search, node, 0);
+    }
+    return takeResults(search);
+}
+
+/* Finds up to numCompletions of most frequent words matching a pattern that
+ * may contain wild cards. Underscores take every child, other letters only
+ * their own.
+ * @param pattern Pattern with wild card to match to
+ * @param numCompletions Number of words to find
+ * @return vector of numCompletions words matching pattern with most freq
+ */
+vector<string> AdaptiveRadixTree::predictUnderscores(
+    string pattern, unsigned int numCompletions) const {
+    TRIE_STAT_QUERY();
+    if (root == NIL || pattern.empty() || numCompletions == 0) {
+        return vector<string>();
+    }
+    Search search(numCompletions, this);
+    search.stack.push_back(make_pair(root, 0));
+    while (!search.stack.empty()) {
+        const ArtNode& node = nodes[search.stack.back().first];
+        unsigned int depth = search.stack.back().second;
+        search.stack.pop_back();
+        if ((search.pq.size() == search.numCompletions &&
+             node.maxFreq <= search.threshold) ||
+            depth + node.pathLength > pattern.length()) {
+            TRIE_STAT_ADD(SUBTREES_PRUNED, 1);
+            continue;
+        }
+        TRIE_STAT_ADD(NODES_VISITED, 1);
+
+        // match the path against the pattern
+        const char* path = wordPool.data() + wordStarts[node.pathWord];
+        unsigned int end = depth + node.pathLength;
+        while (depth < end &&
+               (pattern[depth] == '_' || pattern[depth] == path[depth])) {
+            depth++;
+        }
+        if (depth < end) {
+            continue;
+        }
+
+        if (depth == pattern.length()) {  // end of pattern
+            if (node.wordId != NIL) {
+                offerWord(search, node);
+            }
+        } else if (pattern[depth] == '_') {
+            pushChildren(search, node, depth + 1);
+        } else {
+            unsigned int child = findChild(node, pattern[depth]);
+            if (child != NIL) {
+                search.stack.push_back(make_pair(child, depth + 1));
+            }
+        }
+    }
+    return takeResults(search);
+}
+
+/* Returns the number of words in the tree. */
+unsigned int AdaptiveRadixTree::wordCount() const {
+    return wordStarts.size() - 1;
+}
+
+/* Returns the number of nodes in the tree. */
+unsigned int AdaptiveRadixTree::numNodes() const { return nodes.size(); }
+
+/* Returns the number of bytes reserved for the nodes, child blocks and word
+ * pool.
+ */
+size_t AdaptiveRadixTree::memoryUsage() const {
+    size_t bytes = nodes.capacity() * sizeof(ArtNode) +
+                   blocks4.capacity() * sizeof(Node4) +
+                   blocks16.capacity() * sizeof(Node16) +
+                   blocks48.capacity() * sizeof(Node48) +
+                   blocks256.capacity() * sizeof(Node256) +
+                   wordPool.capacity() +
+                   wordStarts.capacity() * sizeof(unsigned int);
+    for (const vector<unsigned int>& blocks : freeBlocks) {
+        bytes += blocks.capacity() * sizeof(unsigned int);
+    }
+    return bytes;
+}
+
+/* Returns the word with the given id, as a view into the word pool. */
+string_view AdaptiveRadixTree::wordAt(unsigned int id) const {
+    return string_view(wordPool.data() + wordStarts[id],
+                       wordStarts[id + 1] - wordStarts[id]);
+}
+
+/* Adds a word to the word pool.
+ * @param word Word to add
+ * @return Id of the word
+ */
+unsigned int AdaptiveRadixTree::addWord(string_view word) {
+    wordPool.append(word.data(), word.size());
+    wordStarts.push_back(wordPool.size());
+    return wordStarts.size() - 2;
+}
+
+/* Adds a node ending a word, holding the rest of the word as its path.
+ * @param word Word the node ends
+ * @param depth Number of bytes of the word above the node
+ * @param freq Frequency of the word
+ * @return Index of the new node
+ */
+unsigned int AdaptiveRadixTree::newLeaf(string_view word, unsigned int depth,
+                                        unsigned int freq) {
+    unsigned int id = addWord(word);
+    nodes.push_back(ArtNode{freq, freq, id, id,
+                            (unsigned int)word.length() - depth, NIL, 0,
+                            NODE4});
+    return nodes.size() - 1;
+}
+
+/* Hands out an empty child block of a kind, reusing an outgrown one.
+ * @param type Kind of block
+ * @return Index of the block
+ */
+unsigned int AdaptiveRadixTree::newBlock(NodeType type) {
+    unsigned int block;
+    if (!freeBlocks[type].empty()) {
+        block = freeBlocks[type].back();
+        freeBlocks[type].pop_back();
+    } else {
+        switch (type) {
+            case NODE4:
+                block = blocks4.size();
+                blocks4.emplace_back();
+                break;
+            case NODE16:
+                block = blocks16.size();
+                blocks16.emplace_back();
+                break;
+            case NODE48:
+                block = blocks48.size();
+                blocks48.emplace_back();
+                break;
+            default:
+                block = blocks256.size();
+                blocks256.emplace_back();
+        }
+    }
+
+    // only Node48 and Node256 are read without a count
+    if (type == NODE48) {
+        memset(blocks48[block].slots, 0, sizeof(blocks48[block].slots));
+    } else if (type == NODE256) {
+        std::fill_n(blocks256[block].children, 256, NIL);
+    }
+    return block;
+}
+
+/* Finds the child of a node for a byte. Node16 compares all 16 keys at once
+ * with SSE2 where the target has it.
+ * @param node Node to look in
+ * @param key Byte of the child
+ * @return Index of the child, or NIL
+ */
+unsigned int AdaptiveRadixTree::findChild(const ArtNode& node,
+                                          unsigned char key) const {
+    if (node.count == 0) {
+        return NIL;
+    }
+    switch (node.type) {
+        case NODE4: {
+            const Node4& block = blocks4[node.children];
+            for (unsigned int i = 0; i < node.count; i++) {
+                if (block.keys[i] == key) {
+                    return block.children[i];
+                }
+            }
+            return NIL;
+        }
+        case NODE16: {
+            const Node16& block = blocks16[node.children];
+#if defined(__SSE2__)
+            __m128i keys = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(block.keys));
+            unsigned int mask = _mm_movemask_epi8(
+                _mm_cmpeq_epi8(keys, _mm_set1_epi8(key)));
+            mask &= (1U << node.count) - 1;
+            return mask == 0 ? NIL : block.children[__builtin_ctz(mask)];
+#else
+            for (unsigned int i = 0; i < node.count; i++) {
+                if (block.keys[i] == key) {
+                    return block.children[i];
+                }
+            }
+            return NIL;
+#endif
+        }
+        case NODE48: {
+            const Node48& block = blocks48[node.children];
+            unsigned char slot = block.slots[key];
+            return slot == 0 ? NIL : block.children[slot - 1];
+        }
+        default:
+            return blocks256[node.children].children[key];
+    }
+}
+
+/* Adds a child to a node, moving it to a larger block if it is full. Keys of
+ * Node4 and Node16 are kept sorted in char order, so their children can be
+ * visited in order.
+ * @param curr Index of the node
+ * @param key Byte of the child, not already a child of the node
+ * @param child Index of the child
+ */
+void AdaptiveRadixTree::addChild(unsigned int curr, unsigned char key,
+                                 unsigned int child) {
+    ArtNode& node = nodes[curr];
+    if (node.count == 0 && node.children == NIL) {
+        node.type = NODE4;
+        node.children = newBlock(NODE4);
+    }
+    unsigned int count = node.count;
+
+    if (node.type == NODE4 && count == 4) {  // grow to Node16
+        unsigned int block = newBlock(NODE16);
+        memcpy(blocks16[block].keys, blocks4[node.children].keys, 4);
+        memcpy(blocks16[block].children, blocks4[node.children].children,
+               4 * sizeof(unsigned int));
+        freeBlocks[NODE4].push_back(node.children);
+        node.type = NODE16;
+        node.children = block;
+    } else if (node.type == NODE16 && count == 16) {  // grow to Node48
+        unsigned int block = newBlock(NODE48);
+        const Node16& old = blocks16[node.children];
+        for (unsigned int i = 0; i < count; i++) {
+            blocks48[block].slots[old.keys[i]] = i + 1;
+            blocks48[block].children[i] = old.children[i];
+        }
+        freeBlocks[NODE16].push_back(node.children);
+        node.type = NODE48;
+        node.children = block;
+    } else if (node.type == NODE48 && count == 48) {  // grow to Node256
+        unsigned int block = newBlock(NODE256);
+        const Node48& old = blocks48[node.children];
+        for (unsigned int b = 0; b < 256; b++) {
+            if (old.slots[b] != 0) {
+                blocks256[block].children[b] = old.children[old.slots[b] - 1];
+            }
+        }
+        freeBlocks[NODE48].push_back(node.children);
+        node.type = NODE256;
+        node.children = block;
+    }
+
+    if (node.type == NODE4 || node.type == NODE16) {
+        unsigned char* keys = node.type == NODE4
+                                  ? blocks4[node.children].keys
+                                  : blocks16[node.children].keys;
+        unsigned int* children = node.type == NODE4
+                                     ? blocks4[node.children].children
+                                     : blocks16[node.children].children;
+        unsigned int i = count;
+        while (i > 0 && (char)keys[i - 1] > (char)key) {  // shift bigger up
+            keys[i] = keys[i - 1];
+            children[i] = children[i - 1];
+            i--;
+        }
+        keys[i] = key;
+        children[i] = child;
+    } else if (node.type == NODE48) {
+        blocks48[node.children].slots[key] = count + 1;
+        blocks48[node.children].children[count] = child;
+    } else {
+        blocks256[node.children].children[key] = child;
+    }
+    node.count++;
+}
+
+/* Replaces the child of a node for a byte.
+ * @param curr Index of the node
+ * @param key Byte of the child
+ * @param child Index of the new child
+ */
+void AdaptiveRadixTree::setChild(unsigned int curr, unsigned char key,
+                                 unsigned int child) {
+    const ArtNode& node = nodes[curr];
+    switch (node.type) {
+        case NODE4:
+            for (unsigned int i = 0; i < node.count; i++) {
+                if (blocks4[node.children].keys[i] == key) {
+                    blocks4[node.children].children[i] = child;
+                }
+            }
+            break;
+        case NODE16:
+            for (unsigned int i = 0; i < node.count; i++) {
+                if (blocks16[node.children].keys[i] == key) {
+                    blocks16[node.children].children[i] = child;
+                }
+            }
+            break;
+        case NODE48: {
+            Node48& block = blocks48[node.children];
+            block.children[block.slots[key] - 1] = child;
+            break;
+        }
+        default:
+            blocks256[node.children].children[key] = child;
+    }
+}
+
+/* Pushes the children of a node onto a search's stack, last byte first, so
+ * they are visited in alphabetical order. Bytes are ordered as char, like the
+ * labels of DictionaryTrie, so a tie cut off by a full heap is the same one.
+ * @param search Search to push onto
+ * @param node Node whose children to push
+ * @param depth Number of bytes above the children
+ */
+void AdaptiveRadixTree::pushChildren(Search& search, const ArtNode& node,
+                                     unsigned int depth) const {
+    if (node.count == 0) {
+        return;
+    }
+    switch (node.type) {
+        case NODE4:
+            for (unsigned int i = node.count; i > 0; i--) {
+                search.stack.push_back(
+                    make_pair(blocks4[node.children].children[i - 1], depth));
+            }
+            break;
+        case NODE16:
+            for (unsigned int i = node.count; i > 0; i--) {
+                search.stack.push_back(
+                    make_pair(blocks16[node.children].children[i - 1], depth));
+            }
+            break;
+        case NODE48: {
+            const Node48& block = blocks48[node.children];
+            for (int c = CHAR_MAX; c >= CHAR_MIN; c--) {
+                unsigned char b = c;
+                if (block.slots[b] != 0) {
+                    search.stack.push_back(
+                        make_pair(block.children[block.slots[b] - 1], depth));
+                }
+            }
+            break;
+        }
+        default: {
+            const Node256& block = blocks256[node.children];
+            for (int c = CHAR_MAX; c >= CHAR_MIN; c--) {
+                unsigned char b = c;
+                if (block.children[b] != NIL) {
+                    search.stack.push_back(make_pair(block.children[b], depth));
+                }
+            }
+        }
+    }
+}
+
+/* Offers a word node to a search. The word goes in the heap if the heap is
+ * not full yet or the word beats the least frequent word in it.
+ * @param search State of the search
+ * @param node Word node to offer
+ */
+void AdaptiveRadixTree::offerWord(Search& search, const ArtNode& node) {
+    if (search.pq.size() == search.numCompletions) {
+        // words come in alphabetical order, so a tie never gets in
+        if (node.freq > search.pq.top().first) {
+            search.pq.pop();
+            search.pq.push(make_pair(node.freq, node.wordId));
+            TRIE_STAT_ADD(HEAP_POPS, 1);
+            TRIE_STAT_ADD(HEAP_PUSHES, 1);
+            search.threshold = search.pq.top().first;
+        }
+    } else {
+        search.pq.push(make_pair(node.freq, node.wordId));
+        TRIE_STAT_ADD(HEAP_PUSHES, 1);
+        if (search.pq.size() == search.numCompletions) {
+            search.threshold = search.pq.top().first;
+        }
+    }
+}
+
+/* Moves the words left in a search out of its heap.
+ * @param search State of a finished search
+ * @return vector of words, most frequent first
+ */
+vector<string> AdaptiveRadixTree::takeResults(Search& search) const {
+    vector<string> words(search.pq.size());
+    for (unsigned int i = words.size(); i > 0; i--) {  // most frequent last
+        words[i - 1] = string(wordAt(search.pq.top().second));
+        search.pq.pop();
+    }
+    TRIE_STAT_ADD(HEAP_POPS, words.size());
+    return words;
+}
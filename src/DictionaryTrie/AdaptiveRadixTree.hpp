@@ -0,0 +1,256 @@
+/**
+ * The header of an adaptive radix tree: a dictionary backend whose inner
+ * nodes grow from 4 to 16, 48 and 256 children as they fill, with paths of
+ * single child nodes compressed into the node below them.
+ */
+#ifndef ADAPTIVE_RADIX_TREE_HPP
+#define ADAPTIVE_RADIX_TREE_HPP
+
+#include <queue>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "Dictionary.hpp"
+
+using namespace std;
+
+/**
+ * The class for a dictionary implemented as an adaptive radix tree. Each
+ * node branches on one byte of the words, through a child block sized to
+ * how many children it has, so sparse nodes stay small and the dense ones
+ * near the root find a child with one lookup. Every node holds the most
+ * frequent word of its subtree, so completions skip subtrees that can not
+ * get in. Words of the same prefix come out of a walk in alphabetical
+ * order, which gives the same results as DictionaryTrie.
+ */
+class AdaptiveRadixTree final : public Dictionary {
+  private:
+    /* The kinds of child block, by how many children they have room for. */
+    enum NodeType : unsigned char { NODE4, NODE16, NODE48, NODE256 };
+
+    /* The class for a node. The node first matches its compressed path, then
+     * ends a word or branches on the next byte. The path is stored in the
+     * word pool, inside a word that passes through the node.
+     */
+    class ArtNode {
+      public:
+        unsigned int maxFreq;     // max frequency in the subtree
+        unsigned int freq;        // frequency of the word ending here
+        unsigned int wordId;      // id of the word ending here, or NIL
+        unsigned int pathWord;    // id of a word holding the path
+        unsigned int pathLength;  // number of bytes in the path
+        unsigned int children;    // index of the child block, or NIL
+        unsigned short count;     // number of children
+        NodeType type;            // kind of the child block
+    };
+
+    /* Child blocks. Node4 and Node16 keep their keys sorted as char, Node48
+     * maps each byte to a slot plus 1 (0 for none) and Node256 holds a child
+     * per byte.
+     */
+    class Node4 {
+      public:
+        unsigned char keys[4];     // bytes of the children, sorted
+        unsigned int children[4];  // index of each child
+    };
+    class Node16 {
+      public:
+        unsigned char keys[16];     // bytes of the children, sorted
+        unsigned int children[16];  // index of each child
+    };
+    class Node48 {
+      public:
+        unsigned char slots[256];   // slot + 1 of each byte, or 0
+        unsigned int children[48];  // index of each child
+    };
+    class Node256 {
+      public:
+        unsigned int children[256];  // index of the child of each byte
+    };
+
+    /* Comparator class to sort (freq, word id) pairs in the priority queue,
+     * looking the words up in the word pool to break ties.
+     */
+    class IdComp {
+      public:
+        const AdaptiveRadixTree* tree;  // tree whose word pool holds the ids
+
+        /* Constructor.
+         * @param t Tree whose word pool holds the ids
+         */
+        explicit IdComp(const AdaptiveRadixTree* t) : tree(t) {}
+
+        /* Compare function. In order of first in pair and reverse
+         * alphabetical order of the words if tied.
+         * @param a First pair to compare with second pair
+         * @param b Second pair to compare with first pair
+         * @return True if a > b, false if a < b.
+         */
+        bool operator()(const idPairing& a, const idPairing& b) const {
+            if (a.first == b.first) {
+                return tree->wordAt(a.second) < tree->wordAt(b.second);
+            }
+            return a.first > b.first;
+        }
+    };
+
+    /* State of one top completions search: the heap of the best words found
+     * so far, the frequency a word must beat to get in, and the nodes left
+     * to visit with the number of bytes above each.
+     */
+    class Search {
+      public:
+        const unsigned int numCompletions;  // number of completions we need
+        unsigned int threshold;  // min frequency in the heap once it is full
+        std::priority_queue<idPairing, vector<idPairing>, IdComp>
+            pq;  // (freq, word id) of the best words so far
+        vector<pair<unsigned int, unsigned int>>&
+            stack;  // (node, depth) left to visit
+
+        /* Constructor.
+         * @param k Number of completions we need. Max size of heap.
+         * @param tree Tree whose word pool holds the ids
+         */
+        Search(unsigned int k, const AdaptiveRadixTree* tree);
+    };
+
+    static const unsigned int NIL = 0xFFFFFFFF;  // index of a missing node
+
+    vector<ArtNode> nodes;  // every node of the tree
+    unsigned int root;      // index of the root node, or NIL if empty
+    vector<unsigned int> insertPath;  // nodes walked by the last insert
+
+    vector<Node4> blocks4;      // child blocks of each kind
+    vector<Node16> blocks16;
+    vector<Node48> blocks48;
+    vector<Node256> blocks256;
+    vector<unsigned int> freeBlocks[4];  // outgrown blocks of each kind
+
+    string wordPool;                  // every word, stored back to back
+    vector<unsigned int> wordStarts;  // offset of each word id in wordPool
+
+    /* Returns the word with the given id, as a view into the word pool. */
+    string_view wordAt(unsigned int id) const;
+
+    /* Adds a word to the word pool.
+     * @param word Word to add
+     * @return Id of the word
+     */
+    unsigned int addWord(string_view word);
+
+    /* Adds a node ending a word, holding the rest of the word as its path.
+     * @param word Word the node ends
+     * @param depth Number of bytes of the word above the node
+     * @param freq Frequency of the word
+     * @return Index of the new node
+     */
+    unsigned int newLeaf(string_view word, unsigned int depth,
+                         unsigned int freq);
+
+    /* Hands out an empty child block of a kind, reusing an outgrown one.
+     * @param type Kind of block
+     * @return Index of the block
+     */
+    unsigned int newBlock(NodeType type);
+
+    /* Finds the child of a node for a byte.
+     * @param node Node to look in
+     * @param key Byte of the child
+     * @return Index of the child, or NIL
+     */
+    unsigned int findChild(const ArtNode& node, unsigned char key) const;
+
+    /* Adds a child to a node, moving it to a larger block if it is full.
+     * @param curr Index of the node
+     * @param key Byte of the child, not already a child of the node
+     * @param child Index of the child
+     */
+    void addChild(unsigned int curr, unsigned char key, unsigned int child);
+
+    /* Replaces the child of a node for a byte.
+     * @param curr Index of the node
+     * @param key Byte of the child
+     * @param child Index of the new child
+     */
+    void setChild(unsigned int curr, unsigned char key, unsigned int child);
+
+    /* Pushes the children of a node onto a search's stack, last byte first,
+     * so they are visited in alphabetical order.
+     * @param search Search to push onto
+     * @param node Node whose children to push
+     * @param depth Number of bytes above the children
+     */
+    void pushChildren(Search& search, const ArtNode& node,
+                      unsigned int depth) const;
+
+    /* Offers a word node to a search. The word goes in the heap if the heap
+     * is not full yet or the word beats the least frequent word in it.
+     * @param search State of the search
+     * @param node Word node to offer
+     */
+    static void offerWord(Search& search, const ArtNode& node);
+
+    /* Moves the words left in a search out of its heap.
+     * @param search State of a finished search
+     * @return vector of words, most frequent first
+     */
+    vector<string> takeResults(Search& search) const;
+
+  public:
+    /* Constructor.
+     * Initializes an empty tree.
+     */
+    AdaptiveRadixTree();
+
+    /* Inserts a word into the tree with a given frequency.
+     * @param word Word to insert into the tree
+     * @param freq Frequency of the word
+     * @return True if we successfully inserted. Otherwise, false.
+     */
+    bool insert(string_view word, unsigned int freq) override;
+
+    /* Inserts a whole set of words at once, in sorted order so each node is
+     * filled while it is still in cache. Empty and duplicate words are
+     * skipped and the first duplicate wins.
+     * @param entries (word, freq) pairs to insert
+     * @return Number of words inserted
+     */
+    unsigned int bulkInsert(vector<entry> entries) override;
+
+    /* Finds a query word in the tree.
+     * @param word Query word to find in tree
+     * @return True if we found the word. False otherwise.
+     */
+    bool find(string word) const override;
+
+    /* Finds up to numCompletions of most frequent completions of a prefix.
+     * @param prefix Prefix to complete
+     * @param numCompletions Number of words to find
+     * @return vector of numCompletions words with most frequency with prefix
+     */
+    vector<string> predictCompletions(
+        string prefix, unsigned int numCompletions) const override;
+
+    /* Finds up to numCompletions of most frequent words matching a pattern
+     * that may contain wild cards.
+     * @param pattern Pattern with wild card to match to
+     * @param numCompletions Number of words to find
+     * @return vector of numCompletions words matching pattern with most freq
+     */
+    vector<string> predictUnderscores(
+        string pattern, unsigned int numCompletions) const override;
+
+    /* Returns the number of words in the tree. */
+    unsigned int wordCount() const override;
+
+    /* Returns the number of nodes in the tree. */
+    unsigned int numNodes() const override;
+
+    /* Returns the number of bytes reserved for the nodes, child blocks and
+     * word pool.
+     */
+    size_t memoryUsage() const override;
+};
+
+#endif  // ADAPTIVE_RADIX_TREE_HPP
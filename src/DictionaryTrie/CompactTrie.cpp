@@ -0,0 +1,410 @@
+/**
+ * A read only, path compressed copy of a dictionary trie. Runs of ternary trie
+ * nodes with a single child and no word are merged into one node holding a
+ * string segment.
+ */
+#include "CompactTrie.hpp"
+#include <algorithm>
+
+/* A pending step of the copy: copy the sibling tree at a trie node and hang
+ * it from a side of its parent, or finish the parent once the tree below it
+ * is copied.
+ */
+struct CopyStep {
+    unsigned int curr;    // trie node to copy, unused when finishing
+    unsigned int depth;   // number of letters above curr
+    unsigned int parent;  // copy the tree hangs from, or NIL for the root,
+                          // or when finishing, the copy to finish
+    char side;            // 'l', 'm' or 'r' for the child it becomes, or
+                          // 'f' to finish the parent
+};
+
+const unsigned int CompactTrie::NIL;
+const unsigned char CompactTrie::LENGTH_CAP;
+
+/* Constructor.
+ * Copies a finished dictionary trie. Later inserts into the trie are not seen
+ * by the copy.
+ * @param trie Trie to copy
+ */
+CompactTrie::CompactTrie(const DictionaryTrie& trie) {
+    // renumber the words in alphabetical order, so ties in frequency are
+    // broken by comparing ids. Ids of erased words are dropped.
+    vector<unsigned int> order;
+    order.reserve(trie.wordCount());
+    for (unsigned int curr = 0; curr < trie.nodeCount; curr++) {
+        if (trie.nodeData[curr].word) {
+            order.push_back(trie.nodeData[curr].wordId);
+        }
+    }
+    unsigned int count = order.size();
+    std::sort(order.begin(), order.end(),
+              [&trie](unsigned int a, unsigned int b) {
+                  return trie.compareWords(a, b) < 0;
+              });
+    vector<unsigned int> ids(trie.idCount());
+    wordStarts.reserve(count + 1);
+    wordStarts.push_back(0);
+    for (unsigned int rank = 0; rank < count; rank++) {
+        ids[order[rank]] = rank;
+        wordPool.append(trie.wordAt(order[rank]));
+        wordStarts.push_back(wordPool.size());
+    }
+    freqs.resize(count);
+
+    root = copyTrie(trie, ids);
+    nodes.shrink_to_fit();
+}
+
+/* Finds a query word in the trie.
+ * @param word Query word to find in trie
+ * @return True if we found the word. False otherwise.
+ */
+bool CompactTrie::find(string word) const {
+    unsigned int index = 0;
+    unsigned int curr = root;
+    while (curr != NIL && index < word.length()) {
+        const CompactNode& node = nodes[curr];
+        if (word[index] < node.data) {  // go left
+            curr = node.left;
+        } else if (word[index] > node.data) {  // go right
+            curr = node.right;
+        } else {  // match the rest of the segment, then go down middle
+            for (unsigned int i = 1; i < node.length; i++) {
+                if (index + i >= word.length() ||
+                    word[index + i] != wordPool[node.label + i]) {
+                    return false;
+                }
+            }
+            index += node.length;
+            if (index == word.length()) {
+                return node.wordId != NIL;
+            }
+            curr = node.middle;
+        }
+    }
+    return false;
+}
+
+/* Finds up to numCompletions of most frequent completions given a prefix, the
+ * same as DictionaryTrie::predictCompletions.
+ * @param prefix Prefix to complete
+ * @param numCompletions Number of words to find
+ * @return vector of numCompletions words with most frequency with prefix
+ */
+vector<string> CompactTrie::predictCompletions(
+    string prefix, unsigned int numCompletions) const {
+    Search search(numCompletions);
+    if (numCompletions == 0) {
+        return vector<string>();
+    }
+    if (prefix.empty()) {
+        completeSubtree(search, root);
+        return takeResults(search);
+    }
+
+    // find the node whose segment the prefix ends in
+    unsigned int index = 0;
+    unsigned int curr = root;
+    while (curr != NIL) {
+        const CompactNode& node = nodes[curr];
+        if (prefix[index] < node.data) {  // go left
+            curr = node.left;
+        } else if (prefix[index] > node.data) {  // go right
+            curr = node.right;
+        } else {
+            for (unsigned int i = 1; i < node.length; i++) {
+                if (index + i == prefix.length()) {
+                    break;  // prefix ends inside the segment
+                }
+                if (prefix[index + i] != wordPool[node.label + i]) {
+                    return vector<string>();
+                }
+            }
+            index += node.length;
+            if (index >= prefix.length()) {
+                // every word through this segment completes the prefix
+                if (node.wordId != NIL) {
+                    offerWord(search, node.wordId);
+                }
+                completeSubtree(search, node.middle);
+                return takeResults(search);
+            }
+            curr = node.middle;
+        }
+    }
+    return vector<string>();
+}
+
+/* Finds up to numCompletions of most frequent words matching a pattern with
+ * wild cards, the same as DictionaryTrie::predictUnderscores.
+ * @param pattern Pattern with wild card to match to
+ * @param numCompletions Number of words to find
+ * @return vector of numCompletions words matching pattern with most freq
+ */
+vector<string> CompactTrie::predictUnderscores(
+    string pattern, unsigned int numCompletions) const {
+    Search search(numCompletions);
+    if (numCompletions == 0 || pattern.empty()) {
+        return vector<string>();
+    }
+    searchPattern(pattern, search);
+    return takeResults(search);
+}
+
+/* Returns the number of words in the trie. */
+unsigned int CompactTrie::wordCount() const { return freqs.size(); }
+
+/* Returns the number of nodes in the trie. */
+unsigned int CompactTrie::numNodes() const { return nodes.size(); }
+
+/* Returns the number of bytes reserved for the nodes, word pool and
+ * frequencies.
+ */
+size_t CompactTrie::memoryUsage() const {
+    return nodes.capacity() * sizeof(CompactNode) + wordPool.capacity() +
+           wordStarts.capacity() * sizeof(unsigned int) +
+           freqs.capacity() * sizeof(unsigned int);
+}
+
+/* Helper method for the constructor to copy the ternary trie, merging single
+ * child chains. Takes the nodes off a work list, so deep tries can not
+ * overflow the call stack.
+ * @param trie Trie being copied
+ * @param ids New id of every word id of the trie
+ * @return Index of the root of the copy, or NIL if the trie is empty
+ */
+unsigned int CompactTrie::copyTrie(const DictionaryTrie& trie,
+                                   const vector<unsigned int>& ids) {
+    const DictionaryTrie::TrieNode* trieNodes = trie.nodeData;
+    unsigned int top = NIL;
+    vector<CopyStep> steps;
+    if (trie.root != NIL) {
+        steps.push_back({trie.root, 0, NIL, 'm'});
+    }
+    while (!steps.empty()) {
+        CopyStep step = steps.back();
+        steps.pop_back();
+
+        if (step.side == 'f') {
+            // the segment lies in its own word, or in a word passing through
+            // the middle child right after it
+            CompactNode& node = nodes[step.parent];
+            if (node.wordId != NIL) {
+                node.label = wordStarts[node.wordId] + step.depth;
+            } else if (node.middle != NIL) {
+                node.label = nodes[node.middle].label - node.length;
+            }
+            continue;
+        }
+
+        unsigned int index = nodes.size();
+        nodes.emplace_back();
+        if (step.parent == NIL) {
+            top = index;
+        } else if (step.side == 'l') {
+            nodes[step.parent].left = index;
+        } else if (step.side == 'r') {
+            nodes[step.parent].right = index;
+        } else {
+            nodes[step.parent].middle = index;
+        }
+
+        // follow middle children with no siblings until a word ends
+        unsigned int curr = step.curr;
+        unsigned int last = curr;
+        unsigned int length = 1;
+        while (!trieNodes[last].word && trieNodes[last].middle != NIL &&
+               length < LENGTH_CAP) {
+            const DictionaryTrie::TrieNode& next =
+                trieNodes[trieNodes[last].middle];
+            if (next.left != NIL || next.right != NIL) {
+                break;
+            }
+            last = trieNodes[last].middle;
+            length++;
+        }
+
+        CompactNode& node = nodes[index];
+        node.left = NIL;
+        node.right = NIL;
+        node.middle = NIL;
+        node.maxFreq = trieNodes[curr].maxFreq;
+        node.wordId = NIL;
+        node.label = 0;
+        node.data = trieNodes[curr].data;
+        node.length = length;
+        node.minLength = trieNodes[curr].minLength;
+        node.maxLength = trieNodes[curr].maxLength;
+        if (trieNodes[last].word) {
+            node.wordId = ids[trieNodes[last].wordId];
+            freqs[node.wordId] = trieNodes[last].freq;
+        }
+
+        // copy the left tree, the right tree and the tree below, then finish
+        // this node, so push them last first
+        steps.push_back({curr, step.depth, index, 'f'});
+        if (trieNodes[last].middle != NIL) {
+            steps.push_back(
+                {trieNodes[last].middle, step.depth + length, index, 'm'});
+        }
+        if (trieNodes[curr].right != NIL) {
+            steps.push_back({trieNodes[curr].right, step.depth, index, 'r'});
+        }
+        if (trieNodes[curr].left != NIL) {
+            steps.push_back({trieNodes[curr].left, step.depth, index, 'l'});
+        }
+    }
+    return top;
+}
+
+/* Returns the word with the given id. */
+string_view CompactTrie::wordAt(unsigned int id) const {
+    return string_view(wordPool.data() + wordStarts[id],
+                       wordStarts[id + 1] - wordStarts[id]);
+}
+
+/* Returns true if a word can end a given number of letters from the start of a
+ * node's segment.
+ */
+bool CompactTrie::mayHaveLength(const CompactNode& node,
+                                unsigned int remaining) {
+    return remaining >= node.minLength &&
+           (node.maxLength == LENGTH_CAP || remaining <= node.maxLength);
+}
+
+/* Offers a word to a search. The word goes in the heap if the heap is not full
+ * yet or the word beats the least frequent word in it.
+ * @param search State of the search
+ * @param id Id of the word to offer
+ */
+void CompactTrie::offerWord(Search& search, unsigned int id) const {
+    if (search.pq.size() == search.numCompletions) {
+        if (freqs[id] > search.pq.top().first) {
+            search.pq.pop();
+            search.pq.push(make_pair(freqs[id], id));
+            search.threshold = search.pq.top().first;
+        }
+    } else {
+        search.pq.push(make_pair(freqs[id], id));
+        if (search.pq.size() == search.numCompletions) {
+            search.threshold = search.pq.top().first;
+        }
+    }
+}
+
+/* Moves the words left in a search out of its heap.
+ * @param search State of a finished search
+ * @return the words, most frequent first
+ */
+vector<string> CompactTrie::takeResults(Search& search) const {
+    vector<string> words(search.pq.size());
+    for (unsigned int i = words.size(); i > 0; i--) {  // most frequent last
+        words[i - 1] = string(wordAt(search.pq.top().second));
+        search.pq.pop();
+    }
+    return words;
+}
+
+/* Helper method for predictCompletions to offer the words of a subtree in
+ * alphabetical order, skipping subtrees with nothing frequent enough. Keeps
+ * its steps on an explicit stack, like DictionaryTrie.
+ * @param search State of this search
+ * @param curr Index of the root of the subtree
+ */
+void CompactTrie::completeSubtree(Search& search, unsigned int curr) const {
+    StepStack stack(DictionaryTrie::threadSteps());
+    stack.push(curr, 0, 0, false);
+    while (stack.size() > 0) {
+        Step step = stack.pop();
+        unsigned int next = step.node;
+        if (step.visited) {  // the words left of this one are done
+            const CompactNode& node = nodes[next];
+            if (node.wordId != NIL) {
+                offerWord(search, node.wordId);
+            }
+            next = node.middle;
+        }
+
+        // take the left subtree, the word, the middle then the right
+        while (next != NIL && nodes[next].maxFreq > search.threshold) {
+            const CompactNode& node = nodes[next];
+            if (node.right != NIL) {
+                stack.push(node.right, 0, 0, false);
+            }
+            if (node.left != NIL &&
+                nodes[node.left].maxFreq > search.threshold) {
+                stack.push(next, 0, 0, true);
+                next = node.left;
+            } else {  // nothing frequent enough to the left
+                if (node.wordId != NIL) {
+                    offerWord(search, node.wordId);
+                }
+                next = node.middle;
+            }
+        }
+    }
+}
+
+/* Helper method for predictUnderscores to offer the words matching a pattern
+ * in alphabetical order. Keeps its steps on an explicit stack, like
+ * DictionaryTrie.
+ * @param pattern Pattern that the word should match
+ * @param search State of this search
+ */
+void CompactTrie::searchPattern(string_view pattern, Search& search) const {
+    StepStack stack(DictionaryTrie::threadSteps());
+    stack.push(root, 0, 0, false);
+    while (stack.size() > 0) {
+        Step step = stack.pop();
+        if (step.visited) {  // the matches left of this one are done
+            offerWord(search, nodes[step.node].wordId);
+            continue;
+        }
+
+        // the left subtree, the word or the middle, then the right, so push
+        // them last first. Siblings match the same letter of the pattern.
+        unsigned int index = step.depth;
+        unsigned int next = step.node;
+        while (next != NIL) {
+            const CompactNode& node = nodes[next];
+
+            // prune subtrees with nothing frequent enough once the heap is
+            // full, or with no word as long as the pattern
+            if ((search.pq.size() == search.numCompletions &&
+                 node.maxFreq <= search.threshold) ||
+                !mayHaveLength(node, pattern.length() - index)) {
+                break;
+            }
+
+            if (node.right != NIL &&
+                (pattern[index] == '_' || pattern[index] > node.data)) {
+                stack.push(node.right, index, 0, false);
+            }
+            bool left = node.left != NIL &&
+                        (pattern[index] == '_' || pattern[index] < node.data);
+
+            // the whole segment must fit in and match the pattern
+            unsigned int end = index + node.length;
+            if ((pattern[index] == '_' || pattern[index] == node.data) &&
+                end <= pattern.length()) {
+                bool match = true;
+                for (unsigned int i = 1; match && i < node.length; i++) {
+                    match = pattern[index + i] == '_' ||
+                            pattern[index + i] == wordPool[node.label + i];
+                }
+                if (match && end == pattern.length() && node.wordId != NIL) {
+                    if (left) {  // offer it once the left subtree is done
+                        stack.push(next, index, 0, true);
+                    } else {
+                        offerWord(search, node.wordId);
+                    }
+                } else if (match && end < pattern.length() &&
+                           node.middle != NIL) {
+                    stack.push(node.middle, end, 0, false);
+                }
+            }
+            next = left ? node.left : NIL;
+        }
+    }
+}
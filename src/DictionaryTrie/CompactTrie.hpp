@@ -0,0 +1,186 @@
+/**
+ * The header of a read only, path compressed copy of a dictionary trie. Runs
+ * of ternary trie nodes with a single child and no word are merged into one
+ * node holding a string segment, which cuts the node count and memory.
+ */
+#ifndef COMPACT_TRIE_HPP
+#define COMPACT_TRIE_HPP
+
+#include <queue>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "DictionaryTrie.hpp"
+
+using namespace std;
+
+/**
+ * The class for an immutable, path compressed ternary search trie built from
+ * a finished DictionaryTrie. It answers the same queries with the same
+ * results.
+ */
+class CompactTrie {
+  private:
+    /* The class for a compact node. The node branches on its first letter
+     * like a ternary trie node, then matches the rest of its segment before
+     * going down the middle. The segment is stored in the word pool, inside
+     * a word that passes through the node.
+     */
+    class CompactNode {
+      public:
+        unsigned int left;        // index of left child, or NIL
+        unsigned int right;       // index of right child, or NIL
+        unsigned int middle;      // index of middle child, or NIL
+        unsigned int maxFreq;     // max frequency in the subtree
+        unsigned int wordId;      // id of the word ending the segment, or NIL
+        unsigned int label;       // offset of the segment in the word pool
+        char data;                // first letter of the segment
+        unsigned char length;     // number of letters in the segment
+        unsigned char minLength;  // fewest letters left to a word end in the
+                                  // subtree, from this node on, capped
+        unsigned char maxLength;  // most letters left to a word end in the
+                                  // subtree, from this node on, capped
+    };
+
+    /* Comparator class to sort (freq, word id) pairs in the priority queue.
+     * Word ids follow alphabetical order, so ties compare the ids.
+     */
+    class Comp {
+      public:
+        /* Compare function. In order of first in pair and reverse
+         * alphabetical order of the words if tied.
+         * @param a First pair to compare with second pair
+         * @param b Second pair to compare with first pair
+         * @return True if a > b, false if a < b.
+         */
+        bool operator()(const idPairing& a, const idPairing& b) const {
+            if (a.first == b.first) {
+                return a.second < b.second;
+            }
+            return a.first > b.first;
+        }
+    };
+
+    /* State of one top completions search: the heap of the best words found
+     * so far and the frequency a word must beat to get in.
+     */
+    class Search {
+      public:
+        const unsigned int numCompletions;  // number of completions we need
+        unsigned int threshold;  // min frequency in the heap once it is full
+        std::priority_queue<idPairing, vector<idPairing>, Comp>
+            pq;  // (freq, word id) of the best words so far
+
+        /* Constructor.
+         * @param k Number of completions we need. Max size of heap.
+         */
+        explicit Search(unsigned int k) : numCompletions(k), threshold(0) {}
+    };
+
+    // searches keep their steps on the same reused stacks as DictionaryTrie
+    typedef DictionaryTrie::Step Step;
+    typedef DictionaryTrie::StepStack StepStack;
+
+    static const unsigned int NIL = 0xFFFFFFFF;   // index of a missing node
+    static const unsigned char LENGTH_CAP = 255;  // longest segment, and
+                                                  // longest tracked length
+
+    vector<CompactNode> nodes;  // every node of the trie
+    unsigned int root;          // index of the root node, or NIL if empty
+
+    string wordPool;                  // every word in alphabetical order
+    vector<unsigned int> wordStarts;  // offset of each word id in wordPool
+    vector<unsigned int> freqs;       // frequency of each word id
+
+    /* Helper method for the constructor to copy the ternary trie, merging
+     * single child chains. Takes the nodes off a work list, so deep tries can
+     * not overflow the call stack.
+     * @param trie Trie being copied
+     * @param ids New id of every word id of the trie
+     * @return Index of the root of the copy, or NIL if the trie is empty
+     */
+    unsigned int copyTrie(const DictionaryTrie& trie,
+                          const vector<unsigned int>& ids);
+
+    /* Returns the word with the given id. */
+    string_view wordAt(unsigned int id) const;
+
+    /* Returns true if a word can end a given number of letters from the
+     * start of a node's segment.
+     */
+    static bool mayHaveLength(const CompactNode& node, unsigned int remaining);
+
+    /* Offers a word to a search. The word goes in the heap if the heap is not
+     * full yet or the word beats the least frequent word in it.
+     * @param search State of the search
+     * @param id Id of the word to offer
+     */
+    void offerWord(Search& search, unsigned int id) const;
+
+    /* Moves the words left in a search out of its heap.
+     * @param search State of a finished search
+     * @return the words, most frequent first
+     */
+    vector<string> takeResults(Search& search) const;
+
+    /* Helper method for predictCompletions to offer the words of a subtree
+     * in alphabetical order, skipping subtrees with nothing frequent enough.
+     * Keeps its steps on an explicit stack, like DictionaryTrie.
+     * @param search State of this search
+     * @param curr Index of the root of the subtree
+     */
+    void completeSubtree(Search& search, unsigned int curr) const;
+
+    /* Helper method for predictUnderscores to offer the words matching a
+     * pattern in alphabetical order. Keeps its steps on an explicit stack,
+     * like DictionaryTrie.
+     * @param pattern Pattern that the word should match
+     * @param search State of this search
+     */
+    void searchPattern(string_view pattern, Search& search) const;
+
+  public:
+    /* Constructor.
+     * Copies a finished dictionary trie. Later inserts into the trie are not
+     * seen by the copy.
+     * @param trie Trie to copy
+     */
+    explicit CompactTrie(const DictionaryTrie& trie);
+
+    /* Finds a query word in the trie.
+     * @param word Query word to find in trie
+     * @return True if we found the word. False otherwise.
+     */
+    bool find(string word) const;
+
+    /* Finds up to numCompletions of most frequent completions given a prefix,
+     * the same as DictionaryTrie::predictCompletions.
+     * @param prefix Prefix to complete
+     * @param numCompletions Number of words to find
+     * @return vector of numCompletions words with most frequency with prefix
+     */
+    vector<string> predictCompletions(string prefix,
+                                      unsigned int numCompletions) const;
+
+    /* Finds up to numCompletions of most frequent words matching a pattern
+     * with wild cards, the same as DictionaryTrie::predictUnderscores.
+     * @param pattern Pattern with wild card to match to
+     * @param numCompletions Number of words to find
+     * @return vector of numCompletions words matching pattern with most freq
+     */
+    vector<string> predictUnderscores(string pattern,
+                                      unsigned int numCompletions) const;
+
+    /* Returns the number of words in the trie. */
+    unsigned int wordCount() const;
+
+    /* Returns the number of nodes in the trie. */
+    unsigned int numNodes() const;
+
+    /* Returns the number of bytes reserved for the nodes, word pool and
+     * frequencies.
+     */
+    size_t memoryUsage() const;
+};
+
+#endif  // COMPACT_TRIE_HPP
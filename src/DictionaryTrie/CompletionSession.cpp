@@ -0,0 +1,132 @@
+/**
+ * A completion session: the state of one as-you-type query to a dictionary
+ * trie, so each keystroke only walks one letter.
+ */
+#include "CompletionSession.hpp"
+
+/* Constructor.
+ * Starts a session with nothing typed.
+ * @param t Trie to complete from. Must outlive the session.
+ * @param k Number of completions per query
+ */
+CompletionSession::CompletionSession(const DictionaryTrie& t, unsigned int k)
+    : trie(t), numCompletions(k) {
+    clear();
+}
+
+/* Adds a letter to the end of the typed text. Steps one level down if the
+ * longer prefix is in the trie.
+ */
+void CompletionSession::append(char letter) {
+    refresh();
+    typed.push_back(letter);
+    unsigned int node = path.back();
+    if (typed.length() == path.size() && trie.stepPrefix(node, letter)) {
+        path.push_back(node);
+        lists.emplace_back();
+        listed.push_back(false);
+    }
+}
+
+/* Removes the last letter of the typed text, if any. Steps one level back
+ * up, keeping the completions found for the shorter prefix.
+ */
+void CompletionSession::backspace() {
+    if (typed.empty()) {
+        return;
+    }
+    typed.pop_back();
+    if (path.size() > typed.length() + 1) {
+        path.pop_back();
+        lists.pop_back();
+        listed.pop_back();
+    }
+}
+
+/* Clears the typed text. */
+void CompletionSession::clear() {
+    typed.clear();
+    path.assign(1, DictionaryTrie::NIL);
+    lists.assign(1, vector<idPairing>());
+    listed.assign(1, false);
+    changes = trie.changeCount();
+}
+
+/* Returns the text typed so far. */
+const string& CompletionSession::prefix() const { return typed; }
+
+/* Walks the typed text again and drops the lists if the trie changed. Nodes
+ * on the old path may have been unlinked or reused.
+ */
+void CompletionSession::refresh() {
+    if (changes == trie.changeCount()) {
+        return;
+    }
+    string text = std::move(typed);
+    clear();
+    for (char letter : text) {
+        append(letter);
+    }
+}
+
+/* Finds the completions of the longest prefix in path. The words of the
+ * shorter prefix's list that have the longer prefix are the best of its
+ * completions, so they are the whole answer if there are numCompletions of
+ * them, or if the shorter list held every completion there is.
+ */
+const vector<idPairing>& CompletionSession::currentList() {
+    unsigned int depth = path.size() - 1;
+    if (listed[depth]) {
+        return lists[depth];
+    }
+    vector<idPairing>& list = lists[depth];
+    bool found = false;
+    if (depth > 0 && listed[depth - 1]) {
+        const vector<idPairing>& shorter = lists[depth - 1];
+        string_view letters(typed.data(), depth);
+        unsigned int matches = 0;
+        for (const idPairing& id : shorter) {
+            matches += trie.wordAt(id.second).substr(0, depth) == letters;
+        }
+        found = matches == numCompletions || shorter.size() < numCompletions;
+        if (found) {
+            list.reserve(matches);
+            for (const idPairing& id : shorter) {
+                if (trie.wordAt(id.second).substr(0, depth) == letters) {
+                    list.push_back(id);
+                }
+            }
+        }
+    }
+
+    // otherwise better words may be past the end of the shorter list
+    if (!found && numCompletions > 0) {
+        list = trie.completeFromNode(path[depth], depth, numCompletions);
+    }
+    listed[depth] = true;
+    return list;
+}
+
+/* Finds the most frequent completions of the typed text.
+ * @return vector of up to numCompletions words, most frequent first
+ */
+vector<string> CompletionSession::completions() {
+    vector<string_view> views = completionViews();
+    return vector<string>(views.begin(), views.end());
+}
+
+/* Same as completions, but returns views into the trie's word pool.
+ * @return views of up to numCompletions words, most frequent first
+ */
+vector<string_view> CompletionSession::completionViews() {
+    refresh();
+    if (typed.length() >= path.size()) {
+        return vector<string_view>();  // the typed text left the trie
+    }
+    const vector<idPairing>& list = currentList();
+    vector<string_view> words(list.size());
+    for (unsigned int i = 0; i < list.size(); i++) {
+        words[i] = trie.wordAt(list[i].second);
+    }
+    return words;
+}
@@ -0,0 +1,79 @@
+/**
+ * The header of a completion session: the state of one as-you-type query to
+ * a dictionary trie, so each keystroke only walks one letter.
+ */
+#ifndef COMPLETION_SESSION_HPP
+#define COMPLETION_SESSION_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "DictionaryTrie.hpp"
+
+using namespace std;
+
+/**
+ * The class for an as-you-type completion session on a DictionaryTrie. It
+ * keeps the node ending each prefix of the typed text, so appending a letter
+ * steps down one level and backspace steps back up one. The completions of
+ * each prefix are kept too: backspace gets them back without a search, and
+ * the completions of a longer prefix are picked out of the shorter prefix's
+ * when enough of them still match. Results are the same as those of
+ * predictCompletions on the typed text. The trie must outlive the session;
+ * if it changes, the session walks the typed text again on its next query.
+ */
+class CompletionSession {
+  private:
+    const DictionaryTrie& trie;   // trie the session completes from
+    unsigned int numCompletions;  // number of completions per query
+    string typed;                 // text typed so far
+    vector<unsigned int> path;  // node ending each prefix of typed that is in
+                                // the trie, path[0] = NIL for the empty one
+    vector<vector<idPairing>>
+        lists;                  // (freq, word id) completions of each prefix
+                                // in path, most frequent first
+    vector<bool> listed;        // true once the list of a prefix is found
+    unsigned long long changes;  // trie change count the path was walked at
+
+    /* Walks the typed text again and drops the lists if the trie changed. */
+    void refresh();
+
+    /* Finds the completions of the longest prefix in path, from the list of
+     * the prefix one letter shorter if it can, else by a search.
+     */
+    const vector<idPairing>& currentList();
+
+  public:
+    /* Constructor.
+     * Starts a session with nothing typed.
+     * @param t Trie to complete from. Must outlive the session.
+     * @param k Number of completions per query
+     */
+    CompletionSession(const DictionaryTrie& t, unsigned int k);
+
+    /* Adds a letter to the end of the typed text. */
+    void append(char letter);
+
+    /* Removes the last letter of the typed text, if any. */
+    void backspace();
+
+    /* Clears the typed text. */
+    void clear();
+
+    /* Returns the text typed so far. */
+    const string& prefix() const;
+
+    /* Finds the most frequent completions of the typed text, the same as
+     * predictCompletions(prefix(), numCompletions).
+     * @return vector of up to numCompletions words, most frequent first
+     */
+    vector<string> completions();
+
+    /* Same as completions, but returns views into the trie's word pool. The
+     * views stay valid until the next change to the trie.
+     * @return views of up to numCompletions words, most frequent first
+     */
+    vector<string_view> completionViews();
+};
+
+#endif  // COMPLETION_SESSION_HPP
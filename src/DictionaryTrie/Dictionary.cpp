@@ -0,0 +1,23 @@
+/**
+ * The factory of dictionary backends.
+ */
+#include "Dictionary.hpp"
+#include "AdaptiveRadixTree.hpp"
+#include "DictionaryTrie.hpp"
+
+/* Makes an empty dictionary of a backend.
+ * @param backend Name of the backend, one of backends()
+ * @return the dictionary, or nullptr if there is no such backend
+ */
+unique_ptr<Dictionary> Dictionary::create(const string& backend) {
+    if (backend == "tst") {
+        return unique_ptr<Dictionary>(new DictionaryTrie());
+    }
+    if (backend == "art") {
+        return unique_ptr<Dictionary>(new AdaptiveRadixTree());
+    }
+    return nullptr;
+}
+
+/* Returns the names of the backends create knows, the default first. */
+vector<string> Dictionary::backends() { return {"tst", "art"}; }
@@ -0,0 +1,86 @@
+/**
+ * The header of the dictionary interface: what autocomplete needs from a
+ * dictionary, so its backends can be swapped at runtime.
+ */
+#ifndef DICTIONARY_HPP
+#define DICTIONARY_HPP
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+typedef pair<unsigned int, unsigned int> idPairing;  // (freq, word id)
+typedef pair<string_view, unsigned int> entry;  // (word, freq) to insert
+
+/**
+ * The interface of a dictionary of words with frequencies that completes
+ * prefixes and wildcard patterns with its most frequent words. Every backend
+ * gives the same results: most frequent first, ties in alphabetical order.
+ */
+class Dictionary {
+  public:
+    /* Inserts a word into the dictionary with a given frequency.
+     * @param word Word to insert into the dictionary
+     * @param freq Frequency of the word
+     * @return True if we successfully inserted. False if the word is empty
+     * or already in the dictionary.
+     */
+    virtual bool insert(string_view word, unsigned int freq) = 0;
+
+    /* Inserts a whole set of words at once. Empty and duplicate words are
+     * skipped and the first duplicate wins.
+     * @param entries (word, freq) pairs to insert
+     * @return Number of words inserted
+     */
+    virtual unsigned int bulkInsert(vector<entry> entries) = 0;
+
+    /* Finds a query word in the dictionary.
+     * @param word Query word to find
+     * @return True if we found the word. False otherwise.
+     */
+    virtual bool find(string word) const = 0;
+
+    /* Finds up to numCompletions of most frequent completions of a prefix.
+     * @param prefix Prefix to complete
+     * @param numCompletions Number of words to find
+     * @return vector of up to numCompletions words, most frequent first
+     */
+    virtual vector<string> predictCompletions(
+        string prefix, unsigned int numCompletions) const = 0;
+
+    /* Finds up to numCompletions of most frequent words of the same length
+     * as a pattern whose underscores match any letter.
+     * @param pattern Pattern with wild card to match to
+     * @param numCompletions Number of words to find
+     * @return vector of up to numCompletions words, most frequent first
+     */
+    virtual vector<string> predictUnderscores(
+        string pattern, unsigned int numCompletions) const = 0;
+
+    /* Returns the number of words in the dictionary. */
+    virtual unsigned int wordCount() const = 0;
+
+    /* Returns the number of nodes in the dictionary. */
+    virtual unsigned int numNodes() const = 0;
+
+    /* Returns the number of bytes reserved for the dictionary. */
+    virtual size_t memoryUsage() const = 0;
+
+    /* Deallocates the dictionary. */
+    virtual ~Dictionary() {}
+
+    /* Makes an empty dictionary of a backend.
+     * @param backend Name of the backend, one of backends()
+     * @return the dictionary, or nullptr if there is no such backend
+     */
+    static unique_ptr<Dictionary> create(const string& backend);
+
+    /* Returns the names of the backends create knows, the default first. */
+    static vector<string> backends();
+};
+
+#endif  // DICTIONARY_HPP
@@ -8,16 +8,118 @@
  * https://www.geeksforgeeks.org/priority-queue-of-pairs-in-c-ordered-by-first/
  */
 #include "DictionaryTrie.hpp"
+#include "TrieStats.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 #include <algorithm>
+#include <climits>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include <queue>
+#include <thread>
 
-typedef pair<unsigned int, string> pairing;  // used in predictCompletions
+// snapshot files start with this tag, followed by the format version. Bump
+// the version whenever the header or TrieNode layout changes.
+static const char SNAPSHOT_MAGIC[8] = {'D', 'T', 'S', 'N', 'A', 'P', 0, 0};
+static const unsigned int SNAPSHOT_VERSION = 3;
+static const uint64_t SNAPSHOT_ALIGN = 8;
+
+/* Header at the start of a snapshot file. Sections are stored in host byte
+ * order at the given offsets: the node array, the word start offsets and the
+ * word pool.
+ */
+struct SnapshotHeader {
+    char magic[8];              // SNAPSHOT_MAGIC
+    unsigned int version;       // SNAPSHOT_VERSION
+    unsigned int nodeSize;      // sizeof(TrieNode) of the writer
+    unsigned int root;          // index of the root node, or NIL if empty
+    unsigned int maxFreq;       // highest frequency in the trie
+    unsigned int nodeCount;     // number of nodes in the node array
+    unsigned int wordCount;     // number of words in the word pool
+    unsigned int erasedCount;   // words in the pool that were erased
+    unsigned int freeCount;     // nodes in the array that were unlinked
+    uint64_t poolSize;          // bytes in the word pool
+    uint64_t nodesOffset;       // file offset of the node array
+    uint64_t startsOffset;      // file offset of the word start offsets
+    uint64_t poolOffset;        // file offset of the word pool
+    uint64_t fileSize;          // total bytes in the file
+};
+
+/* Rounds a snapshot file offset up to the section alignment. */
+static uint64_t alignSnapshot(uint64_t offset) {
+    return (offset + SNAPSHOT_ALIGN - 1) / SNAPSHOT_ALIGN * SNAPSHOT_ALIGN;
+}
+
+// approximate bytes a cached list costs on top of its word ids: the map
+// entry, its hash node link and its bucket
+static const size_t CACHE_ENTRY_OVERHEAD =
+    sizeof(pair<const unsigned int, vector<idPairing>>) +
+    2 * sizeof(void*);
+
+/* A pending step of bulkInsert's build: build the sibling tree of groups
+ * [lo, hi) and hang it from a side of its parent, or finish the parent once
+ * all of its children are built.
+ */
+struct BuildStep {
+    unsigned int lo;      // first group of the tree, or when finishing, the
+                          // number of groups to keep
+    unsigned int hi;      // one past the last group of the tree
+    unsigned int depth;   // index of the letter the tree branches on
+    unsigned int parent;  // node the tree hangs from, or NIL for the root
+    char side;            // 'l', 'm' or 'r' for the child it becomes, or
+                          // 'f' to finish the parent
+};
+
+const unsigned int DictionaryTrie::NIL;
+const unsigned char DictionaryTrie::LENGTH_CAP;
+const unsigned int DictionaryTrie::WIDE_CHUNK;
+
+/* Returns the calling thread's stack of search steps. Every search empties it
+ * before returning, so the searches of a thread take turns with it and its
+ * memory is reused from one query to the next.
+ */
+vector<DictionaryTrie::Step>& DictionaryTrie::threadSteps() {
+    thread_local vector<Step> steps;
+    return steps;
+}
+
+/* Returns the calling thread's memory for the frontier of best first searches.
+ * Every search clears it first, so its memory is reused from one query to the
+ * next.
+ */
+vector<DictionaryTrie::Frontier>& DictionaryTrie::threadFrontier() {
+    thread_local vector<Frontier> frontier;
+    return frontier;
+}
 
 /* Constructor.
  * Initializes the dictionary trie.
  */
-DictionaryTrie::DictionaryTrie() { root = nullptr; }
+DictionaryTrie::DictionaryTrie() {
+    root = NIL;
+    wordStarts.push_back(0);
+    erasedWords = 0;
+    nodeData = nodes.data();
+    nodeCount = 0;
+    poolData = wordPool.data();
+    startData = wordStarts.data();
+    mapping = nullptr;
+    mappingSize = 0;
+    cacheDepth = 0;
+    cacheSize = 0;
+    cacheBudget = 0;
+    bestFirst = false;
+    wideRoot = NIL;
+    wideDepth = 0;
+    wideMinChildren = 0;
+    changes = 0;
+}
 
 /* Inserts a word into the dictionary trie with a given frequency.
  * Creates TrieNodes to store letters in the word along with way.
@@ -25,25 +127,236 @@ DictionaryTrie::DictionaryTrie() { root = nullptr; }
  * @param freq Frequency of the word
  * @return True if we successfully inserted. Otherwise, false.
  */
-bool DictionaryTrie::insert(string word, unsigned int freq) {
-    // check for empty word
-    if (word == "") {
+bool DictionaryTrie::insert(string_view word, unsigned int freq) {
+    // check for empty word or a read only snapshot
+    if (word.empty() || mapping != nullptr) {
         return false;
     }
 
-    // assign root if needed
-    if (root == nullptr) {
-        root = new TrieNode(word.at(0));
-        if (word.length() == 1) {  // one letter word then done.
-            root->word = true;
-            root->freq = freq;
-            root->maxFreq = freq;
-            return true;
+    // assign root if needed. firstNew is the index of the letter of the
+    // first node added, if any.
+    unsigned int firstNew = word.length();
+    if (root == NIL) {
+        root = newNode(word.at(0));
+        firstNew = 0;
+    }
+
+    // walk down to the node of the last letter, adding nodes as needed.
+    // newNode may grow the arena, so nodes are looked up by index only.
+    updatePath.clear();
+    unsigned int index = 0;
+    unsigned int curr = root;
+    while (true) {
+        updatePath.push_back(make_pair(curr, word.length() - index));
+        if (word.at(index) < nodes[curr].data) {  // go left
+            if (nodes[curr].left == NIL) {        // insert new node
+                unsigned int next = newNode(word.at(index));
+                nodes[curr].left = next;
+                firstNew = std::min(firstNew, index);
+            }
+            curr = nodes[curr].left;
+        } else if (word.at(index) > nodes[curr].data) {  // go right
+            if (nodes[curr].right == NIL) {              // insert new node
+                unsigned int next = newNode(word.at(index));
+                nodes[curr].right = next;
+                firstNew = std::min(firstNew, index);
+            }
+            curr = nodes[curr].right;
+        } else if (index < word.length() - 1) {  // same letter, go down middle
+            if (nodes[curr].middle == NIL) {     // insert next letter
+                unsigned int next = newNode(word.at(index + 1));
+                nodes[curr].middle = next;
+                firstNew = std::min(firstNew, index + 1);
+            }
+            curr = nodes[curr].middle;
+            index++;
+        } else {  // last letter and correct node
+            break;
         }
     }
 
-    // insert word
-    return insertRec(word, freq, 0, root);
+    if (nodes[curr].word) {  // duplicate word
+        return false;
+    }
+    nodes[curr].word = true;
+    nodes[curr].freq = freq;
+    nodes[curr].wordId = addWord(word);
+
+    // update maxFreq and the word lengths of every node on the way
+    for (const pair<unsigned int, unsigned int>& step : updatePath) {
+        TrieNode& node = nodes[step.first];
+        node.maxFreq = std::max(node.maxFreq, freq);
+        node.addLength(step.second);
+    }
+    updateCompletionCache(word, freq, nodes[curr].wordId, false);
+
+    // a new letter among the children of a wide node
+    if (firstNew < wideDepth) {
+        enableWideNodes(wideDepth, wideMinChildren);
+    }
+    changes++;
+    return true;
+}
+
+/* Sets the frequency of a word already in the trie. Only the maxFreq of the
+ * nodes on the word's path is updated.
+ * @param word Word to update
+ * @param freq New frequency of the word
+ * @return True if the word was updated. False if it is not in the trie or the
+ * trie is read only.
+ */
+bool DictionaryTrie::setFrequency(string_view word, unsigned int freq) {
+    unsigned int curr = walkWord(word);
+    if (curr == NIL) {
+        return false;
+    }
+    nodes[curr].freq = freq;
+    refreshPath(updatePath.size());
+    updateCompletionCache(word, freq, nodes[curr].wordId, false);
+    changes++;
+    return true;
+}
+
+/* Adds to the frequency of a word already in the trie, saturating at the
+ * largest frequency.
+ * @param word Word to update
+ * @param delta Amount to add to the frequency
+ * @return True if the word was updated. False if it is not in the trie or the
+ * trie is read only.
+ */
+bool DictionaryTrie::incrementFrequency(string_view word, unsigned int delta) {
+    unsigned int curr = walkWord(word);
+    if (curr == NIL) {
+        return false;
+    }
+    unsigned int freq = nodes[curr].freq;
+    freq = delta > UINT_MAX - freq ? UINT_MAX : freq + delta;
+    nodes[curr].freq = freq;
+
+    // the frequency only grows, so raising maxFreq on the way is enough
+    for (const pair<unsigned int, unsigned int>& step : updatePath) {
+        TrieNode& node = nodes[step.first];
+        node.maxFreq = std::max(node.maxFreq, freq);
+    }
+    updateCompletionCache(word, freq, nodes[curr].wordId, false);
+    changes++;
+    return true;
+}
+
+/* Removes a word from the trie. Nodes left with no word below them are
+ * unlinked and reused by later inserts. The word's id is not reused.
+ * @param word Word to remove
+ * @return True if the word was removed. False if it is not in the trie or the
+ * trie is read only.
+ */
+bool DictionaryTrie::erase(string_view word) {
+    unsigned int curr = walkWord(word);
+    if (curr == NIL) {
+        return false;
+    }
+    unsigned int id = nodes[curr].wordId;
+    nodes[curr].word = false;
+    nodes[curr].freq = 0;
+    nodes[curr].wordId = NIL;
+    erasedWords++;
+
+    // unlink the nodes that lead to no word any more, from the bottom up.
+    // Every other node on the path leads to a word down its middle.
+    unsigned int length = updatePath.size();
+    bool shallow = false;  // true if a letter of a wide node was unlinked
+    while (length > 0) {
+        curr = updatePath[length - 1].first;
+        if (nodes[curr].word || nodes[curr].middle != NIL) {
+            break;
+        }
+        unsigned int replacement = unlinkNode(curr);
+        length--;
+        shallow |= word.length() - updatePath[length].second < wideDepth;
+        if (length == 0) {
+            root = replacement;
+        } else {
+            TrieNode& parent = nodes[updatePath[length - 1].first];
+            if (parent.left == curr) {
+                parent.left = replacement;
+            } else if (parent.right == curr) {
+                parent.right = replacement;
+            } else {
+                parent.middle = replacement;
+            }
+        }
+    }
+    refreshPath(length);
+    updateCompletionCache(word, 0, id, true);
+    if (shallow) {
+        enableWideNodes(wideDepth, wideMinChildren);
+    }
+    changes++;
+    return true;
+}
+
+/* Orders words letter by letter using char comparisons, the same order the
+ * sibling trees use.
+ */
+static bool entryLess(const entry& a, const entry& b) {
+    return std::lexicographical_compare(a.first.begin(), a.first.end(),
+                                        b.first.begin(), b.first.end());
+}
+
+/* Inserts a whole set of words at once. The words are sorted and each sibling
+ * tree is built balanced around its median letter, with maxFreq filled in
+ * bottom up. If the trie already holds words, they are inserted one at a time
+ * in median first order instead. As with insert, empty and duplicate words
+ * are skipped and the first duplicate wins.
+ * @param entries (word, freq) pairs to insert
+ * @return Number of words inserted
+ */
+unsigned int DictionaryTrie::bulkInsert(vector<entry> entries) {
+    if (mapping != nullptr) {
+        return 0;
+    }
+    changes++;
+
+    // sort, keeping the first of each run of duplicates and no empty words
+    std::stable_sort(entries.begin(), entries.end(), entryLess);
+    unsigned int unique = 0;
+    for (unsigned int i = 0; i < entries.size(); i++) {
+        if (!entries[i].first.empty() &&
+            (unique == 0 || entries[i].first != entries[unique - 1].first)) {
+            entries[unique++] = entries[i];
+        }
+    }
+    entries.resize(unique);
+
+    if (root != NIL) {
+        // insert medians before the words on either side of them
+        unsigned int inserted = 0;
+        vector<pair<unsigned int, unsigned int>> ranges;
+        ranges.push_back(make_pair(0, entries.size()));
+        while (!ranges.empty()) {
+            pair<unsigned int, unsigned int> range = ranges.back();
+            ranges.pop_back();
+            if (range.first >= range.second) {
+                continue;
+            }
+            unsigned int mid = range.first + (range.second - range.first) / 2;
+            inserted += insert(entries[mid].first, entries[mid].second);
+            ranges.push_back(make_pair(range.first, mid));
+            ranges.push_back(make_pair(mid + 1, range.second));
+        }
+        return inserted;
+    }
+
+    nodes.reserve(nodes.size() + entries.size());
+    root = buildBalanced(entries);
+
+    // the cached lists and wide nodes were built for the empty trie
+    if (cacheSize > 0) {
+        enableCompletionCache(cacheDepth, cacheSize, cacheBudget);
+    }
+    if (wideDepth > 0) {
+        enableWideNodes(wideDepth, wideMinChildren);
+    }
+    return entries.size();
 }
 
 /* Finds a query word in the dictionary trie.
@@ -51,10 +364,9 @@ bool DictionaryTrie::insert(string word, unsigned int freq) {
  * @return True if we found the word. False otherwise.
  */
 bool DictionaryTrie::find(string word) const {
-    if (root == nullptr || word == "") {  // empty then false
-        return false;
-    }  // otherwise, go find
-    return findRec(word, 0, root);
+    TRIE_STAT_QUERY();
+    unsigned int curr;
+    return !word.empty() && walkPrefix(word, curr) && nodeData[curr].word;
 }
 
 /* Finds up to numCompletions of most frequent completions given a prefix.
@@ -66,256 +378,1642 @@ bool DictionaryTrie::find(string word) const {
  * @return vector of numCompletions words of most frequent completions of
  * prefix
  */
-vector<string> DictionaryTrie::predictCompletions(string prefix,
-                                                  unsigned int numCompletions) {
+vector<string> DictionaryTrie::predictCompletions(
+    string prefix, unsigned int numCompletions) const {
     // Stores final answer
     vector<string> completions;
+    for (const idPairing& id : completePrefix(prefix, numCompletions)) {
+        completions.emplace_back(wordAt(id.second));
+    }
+    return completions;
+}
 
-    // numCompletions = 0, then return empty completions vector
-    if (numCompletions == 0) {
-        return completions;
+/* Finds up to numCompletions of most frequent completions that fit in
+ * the pattern that may contain a wild card.
+ * @param pattern Pattern with wild card to match to
+ * @param numCompletions Number of words to find in order of most freq
+ * @return vector of numCompletions words matching pattern with most freq
+ */
+std::vector<string> DictionaryTrie::predictUnderscores(
+    string pattern, unsigned int numCompletions) const {
+    // Stores final answer
+    vector<string> completions;
+    for (const idPairing& id : matchPattern(pattern, numCompletions)) {
+        completions.emplace_back(wordAt(id.second));
+    }
+    return completions;
+}
+
+/* Finds up to numCompletions of completions of a prefix that may have typos. A
+ * word matches if some prefix of it is within maxEdits insertions, deletions or
+ * substitutions of the given prefix. Matches are listed by fewest edits, then
+ * most frequent.
+ * @param prefix Prefix to complete
+ * @param maxEdits Most edits a match may need
+ * @param numCompletions Number of words to find
+ * @return vector of up to numCompletions best matching words
+ */
+vector<string> DictionaryTrie::predictFuzzy(string_view prefix,
+                                            unsigned int maxEdits,
+                                            unsigned int numCompletions) const {
+    vector<string> completions;
+    for (const fuzzyPairing& match :
+         matchFuzzy(prefix, maxEdits, numCompletions)) {
+        completions.emplace_back(wordAt(match.second.second));
+    }
+    return completions;
+}
+
+/* Same as predictCompletions, but returns views into the word pool instead of
+ * copies of the words. The views stay valid until the next insert or
+ * loadSnapshot.
+ * @param prefix Prefix to complete
+ * @param numCompletions Number of words to find
+ * @return views of the most frequent completions, most frequent first
+ */
+vector<string_view> DictionaryTrie::predictCompletionViews(
+    string_view prefix, unsigned int numCompletions) const {
+    vector<idPairing> ids = completePrefix(prefix, numCompletions);
+    vector<string_view> completions(ids.size());
+    for (unsigned int i = 0; i < ids.size(); i++) {
+        completions[i] = wordAt(ids[i].second);
+    }
+    return completions;
+}
+
+/* Same as predictCompletions, but returns the ids of the words.
+ * @param prefix Prefix to complete
+ * @param numCompletions Number of words to find
+ * @return ids of the most frequent completions, most frequent first
+ */
+vector<unsigned int> DictionaryTrie::predictCompletionIds(
+    string_view prefix, unsigned int numCompletions) const {
+    vector<idPairing> ids = completePrefix(prefix, numCompletions);
+    vector<unsigned int> completions(ids.size());
+    for (unsigned int i = 0; i < ids.size(); i++) {
+        completions[i] = ids[i].second;
+    }
+    return completions;
+}
+
+/* Same as predictUnderscores, but returns views into the word pool. The views
+ * stay valid until the next insert or loadSnapshot.
+ * @param pattern Pattern with wild card to match to
+ * @param numCompletions Number of words to find
+ * @return views of the most frequent matches, most frequent first
+ */
+vector<string_view> DictionaryTrie::predictUnderscoreViews(
+    string_view pattern, unsigned int numCompletions) const {
+    vector<idPairing> ids = matchPattern(pattern, numCompletions);
+    vector<string_view> completions(ids.size());
+    for (unsigned int i = 0; i < ids.size(); i++) {
+        completions[i] = wordAt(ids[i].second);
     }
+    return completions;
+}
 
-    // minHeap of pairs of frequency with the string, sorting frequency
-    // (first)
-    std::priority_queue<pairing, vector<pairing>, Comp> pq;
+/* Returns the word with the given id, as a view into the word pool.
+ * @param id Id of the word
+ */
+string_view DictionaryTrie::wordAt(unsigned int id) const {
+    return string_view(poolData + startData[id],
+                       startData[id + 1] - startData[id]);
+}
 
-    unsigned int index = 0;  // index to traverse prefix word
-    TrieNode* curr = root;   // current node when traversing trie
-    threshold = 0;           // reset threshold, freq are all positive
+/* Finds up to numCompletions of most frequent completions for each of a batch
+ * of prefixes. Prefixes sharing a leading path walk it once, and large
+ * batches are split across threads.
+ * @param prefixes Prefixes to complete
+ * @param numCompletions Number of completions per prefix
+ * @param numThreads Most threads to use, or 0 for one per core
+ * @return the completions of every prefix, in the order of prefixes
+ */
+CompletionBatch DictionaryTrie::predictCompletionsBatch(
+    const vector<string_view>& prefixes, unsigned int numCompletions,
+    unsigned int numThreads) const {
+    // fewer prefixes than this per thread are not worth a thread
+    const unsigned int MIN_PREFIXES_PER_THREAD = 64;
 
-    while (index < prefix.length()) {  // find first node where prefix exists
-        if (curr == nullptr) {  // return empty vector if no completions exist
-            return vector<string>();
+    // sort so prefixes sharing a leading path are next to each other
+    vector<unsigned int> order(prefixes.size());
+    for (unsigned int i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(),
+              [&prefixes](unsigned int a, unsigned int b) {
+                  return std::lexicographical_compare(
+                      prefixes[a].begin(), prefixes[a].end(),
+                      prefixes[b].begin(), prefixes[b].end());
+              });
+
+    // answer contiguous runs of the sorted prefixes on each thread
+    if (numThreads == 0) {
+        numThreads = std::max(1U, thread::hardware_concurrency());
+    }
+    numThreads = std::min<unsigned int>(
+        numThreads, std::max<size_t>(1, prefixes.size() /
+                                            MIN_PREFIXES_PER_THREAD));
+    vector<vector<idPairing>> results(prefixes.size());
+    if (numCompletions > 0) {
+        vector<thread> workers;
+        unsigned int chunk = (prefixes.size() + numThreads - 1) / numThreads;
+        for (unsigned int first = 0; first < prefixes.size(); first += chunk) {
+            unsigned int last = std::min<unsigned int>(first + chunk,
+                                                       prefixes.size());
+            if (last == prefixes.size()) {  // last run on this thread
+                completeSorted(prefixes, order, first, last, numCompletions,
+                               results);
+            } else {
+                workers.emplace_back(&DictionaryTrie::completeSorted, this,
+                                     std::cref(prefixes), std::cref(order),
+                                     first, last, numCompletions,
+                                     std::ref(results));
+            }
         }
+        for (thread& worker : workers) {
+            worker.join();
+        }
+    }
 
-        if (prefix.at(index) < curr->data) {  // go left
-            curr = curr->left;
-        } else if (prefix.at(index) > curr->data) {  // go right
-            curr = curr->right;
-        } else {  // go middle
-            index++;
-            // if prefix is a word, add it to the priority queue
-            if (index == prefix.length() && curr->word) {
-                pq.push(make_pair(curr->freq, prefix));
+    // copy the words out into one buffer, in the order they were asked
+    CompletionBatch batch;
+    batch.queryStarts.push_back(0);
+    batch.wordStarts.push_back(0);
+    for (const vector<idPairing>& ids : results) {
+        for (const idPairing& id : ids) {
+            batch.text.append(wordAt(id.second));
+            batch.wordStarts.push_back(batch.text.size());
+        }
+        batch.queryStarts.push_back(batch.wordStarts.size() - 1);
+    }
+    return batch;
+}
+
+/* Precomputes the completions of every prefix up to maxDepth letters long so
+ * predictCompletions can answer them with one prefix walk. Shorter prefixes
+ * are cached first, then the ones with the most frequent subtrees, until the
+ * memory budget runs out. Later inserts keep the cached lists up to date.
+ * @param maxDepth Length of the longest prefix to cache
+ * @param numCompletions Number of completions kept per prefix
+ * @param budget Maximum number of bytes the cached lists may use
+ */
+void DictionaryTrie::enableCompletionCache(unsigned int maxDepth,
+                                           unsigned int numCompletions,
+                                           size_t budget) {
+    disableCompletionCache();
+    if (numCompletions == 0) {
+        return;
+    }
+    cacheDepth = maxDepth;
+    cacheSize = numCompletions;
+    cacheBudget = budget;
+
+    // the empty prefix comes first
+    size_t used = 0;
+    vector<idPairing> ids = topCompletionIds(NIL, numCompletions);
+    used += CACHE_ENTRY_OVERHEAD + ids.size() * sizeof(idPairing);
+    if (used > budget) {
+        return;
+    }
+    completionCache[NIL] = ids;
+
+    // roots of the sibling trees holding the last letter of each prefix
+    vector<unsigned int> level;
+    if (root != NIL) {
+        level.push_back(root);
+    }
+    for (unsigned int depth = 1; depth <= maxDepth && !level.empty();
+         depth++) {
+        // gather every node ending a prefix of this length
+        vector<unsigned int> prefixNodes;
+        vector<unsigned int> toVisit(level);
+        while (!toVisit.empty()) {
+            unsigned int curr = toVisit.back();
+            toVisit.pop_back();
+            prefixNodes.push_back(curr);
+            if (nodeData[curr].left != NIL) {
+                toVisit.push_back(nodeData[curr].left);
+            }
+            if (nodeData[curr].right != NIL) {
+                toVisit.push_back(nodeData[curr].right);
             }
-            curr = curr->middle;
         }
+
+        // spend the budget on the most frequent subtrees first
+        std::sort(prefixNodes.begin(), prefixNodes.end(),
+                  [this](unsigned int a, unsigned int b) {
+                      return nodeData[a].maxFreq > nodeData[b].maxFreq;
+                  });
+
+        level.clear();
+        for (unsigned int curr : prefixNodes) {
+            ids = topCompletionIds(curr, numCompletions);
+            used += CACHE_ENTRY_OVERHEAD + ids.size() * sizeof(idPairing);
+            if (used > budget) {
+                return;
+            }
+            completionCache[curr] = ids;
+            if (nodeData[curr].middle != NIL) {
+                level.push_back(nodeData[curr].middle);
+            }
+        }
+    }
+}
+
+/* Drops every precomputed completion list. */
+void DictionaryTrie::disableCompletionCache() {
+    completionCache.clear();
+    cacheDepth = 0;
+    cacheSize = 0;
+    cacheBudget = 0;
+}
+
+/* Lists the children of the prefixes shorter than maxDepth letters, the empty
+ * one included, as wide nodes searched 16 letters at a time. A prefix gets one
+ * if it has at least minChildren children and its own prefix one letter
+ * shorter has one.
+ * @param maxDepth Length of the longest prefix that may get a wide node
+ * @param minChildren Fewest children a prefix needs for a wide node
+ */
+void DictionaryTrie::enableWideNodes(unsigned int maxDepth,
+                                     unsigned int minChildren) {
+    disableWideNodes();
+    wideDepth = maxDepth;
+    wideMinChildren = std::max(1U, minChildren);
+    if (maxDepth > 0 && root != NIL) {
+        wideRoot = buildWide(root, 0);
     }
+}
+
+/* Drops every wide node. */
+void DictionaryTrie::disableWideNodes() {
+    wideNodes = vector<WideNode>();
+    wideLabels = vector<char>();
+    wideChildren = vector<unsigned int>();
+    wideNext = vector<unsigned int>();
+    wideRoot = NIL;
+    wideDepth = 0;
+    wideMinChildren = 0;
+}
 
-    // find all other words with the prefix
-    predictCompletionsRec(numCompletions, curr, prefix, pq);
+/* Returns the number of bytes used by the wide nodes. */
+size_t DictionaryTrie::wideNodeMemory() const {
+    return wideNodes.capacity() * sizeof(WideNode) + wideLabels.capacity() +
+           (wideChildren.capacity() + wideNext.capacity()) *
+               sizeof(unsigned int);
+}
 
-    while (!pq.empty()) {  // move words in pq to vector in order
-        completions.push_back(pq.top().second);
-        pq.pop();
+/* Helper method for enableWideNodes to build the wide node of a sibling tree
+ * and, below it, those of its children's sibling trees.
+ * @param siblings Index of the root of the sibling tree
+ * @param depth Number of letters of the prefix the siblings follow
+ * @return Index of the wide node, or NIL if the siblings are too few
+ */
+unsigned int DictionaryTrie::buildWide(unsigned int siblings,
+                                       unsigned int depth) {
+    // in order, so the letters come out sorted
+    vector<unsigned int> children;
+    vector<unsigned int> toVisit;
+    unsigned int curr = siblings;
+    while (curr != NIL || !toVisit.empty()) {
+        if (curr != NIL) {
+            toVisit.push_back(curr);
+            curr = nodeData[curr].left;
+        } else {
+            curr = toVisit.back();
+            toVisit.pop_back();
+            children.push_back(curr);
+            curr = nodeData[curr].right;
+        }
+    }
+    if (children.size() < wideMinChildren) {
+        return NIL;
     }
 
-    // reverse so in order from greatest freq to lowest
-    std::reverse(completions.begin(), completions.end());
+    WideNode node;
+    node.first = wideLabels.size();
+    node.count = children.size();
+    unsigned int padded =
+        (node.count + WIDE_CHUNK - 1) / WIDE_CHUNK * WIDE_CHUNK;
+    wideLabels.resize(node.first + padded, 0);
+    wideChildren.resize(node.first + padded, NIL);
+    wideNext.resize(node.first + padded, NIL);
+    for (unsigned int i = 0; i < node.count; i++) {
+        wideLabels[node.first + i] = nodeData[children[i]].data;
+        wideChildren[node.first + i] = children[i];
+    }
+    unsigned int wide = wideNodes.size();
+    wideNodes.push_back(node);
 
-    return completions;
+    if (depth + 1 < wideDepth) {
+        for (unsigned int i = 0; i < node.count; i++) {
+            unsigned int below = nodeData[children[i]].middle;
+            if (below != NIL) {
+                unsigned int next = buildWide(below, depth + 1);
+                wideNext[node.first + i] = next;
+            }
+        }
+    }
+    return wide;
 }
 
-/* Finds up to numCompletions of most frequent completions that fit in
- * the pattern that may contain a wild card.
- * @param pattern Pattern with wild card to match to
- * @param numCompletions Number of words to find in order of most freq
- * @return vector of numCompletions words matching pattern with most freq
+/* Chooses how completions are searched for below a prefix. Depth first walks
+ * the subtree in alphabetical order and only prunes once it holds
+ * numCompletions words. Best first keeps a frontier of subtrees ordered by
+ * maxFreq and stops as soon as numCompletions words beat everything on it.
+ * Both give the same results, except that best first never returns words of
+ * frequency 0.
+ * @param enabled True to search best first, false for depth first
  */
-std::vector<string> DictionaryTrie::predictUnderscores(
-    string pattern, unsigned int numCompletions) {
-    // Stores final answer
-    vector<string> completions;
+void DictionaryTrie::setBestFirst(bool enabled) {
+    // best first leaves out words of frequency 0, so results may change
+    changes += bestFirst != enabled;
+    bestFirst = enabled;
+}
 
-    // numCompletions = 0, then return empty completions vector
-    if (numCompletions == 0) {
-        return completions;
+/* Returns the number of nodes a search for the completions of a prefix looks
+ * at below the prefix, in the current search order and without the completion
+ * cache.
+ * @param prefix Prefix to complete
+ * @param numCompletions Number of words to find
+ */
+unsigned int DictionaryTrie::completionVisits(
+    string_view prefix, unsigned int numCompletions) const {
+    unsigned int prefixNode;
+    if (numCompletions == 0 || !walkPrefix(prefix, prefixNode)) {
+        return 0;
     }
+    IdSearch search(numCompletions, this);
+    searchCompletions(search, prefixNode);
+    return search.visited;
+}
 
-    // minHeap of pairs of frequency with the string
-    std::priority_queue<pairing, vector<pairing>, Comp> pq;
+/* Returns the number of bytes used by the precomputed completions. */
+size_t DictionaryTrie::completionCacheMemory() const {
+    if (completionCache.empty()) {
+        return 0;
+    }
+    size_t bytes = completionCache.bucket_count() * sizeof(void*);
+    for (const auto& entry : completionCache) {
+        bytes += CACHE_ENTRY_OVERHEAD - sizeof(void*) +
+                 entry.second.capacity() * sizeof(idPairing);
+    }
+    return bytes;
+}
 
-    // find all words matching pattern
-    predictUnderscoresRec(pattern, 0, numCompletions, root, "", pq);
+/* Returns a count that goes up whenever a change to the trie may change the
+ * results of a query.
+ */
+unsigned long long DictionaryTrie::changeCount() const { return changes; }
 
-    while (!pq.empty()) {  // move words in pq to vector in order
-        completions.push_back(pq.top().second);
-        pq.pop();
+/* Writes the trie to a binary snapshot file that loadSnapshot can map.
+ * @param filename File to write the snapshot to
+ * @return True if the snapshot was written. False otherwise.
+ */
+bool DictionaryTrie::saveSnapshot(const string& filename) const {
+    ofstream out(filename, ios::binary | ios::trunc);
+    if (!out.is_open()) {
+        return false;
     }
 
-    // reverse so in order from greatest freq to lowest
-    std::reverse(completions.begin(), completions.end());
+    // lay the sections out one after another, each 8 byte aligned
+    SnapshotHeader header;
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.nodeSize = sizeof(TrieNode);
+    header.root = root;
+    header.maxFreq = root == NIL ? 0 : nodeData[root].maxFreq;
+    header.nodeCount = nodeCount;
+    header.wordCount = idCount();
+    header.erasedCount = idCount() - wordCount();
+    header.freeCount = nodeCount - numNodes();
+    header.poolSize = startData[header.wordCount];
+    header.nodesOffset = alignSnapshot(sizeof(SnapshotHeader));
+    header.startsOffset = alignSnapshot(
+        header.nodesOffset + (uint64_t)header.nodeCount * sizeof(TrieNode));
+    header.poolOffset = alignSnapshot(
+        header.startsOffset +
+        ((uint64_t)header.wordCount + 1) * sizeof(unsigned int));
+    header.fileSize = header.poolOffset + header.poolSize;
 
-    return completions;
+    const char padding[SNAPSHOT_ALIGN] = {0};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(padding, header.nodesOffset - sizeof(header));
+    out.write(reinterpret_cast<const char*>(nodeData),
+              (streamsize)header.nodeCount * sizeof(TrieNode));
+    out.write(padding, header.startsOffset - header.nodesOffset -
+                           header.nodeCount * sizeof(TrieNode));
+    out.write(reinterpret_cast<const char*>(startData),
+              ((streamsize)header.wordCount + 1) * sizeof(unsigned int));
+    out.write(padding,
+              header.poolOffset - header.startsOffset -
+                  (header.wordCount + 1) * sizeof(unsigned int));
+    out.write(poolData, header.poolSize);
+    return out.good();
 }
 
-/* Deallocates the dictionary trie. */
-DictionaryTrie::~DictionaryTrie() { delete root; }
+/* Replaces the contents of the trie with a snapshot file written by
+ * saveSnapshot. The file is mapped into memory and queries read straight
+ * from it, so the trie becomes read only and insert returns false.
+ * @param filename Snapshot file to map
+ * @return True if the snapshot was loaded. False if the file is missing or
+ * is not a valid snapshot, in which case the trie is left unchanged.
+ */
+bool DictionaryTrie::loadSnapshot(const string& filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 ||
+        (size_t)info.st_size < sizeof(SnapshotHeader)) {
+        close(fd);
+        return false;
+    }
+    size_t size = info.st_size;
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  // the mapping keeps the file alive
+    if (mapped == MAP_FAILED) {
+        return false;
+    }
+
+    const char* base = static_cast<const char*>(mapped);
+    if (!validSnapshot(base, size)) {
+        munmap(mapped, size);
+        return false;
+    }
+    const SnapshotHeader* header =
+        reinterpret_cast<const SnapshotHeader*>(base);
+
+    // drop the old contents and point the views at the mapped sections
+    disableCompletionCache();
+    unsigned int keepWideDepth = wideDepth;
+    unsigned int keepMinChildren = wideMinChildren;
+    disableWideNodes();
+    unmapSnapshot();
+    nodes = vector<TrieNode>();
+    wordPool = string();
+    wordStarts = vector<unsigned int>();
+    erasedWords = 0;
+    freeNodes = vector<unsigned int>();
+    mapping = mapped;
+    mappingSize = size;
+    root = header->root;
+    nodeData = reinterpret_cast<const TrieNode*>(base + header->nodesOffset);
+    nodeCount = header->nodeCount;
+    startData =
+        reinterpret_cast<const unsigned int*>(base + header->startsOffset);
+    poolData = base + header->poolOffset;
+    if (keepWideDepth > 0) {
+        enableWideNodes(keepWideDepth, keepMinChildren);
+    }
+    changes++;
+    return true;
+}
 
-/* Helper method to insert a word recursively.
- * @param word Word to insert
- * @param freq Frequency of the word to insert
- * @param index Index of character in the word we are currently inserting
- * @param curr Current TrieNode we are checking
- * @return True if inserted. False otherwise (empty string or duplicate).
+/* Checks that a mapped snapshot file is one saveSnapshot could have written:
+ * every section fits in the file, every child index is a node and every word
+ * node and word start lies inside the word pool.
+ * @param base Start of the mapped file
+ * @param size Bytes in the mapped file
+ * @return True if queries can read the snapshot safely
  */
-bool DictionaryTrie::insertRec(string word, unsigned int freq,
-                               unsigned int index, TrieNode* curr) {
-    // base case, we are at last letter and correct node
-    if (index == word.length() - 1 && word.at(index) == curr->data) {
-        if (curr->word == true) {  // duplicate word
+bool DictionaryTrie::validSnapshot(const char* base, size_t size) {
+    // each offset is checked against the size before anything is added to
+    // it, so the sums can not wrap
+    const SnapshotHeader* header =
+        reinterpret_cast<const SnapshotHeader*>(base);
+    uint64_t nodesBytes = (uint64_t)header->nodeCount * sizeof(TrieNode);
+    uint64_t startsBytes =
+        ((uint64_t)header->wordCount + 1) * sizeof(unsigned int);
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != SNAPSHOT_VERSION ||
+        header->nodeSize != sizeof(TrieNode) || header->fileSize != size ||
+        header->nodesOffset % SNAPSHOT_ALIGN != 0 ||
+        header->startsOffset % SNAPSHOT_ALIGN != 0 ||
+        header->nodesOffset > size ||
+        nodesBytes > size - header->nodesOffset ||
+        header->nodesOffset + nodesBytes > header->startsOffset ||
+        header->startsOffset > size ||
+        startsBytes > size - header->startsOffset ||
+        header->startsOffset + startsBytes > header->poolOffset ||
+        header->poolOffset > size ||
+        header->poolSize > size - header->poolOffset ||
+        (header->root != NIL && header->root >= header->nodeCount) ||
+        header->erasedCount > header->wordCount ||
+        header->freeCount > header->nodeCount) {
+        return false;
+    }
+
+    const TrieNode* nodes =
+        reinterpret_cast<const TrieNode*>(base + header->nodesOffset);
+    for (unsigned int i = 0; i < header->nodeCount; i++) {
+        const TrieNode& node = nodes[i];
+        if ((node.left != NIL && node.left >= header->nodeCount) ||
+            (node.right != NIL && node.right >= header->nodeCount) ||
+            (node.middle != NIL && node.middle >= header->nodeCount) ||
+            (node.word && node.wordId >= header->wordCount)) {
             return false;
-        }  // otherwise new word
-        curr->word = true;
-        curr->freq = freq;
-        curr->maxFreq = freq;
-        return true;
+        }
+    }
+    const unsigned int* starts =
+        reinterpret_cast<const unsigned int*>(base + header->startsOffset);
+    for (unsigned int i = 0; i < header->wordCount; i++) {
+        if (starts[i] > starts[i + 1]) {
+            return false;
+        }
     }
+    return starts[0] == 0 && starts[header->wordCount] == header->poolSize;
+}
+
+/* Returns true if the trie is backed by a read only snapshot. */
+bool DictionaryTrie::isReadOnly() const { return mapping != nullptr; }
+
+/* Returns the number of words in the dictionary trie. */
+unsigned int DictionaryTrie::wordCount() const {
+    return mapping != nullptr
+               ? idCount() -
+                     reinterpret_cast<const SnapshotHeader*>(mapping)
+                         ->erasedCount
+               : idCount() - erasedWords;
+}
+
+/* Returns the number of ids handed out, erased words included. */
+unsigned int DictionaryTrie::idCount() const {
+    return mapping != nullptr
+               ? reinterpret_cast<const SnapshotHeader*>(mapping)->wordCount
+               : wordStarts.size() - 1;
+}
 
-    if (word.at(index) < curr->data) {  // go left
-        if (!curr->left) {              // insert new node
-            curr->left = new TrieNode(word.at(index));
+/* Returns the number of nodes in the dictionary trie. */
+unsigned int DictionaryTrie::numNodes() const {
+    return mapping != nullptr
+               ? nodeCount -
+                     reinterpret_cast<const SnapshotHeader*>(mapping)->freeCount
+               : nodeCount - freeNodes.size();
+}
+
+/* Returns the number of nodes on the longest path from the root. */
+unsigned int DictionaryTrie::height() const {
+    unsigned int maxDepth = 0;
+    vector<pair<unsigned int, unsigned int>> toVisit;  // (node, depth)
+    if (root != NIL) {
+        toVisit.push_back(make_pair(root, 1));
+    }
+    while (!toVisit.empty()) {
+        unsigned int curr = toVisit.back().first;
+        unsigned int depth = toVisit.back().second;
+        toVisit.pop_back();
+        maxDepth = std::max(maxDepth, depth);
+        const TrieNode& node = nodeData[curr];
+        for (unsigned int child : {node.left, node.middle, node.right}) {
+            if (child != NIL) {
+                toVisit.push_back(make_pair(child, depth + 1));
+            }
         }
-        bool result = insertRec(word, freq, index, curr->left);
-        // update maxFreq
-        curr->maxFreq = std::max(curr->maxFreq, curr->left->maxFreq);
-        return result;
-    } else if (word.at(index) > curr->data) {  // go right
-        if (!curr->right) {                    // insert new node
-            curr->right = new TrieNode(word.at(index));
+    }
+    return maxDepth;
+}
+
+/* Returns the average number of nodes visited to find each word. */
+double DictionaryTrie::averageProbeDepth() const {
+    unsigned long long totalDepth = 0;
+    unsigned int words = 0;
+    vector<pair<unsigned int, unsigned int>> toVisit;  // (node, depth)
+    if (root != NIL) {
+        toVisit.push_back(make_pair(root, 1));
+    }
+    while (!toVisit.empty()) {
+        unsigned int curr = toVisit.back().first;
+        unsigned int depth = toVisit.back().second;
+        toVisit.pop_back();
+        const TrieNode& node = nodeData[curr];
+        if (node.word) {
+            totalDepth += depth;
+            words++;
         }
-        bool result = insertRec(word, freq, index, curr->right);
-        // update maxFreq
-        curr->maxFreq = std::max(curr->maxFreq, curr->right->maxFreq);
-        return result;
-    } else {                  // same letter, go down middle
-        if (!curr->middle) {  // insert next letter
-            curr->middle = new TrieNode(word.at(index + 1));
+        for (unsigned int child : {node.left, node.middle, node.right}) {
+            if (child != NIL) {
+                toVisit.push_back(make_pair(child, depth + 1));
+            }
+        }
+    }
+    return words == 0 ? 0 : (double)totalDepth / words;
+}
+
+/* Returns the number of bytes reserved for the node arena and word pool, or
+ * the size of the mapped snapshot.
+ */
+size_t DictionaryTrie::memoryUsage() const {
+    if (mapping != nullptr) {
+        return mappingSize;
+    }
+    return nodes.capacity() * sizeof(TrieNode) + wordPool.capacity() +
+           wordStarts.capacity() * sizeof(unsigned int);
+}
+
+/* Deallocates the dictionary trie. The arena frees every node at once. */
+DictionaryTrie::~DictionaryTrie() { unmapSnapshot(); }
+
+/* Unmaps the snapshot backing the trie, if any. */
+void DictionaryTrie::unmapSnapshot() {
+    if (mapping != nullptr) {
+        munmap(mapping, mappingSize);
+        mapping = nullptr;
+        mappingSize = 0;
+    }
+}
+
+/* Allocates a new node in the arena, reusing an unlinked one if any.
+ * @param d Data/element of the new node
+ * @return Index of the new node
+ */
+unsigned int DictionaryTrie::newNode(char d) {
+    if (!freeNodes.empty()) {
+        unsigned int index = freeNodes.back();
+        freeNodes.pop_back();
+        nodes[index] = TrieNode(d);
+        return index;
+    }
+    nodes.emplace_back(d);
+    nodeData = nodes.data();
+    nodeCount = nodes.size();
+    return nodes.size() - 1;
+}
+
+/* Walks the trie down to the node of a word, keeping the path in updatePath.
+ * @param word Word to walk to
+ * @return Index of the word node, or NIL if the word is not in the trie or the
+ * trie is read only
+ */
+unsigned int DictionaryTrie::walkWord(string_view word) {
+    updatePath.clear();
+    if (word.empty() || mapping != nullptr) {
+        return NIL;
+    }
+    unsigned int index = 0;
+    unsigned int curr = root;
+    while (curr != NIL) {
+        updatePath.push_back(make_pair(curr, word.length() - index));
+        const TrieNode& node = nodes[curr];
+        if (word[index] < node.data) {  // go left
+            curr = node.left;
+        } else if (word[index] > node.data) {  // go right
+            curr = node.right;
+        } else if (index < word.length() - 1) {  // go down middle
+            curr = node.middle;
+            index++;
+        } else {  // last letter and found node
+            return node.word ? curr : NIL;
+        }
+    }
+    return NIL;
+}
+
+/* Recomputes the maxFreq and word lengths of a node from its word and its
+ * children.
+ * @param curr Index of the node
+ */
+void DictionaryTrie::refreshNode(unsigned int curr) {
+    TrieNode& node = nodes[curr];
+    node.maxFreq = node.freq;
+    node.minLength = LENGTH_CAP;
+    node.maxLength = 0;
+    if (node.word) {
+        node.addLength(1);
+    }
+
+    // the middle child is one letter further along the words
+    for (unsigned int child : {node.left, node.middle, node.right}) {
+        if (child != NIL) {
+            unsigned int skipped = child == node.middle ? 1 : 0;
+            node.maxFreq = std::max(node.maxFreq, nodes[child].maxFreq);
+            node.addLength(nodes[child].minLength + skipped);
+            node.addLength(nodes[child].maxLength + skipped);
+        }
+    }
+}
+
+/* Recomputes the nodes of updatePath from the bottom up, stopping at the first
+ * node that does not change.
+ * @param length Number of nodes of the path to recompute, from the top
+ */
+void DictionaryTrie::refreshPath(unsigned int length) {
+    for (unsigned int i = length; i > 0; i--) {
+        const TrieNode& node = nodes[updatePath[i - 1].first];
+        unsigned int maxFreq = node.maxFreq;
+        unsigned char minLength = node.minLength;
+        unsigned char maxLength = node.maxLength;
+        refreshNode(updatePath[i - 1].first);
+        if (i < length && node.maxFreq == maxFreq &&
+            node.minLength == minLength && node.maxLength == maxLength) {
+            return;  // nothing above can change either
+        }
+    }
+}
+
+/* Unlinks a node with no word and no middle child from its sibling tree and
+ * hands it to freeNodes. A node with both siblings is replaced by the leftmost
+ * node to its right.
+ * @param curr Index of the node
+ * @return Index of the node that takes its place, or NIL
+ */
+unsigned int DictionaryTrie::unlinkNode(unsigned int curr) {
+    TrieNode& node = nodes[curr];
+    unsigned int replacement = node.left == NIL ? node.right : node.left;
+    if (node.left != NIL && node.right != NIL) {
+        // nodes passed on the way down to the leftmost node on the right
+        vector<unsigned int> above;
+        replacement = node.right;
+        while (nodes[replacement].left != NIL) {
+            above.push_back(replacement);
+            replacement = nodes[replacement].left;
+        }
+        if (!above.empty()) {
+            nodes[above.back()].left = nodes[replacement].right;
+            nodes[replacement].right = node.right;
+        }
+        nodes[replacement].left = node.left;
+
+        // the nodes passed lost the replacement from below them
+        for (unsigned int i = above.size(); i > 0; i--) {
+            refreshNode(above[i - 1]);
         }
-        bool result = insertRec(word, freq, index + 1, curr->middle);
-        // update maxFreq
-        curr->maxFreq = std::max(curr->maxFreq, curr->middle->maxFreq);
+        refreshNode(replacement);
+    }
+
+    completionCache.erase(curr);  // nothing starts with its prefix now
+    node = TrieNode(0);
+    freeNodes.push_back(curr);
+    return replacement;
+}
+
+/* Adds a word to the word pool.
+ * @param word Word to add
+ * @return Id of the word
+ */
+unsigned int DictionaryTrie::addWord(string_view word) {
+    wordPool.append(word.data(), word.size());
+    wordStarts.push_back(wordPool.size());
+    poolData = wordPool.data();
+    startData = wordStarts.data();
+    return wordStarts.size() - 2;
+}
+
+/* Compares two words in the word pool alphabetically.
+ * @param a Id of the first word
+ * @param b Id of the second word
+ * @return Negative if a < b, 0 if equal and positive if a > b.
+ */
+int DictionaryTrie::compareWords(unsigned int a, unsigned int b) const {
+    unsigned int lenA = startData[a + 1] - startData[a];
+    unsigned int lenB = startData[b + 1] - startData[b];
+    int result = memcmp(poolData + startData[a], poolData + startData[b],
+                        std::min(lenA, lenB));
+    if (result != 0) {
         return result;
     }
+    return lenA < lenB ? -1 : (lenA > lenB ? 1 : 0);
+}
+
+/* Offers a word node to a search. The word goes in the heap if the heap is not
+ * full yet or the word beats the least frequent word in it.
+ * @param search State of the search: heap of word ids and threshold
+ * @param node Word node to offer
+ */
+void DictionaryTrie::offerWord(IdSearch& search, const TrieNode& node) const {
+    // Reached numCompletions, must consider removing
+    if (search.pq.size() == search.numCompletions) {
+        // add word only if current word freq > lowest freq
+        if (node.freq > search.pq.top().first) {
+            search.pq.pop();  // get rid of lowest freq word
+            search.pq.push(make_pair(node.freq, node.wordId));
+            TRIE_STAT_ADD(HEAP_POPS, 1);
+            TRIE_STAT_ADD(HEAP_PUSHES, 1);
+            search.threshold = search.pq.top().first;  // update threshold
+        }
+    } else {  // priority queue not full yet, just add word
+        search.pq.push(make_pair(node.freq, node.wordId));
+        TRIE_STAT_ADD(HEAP_PUSHES, 1);
+        // reached numCompletions, set threshold as minimum freq in pq
+        if (search.pq.size() == search.numCompletions) {
+            search.threshold = search.pq.top().first;
+        }
+    }
 }
 
-/* Helper method to find the given word recursively.
- * @param word Word to find
- * @param index Index of character we are at in the word
- * @param curr Current node we are checking
- * @return True if we find word so far. False otherwise.
+/* Finds the child with a letter in a wide node. The letters are compared a
+ * chunk at a time, with SSE2 where the target has it. Letters are unique, so
+ * a match in the padding past the children can only come after the real one.
+ * @param wide Index of the wide node
+ * @param letter Letter to find
+ * @return Index of the letter in the wide arrays, or NIL
+ */
+unsigned int DictionaryTrie::findWide(unsigned int wide, char letter) const {
+    const WideNode& node = wideNodes[wide];
+    const char* labels = wideLabels.data() + node.first;
+#if defined(__SSE2__)
+    __m128i key = _mm_set1_epi8(letter);
+    for (unsigned int i = 0; i < node.count; i += WIDE_CHUNK) {
+        __m128i chunk =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(labels + i));
+        unsigned int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, key));
+        if (mask != 0) {
+            unsigned int slot = i + __builtin_ctz(mask);
+            return slot < node.count ? node.first + slot : NIL;
+        }
+    }
+#else
+    for (unsigned int i = 0; i < node.count; i++) {
+        if (labels[i] == letter) {
+            return node.first + i;
+        }
+    }
+#endif
+    return NIL;
+}
+
+/* Walks one letter further down from the end of a prefix.
+ * @param prefixNode Node ending the prefix, or NIL for the empty prefix. Set
+ * to the node ending the longer prefix if there is one.
+ * @param letter Letter to add to the prefix
+ * @return True if the longer prefix is in the trie. False otherwise.
+ */
+bool DictionaryTrie::stepPrefix(unsigned int& prefixNode, char letter) const {
+    unsigned int curr = prefixNode == NIL ? root : nodeData[prefixNode].middle;
+    while (curr != NIL) {
+        const TrieNode& node = nodeData[curr];
+        TRIE_STAT_ADD(WALK_NODES, 1);
+        if (letter < node.data) {  // go left
+            curr = node.left;
+        } else if (letter > node.data) {  // go right
+            curr = node.right;
+        } else {  // found the letter
+            prefixNode = curr;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Walks the trie along a prefix.
+ * @param prefix Prefix to walk
+ * @param prefixNode Set to the node ending the prefix, or NIL for the empty
+ * prefix
+ * @return True if the prefix is in the trie. False otherwise.
  */
-bool DictionaryTrie::findRec(string word, unsigned int index,
-                             TrieNode* curr) const {
-    // cant find
-    if (curr == nullptr) {
+bool DictionaryTrie::walkPrefix(string_view prefix,
+                                unsigned int& prefixNode) const {
+    prefixNode = NIL;
+
+    // through the wide nodes while there are any, one compare per letter
+    unsigned int index = 0;
+    for (unsigned int wide = wideRoot; wide != NIL && index < prefix.length();
+         index++) {
+        unsigned int slot = findWide(wide, prefix[index]);
+        TRIE_STAT_ADD(WALK_NODES, 1);
+        if (slot == NIL) {
+            return false;
+        }
+        prefixNode = wideChildren[slot];
+        wide = wideNext[slot];
+    }
+    for (; index < prefix.length(); index++) {  // find node where prefix ends
+        if (!stepPrefix(prefixNode, prefix[index])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Finds up to numCompletions of most frequent completions of a prefix.
+ * @param prefix Prefix to complete
+ * @param numCompletions Number of words to find
+ * @return vector of (freq, word id) pairs, most frequent first
+ */
+vector<idPairing> DictionaryTrie::completePrefix(
+    string_view prefix, unsigned int numCompletions) const {
+    TRIE_STAT_QUERY();
+    unsigned int prefixNode;
+    if (numCompletions == 0 || !walkPrefix(prefix, prefixNode)) {
+        return vector<idPairing>();
+    }
+    return completeFromNode(prefixNode, prefix.length(), numCompletions);
+}
+
+/* Finds up to numCompletions of most frequent words matching a pattern.
+ * @param pattern Pattern with wild card to match to
+ * @param numCompletions Number of words to find
+ * @return vector of (freq, word id) pairs, most frequent first
+ */
+vector<idPairing> DictionaryTrie::matchPattern(
+    string_view pattern, unsigned int numCompletions) const {
+    TRIE_STAT_QUERY();
+    if (numCompletions == 0 || pattern.empty()) {
+        return vector<idPairing>();
+    }
+    IdSearch search(numCompletions, this);
+    searchPattern(pattern, search);
+    return takeResults(search);
+}
+
+/* Finds up to numCompletions of words starting within maxEdits edits of a
+ * prefix, fewest edits first, then most frequent.
+ * @param prefix Prefix to complete
+ * @param maxEdits Most edits a match may need
+ * @param numCompletions Number of words to find
+ * @return vector of (edits, (freq, word id)), best first
+ */
+vector<fuzzyPairing> DictionaryTrie::matchFuzzy(
+    string_view prefix, unsigned int maxEdits,
+    unsigned int numCompletions) const {
+    vector<fuzzyPairing> matches;
+    if (numCompletions == 0) {
+        return matches;
+    }
+
+    // words with the exact prefix need no edits, so they rank first. If
+    // there are enough of them the fuzzy search is not needed at all.
+    vector<idPairing> exact = completePrefix(prefix, numCompletions);
+    if (exact.size() == numCompletions || root == NIL) {
+        for (const idPairing& id : exact) {
+            matches.push_back(make_pair(0, id));
+        }
+        return matches;
+    }
+
+    // the passes skip the exact matches, so seed the heap with them
+    FuzzySearch search(prefix, maxEdits, numCompletions, this);
+    for (const idPairing& id : exact) {
+        search.pq.push(make_pair(0, id));
+    }
+
+    // the empty path is j edits away from the first j letters of the prefix
+    for (unsigned int j = 0; j <= prefix.length(); j++) {
+        search.rows[j] = j;
+    }
+    search.rowMins[0] = 0;
+
+    // words needing fewer edits rank first, so stop once the heap is full
+    for (search.edits = 1;
+         search.edits <= maxEdits && search.pq.size() < numCompletions;
+         search.edits++) {
+        fuzzyPass(search);
+    }
+
+    matches.resize(search.pq.size());
+    for (unsigned int i = matches.size(); i > 0; i--) {  // best last
+        matches[i - 1] = search.pq.top();
+        search.pq.pop();
+    }
+    return matches;
+}
+
+/* Returns true if no word in a subtree can get into a fuzzy search.
+ * @param search State of the search
+ * @param node Root of the subtree
+ * @param edits Fewest edits any word in the subtree can need
+ */
+bool DictionaryTrie::fuzzyPrunable(const FuzzySearch& search,
+                                   const TrieNode& node,
+                                   unsigned int edits) const {
+    if (edits > search.edits) {
+        return true;
+    }
+    if (search.pq.size() < search.numCompletions) {
         return false;
     }
+    // words are found in alphabetical order, so a tie with the worst match
+    // in the heap would lose
+    const fuzzyPairing& worst = search.pq.top();
+    return edits > worst.first ||
+           (edits == worst.first && node.maxFreq <= worst.second.first);
+}
 
-    // base case, last letter and found node
-    if (index == word.length() - 1 && word.at(index) == curr->data) {
-        return curr->word;  // if word or if not a word
+/* Offers a word node to a fuzzy search.
+ * @param search State of the search
+ * @param node Word node to offer
+ * @param edits Edits the word needs to match the prefix
+ */
+void DictionaryTrie::offerFuzzy(FuzzySearch& search, const TrieNode& node,
+                                unsigned int edits) const {
+    fuzzyPairing match = make_pair(edits, make_pair(node.freq, node.wordId));
+    if (search.pq.size() < search.numCompletions) {
+        search.pq.push(match);
+    } else if (FuzzyComp(this)(match, search.pq.top())) {
+        search.pq.pop();
+        search.pq.push(match);
     }
+}
 
-    if (word.at(index) < curr->data) {  // go left
-        return findRec(word, index, curr->left);
-    } else if (word.at(index) > curr->data) {  // go right
-        return findRec(word, index, curr->right);
-    } else {  // go down middle
-        return findRec(word, index + 1, curr->middle);
+/* Helper method for matchFuzzy to run one pass over the trie. Fills in the
+ * next row of edit distances at each node and goes down while some row entry
+ * is still within the edits of this pass. Offers the words needing exactly
+ * that many edits.
+ * @param search State of this search
+ */
+void DictionaryTrie::fuzzyPass(FuzzySearch& search) const {
+    unsigned int width = search.prefix.length() + 1;
+    StepStack stack(search.steps);
+    stack.push(root, 0, search.prefix.length(), false);
+    while (stack.size() > 0) {
+        Step step = stack.pop();
+        unsigned int curr = step.node;
+        unsigned int depth = step.depth;  // letters on the path above curr
+        unsigned int edits = step.edits;  // fewest edits of the path above
+        bool visited = step.visited;
+
+        // take the left subtree, the node, the middle then the right. Only
+        // the right subtree, and the node itself while its left subtree is
+        // taken, wait on the stack.
+        while (curr != NIL) {
+            const TrieNode& node = nodeData[curr];
+            if (!visited) {
+                // siblings share the row of the path above them, and longer
+                // paths can not get closer than the best entry of the row
+                unsigned int rowEdits = std::min(edits, search.rowMins[depth]);
+                if (fuzzyPrunable(search, node, rowEdits)) {
+                    break;
+                }
+                if (node.right != NIL) {
+                    stack.push(node.right, depth, edits, false);
+                }
+                if (node.left != NIL) {
+                    stack.push(curr, depth, edits, true);
+                    curr = node.left;
+                    continue;
+                }
+            }
+            visited = false;
+
+            // row for the path extended by this node's letter
+            const unsigned int* above = &search.rows[depth * width];
+            unsigned int* row = &search.rows[(depth + 1) * width];
+            row[0] = depth + 1;
+            unsigned int rowMin = row[0];
+            for (unsigned int j = 1; j < width; j++) {
+                unsigned int substitute =
+                    above[j - 1] + (search.prefix[j - 1] == node.data ? 0 : 1);
+                row[j] = std::min({above[j] + 1, row[j - 1] + 1, substitute});
+                rowMin = std::min(rowMin, row[j]);
+            }
+            search.rowMins[depth + 1] = rowMin;
+            unsigned int nodeEdits = std::min(edits, row[width - 1]);
+
+            // words needing fewer edits were found by the earlier passes, or
+            // seeded from completePrefix
+            curr = NIL;
+            if (nodeEdits >= search.edits) {
+                if (node.word && nodeEdits == search.edits) {
+                    offerFuzzy(search, node, nodeEdits);
+                }
+                if (rowMin < nodeEdits && rowMin <= search.edits) {
+                    curr = node.middle;  // go on down the middle
+                    depth++;
+                    edits = nodeEdits;
+                } else if (nodeEdits == search.edits) {
+                    // no longer path can do better, every word below ties
+                    fuzzyComplete(search, stack, node.middle, nodeEdits);
+                }
+            }
+        }
     }
 }
 
-/* Helper method for predictCompletions to recurse through subtree.
- * @param numCompletions Number of completions we need. Max size of heap.
- * @param curr Pointer to current node we are checking
- * @param word Word we are constructing
- * @param pq Priority queue used to sort frequency of words
+/* Helper method for fuzzyPass to offer every word in a subtree whose words all
+ * need the same number of edits.
+ * @param search State of this search
+ * @param stack Steps of the pass, left as they were found
+ * @param curr Index of the root of the subtree
+ * @param edits Edits every word in the subtree needs
  */
-void DictionaryTrie::predictCompletionsRec(
-    const unsigned int numCompletions, TrieNode* curr, string word,
-    std::priority_queue<pairing, vector<pairing>, Comp>& pq) {
-    // base case, if nullptr then return
-    if (curr == nullptr || curr->maxFreq <= threshold) {
+void DictionaryTrie::fuzzyComplete(FuzzySearch& search, StepStack& stack,
+                                   unsigned int curr,
+                                   unsigned int edits) const {
+    size_t base = stack.size();
+    stack.push(curr, 0, edits, false);
+    while (stack.size() > base) {
+        Step step = stack.pop();
+        unsigned int next = step.node;
+        if (step.visited) {  // the words left of this one are done
+            const TrieNode& node = nodeData[next];
+            if (node.word) {
+                offerFuzzy(search, node, edits);
+            }
+            next = node.middle;
+        }
+
+        // take the left subtree, the word, the middle then the right. Only
+        // the right subtree, and the node itself while its left subtree is
+        // taken, wait on the stack.
+        if (next != NIL && fuzzyPrunable(search, nodeData[next], edits)) {
+            continue;
+        }
+        while (next != NIL) {
+            const TrieNode& node = nodeData[next];
+            if (node.right != NIL) {
+                stack.push(node.right, 0, edits, false);
+            }
+            if (node.left != NIL &&
+                !fuzzyPrunable(search, nodeData[node.left], edits)) {
+                stack.push(next, 0, edits, true);
+                next = node.left;
+                continue;
+            }
+
+            // nothing left of this node can get in
+            if (node.word) {
+                offerFuzzy(search, node, edits);
+            }
+            next = node.middle;
+            if (next != NIL && fuzzyPrunable(search, nodeData[next], edits)) {
+                break;
+            }
+        }
+    }
+}
+
+/* Moves the words left in a search out of its heap.
+ * @param search State of a finished search
+ * @return vector of (freq, word id) pairs, most frequent first
+ */
+vector<idPairing> DictionaryTrie::takeResults(IdSearch& search) {
+    vector<idPairing> ids(search.pq.size());
+    TRIE_STAT_ADD(HEAP_POPS, ids.size());
+    for (unsigned int i = ids.size(); i > 0; i--) {  // most frequent last
+        ids[i - 1] = search.pq.top();
+        search.pq.pop();
+    }
+    return ids;
+}
+
+/* Finds up to numCompletions of most frequent words starting at a prefix node,
+ * most frequent first.
+ * @param prefixNode Node ending the prefix, or NIL for the empty prefix
+ * @param numCompletions Number of words to find
+ * @return vector of (freq, word id) pairs
+ */
+vector<idPairing> DictionaryTrie::topCompletionIds(
+    unsigned int prefixNode, unsigned int numCompletions) const {
+    IdSearch search(numCompletions, this);
+    searchCompletions(search, prefixNode);
+    return takeResults(search);
+}
+
+/* Helper method for topCompletionIds to offer the words starting at a prefix
+ * node to a search, in the search order the trie is set to.
+ * @param search State of this search: heap of word ids and threshold
+ * @param prefixNode Node ending the prefix, or NIL for the empty prefix
+ */
+void DictionaryTrie::searchCompletions(IdSearch& search,
+                                       unsigned int prefixNode) const {
+    if (bestFirst) {
+        completeBestFirst(search, prefixNode);
         return;
     }
 
-    predictCompletionsRec(numCompletions, curr->left, word, pq);  // check left
+    unsigned int start = root;
+    if (prefixNode != NIL) {
+        // the prefix itself is a completion if it is a word
+        if (nodeData[prefixNode].word) {
+            offerWord(search, nodeData[prefixNode]);
+        }
+        start = nodeData[prefixNode].middle;
+    }
+    completeSubtree(search, start);
+}
+
+/* Helper method for searchCompletions to offer the words of a subtree in
+ * alphabetical order, skipping subtrees with nothing frequent enough.
+ * @param search State of this search: heap of word ids and threshold
+ * @param curr Index of the root of the subtree
+ */
+void DictionaryTrie::completeSubtree(IdSearch& search,
+                                     unsigned int curr) const {
+    unsigned int visited = 0;
+    StepStack stack(search.steps);
+    stack.push(curr, 0, 0, false);
+    while (stack.size() > 0) {
+        Step step = stack.pop();
+        unsigned int next = step.node;
+        if (step.visited) {  // the words left of this one are done
+            const TrieNode& node = nodeData[next];
+            if (node.word) {
+                offerWord(search, node);
+            }
+            next = node.middle;
+        }
 
-    // if current is a word, add it to priority queue
-    if (curr->word) {
-        // Reached numCompletions, must consider removing
-        if (pq.size() == numCompletions) {
-            // add word only if current word freq > lowest freq
-            if (curr->freq > pq.top().first) {
-                pq.pop();  // get rid of lowest freq word
-                pq.push(make_pair(curr->freq,
-                                  word + curr->data));  // add new word
-                threshold = pq.top().first;             // update threshold
+        // take the left subtree, the word, the middle then the right. Only
+        // the right subtree, and the node itself while its left subtree is
+        // taken, wait on the stack.
+        while (next != NIL && nodeData[next].maxFreq > search.threshold) {
+            const TrieNode& node = nodeData[next];
+            visited++;
+            if (node.right != NIL) {
+                stack.push(node.right, 0, 0, false);
             }
-        } else {  // priority queue not full yet, just add word
-            pq.push(make_pair(curr->freq, word + curr->data));
-            if (pq.size() == numCompletions) {  // reached numCompletions
-                // set threshold as minimum freq in pq
-                threshold = pq.top().first;
+            if (node.left != NIL &&
+                nodeData[node.left].maxFreq > search.threshold) {
+                stack.push(next, 0, 0, true);
+                next = node.left;
+            } else {  // nothing frequent enough to the left
+                TRIE_STAT_ADD(SUBTREES_PRUNED, node.left != NIL);
+                if (node.word) {
+                    offerWord(search, node);
+                }
+                next = node.middle;
             }
         }
+        TRIE_STAT_ADD(SUBTREES_PRUNED, next != NIL);
     }
-    // check middle
-    predictCompletionsRec(numCompletions, curr->middle, word + curr->data, pq);
-    // check right
-    predictCompletionsRec(numCompletions, curr->right, word, pq);
+    search.visited += visited;
+    TRIE_STAT_ADD(NODES_VISITED, visited);
 }
 
-/* Helper method for predictUnderscores. Uses recursion.
- * @param pattern Pattern that the word should match
- * @param index Index of location in pattern we are at
- * @param numCompletions Number of completions we need. Max size of heap.
- * @param curr Pointer to current node we are checking
- * @param word Word we are constructing
- * @param pq Priority queue used to sort frequency of words
- */
-void DictionaryTrie::predictUnderscoresRec(
-    const string pattern, unsigned int index, const unsigned int numCompletions,
-    TrieNode* curr, string word,
-    std::priority_queue<pairing, vector<pairing>, Comp>& pq) {
-    // base case, we are at one level beyond or no more words
-    if (index >= pattern.length() || curr == nullptr) {
-        return;
+/* Helper method for searchCompletions to search best first. Subtrees wait on
+ * a frontier ordered by maxFreq, and the most promising one is opened up next.
+ * A word comes off the frontier only once nothing left on it can beat the
+ * word, so the search stops at the k-th word.
+ * @param search State of this search: heap of word ids
+ * @param prefixNode Node ending the prefix, or NIL for the empty prefix
+ */
+void DictionaryTrie::completeBestFirst(IdSearch& search,
+                                       unsigned int prefixNode) const {
+    FrontierComp comp(this);
+    vector<Frontier>& frontier = threadFrontier();
+    frontier.clear();
+
+    // like the depth first search, words of frequency 0 never get in
+    auto push = [&frontier, &comp](unsigned int freq, unsigned int node,
+                                   bool word) {
+        if (freq > 0) {
+            frontier.emplace_back(freq, node, word);
+            std::push_heap(frontier.begin(), frontier.end(), comp);
+            TRIE_STAT_ADD(HEAP_PUSHES, 1);
+        }
+    };
+    unsigned int start = root;
+    if (prefixNode != NIL) {
+        const TrieNode& node = nodeData[prefixNode];
+        if (node.word) {
+            push(node.freq, prefixNode, true);
+        }
+        start = node.middle;
+    }
+    if (start != NIL) {
+        push(nodeData[start].maxFreq, start, false);
     }
 
-    // check in alphabetical order to ensure correct for same freq
-    // check left only if wildcard or less than
-    if (pattern.at(index) == '_' || pattern.at(index) < curr->data) {
-        predictUnderscoresRec(pattern, index, numCompletions, curr->left, word,
-                              pq);
-    }
-
-    // consider adding word and going down middle only if still matching
-    if (pattern.at(index) == '_' || pattern.at(index) == curr->data) {
-        // if current is a word and end of pattern, add it to priority queue
-        if (curr->word && index == pattern.length() - 1) {
-            // Reached numCompletions, must consider removing
-            if (pq.size() == numCompletions) {
-                // add word only if current word freq > lowest freq
-                if (curr->freq > pq.top().first) {
-                    pq.pop();  // get rid of lowest freq word
-                    pq.push(make_pair(curr->freq,
-                                      word + curr->data));  // add new word
+    unsigned int visited = 0;
+    while (!frontier.empty() && search.pq.size() < search.numCompletions) {
+        std::pop_heap(frontier.begin(), frontier.end(), comp);
+        Frontier top = frontier.back();
+        frontier.pop_back();
+        TRIE_STAT_ADD(HEAP_POPS, 1);
+        if (top.word) {  // nothing left can beat it
+            offerWord(search, nodeData[top.node]);
+            continue;
+        }
+
+        // open up the subtree: its siblings, its word and the words below.
+        // A child as frequent as the subtree would come off the frontier
+        // next, so go straight down into it instead.
+        unsigned int curr = top.node;
+        while (curr != NIL) {
+            const TrieNode& node = nodeData[curr];
+            visited++;
+            unsigned int next = NIL;
+            for (unsigned int child : {node.left, node.middle, node.right}) {
+                if (child == NIL) {
+                    continue;
                 }
-            } else {  // priority queue not full yet, just add word
-                pq.push(make_pair(curr->freq, word + curr->data));
+                if (next == NIL && nodeData[child].maxFreq == node.maxFreq) {
+                    next = child;
+                } else {
+                    push(nodeData[child].maxFreq, child, false);
+                }
+            }
+            if (node.word) {
+                push(node.freq, curr, true);
+            }
+            curr = next;
+        }
+    }
+    search.visited += visited;
+
+    // whatever is still waiting on the frontier was never opened up
+    TRIE_STAT_ADD(NODES_VISITED, visited);
+    TRIE_STAT_ADD(SUBTREES_PRUNED, frontier.size());
+}
+
+/* Finds up to numCompletions of most frequent words starting at a prefix node,
+ * from its cached list if it has one.
+ * @param prefixNode Node ending the prefix, or NIL for the empty prefix
+ * @param prefixLength Number of letters in the prefix
+ * @param numCompletions Number of words to find
+ * @return vector of (freq, word id) pairs, most frequent first
+ */
+vector<idPairing> DictionaryTrie::completeFromNode(
+    unsigned int prefixNode, unsigned int prefixLength,
+    unsigned int numCompletions) const {
+    TRIE_STAT_QUERY();
+    if (numCompletions <= cacheSize && prefixLength <= cacheDepth) {
+        auto cached = completionCache.find(prefixNode);
+        if (cached != completionCache.end()) {
+            unsigned int count =
+                std::min<size_t>(numCompletions, cached->second.size());
+            return vector<idPairing>(cached->second.begin(),
+                                     cached->second.begin() + count);
+        }
+    }
+    return topCompletionIds(prefixNode, numCompletions);
+}
+
+/* Helper method for predictCompletionsBatch. Answers the queries
+ * order[first, last), which are sorted by prefix, walking each shared leading
+ * path of the prefixes once.
+ * @param prefixes Prefixes of the whole batch
+ * @param order Indexes of the prefixes in sorted order
+ * @param first First position in order to answer
+ * @param last One past the last position in order to answer
+ * @param numCompletions Number of completions per prefix
+ * @param results Set to the completions of each query, by query index
+ */
+void DictionaryTrie::completeSorted(const vector<string_view>& prefixes,
+                                    const vector<unsigned int>& order,
+                                    unsigned int first, unsigned int last,
+                                    unsigned int numCompletions,
+                                    vector<vector<idPairing>>& results) const {
+    // path of the previous prefix: the node ending each of its first d
+    // letters is path[d], with path[0] = NIL standing for the empty prefix
+    vector<unsigned int> path(1, NIL);
+    string_view previous;
+
+    for (unsigned int i = first; i < last; i++) {
+        string_view prefix = prefixes[order[i]];
+        if (i > first && prefix == previous) {  // same prefix, same answer
+            results[order[i]] = results[order[i - 1]];
+            continue;
+        }
+
+        // resume from the longest part of the previous path still shared
+        unsigned int shared = 0;
+        while (shared < prefix.length() && shared < previous.length() &&
+               shared + 1 < path.size() && prefix[shared] == previous[shared]) {
+            shared++;
+        }
+        path.resize(shared + 1);
+        previous = prefix;
+
+        // walk the rest of the prefix
+        unsigned int curr =
+            path.back() == NIL ? root : nodeData[path.back()].middle;
+        unsigned int index = shared;
+        while (index < prefix.length() && curr != NIL) {
+            const TrieNode& node = nodeData[curr];
+            if (prefix[index] < node.data) {
+                curr = node.left;
+            } else if (prefix[index] > node.data) {
+                curr = node.right;
+            } else {
+                index++;
+                path.push_back(curr);
+                curr = node.middle;
             }
         }
+        if (index == prefix.length()) {
+            results[order[i]] =
+                completeFromNode(path.back(), prefix.length(), numCompletions);
+        }
+    }
+}
+
+/* Moves a word that was inserted, erased or given a new frequency to its
+ * place in every cached list along its path.
+ * @param word Word that changed
+ * @param freq New frequency of the word
+ * @param id Id of the word
+ * @param erased True if the word was erased
+ */
+void DictionaryTrie::updateCompletionCache(string_view word,
+                                           unsigned int freq, unsigned int id,
+                                           bool erased) {
+    if (completionCache.empty()) {
+        return;
+    }
+
+    vector<unsigned int> prefixNodes;  // nodes ending each cached prefix
+    prefixNodes.push_back(NIL);
+    unsigned int curr = root;
+    unsigned int index = 0;
+    while (curr != NIL && index < word.length()) {
+        if (word.at(index) < nodeData[curr].data) {
+            curr = nodeData[curr].left;
+        } else if (word.at(index) > nodeData[curr].data) {
+            curr = nodeData[curr].right;
+        } else {
+            index++;
+            if (index <= cacheDepth) {
+                prefixNodes.push_back(curr);
+            }
+            curr = nodeData[curr].middle;
+        }
+    }
+
+    for (unsigned int prefixNode : prefixNodes) {
+        auto cached = completionCache.find(prefixNode);
+        if (cached == completionCache.end()) {
+            continue;  // new or over budget prefix, answered by search
+        }
+        vector<idPairing>& ids = cached->second;
+
+        // take the word out of the list if it is in it. A full list then
+        // misses a word, and only a search knows which one.
+        bool full = ids.size() >= cacheSize;
+        unsigned int pos = 0;
+        while (pos < ids.size() && ids[pos].second != id) {
+            pos++;
+        }
+        unsigned int oldFreq = pos < ids.size() ? ids[pos].first : 0;
+        bool listed = pos < ids.size();
+        if (listed) {
+            ids.erase(ids.begin() + pos);
+        }
+        if (erased) {
+            if (listed && full) {
+                ids = topCompletionIds(prefixNode, cacheSize);
+            }
+            continue;
+        }
+
+        // find where the word ranks, most frequent first
+        pos = 0;
+        while (pos < ids.size()) {
+            if (freq > ids[pos].first ||
+                (freq == ids[pos].first &&
+                 compareWords(id, ids[pos].second) < 0)) {
+                break;
+            }
+            pos++;
+        }
+        if (listed && full && freq < oldFreq && pos == ids.size()) {
+            // the word dropped below every listed word, and so may have
+            // dropped below a word left out of the list
+            ids = topCompletionIds(prefixNode, cacheSize);
+        } else if (pos < cacheSize) {
+            ids.insert(ids.begin() + pos, make_pair(freq, id));
+            if (ids.size() > cacheSize) {
+                ids.pop_back();
+            }
+        }
+    }
+}
+
+/* Appends the start of each run of entries [first, last) sharing the letter at
+ * depth, followed by last, to a list of groups.
+ * @param entries Sorted entries sharing their first depth letters
+ * @param first First entry to split
+ * @param last One past the last entry to split
+ * @param depth Index of the letter to split on
+ * @param groups List to append the runs to
+ */
+static void appendGroups(const vector<entry>& entries, unsigned int first,
+                         unsigned int last, unsigned int depth,
+                         vector<unsigned int>& groups) {
+    for (unsigned int i = first; i < last; i++) {
+        if (i == first ||
+            entries[i].first[depth] != entries[i - 1].first[depth]) {
+            groups.push_back(i);
+        }
+    }
+    groups.push_back(last);
+}
+
+/* Helper method for bulkInsert to build the trie from sorted, unique entries
+ * into the empty arena. Each sibling tree is built balanced around its median
+ * letter, and maxFreq and the word lengths are filled in bottom up.
+ * @param entries Sorted entries to build from
+ * @return Index of the root, or NIL if no entries
+ */
+unsigned int DictionaryTrie::buildBalanced(const vector<entry>& entries) {
+    // runs of entries sharing a letter, one level after another. A level is
+    // dropped once the sibling tree built from it is finished.
+    vector<unsigned int> groups;
+    vector<BuildStep> steps;
+    unsigned int top = NIL;
+    appendGroups(entries, 0, entries.size(), 0, groups);
+    steps.push_back({0, (unsigned int)groups.size() - 1, 0, NIL, 'm'});
+
+    while (!steps.empty()) {
+        BuildStep step = steps.back();
+        steps.pop_back();
+
+        if (step.side == 'f') {
+            // fill in maxFreq and word lengths from the finished children
+            refreshNode(step.parent);
+            groups.resize(step.lo);
+            continue;
+        }
+        if (step.lo >= step.hi) {  // no letters, the child stays NIL
+            continue;
+        }
+
+        // the median letter becomes the root of this sibling tree
+        unsigned int mid = step.lo + (step.hi - step.lo) / 2;
+        unsigned int first = groups[mid];
+        unsigned int last = groups[mid + 1];
+        unsigned int curr = newNode(entries[first].first[step.depth]);
+        if (step.parent == NIL) {
+            top = curr;
+        } else if (step.side == 'l') {
+            nodes[step.parent].left = curr;
+        } else if (step.side == 'r') {
+            nodes[step.parent].right = curr;
+        } else {
+            nodes[step.parent].middle = curr;
+        }
 
-        predictUnderscoresRec(pattern, index + 1, numCompletions, curr->middle,
-                              word + curr->data, pq);  // check middle
+        // a word ending here sorts before the longer words sharing the letter
+        if (entries[first].first.length() == step.depth + 1) {
+            nodes[curr].word = true;
+            nodes[curr].freq = entries[first].second;
+            nodes[curr].wordId = addWord(entries[first].first);
+            first++;
+        }
+
+        // build the left tree, the right tree and the next level down the
+        // middle, then finish this node, so push them last first
+        unsigned int level = groups.size();
+        steps.push_back({level, 0, 0, curr, 'f'});
+        if (first < last) {
+            appendGroups(entries, first, last, step.depth + 1, groups);
+            steps.push_back({level, (unsigned int)groups.size() - 1,
+                             step.depth + 1, curr, 'm'});
+        }
+        steps.push_back({mid + 1, step.hi, step.depth, curr, 'r'});
+        steps.push_back({step.lo, mid, step.depth, curr, 'l'});
     }
+    return top;
+}
+/* Helper method for matchPattern to offer the words matching a pattern in
+ * alphabetical order.
+ * @param pattern Pattern that the word should match
+ * @param search State of this search: heap of word ids
+ */
+void DictionaryTrie::searchPattern(string_view pattern,
+                                   IdSearch& search) const {
+    StepStack stack(search.steps);
+    stack.push(root, 0, 0, false);
+    while (stack.size() > 0) {
+        Step step = stack.pop();
+        if (step.visited) {  // the matches left of this one are done
+            offerWord(search, nodeData[step.node]);
+            continue;
+        }
+
+        // check in alphabetical order to ensure correct for same freq: the
+        // left subtree, the word, the middle then the right, so push them
+        // last first. Siblings match the same letter of the pattern.
+        unsigned int index = step.depth;
+        unsigned int next = step.node;
+        while (next != NIL) {
+            const TrieNode& node = nodeData[next];
+            TRIE_STAT_ADD(NODES_VISITED, 1);
+
+            // prune subtrees with nothing frequent enough once the heap is
+            // full, so words of frequency 0 still fill it, or with no word as
+            // long as the pattern
+            if ((search.pq.size() == search.numCompletions &&
+                 node.maxFreq <= search.threshold) ||
+                !node.mayHaveLength(pattern.length() - index)) {
+                TRIE_STAT_ADD(SUBTREES_PRUNED, 1);
+                break;
+            }
 
-    // check right only if underscore or greater than
-    if (pattern.at(index) == '_' || pattern.at(index) > curr->data) {
-        predictUnderscoresRec(pattern, index, numCompletions, curr->right, word,
-                              pq);
+            // check right only if underscore or greater than
+            if (node.right != NIL &&
+                (pattern[index] == '_' || pattern[index] > node.data)) {
+                stack.push(node.right, index, 0, false);
+            }
+
+            // check left only if wildcard or less than
+            bool left = node.left != NIL &&
+                        (pattern[index] == '_' || pattern[index] < node.data);
+
+            // consider adding word and going down middle only if matching
+            if (pattern[index] == '_' || pattern[index] == node.data) {
+                if (index < pattern.length() - 1) {
+                    if (node.middle != NIL) {
+                        stack.push(node.middle, index + 1, 0, false);
+                    }
+                } else if (node.word && left) {  // end of pattern
+                    stack.push(next, index, 0, true);
+                } else if (node.word) {  // nothing to the left, offer now
+                    offerWord(search, node);
+                }
+            }
+            next = left ? node.left : NIL;
+        }
     }
-}
\ No newline at end of file
+}
@@ -12,114 +12,649 @@
 
 #include <queue>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <utility>
 #include <vector>
+#include "Dictionary.hpp"
 
 using namespace std;
 
-typedef pair<unsigned int, string> pairing;  // used in predictCompletions
+typedef pair<unsigned int, idPairing> fuzzyPairing;  // (edits, (freq, id))
+
+/**
+ * The completions of a batch of prefixes, stored back to back in one buffer.
+ * Query i has count(i) completions, most frequent first.
+ */
+class CompletionBatch {
+  private:
+    friend class DictionaryTrie;
+
+    string text;                       // every completion, back to back
+    vector<unsigned int> wordStarts;   // offset of each completion in text
+    vector<unsigned int> queryStarts;  // first completion of each query
+
+  public:
+    /* Returns the number of queries in the batch. */
+    unsigned int size() const { return queryStarts.size() - 1; }
+
+    /* Returns the number of completions found for a query.
+     * @param query Index of the query in the batch
+     */
+    unsigned int count(unsigned int query) const {
+        return queryStarts[query + 1] - queryStarts[query];
+    }
+
+    /* Returns one completion of a query. Valid while the batch is alive.
+     * @param query Index of the query in the batch
+     * @param rank Rank of the completion, 0 being the most frequent
+     */
+    string_view at(unsigned int query, unsigned int rank) const {
+        unsigned int word = queryStarts[query] + rank;
+        return string_view(text.data() + wordStarts[word],
+                           wordStarts[word + 1] - wordStarts[word]);
+    }
+};
+
 /**
  * The class for a dictionary ADT, implemented as either
  * a mulit-way trie or a ternary search tree.
  */
-class DictionaryTrie {
+class DictionaryTrie final : public Dictionary {
   private:
+    friend class CompactTrie;
+    friend class SuccinctTrie;
+    friend class ShardedTrie;
+    friend class CompletionSession;
+
     /* The class for a trie node that will store a letter to help build up the
-     * ternary search tree.
+     * ternary search tree. Nodes live in one contiguous arena and refer to
+     * their children by index instead of by pointer.
      */
     class TrieNode {
       public:
-        TrieNode* left;
-        TrieNode* right;
-        TrieNode* middle;
-        char const data;       // the constant data in this node
-        bool word;             // determines if this is a word node
+        unsigned int left;     // index of left child in the arena, or NIL
+        unsigned int right;    // index of right child in the arena, or NIL
+        unsigned int middle;   // index of middle child in the arena, or NIL
         unsigned int freq;     // frequency of this word if word node
         unsigned int maxFreq;  // maxFrequency in the subtree
+        unsigned int wordId;   // id of the word in the word pool if word node
+        char data;             // the data in this node
+        bool word;             // determines if this is a word node
+        unsigned char minLength;  // fewest letters left to a word end in the
+                                  // subtree, from this node on, capped
+        unsigned char maxLength;  // most letters left to a word end in the
+                                  // subtree, from this node on, capped
 
         /* Constructor.
          * Initializes a TrieNode with given data.
          * @param c Data/element of this node
          */
-        TrieNode(const char& d) : data(d), word(false), freq(0), maxFreq(0) {
-            left = right = middle = nullptr;
+        TrieNode(const char& d)
+            : left(NIL),
+              right(NIL),
+              middle(NIL),
+              freq(0),
+              maxFreq(0),
+              wordId(NIL),
+              data(d),
+              word(false),
+              minLength(LENGTH_CAP),
+              maxLength(0) {}
+
+        /* Widens the range of word lengths in the subtree to take in one
+         * more word.
+         * @param remaining Letters the word has from this node on
+         */
+        void addLength(unsigned int remaining) {
+            unsigned char length =
+                remaining < LENGTH_CAP ? remaining : LENGTH_CAP;
+            minLength = length < minLength ? length : minLength;
+            maxLength = length > maxLength ? length : maxLength;
         }
 
-        /* Deconstructor.
-         * Deallocates the child pointers.
+        /* Returns false if no word in the subtree has exactly the given
+         * number of letters left from this node on.
+         * @param remaining Letters left to match
          */
-        ~TrieNode() {
-            delete left;
-            delete right;
-            delete middle;
+        bool mayHaveLength(unsigned int remaining) const {
+            return remaining >= minLength &&
+                   (maxLength == LENGTH_CAP || remaining <= maxLength);
         }
     };
     typedef DictionaryTrie::TrieNode TrieNode;
 
-    /* Comparator class to determine how to sort in the priority queue for
-     * predictions.
+    /* Comparator class to determine how to sort (freq, word id) pairs in the
+     * priority queue for predictions, looking the words up in the word pool
+     * to break ties.
      */
-    class Comp {
+    class IdComp {
       public:
-        /* Compare function. In order of first in pair and reverse order of
-         * second if tied.
+        const DictionaryTrie* trie;  // trie whose word pool holds the ids
+
+        /* Constructor.
+         * @param t Trie whose word pool holds the ids
+         */
+        explicit IdComp(const DictionaryTrie* t) : trie(t) {}
+
+        /* Compare function. In order of first in pair and reverse
+         * alphabetical order of the words if tied.
          * @param a First pair to compare with second pair
          * @param b Second pair to compare with first pair
          * @return True if a > b, false if a < b.
          */
-        bool operator()(const pairing& a,
-                        const pairing& b) {
-            if (a.first ==
-                b.first) {  // if freq equal, reverse alphabetical order
-                return a.second < b.second;
+        bool operator()(const idPairing& a, const idPairing& b) const {
+            if (a.first == b.first) {
+                return trie->compareWords(a.second, b.second) < 0;
             }
             return a.first > b.first;
         }
     };
 
-    TrieNode* root;  // pointer to root of the dictionary trie, or 0 if empty
-    unsigned int threshold;  // threshold for min frequency in predictions vec
+    /* A step of an iterative depth first search: either the visit of the
+     * subtree at a node, or the work left at a node once the subtree to its
+     * left is done. Searches keep their steps on an explicit stack, so deep
+     * tries can not overflow the call stack.
+     */
+    class Step {
+      public:
+        unsigned int node;   // index of the node
+        unsigned int depth;  // number of letters on the path above the node
+        unsigned int edits;  // fewest edits of the path above, fuzzy only
+        bool visited;        // true once the subtree left of it is taken
+
+        /* Constructor.
+         * @param n Index of the node
+         * @param d Number of letters on the path above the node
+         * @param e Fewest edits of the path above the node
+         * @param v True if the subtree left of the node is taken
+         */
+        Step(unsigned int n, unsigned int d, unsigned int e, bool v)
+            : node(n), depth(d), edits(e), visited(v) {}
+    };
+
+    /* The stack of steps of one search. The steps live in a vector that is
+     * reused from one search to the next and only ever grows, while the top
+     * is kept in the stack itself so it can stay in a register.
+     */
+    class StepStack {
+      private:
+        vector<Step>& storage;  // memory the steps live in
+        Step* steps;            // storage.data()
+        size_t room;            // storage.size()
+        size_t top;             // number of steps on the stack
+
+      public:
+        /* Constructor.
+         * @param s Memory for the steps, reused from earlier searches
+         */
+        explicit StepStack(vector<Step>& s)
+            : storage(s), steps(s.data()), room(s.size()), top(0) {}
+
+        /* Returns the number of steps on the stack. */
+        size_t size() const { return top; }
+
+        /* Pushes a step, growing the memory if it is full. */
+        void push(unsigned int n, unsigned int d, unsigned int e, bool v) {
+            if (top == room) {
+                storage.resize(2 * room + 16, Step(NIL, 0, 0, false));
+                steps = storage.data();
+                room = storage.size();
+            }
+            steps[top++] = Step(n, d, e, v);
+        }
+
+        /* Pops the step on top. The stack must not be empty. */
+        Step pop() { return steps[--top]; }
+    };
+
+    /* Returns the calling thread's memory for search steps. A search leaves
+     * nothing on its stack, so the searches of a thread take turns with it.
+     */
+    static vector<Step>& threadSteps();
+
+    /* An entry on the frontier of a best first search: a subtree keyed by its
+     * maxFreq, or a single word keyed by its frequency.
+     */
+    class Frontier {
+      public:
+        unsigned int freq;  // maxFreq of the subtree, or freq of the word
+        unsigned int node;  // index of the root of the subtree, or word node
+        bool word;          // true for a word, false for a subtree
+
+        /* Constructor.
+         * @param f Key of the entry
+         * @param n Index of the node
+         * @param w True for a word, false for a subtree
+         */
+        Frontier(unsigned int f, unsigned int n, bool w)
+            : freq(f), node(n), word(w) {}
+    };
+
+    /* Comparator class to order the frontier of a best first search as a max
+     * heap. Higher keys come first, and a subtree comes before a word with
+     * the same key, so words come off the frontier in the order of the
+     * results: most frequent first, then alphabetical.
+     */
+    class FrontierComp {
+      public:
+        const DictionaryTrie* trie;  // trie the nodes belong to
+
+        /* Constructor.
+         * @param t Trie the nodes belong to
+         */
+        explicit FrontierComp(const DictionaryTrie* t) : trie(t) {}
+
+        /* Compare function.
+         * @param a First entry to compare with second entry
+         * @param b Second entry to compare with first entry
+         * @return True if a comes off the frontier after b.
+         */
+        bool operator()(const Frontier& a, const Frontier& b) const {
+            if (a.freq != b.freq) {
+                return a.freq < b.freq;
+            }
+            if (a.word != b.word) {
+                return a.word;
+            }
+            return a.word && trie->compareWords(trie->nodeData[a.node].wordId,
+                                                trie->nodeData[b.node].wordId) >
+                                 0;
+        }
+    };
+
+    /* Returns the calling thread's memory for the frontier of best first
+     * searches, reused from one query to the next like threadSteps.
+     */
+    static vector<Frontier>& threadFrontier();
+
+    /* State of one top completions search: the heap of the best words found
+     * so far and the frequency a word must beat to get in. Every query keeps
+     * its own, so a trie can be searched from many threads at once.
+     */
+    class IdSearch {
+      public:
+        const unsigned int numCompletions;  // number of completions we need
+        unsigned int threshold;  // min frequency in the heap once it is full
+        std::priority_queue<idPairing, vector<idPairing>, IdComp>
+            pq;  // (freq, word id) of the best words so far
+        vector<Step>& steps;  // memory for the steps left to take
+        unsigned int visited;  // number of nodes the search looked at
+
+        /* Constructor.
+         * @param k Number of completions we need. Max size of heap.
+         * @param trie Trie whose word pool holds the ids
+         */
+        IdSearch(unsigned int k, const DictionaryTrie* trie)
+            : numCompletions(k),
+              threshold(0),
+              pq(IdComp(trie)),
+              steps(threadSteps()),
+              visited(0) {}
+    };
+
+    /* Comparator class to rank fuzzy matches in the priority queue: fewer
+     * edits first, then higher frequency, then alphabetical order.
+     */
+    class FuzzyComp {
+      public:
+        const DictionaryTrie* trie;  // trie whose word pool holds the ids
+
+        /* Constructor.
+         * @param t Trie whose word pool holds the ids
+         */
+        explicit FuzzyComp(const DictionaryTrie* t) : trie(t) {}
+
+        /* Compare function.
+         * @param a First match to compare with second match
+         * @param b Second match to compare with first match
+         * @return True if a ranks before b, false otherwise.
+         */
+        bool operator()(const fuzzyPairing& a, const fuzzyPairing& b) const {
+            if (a.first != b.first) {
+                return a.first < b.first;
+            }
+            return IdComp(trie)(a.second, b.second);
+        }
+    };
+
+    /* State of one fuzzy completion search: the heap of the best matches so
+     * far and the rows of edit distances between the prefix and the path
+     * from the root, one row per depth. The trie is searched once for each
+     * number of edits, fewest first, until the heap is full.
+     */
+    class FuzzySearch {
+      public:
+        const string_view prefix;           // prefix the words should match
+        const unsigned int numCompletions;  // number of completions we need
+        unsigned int edits;  // edits of the words this pass looks for
+        vector<unsigned int> rows;  // edit distances of every prefix of the
+                                    // query to the path, prefix + 1 per depth
+        vector<unsigned int> rowMins;  // smallest distance in each row
+        std::priority_queue<fuzzyPairing, vector<fuzzyPairing>, FuzzyComp>
+            pq;  // (edits, (freq, word id)) of the best matches so far
+        vector<Step>& steps;  // memory for the steps left to take
+
+        /* Constructor.
+         * @param p Prefix the words should match
+         * @param e Most edits a match may need
+         * @param k Number of completions we need. Max size of heap.
+         * @param trie Trie whose word pool holds the ids
+         */
+        FuzzySearch(string_view p, unsigned int e, unsigned int k,
+                    const DictionaryTrie* trie)
+            : prefix(p),
+              numCompletions(k),
+              edits(0),
+              rows((p.length() + 1) * (p.length() + e + 2)),
+              rowMins(p.length() + e + 2),
+              pq(FuzzyComp(trie)),
+              steps(threadSteps()) {}
+    };
+
+    static const unsigned int NIL = 0xFFFFFFFF;  // index of a missing node
+    static const unsigned char LENGTH_CAP = 255;  // longest length a node
+                                                  // tracks exactly
+
+    vector<TrieNode> nodes;  // arena holding every node of the trie
+    unsigned int root;       // index of root of the dictionary trie, or NIL
+    vector<pair<unsigned int, unsigned int>>
+        updatePath;  // (node, letters left) walked by the last insert or
+                     // update, kept to reuse
+    vector<unsigned int> freeNodes;  // unlinked nodes newNode hands out again
+
+    string wordPool;                  // every word, stored back to back
+    vector<unsigned int> wordStarts;  // offset of each word id in wordPool
+    unsigned int erasedWords;  // ids in the word pool whose word was erased
+
+    // views that queries read through. They point into the vectors above, or
+    // into the mapped snapshot file when the trie was loaded from one.
+    const TrieNode* nodeData;       // node array
+    unsigned int nodeCount;         // number of nodes in nodeData
+    const char* poolData;           // word pool
+    const unsigned int* startData;  // word start offsets
+    void* mapping;                  // mapped snapshot file, or nullptr
+    size_t mappingSize;             // bytes in the mapped snapshot file
+
+    // precomputed completions, keyed by the node ending the prefix (NIL for
+    // the empty prefix). Each list holds (freq, word id), most frequent first.
+    unordered_map<unsigned int, vector<idPairing>> completionCache;
+    unsigned int cacheDepth;  // longest prefix that may have a cached list
+    unsigned int cacheSize;   // number of completions kept per list, 0 if off
+    size_t cacheBudget;       // byte budget the cached lists were built with
+    bool bestFirst;  // true to search completions best first, not in order
+
+    /* A wide node: the children of a prefix listed as a sorted array of
+     * their letters, found with a few vector compares instead of a walk
+     * down their sibling tree. Its entries are [first, first + count) of
+     * the wide arrays below, padded to whole chunks of WIDE_CHUNK letters.
+     */
+    class WideNode {
+      public:
+        unsigned int first;  // index of the first letter in wideLabels
+        unsigned int count;  // number of children
+    };
+    static const unsigned int WIDE_CHUNK = 16;  // letters compared at once
+
+    vector<WideNode> wideNodes;  // wide nodes of the shallow prefixes
+    vector<char> wideLabels;     // letters of the children, in order
+    vector<unsigned int> wideChildren;  // node of each letter
+    vector<unsigned int> wideNext;  // wide node of the children of each
+                                    // letter's node, or NIL
+    unsigned int wideRoot;  // wide node of the root's siblings, or NIL
+    unsigned int wideDepth;  // prefixes shorter than this may have wide
+                             // nodes, 0 if off
+    unsigned int wideMinChildren;  // fewest children a wide node has
+    unsigned long long changes;  // bumped by every change to the results
+
+    /* Adds a word to the word pool.
+     * @param word Word to add
+     * @return Id of the word
+     */
+    unsigned int addWord(string_view word);
+
+    /* Unmaps the snapshot backing the trie, if any. */
+    void unmapSnapshot();
+
+    /* Checks that a mapped snapshot file is one saveSnapshot could have
+     * written: every section fits in the file, every child index is a node
+     * and every word node and word start lies inside the word pool.
+     * @param base Start of the mapped file
+     * @param size Bytes in the mapped file
+     * @return True if queries can read the snapshot safely
+     */
+    static bool validSnapshot(const char* base, size_t size);
+
+    /* Returns the number of ids handed out, erased words included. */
+    unsigned int idCount() const;
+
+    /* Compares two words in the word pool alphabetically.
+     * @param a Id of the first word
+     * @param b Id of the second word
+     * @return Negative if a < b, 0 if equal and positive if a > b.
+     */
+    int compareWords(unsigned int a, unsigned int b) const;
+
+    /* Offers a word node to a search. The word goes in the heap if the heap
+     * is not full yet or the word beats the least frequent word in it.
+     * @param search State of the search: heap of word ids and threshold
+     * @param node Word node to offer
+     */
+    void offerWord(IdSearch& search, const TrieNode& node) const;
+
+    /* Finds the child with a letter in a wide node.
+     * @param wide Index of the wide node
+     * @param letter Letter to find
+     * @return Index of the letter in the wide arrays, or NIL
+     */
+    unsigned int findWide(unsigned int wide, char letter) const;
+
+    /* Helper method for enableWideNodes to build the wide node of a sibling
+     * tree and, below it, those of its children's sibling trees.
+     * @param siblings Index of the root of the sibling tree
+     * @param depth Number of letters of the prefix the siblings follow
+     * @return Index of the wide node, or NIL if the siblings are too few
+     */
+    unsigned int buildWide(unsigned int siblings, unsigned int depth);
+
+    /* Walks one letter further down from the end of a prefix.
+     * @param prefixNode Node ending the prefix, or NIL for the empty prefix.
+     * Set to the node ending the longer prefix if there is one.
+     * @param letter Letter to add to the prefix
+     * @return True if the longer prefix is in the trie. False otherwise.
+     */
+    bool stepPrefix(unsigned int& prefixNode, char letter) const;
+
+    /* Walks the trie along a prefix.
+     * @param prefix Prefix to walk
+     * @param prefixNode Set to the node ending the prefix, or NIL for the
+     * empty prefix
+     * @return True if the prefix is in the trie. False otherwise.
+     */
+    bool walkPrefix(string_view prefix, unsigned int& prefixNode) const;
+
+    /* Finds up to numCompletions of most frequent completions of a prefix.
+     * @param prefix Prefix to complete
+     * @param numCompletions Number of words to find
+     * @return vector of (freq, word id) pairs, most frequent first
+     */
+    vector<idPairing> completePrefix(string_view prefix,
+                                     unsigned int numCompletions) const;
+
+    /* Finds up to numCompletions of most frequent words matching a pattern.
+     * @param pattern Pattern with wild card to match to
+     * @param numCompletions Number of words to find
+     * @return vector of (freq, word id) pairs, most frequent first
+     */
+    vector<idPairing> matchPattern(string_view pattern,
+                                   unsigned int numCompletions) const;
+
+    /* Finds up to numCompletions of words starting within maxEdits edits of
+     * a prefix, fewest edits first, then most frequent.
+     * @param prefix Prefix to complete
+     * @param maxEdits Most edits a match may need
+     * @param numCompletions Number of words to find
+     * @return vector of (edits, (freq, word id)), best first
+     */
+    vector<fuzzyPairing> matchFuzzy(string_view prefix, unsigned int maxEdits,
+                                    unsigned int numCompletions) const;
+
+    /* Returns true if no word in a subtree can get into a fuzzy search.
+     * @param search State of the search
+     * @param node Root of the subtree
+     * @param edits Fewest edits any word in the subtree can need
+     */
+    bool fuzzyPrunable(const FuzzySearch& search, const TrieNode& node,
+                       unsigned int edits) const;
+
+    /* Offers a word node to a fuzzy search.
+     * @param search State of the search
+     * @param node Word node to offer
+     * @param edits Edits the word needs to match the prefix
+     */
+    void offerFuzzy(FuzzySearch& search, const TrieNode& node,
+                    unsigned int edits) const;
+
+    /* Helper method for matchFuzzy to run one pass over the trie. Fills in
+     * the next row of edit distances at each node and goes down while some
+     * row entry is still within the edits of this pass. Offers the words
+     * needing exactly that many edits.
+     * @param search State of this search
+     */
+    void fuzzyPass(FuzzySearch& search) const;
+
+    /* Helper method for fuzzyPass to offer every word in a subtree whose
+     * words all need the same number of edits.
+     * @param search State of this search
+     * @param stack Steps of the pass, left as they were found
+     * @param curr Index of the root of the subtree
+     * @param edits Edits every word in the subtree needs
+     */
+    void fuzzyComplete(FuzzySearch& search, StepStack& stack,
+                       unsigned int curr, unsigned int edits) const;
+
+    /* Moves the words left in a search out of its heap.
+     * @param search State of a finished search
+     * @return vector of (freq, word id) pairs, most frequent first
+     */
+    static vector<idPairing> takeResults(IdSearch& search);
+
+    /* Finds up to numCompletions of most frequent words starting at a prefix
+     * node, most frequent first.
+     * @param prefixNode Node ending the prefix, or NIL for the empty prefix
+     * @param numCompletions Number of words to find
+     * @return vector of (freq, word id) pairs
+     */
+    vector<idPairing> topCompletionIds(unsigned int prefixNode,
+                                       unsigned int numCompletions) const;
+
+    /* Helper method for topCompletionIds to offer the words starting at a
+     * prefix node to a search, in the search order the trie is set to.
+     * @param search State of this search: heap of word ids and threshold
+     * @param prefixNode Node ending the prefix, or NIL for the empty prefix
+     */
+    void searchCompletions(IdSearch& search, unsigned int prefixNode) const;
+
+    /* Helper method for searchCompletions to offer the words of a subtree in
+     * alphabetical order, skipping subtrees with nothing frequent enough.
+     * @param search State of this search: heap of word ids and threshold
+     * @param curr Index of the root of the subtree
+     */
+    void completeSubtree(IdSearch& search, unsigned int curr) const;
+
+    /* Helper method for searchCompletions to search best first. Subtrees
+     * wait on a frontier ordered by maxFreq, and the most promising one is
+     * opened up next. A word comes off the frontier only once nothing left
+     * on it can beat the word, so the search stops at the k-th word.
+     * @param search State of this search: heap of word ids
+     * @param prefixNode Node ending the prefix, or NIL for the empty prefix
+     */
+    void completeBestFirst(IdSearch& search, unsigned int prefixNode) const;
+
+    /* Moves a word that was inserted, erased or given a new frequency to
+     * its place in every cached list along its path.
+     * @param word Word that changed
+     * @param freq New frequency of the word
+     * @param id Id of the word
+     * @param erased True if the word was erased
+     */
+    void updateCompletionCache(string_view word, unsigned int freq,
+                               unsigned int id, bool erased);
+
+    /* Allocates a new node in the arena, reusing an unlinked one if any.
+     * @param d Data/element of the new node
+     * @return Index of the new node
+     */
+    unsigned int newNode(char d);
+
+    /* Walks the trie down to the node of a word, keeping the path in
+     * updatePath.
+     * @param word Word to walk to
+     * @return Index of the word node, or NIL if the word is not in the trie
+     */
+    unsigned int walkWord(string_view word);
+
+    /* Recomputes the maxFreq and word lengths of a node from its word and
+     * its children.
+     * @param curr Index of the node
+     */
+    void refreshNode(unsigned int curr);
+
+    /* Recomputes the nodes of updatePath from the bottom up, stopping at the
+     * first node that does not change.
+     * @param length Number of nodes of the path to recompute, from the top
+     */
+    void refreshPath(unsigned int length);
+
+    /* Unlinks a node with no word and no middle child from its sibling tree
+     * and hands it to freeNodes. A node with both siblings is replaced by
+     * the leftmost node to its right.
+     * @param curr Index of the node
+     * @return Index of the node that takes its place, or NIL
+     */
+    unsigned int unlinkNode(unsigned int curr);
 
-    /* Helper method to insert a word recursively.
-     * @param word Word to insert
-     * @param freq Frequency of the word to insert
-     * @param index Index of character in the word we are currently inserting
-     * @param curr Current TrieNode we are checking
-     * @return True if inserted. False otherwise.
+    /* Helper method for bulkInsert to build the trie from sorted, unique
+     * entries into the empty arena. Each sibling tree is built balanced
+     * around its median letter, and maxFreq and the word lengths are filled
+     * in bottom up.
+     * @param entries Sorted entries to build from
+     * @return Index of the root, or NIL if no entries
      */
-    bool insertRec(string word, unsigned int freq, unsigned int index,
-                   TrieNode* curr);
+    unsigned int buildBalanced(const vector<entry>& entries);
 
-    /* Helper method to find the given word recursively.
-     * @param word Word to find
-     * @param index Index of character we are currently at in word
-     * @param curr Current node we are checking
-     * @return True if we find word so far. False otherwise.
+    /* Finds up to numCompletions of most frequent words starting at a prefix
+     * node, from its cached list if it has one.
+     * @param prefixNode Node ending the prefix, or NIL for the empty prefix
+     * @param prefixLength Number of letters in the prefix
+     * @param numCompletions Number of words to find
+     * @return vector of (freq, word id) pairs, most frequent first
      */
-    bool findRec(string word, unsigned int index, TrieNode* curr) const;
+    vector<idPairing> completeFromNode(unsigned int prefixNode,
+                                       unsigned int prefixLength,
+                                       unsigned int numCompletions) const;
 
-    /* Helper method for predictCompletions. Uses recursion.
-     * @param numCompletions Number of completions we need. Max size of heap.
-     * @param curr Pointer to current node we are checking
-     * @param word Word we are constructing
-     * @param pq Priority queue used to sort frequency of words
+    /* Helper method for predictCompletionsBatch. Answers the queries
+     * order[first, last), which are sorted by prefix, walking each shared
+     * leading path of the prefixes once.
+     * @param prefixes Prefixes of the whole batch
+     * @param order Indexes of the prefixes in sorted order
+     * @param first First position in order to answer
+     * @param last One past the last position in order to answer
+     * @param numCompletions Number of completions per prefix
+     * @param results Set to the completions of each query, by query index
      */
-    void predictCompletionsRec(
-        const unsigned int numCompletions, TrieNode* curr, string word,
-        std::priority_queue<pairing, vector<pairing>, Comp>& pq);
+    void completeSorted(const vector<string_view>& prefixes,
+                        const vector<unsigned int>& order, unsigned int first,
+                        unsigned int last, unsigned int numCompletions,
+                        vector<vector<idPairing>>& results) const;
 
-    /* Helper method for predictUnderscores. Uses recursion.
+    /* Helper method for matchPattern to offer the words matching a pattern
+     * in alphabetical order.
      * @param pattern Pattern that the word should match
-     * @param index Index of location in pattern we are at
-     * @param numCompletions Number of completions we need. Max size of heap.
-     * @param curr Pointer to current node we are checking
-     * @param word Word we are constructing
-     * @param pq Priority queue used to sort frequency of words
+     * @param search State of this search: heap of word ids
      */
-    void predictUnderscoresRec(
-        const string pattern, unsigned int index,
-        const unsigned int numCompletions, TrieNode* curr, string word,
-        std::priority_queue<pairing, vector<pairing>, Comp>& pq);
+    void searchPattern(string_view pattern, IdSearch& search) const;
 
   public:
     /* Constructor.
@@ -127,19 +662,59 @@ class DictionaryTrie {
      */
     DictionaryTrie();
 
+    // the trie may own a file mapping, so it is not copyable
+    DictionaryTrie(const DictionaryTrie&) = delete;
+    DictionaryTrie& operator=(const DictionaryTrie&) = delete;
+
     /* Inserts a word into the dictionary trie with a given frequency.
      * Creates TrieNodes to store letters in the word along with way.
      * @param word Word to insert into the dictionary trie
      * @param freq Frequency of the word
      * @return True if we successfully inserted. Otherwise, false.
      */
-    bool insert(string word, unsigned int freq);
+    bool insert(string_view word, unsigned int freq) override;
+
+    /* Inserts a whole set of words at once. The words are sorted and each
+     * sibling tree is built balanced around its median letter, with maxFreq
+     * filled in bottom up. If the trie already holds words, they are
+     * inserted one at a time in median first order instead. As with insert,
+     * empty and duplicate words are skipped and the first duplicate wins.
+     * @param entries (word, freq) pairs to insert
+     * @return Number of words inserted
+     */
+    unsigned int bulkInsert(vector<entry> entries) override;
+
+    /* Sets the frequency of a word already in the trie. Only the maxFreq of
+     * the nodes on the word's path is updated.
+     * @param word Word to update
+     * @param freq New frequency of the word
+     * @return True if the word was updated. False if it is not in the trie
+     * or the trie is read only.
+     */
+    bool setFrequency(string_view word, unsigned int freq);
+
+    /* Adds to the frequency of a word already in the trie, saturating at the
+     * largest frequency.
+     * @param word Word to update
+     * @param delta Amount to add to the frequency
+     * @return True if the word was updated. False if it is not in the trie
+     * or the trie is read only.
+     */
+    bool incrementFrequency(string_view word, unsigned int delta);
+
+    /* Removes a word from the trie. Nodes left with no word below them are
+     * unlinked and reused by later inserts. The word's id is not reused.
+     * @param word Word to remove
+     * @return True if the word was removed. False if it is not in the trie
+     * or the trie is read only.
+     */
+    bool erase(string_view word);
 
     /* Finds a query word in the dictionary trie.
      * @param word Query word to find in trie
      * @return True if we found the word. False otherwise.
      */
-    bool find(string word) const;
+    bool find(string word) const override;
 
     /* Finds up to numCompletions of most frequent completions given a prefix.
      * The words must be found in the dictionary and will be listed from most to
@@ -149,8 +724,8 @@ class DictionaryTrie {
      * frequency
      * @return vector of numCompletions words with most frequency with prefix
      */
-    vector<string> predictCompletions(string prefix,
-                                      unsigned int numCompletions);
+    vector<string> predictCompletions(
+        string prefix, unsigned int numCompletions) const override;
 
     /* Finds up to numCompletions of most frequent completions that fit in
      * the pattern that may contain a wild card.
@@ -158,11 +733,167 @@ class DictionaryTrie {
      * @param numCompletions Number of words to find in order of most freq
      * @return vector of numCompletions words matching pattern with most freq
      */
-    vector<string> predictUnderscores(string pattern,
-                                      unsigned int numCompletions);
+    vector<string> predictUnderscores(
+        string pattern, unsigned int numCompletions) const override;
+
+    /* Finds up to numCompletions of completions of a prefix that may have
+     * typos. A word matches if some prefix of it is within maxEdits
+     * insertions, deletions or substitutions of the given prefix. Matches
+     * are listed by fewest edits, then most frequent.
+     * @param prefix Prefix to complete
+     * @param maxEdits Most edits a match may need
+     * @param numCompletions Number of words to find
+     * @return vector of up to numCompletions best matching words
+     */
+    vector<string> predictFuzzy(string_view prefix, unsigned int maxEdits,
+                                unsigned int numCompletions) const;
+
+    /* Same as predictCompletions, but returns views into the word pool
+     * instead of copies of the words, so nothing is allocated per word. The
+     * views stay valid until the next insert or loadSnapshot.
+     * @param prefix Prefix to complete
+     * @param numCompletions Number of words to find
+     * @return views of the most frequent completions, most frequent first
+     */
+    vector<string_view> predictCompletionViews(
+        string_view prefix, unsigned int numCompletions) const;
+
+    /* Same as predictCompletions, but returns the ids of the words. Use
+     * wordAt to look them up.
+     * @param prefix Prefix to complete
+     * @param numCompletions Number of words to find
+     * @return ids of the most frequent completions, most frequent first
+     */
+    vector<unsigned int> predictCompletionIds(
+        string_view prefix, unsigned int numCompletions) const;
+
+    /* Same as predictUnderscores, but returns views into the word pool. The
+     * views stay valid until the next insert or loadSnapshot.
+     * @param pattern Pattern with wild card to match to
+     * @param numCompletions Number of words to find
+     * @return views of the most frequent matches, most frequent first
+     */
+    vector<string_view> predictUnderscoreViews(
+        string_view pattern, unsigned int numCompletions) const;
+
+    /* Returns the word with the given id, as a view into the word pool. Ids
+     * are handed out from 0 in the order the words were inserted, and are
+     * not reused once a word is erased. The view stays valid until the next
+     * insert or loadSnapshot.
+     * @param id Id of the word
+     */
+    string_view wordAt(unsigned int id) const;
+
+    /* Finds up to numCompletions of most frequent completions for each of a
+     * batch of prefixes. Prefixes sharing a leading path walk it once, and
+     * large batches are split across threads.
+     * @param prefixes Prefixes to complete
+     * @param numCompletions Number of completions per prefix
+     * @param numThreads Most threads to use, or 0 for one per core
+     * @return the completions of every prefix, in the order of prefixes
+     */
+    CompletionBatch predictCompletionsBatch(const vector<string_view>& prefixes,
+                                            unsigned int numCompletions,
+                                            unsigned int numThreads = 0) const;
+
+    /* Precomputes the completions of every prefix up to maxDepth letters
+     * long so predictCompletions can answer them with one prefix walk.
+     * Shorter prefixes are cached first, then the ones with the most
+     * frequent subtrees, until the memory budget runs out. Later inserts
+     * keep the cached lists up to date.
+     * @param maxDepth Length of the longest prefix to cache
+     * @param numCompletions Number of completions kept per prefix
+     * @param budget Maximum number of bytes the cached lists may use
+     */
+    void enableCompletionCache(unsigned int maxDepth,
+                               unsigned int numCompletions, size_t budget);
+
+    /* Drops every precomputed completion list. */
+    void disableCompletionCache();
+
+    /* Lists the children of the prefixes shorter than maxDepth letters, the
+     * empty one included, as wide nodes: sorted arrays of letters that find
+     * and the prefix walk search 16 at a time with SIMD compares instead of
+     * walking the sibling trees. A prefix gets one if it has at least
+     * minChildren children and its own prefix one letter shorter has one.
+     * Deeper and sparser nodes stay ternary. Inserts and erases that change the
+     * children of a wide node build the wide nodes again, so enable them
+     * once the dictionary is loaded.
+     * @param maxDepth Length of the longest prefix that may get a wide node
+     * @param minChildren Fewest children a prefix needs for a wide node
+     */
+    void enableWideNodes(unsigned int maxDepth, unsigned int minChildren);
+
+    /* Drops every wide node. */
+    void disableWideNodes();
+
+    /* Returns the number of bytes used by the wide nodes. */
+    size_t wideNodeMemory() const;
+
+    /* Chooses how completions are searched for below a prefix. Depth first
+     * walks the subtree in alphabetical order and only prunes once it holds
+     * numCompletions words. Best first keeps a frontier of subtrees ordered
+     * by maxFreq and stops as soon as numCompletions words beat everything
+     * on it. Both give the same results, except that best first never
+     * returns words of frequency 0.
+     * @param enabled True to search best first, false for depth first
+     */
+    void setBestFirst(bool enabled);
+
+    /* Returns the number of nodes a search for the completions of a prefix
+     * looks at below the prefix, in the current search order and without the
+     * completion cache.
+     * @param prefix Prefix to complete
+     * @param numCompletions Number of words to find
+     */
+    unsigned int completionVisits(string_view prefix,
+                                  unsigned int numCompletions) const;
+
+    /* Returns the number of bytes used by the precomputed completions. */
+    size_t completionCacheMemory() const;
+
+    /* Returns a count that goes up whenever a change to the trie may change
+     * the results of a query, so copies of results can tell they are stale.
+     */
+    unsigned long long changeCount() const;
+
+    /* Writes the trie to a binary snapshot file that loadSnapshot can map.
+     * @param filename File to write the snapshot to
+     * @return True if the snapshot was written. False otherwise.
+     */
+    bool saveSnapshot(const string& filename) const;
+
+    /* Replaces the contents of the trie with a snapshot file written by
+     * saveSnapshot. The file is mapped into memory and queries read straight
+     * from it, so the trie becomes read only and insert returns false.
+     * @param filename Snapshot file to map
+     * @return True if the snapshot was loaded. False if the file is missing
+     * or is not a valid snapshot, in which case the trie is left unchanged.
+     */
+    bool loadSnapshot(const string& filename);
+
+    /* Returns true if the trie is backed by a read only snapshot. */
+    bool isReadOnly() const;
+
+    /* Returns the number of words in the dictionary trie. */
+    unsigned int wordCount() const override;
+
+    /* Returns the number of nodes in the dictionary trie. */
+    unsigned int numNodes() const override;
+
+    /* Returns the number of nodes on the longest path from the root. */
+    unsigned int height() const;
+
+    /* Returns the average number of nodes visited to find each word. */
+    double averageProbeDepth() const;
+
+    /* Returns the number of bytes reserved for the node arena and word pool,
+     * or the size of the mapped snapshot.
+     */
+    size_t memoryUsage() const override;
 
     /* Deallocates the dictionary trie. */
-    ~DictionaryTrie();
+    ~DictionaryTrie() override;
 };
 
 #endif  // DICTIONARY_TRIE_HPP
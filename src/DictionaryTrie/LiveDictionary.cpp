@@ -0,0 +1,153 @@
+/**
+ * A live dictionary: a handle to the current version of a read only
+ * dictionary trie that can be swapped for a newly built one while queries
+ * keep running. Readers announce the snapshot they pin in a reader slot, and
+ * a replaced snapshot is freed once no slot announces it.
+ */
+#include "LiveDictionary.hpp"
+#include <algorithm>
+#include <chrono>
+
+/* Constructor.
+ * Starts out with an empty trie as version 0.
+ * @param maxPins Most pins that can be held at once. More pins wait for a
+ * slot to free up.
+ */
+LiveDictionary::LiveDictionary(unsigned int maxPins)
+    : slots(new ReaderSlot[std::max(1U, maxPins)]),
+      numSlots(std::max(1U, maxPins)),
+      current(new Snapshot(unique_ptr<const DictionaryTrie>(
+                               new DictionaryTrie()),
+                           0)),
+      nextVersion(1),
+      stopBuilder(false) {}
+
+/* Pins the current snapshot. Takes no lock.
+ * @return the pin, which unpins the snapshot when destroyed
+ */
+LiveDictionary::Pin LiveDictionary::pin() {
+    // each thread starts looking at its own slot, so threads rarely race
+    // for the same one
+    thread_local unsigned int home =
+        std::hash<thread::id>()(this_thread::get_id());
+    unsigned int slot = home % numSlots;
+    while (slots[slot].busy.load(memory_order_relaxed) ||
+           slots[slot].busy.exchange(true, memory_order_acquire)) {
+        slot = (slot + 1) % numSlots;
+        if (slot == home % numSlots) {
+            this_thread::yield();  // every slot is taken, wait for one
+        }
+    }
+
+    // announce the snapshot, then check it is still current. A writer
+    // that replaced it before the announcement was seen retries with the
+    // new one, and a writer replacing it after sees the announcement.
+    Snapshot* snapshot = current.load(memory_order_acquire);
+    while (true) {
+        slots[slot].snapshot.store(snapshot, memory_order_seq_cst);
+        Snapshot* latest = current.load(memory_order_seq_cst);
+        if (latest == snapshot) {
+            break;
+        }
+        snapshot = latest;
+    }
+    return Pin(this, slot, snapshot);
+}
+
+/* Releases a reader slot taken by a pin. */
+void LiveDictionary::release(unsigned int slot) {
+    slots[slot].snapshot.store(nullptr, memory_order_release);
+    slots[slot].busy.store(false, memory_order_release);
+}
+
+/* Publishes a trie as the next snapshot. New pins get it right away, and the
+ * snapshot it replaces is freed once no reader pins it.
+ * @param trie Finished trie to publish. It must not be changed after.
+ * @return Version of the published snapshot
+ */
+unsigned long long LiveDictionary::publish(unique_ptr<DictionaryTrie> trie) {
+    lock_guard<mutex> lock(retireLock);
+    unsigned long long version = nextVersion++;
+    Snapshot* next =
+        new Snapshot(unique_ptr<const DictionaryTrie>(std::move(trie)),
+                     version);
+    retired.push_back(current.exchange(next, memory_order_seq_cst));
+    reclaimLocked();
+    return version;
+}
+
+/* Builds the next trie on a background thread, publishes it and frees the
+ * replaced snapshot once its readers are done. Waits for a reload still
+ * running first.
+ * @param build Function that fills in the new trie, such as by loading a
+ * dictionary file. Returns false to drop the trie instead.
+ */
+void LiveDictionary::reloadAsync(function<bool(DictionaryTrie&)> build) {
+    finishReload();
+    builder = thread([this, build]() {
+        unique_ptr<DictionaryTrie> trie(new DictionaryTrie());
+        if (!build(*trie)) {
+            return;
+        }
+        publish(std::move(trie));
+
+        // readers pin only for a query, so the old trie is free soon
+        while (reclaim() > 0 && !stopBuilder.load()) {
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+    });
+}
+
+/* Waits for the background reload, if any, to publish its trie. Replaced
+ * snapshots still pinned then are left for the next reclaim.
+ */
+void LiveDictionary::finishReload() {
+    if (builder.joinable()) {
+        stopBuilder = true;
+        builder.join();
+        stopBuilder = false;
+    }
+}
+
+/* Frees the replaced snapshots no reader pins any more.
+ * @return Number of replaced snapshots still pinned
+ */
+size_t LiveDictionary::reclaim() {
+    lock_guard<mutex> lock(retireLock);
+    return reclaimLocked();
+}
+
+/* Frees the retired snapshots no reader slot announces. Must be called with
+ * retireLock held.
+ * @return Number of retired snapshots still pinned
+ */
+size_t LiveDictionary::reclaimLocked() {
+    size_t kept = 0;
+    for (Snapshot* snapshot : retired) {
+        bool pinned = false;
+        for (unsigned int i = 0; i < numSlots && !pinned; i++) {
+            pinned = slots[i].snapshot.load(memory_order_seq_cst) == snapshot;
+        }
+        if (pinned) {
+            retired[kept++] = snapshot;
+        } else {
+            delete snapshot;
+        }
+    }
+    retired.resize(kept);
+    return kept;
+}
+
+/* Returns the version of the current snapshot. */
+unsigned long long LiveDictionary::version() const {
+    return current.load(memory_order_acquire)->version;
+}
+
+/* Frees every snapshot. No pins may be held. */
+LiveDictionary::~LiveDictionary() {
+    finishReload();
+    for (Snapshot* snapshot : retired) {
+        delete snapshot;
+    }
+    delete current.load();
+}
@@ -0,0 +1,173 @@
+/**
+ * The header of a live dictionary: a handle to the current version of a
+ * read only dictionary trie that can be swapped for a newly built one while
+ * queries keep running. Readers pin a version without taking locks, and old
+ * versions are freed once no reader pins them.
+ */
+#ifndef LIVE_DICTIONARY_HPP
+#define LIVE_DICTIONARY_HPP
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "DictionaryTrie.hpp"
+
+using namespace std;
+
+/**
+ * The class for a versioned, swappable dictionary trie. Each published trie
+ * becomes an immutable snapshot with the next version number. A reader pins
+ * the current snapshot by announcing it in a reader slot, RCU style, and the
+ * writer frees a replaced snapshot only once no slot announces it. Queries
+ * never wait on a reload, and a reload never waits on queries.
+ */
+class LiveDictionary {
+  private:
+    /* A published trie and its version. */
+    class Snapshot {
+      public:
+        unique_ptr<const DictionaryTrie> trie;  // the trie, never changed
+        unsigned long long version;             // 1 for the first publish
+
+        /* Constructor.
+         * @param t Trie to publish
+         * @param v Version of the trie
+         */
+        Snapshot(unique_ptr<const DictionaryTrie> t, unsigned long long v)
+            : trie(std::move(t)), version(v) {}
+    };
+
+    /* A slot a reader announces its pinned snapshot in. Slots sit on their
+     * own cache lines so readers on different cores do not share one.
+     */
+    class alignas(64) ReaderSlot {
+      public:
+        atomic<bool> busy;            // true while a pin owns the slot
+        atomic<Snapshot*> snapshot;   // snapshot the pin holds, or nullptr
+
+        /* Constructor. Initializes a free slot. */
+        ReaderSlot() : busy(false), snapshot(nullptr) {}
+    };
+
+    unique_ptr<ReaderSlot[]> slots;  // one slot per concurrent pin
+    unsigned int numSlots;           // number of slots
+    atomic<Snapshot*> current;       // snapshot new pins get
+    atomic<unsigned long long> nextVersion;  // version of the next publish
+
+    mutex retireLock;           // guards retired, taken by writers only
+    vector<Snapshot*> retired;  // replaced snapshots not freed yet
+
+    thread builder;             // background reload, if one was started
+    atomic<bool> stopBuilder;   // tells the builder to stop waiting
+
+    /* Frees the retired snapshots no reader slot announces. Must be called
+     * with retireLock held.
+     * @return Number of retired snapshots still pinned
+     */
+    size_t reclaimLocked();
+
+    /* Releases a reader slot taken by a pin. */
+    void release(unsigned int slot);
+
+  public:
+    /**
+     * A pinned snapshot. The trie it points to stays alive and unchanged
+     * until the pin is destroyed, even if a newer one is published. Pins are
+     * meant to be short lived, such as for the span of one query.
+     */
+    class Pin {
+      private:
+        friend class LiveDictionary;
+
+        LiveDictionary* owner;  // dictionary the slot belongs to
+        unsigned int slot;      // reader slot announcing the snapshot
+        Snapshot* snapshot;     // the pinned snapshot
+
+        /* Constructor.
+         * @param o Dictionary the slot belongs to
+         * @param i Reader slot announcing the snapshot
+         * @param s The pinned snapshot
+         */
+        Pin(LiveDictionary* o, unsigned int i, Snapshot* s)
+            : owner(o), slot(i), snapshot(s) {}
+
+      public:
+        // a pin owns its slot, so it can be moved but not copied
+        Pin(const Pin&) = delete;
+        Pin& operator=(const Pin&) = delete;
+        Pin(Pin&& other) noexcept
+            : owner(other.owner), slot(other.slot), snapshot(other.snapshot) {
+            other.owner = nullptr;
+        }
+
+        /* Returns the pinned trie. */
+        const DictionaryTrie& operator*() const { return *snapshot->trie; }
+
+        /* Returns the pinned trie. */
+        const DictionaryTrie* operator->() const {
+            return snapshot->trie.get();
+        }
+
+        /* Returns the version of the pinned trie, 0 for the empty trie. */
+        unsigned long long version() const { return snapshot->version; }
+
+        /* Unpins the snapshot. */
+        ~Pin() {
+            if (owner != nullptr) {
+                owner->release(slot);
+            }
+        }
+    };
+
+    /* Constructor.
+     * Starts out with an empty trie as version 0.
+     * @param maxPins Most pins that can be held at once. More pins wait for
+     * a slot to free up.
+     */
+    explicit LiveDictionary(unsigned int maxPins = 64);
+
+    // readers hold pointers into the slots, so the handle stays in place
+    LiveDictionary(const LiveDictionary&) = delete;
+    LiveDictionary& operator=(const LiveDictionary&) = delete;
+
+    /* Pins the current snapshot. Takes no lock.
+     * @return the pin, which unpins the snapshot when destroyed
+     */
+    Pin pin();
+
+    /* Publishes a trie as the next snapshot. New pins get it right away,
+     * and the snapshot it replaces is freed once no reader pins it.
+     * @param trie Finished trie to publish. It must not be changed after.
+     * @return Version of the published snapshot
+     */
+    unsigned long long publish(unique_ptr<DictionaryTrie> trie);
+
+    /* Builds the next trie on a background thread, publishes it and frees
+     * the replaced snapshot once its readers are done. Waits for a reload
+     * still running first.
+     * @param build Function that fills in the new trie, such as by loading
+     * a dictionary file. Returns false to drop the trie instead.
+     */
+    void reloadAsync(function<bool(DictionaryTrie&)> build);
+
+    /* Waits for the background reload, if any, to publish its trie.
+     * Replaced snapshots still pinned then are left for the next reclaim.
+     */
+    void finishReload();
+
+    /* Frees the replaced snapshots no reader pins any more.
+     * @return Number of replaced snapshots still pinned
+     */
+    size_t reclaim();
+
+    /* Returns the version of the current snapshot. */
+    unsigned long long version() const;
+
+    /* Frees every snapshot. No pins may be held. */
+    ~LiveDictionary();
+};
+
+#endif  // LIVE_DICTIONARY_HPP
@@ -0,0 +1,204 @@
+/**
+ * A bounded cache of the results of completion and wildcard queries to a
+ * dictionary trie, with least recently used eviction and TinyLFU admission.
+ */
+#include "QueryCache.hpp"
+#include <algorithm>
+#include <functional>
+
+const unsigned int QueryCache::FrequencySketch::DEPTH;
+const uint8_t QueryCache::FrequencySketch::MAX_COUNT;
+
+/* Seeds that give each row of the sketch its own counter for a query */
+static const uint64_t ROW_SEEDS[] = {0x9E3779B97F4A7C15ULL,
+                                     0xC2B2AE3D27D4EB4FULL,
+                                     0x165667B19E3779F9ULL,
+                                     0xD6E8FEB86659FD93ULL};
+
+/* Constructor.
+ * Sizes the rows to a power of 2 a few times the capacity, and halves the
+ * counters after ten queries per entry.
+ * @param capacity Number of entries the sketch picks between
+ */
+QueryCache::FrequencySketch::FrequencySketch(size_t capacity)
+    : additions(0), sampleSize(std::max((size_t)16, capacity * 10)) {
+    size_t width = 16;
+    while (width < capacity * 4) {
+        width *= 2;
+    }
+    counters.resize(DEPTH * width, 0);
+    mask = width - 1;
+}
+
+/* Returns the counter of a query in a row. */
+size_t QueryCache::FrequencySketch::slot(uint64_t hash,
+                                         unsigned int row) const {
+    uint64_t mixed = (hash ^ ROW_SEEDS[row]) * ROW_SEEDS[(row + 1) % DEPTH];
+    return row * (mask + 1) + ((mixed >> 32) & mask);
+}
+
+/* Counts one more ask of a query. */
+void QueryCache::FrequencySketch::increment(uint64_t hash) {
+    for (unsigned int row = 0; row < DEPTH; row++) {
+        uint8_t& counter = counters[slot(hash, row)];
+        if (counter < MAX_COUNT) {
+            counter++;
+        }
+    }
+    if (++additions == sampleSize) {
+        for (uint8_t& counter : counters) {
+            counter /= 2;
+        }
+        additions /= 2;
+    }
+}
+
+/* Returns about how often a query was asked, at most 15. */
+unsigned int QueryCache::FrequencySketch::estimate(uint64_t hash) const {
+    unsigned int count = MAX_COUNT;
+    for (unsigned int row = 0; row < DEPTH; row++) {
+        count = std::min(count, (unsigned int)counters[slot(hash, row)]);
+    }
+    return count;
+}
+
+/* Constructor.
+ * @param t Trie to cache the results of. Must outlive the cache.
+ * @param capacity Most results kept. 0 caches nothing.
+ * @param numSegments Number of independently locked parts
+ * @param frequencyAdmission True to only replace an entry by a result asked
+ * for more often, false to always replace the least recently used
+ */
+QueryCache::QueryCache(const DictionaryTrie& t, size_t capacity,
+                       unsigned int numSegments, bool frequencyAdmission)
+    : trie(t),
+      admission(frequencyAdmission),
+      hitCount(0),
+      missCount(0),
+      rejectCount(0) {
+    numSegments = std::max(1U, numSegments);
+    segmentCapacity = (capacity + numSegments - 1) / numSegments;
+    for (unsigned int i = 0; i < numSegments; i++) {
+        segments.emplace_back(new Segment(segmentCapacity));
+        segments.back()->changes = trie.changeCount();
+    }
+}
+
+/* Drops the entries of a segment if the trie changed since they were cached.
+ * Must be called with the segment's lock held.
+ */
+void QueryCache::dropStale(Segment& segment) const {
+    if (segment.changes != trie.changeCount()) {
+        segment.index.clear();
+        segment.entries.clear();
+        segment.changes = trie.changeCount();
+    }
+}
+
+/* Answers a query from the cache, or asks the trie and caches the result.
+ * @param kind 'c' for completions, 'u' for underscores
+ * @param query Prefix or pattern
+ * @param numCompletions Number of words to find
+ * @return the result of the query
+ */
+vector<string> QueryCache::lookup(char kind, const string& query,
+                                  unsigned int numCompletions) {
+    string key(1, kind);
+    key.append(to_string(numCompletions)).append(1, ':').append(query);
+    uint64_t hash = std::hash<string>()(key);
+    Segment& segment = *segments[hash % segments.size()];
+
+    {
+        lock_guard<mutex> lock(segment.lock);
+        dropStale(segment);
+        segment.sketch.increment(hash);
+        auto found = segment.index.find(key);
+        if (found != segment.index.end()) {
+            segment.entries.splice(segment.entries.begin(), segment.entries,
+                                   found->second);
+            hitCount++;
+            return found->second->results;
+        }
+    }
+
+    // ask the trie without the lock, so other queries to the segment go on
+    missCount++;
+    vector<string> results =
+        kind == 'c' ? trie.predictCompletions(query, numCompletions)
+                    : trie.predictUnderscores(query, numCompletions);
+    if (segmentCapacity == 0) {
+        return results;
+    }
+
+    lock_guard<mutex> lock(segment.lock);
+    dropStale(segment);
+    if (segment.index.count(key) > 0) {
+        return results;  // another thread cached it meanwhile
+    }
+    if (segment.entries.size() >= segmentCapacity) {
+        Entry& victim = segment.entries.back();
+        if (admission && segment.sketch.estimate(hash) <=
+                             segment.sketch.estimate(victim.hash)) {
+            rejectCount++;
+            return results;
+        }
+        segment.index.erase(victim.key);
+        segment.entries.pop_back();
+    }
+    segment.entries.push_front(Entry{std::move(key), hash, results});
+    segment.index.emplace(segment.entries.front().key,
+                          segment.entries.begin());
+    return results;
+}
+
+/* Same as DictionaryTrie::predictCompletions, through the cache.
+ * @param prefix Prefix to complete
+ * @param numCompletions Number of words to find
+ * @return vector of numCompletions words with most frequency with prefix
+ */
+vector<string> QueryCache::predictCompletions(string prefix,
+                                              unsigned int numCompletions) {
+    return lookup('c', prefix, numCompletions);
+}
+
+/* Same as DictionaryTrie::predictUnderscores, through the cache.
+ * @param pattern Pattern with wild card to match to
+ * @param numCompletions Number of words to find
+ * @return vector of numCompletions words matching pattern with most freq
+ */
+vector<string> QueryCache::predictUnderscores(string pattern,
+                                              unsigned int numCompletions) {
+    return lookup('u', pattern, numCompletions);
+}
+
+/* Drops every cached result. The counters are kept. */
+void QueryCache::clear() {
+    for (unique_ptr<Segment>& segment : segments) {
+        lock_guard<mutex> lock(segment->lock);
+        segment->index.clear();
+        segment->entries.clear();
+    }
+}
+
+/* Returns the number of queries answered from the cache. */
+unsigned long long QueryCache::hits() const { return hitCount.load(); }
+
+/* Returns the number of queries sent to the trie. */
+unsigned long long QueryCache::misses() const { return missCount.load(); }
+
+/* Returns the number of results not cached because the entry they would
+ * replace was asked for more often.
+ */
+unsigned long long QueryCache::rejections() const {
+    return rejectCount.load();
+}
+
+/* Returns the number of cached results. */
+size_t QueryCache::size() {
+    size_t count = 0;
+    for (unique_ptr<Segment>& segment : segments) {
+        lock_guard<mutex> lock(segment->lock);
+        count += segment->entries.size();
+    }
+    return count;
+}
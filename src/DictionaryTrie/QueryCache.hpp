@@ -0,0 +1,156 @@
+/**
+ * The header of a query cache: a bounded cache of the results of completion
+ * and wildcard queries to a dictionary trie, for query streams where a few
+ * prefixes make up most of the traffic.
+ */
+#ifndef QUERY_CACHE_HPP
+#define QUERY_CACHE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "DictionaryTrie.hpp"
+
+using namespace std;
+
+/**
+ * The class for a cache of query results in front of a DictionaryTrie,
+ * keyed by the kind of query, the prefix or pattern and the number of
+ * completions. Entries are split over segments, each with its own lock and
+ * least recently used order. When a segment is full, a new result only
+ * replaces the least recently used one if the query was asked more often,
+ * TinyLFU style, as counted by a small frequency sketch. Every entry is
+ * dropped once the trie changes. Queries may be asked from many threads at
+ * once, as long as the trie is not changed at the same time.
+ */
+class QueryCache {
+  private:
+    /* A count-min sketch of how often each query was asked, with counters
+     * that saturate at 15 and are halved every so often so old popularity
+     * fades.
+     */
+    class FrequencySketch {
+      private:
+        static const unsigned int DEPTH = 4;  // counters per query
+        static const uint8_t MAX_COUNT = 15;  // largest counter value
+
+        vector<uint8_t> counters;  // DEPTH rows of width counters
+        size_t mask;               // width - 1, width a power of 2
+        size_t additions;          // queries counted since the last halving
+        size_t sampleSize;         // queries counted between halvings
+
+        /* Returns the counter of a query in a row. */
+        size_t slot(uint64_t hash, unsigned int row) const;
+
+      public:
+        /* Constructor.
+         * @param capacity Number of entries the sketch picks between
+         */
+        explicit FrequencySketch(size_t capacity);
+
+        /* Counts one more ask of a query. */
+        void increment(uint64_t hash);
+
+        /* Returns about how often a query was asked, at most 15. */
+        unsigned int estimate(uint64_t hash) const;
+    };
+
+    /* A cached result. */
+    class Entry {
+      public:
+        string key;              // kind, numCompletions and query
+        uint64_t hash;           // hash of the key
+        vector<string> results;  // result of the query
+    };
+
+    /* A part of the cache with its own lock. */
+    class Segment {
+      public:
+        mutex lock;                 // guards everything below
+        list<Entry> entries;        // most recently used first
+        unordered_map<string_view, list<Entry>::iterator>
+            index;                  // entries by key, viewing the entry's key
+        FrequencySketch sketch;     // how often queries were asked
+        unsigned long long changes;  // trie change count the entries are for
+
+        /* Constructor.
+         * @param capacity Most entries the segment holds
+         */
+        explicit Segment(size_t capacity)
+            : sketch(capacity), changes(0) {}
+    };
+
+    const DictionaryTrie& trie;             // trie the results come from
+    vector<unique_ptr<Segment>> segments;   // the parts of the cache
+    size_t segmentCapacity;                 // most entries per segment
+    bool admission;  // true to admit by frequency, false for plain LRU
+    atomic<unsigned long long> hitCount;     // queries answered from cache
+    atomic<unsigned long long> missCount;    // queries sent to the trie
+    atomic<unsigned long long> rejectCount;  // results not admitted
+
+    /* Answers a query from the cache, or asks the trie and caches the
+     * result.
+     * @param kind 'c' for completions, 'u' for underscores
+     * @param query Prefix or pattern
+     * @param numCompletions Number of words to find
+     * @return the result of the query
+     */
+    vector<string> lookup(char kind, const string& query,
+                          unsigned int numCompletions);
+
+    /* Drops the entries of a segment if the trie changed since they were
+     * cached. Must be called with the segment's lock held.
+     */
+    void dropStale(Segment& segment) const;
+
+  public:
+    /* Constructor.
+     * @param t Trie to cache the results of. Must outlive the cache.
+     * @param capacity Most results kept. 0 caches nothing.
+     * @param numSegments Number of independently locked parts
+     * @param frequencyAdmission True to only replace an entry by a result
+     * asked for more often, false to always replace the least recently used
+     */
+    QueryCache(const DictionaryTrie& t, size_t capacity,
+               unsigned int numSegments = 16, bool frequencyAdmission = true);
+
+    /* Same as DictionaryTrie::predictCompletions, through the cache.
+     * @param prefix Prefix to complete
+     * @param numCompletions Number of words to find
+     * @return vector of numCompletions words with most frequency with prefix
+     */
+    vector<string> predictCompletions(string prefix,
+                                      unsigned int numCompletions);
+
+    /* Same as DictionaryTrie::predictUnderscores, through the cache.
+     * @param pattern Pattern with wild card to match to
+     * @param numCompletions Number of words to find
+     * @return vector of numCompletions words matching pattern with most freq
+     */
+    vector<string> predictUnderscores(string pattern,
+                                      unsigned int numCompletions);
+
+    /* Drops every cached result. The counters are kept. */
+    void clear();
+
+    /* Returns the number of queries answered from the cache. */
+    unsigned long long hits() const;
+
+    /* Returns the number of queries sent to the trie. */
+    unsigned long long misses() const;
+
+    /* Returns the number of results not cached because the entry they would
+     * replace was asked for more often.
+     */
+    unsigned long long rejections() const;
+
+    /* Returns the number of cached results. */
+    size_t size();
+};
+
+#endif  // QUERY_CACHE_HPP
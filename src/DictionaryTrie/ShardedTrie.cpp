@@ -0,0 +1,252 @@
+/**
+ * A sharded dictionary: words are split across several dictionary tries by
+ * their first byte, so the tries can be built in parallel and a query for a
+ * prefix only searches one of them.
+ */
+#include "ShardedTrie.hpp"
+#include <algorithm>
+#include <thread>
+
+const unsigned int ShardedTrie::NUM_BYTES;
+
+/* Constructor.
+ * Initializes a dictionary with empty shards. Until the first build, first
+ * bytes are dealt out to the shards in turn.
+ * @param numShards Number of shards. 0 is treated as 1.
+ */
+ShardedTrie::ShardedTrie(unsigned int numShards) {
+    numShards = std::max(1U, numShards);
+    for (unsigned int i = 0; i < numShards; i++) {
+        shards.emplace_back(new DictionaryTrie());
+    }
+    for (unsigned int byte = 0; byte < NUM_BYTES; byte++) {
+        route[byte] = byte % numShards;
+    }
+}
+
+/* Returns the shard a word or prefix belongs in. Must not be empty. */
+unsigned int ShardedTrie::shardOf(string_view word) const {
+    return route[(unsigned char)word[0]];
+}
+
+/* Spreads the first bytes over the shards so each gets about as many words.
+ * Only called while every shard is empty.
+ * @param parts Lists of (word, freq) pairs that will be built
+ */
+void ShardedTrie::balanceRoutes(const vector<vector<entry>>& parts) {
+    vector<size_t> counts(NUM_BYTES, 0);
+    for (const vector<entry>& part : parts) {
+        for (const entry& word : part) {
+            if (!word.first.empty()) {
+                counts[(unsigned char)word.first[0]]++;
+            }
+        }
+    }
+
+    // the most common first bytes go first, each to the lightest shard
+    vector<unsigned int> bytes(NUM_BYTES);
+    for (unsigned int byte = 0; byte < NUM_BYTES; byte++) {
+        bytes[byte] = byte;
+    }
+    std::stable_sort(bytes.begin(), bytes.end(),
+                     [&counts](unsigned int a, unsigned int b) {
+                         return counts[a] > counts[b];
+                     });
+    vector<size_t> loads(shards.size(), 0);
+    for (unsigned int byte : bytes) {
+        unsigned int lightest =
+            std::min_element(loads.begin(), loads.end()) - loads.begin();
+        route[byte] = lightest;
+        loads[lightest] += counts[byte];
+    }
+}
+
+/* Bulk inserts lists of words, one thread per list to split them up by
+ * shard, then one thread per shard to build it.
+ * @param parts Lists of (word, freq) pairs, such as one per split of a
+ * dictionary file
+ * @return Number of words inserted
+ */
+unsigned int ShardedTrie::build(const vector<vector<entry>>& parts) {
+    if (wordCount() == 0) {
+        balanceRoutes(parts);
+    }
+
+    // split every list by shard, keeping the order of the words
+    vector<vector<vector<entry>>> split(
+        parts.size(), vector<vector<entry>>(shards.size()));
+    vector<thread> workers;
+    for (unsigned int p = 0; p < parts.size(); p++) {
+        workers.emplace_back([this, &parts, &split, p]() {
+            for (const entry& word : parts[p]) {
+                if (!word.first.empty()) {
+                    split[p][shardOf(word.first)].push_back(word);
+                }
+            }
+        });
+    }
+    for (thread& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+
+    // build each shard from its pieces of the lists, in list order so the
+    // first of a run of duplicates still wins
+    vector<unsigned int> inserted(shards.size(), 0);
+    for (unsigned int s = 0; s < shards.size(); s++) {
+        workers.emplace_back([this, &split, &inserted, s]() {
+            size_t total = 0;
+            for (const vector<vector<entry>>& pieces : split) {
+                total += pieces[s].size();
+            }
+            vector<entry> entries;
+            entries.reserve(total);
+            for (const vector<vector<entry>>& pieces : split) {
+                entries.insert(entries.end(), pieces[s].begin(),
+                               pieces[s].end());
+            }
+            inserted[s] = shards[s]->bulkInsert(std::move(entries));
+        });
+    }
+    for (thread& worker : workers) {
+        worker.join();
+    }
+
+    unsigned int total = 0;
+    for (unsigned int count : inserted) {
+        total += count;
+    }
+    return total;
+}
+
+/* Inserts a word into the shard it belongs in.
+ * @param word Word to insert
+ * @param freq Frequency of the word
+ * @return True if we successfully inserted. Otherwise, false.
+ */
+bool ShardedTrie::insert(string_view word, unsigned int freq) {
+    if (word.empty()) {
+        return false;
+    }
+    return shards[shardOf(word)]->insert(word, freq);
+}
+
+/* Finds a query word in the dictionary.
+ * @param word Query word to find
+ * @return True if we found the word. False otherwise.
+ */
+bool ShardedTrie::find(string word) const {
+    if (word.empty()) {
+        return false;
+    }
+    return shards[shardOf(word)]->find(word);
+}
+
+/* Merges the (freq, id) lists of every shard into the overall top words,
+ * most frequent first, then alphabetical.
+ * @param lists Most frequent matches of each shard, indexed by shard
+ * @param numCompletions Number of words to keep
+ * @return the words of the top numCompletions matches
+ */
+vector<string> ShardedTrie::mergeShards(const vector<vector<idPairing>>& lists,
+                                        unsigned int numCompletions) const {
+    vector<pair<unsigned int, string_view>> matches;  // (freq, word)
+    for (unsigned int s = 0; s < lists.size(); s++) {
+        for (const idPairing& id : lists[s]) {
+            matches.push_back(
+                make_pair(id.first, shards[s]->wordAt(id.second)));
+        }
+    }
+    unsigned int count = std::min((size_t)numCompletions, matches.size());
+    std::partial_sort(matches.begin(), matches.begin() + count, matches.end(),
+                      [](const pair<unsigned int, string_view>& a,
+                         const pair<unsigned int, string_view>& b) {
+                          if (a.first == b.first) {
+                              return a.second < b.second;
+                          }
+                          return a.first > b.first;
+                      });
+
+    vector<string> completions;
+    for (unsigned int i = 0; i < count; i++) {
+        completions.emplace_back(matches[i].second);
+    }
+    return completions;
+}
+
+/* Finds up to numCompletions of most frequent completions given a prefix.
+ * A prefix with a first letter searches one shard, the empty prefix all.
+ * @param prefix Prefix to complete
+ * @param numCompletions Number of words to find
+ * @return vector of numCompletions words with most frequency with prefix
+ */
+vector<string> ShardedTrie::predictCompletions(
+    string prefix, unsigned int numCompletions) const {
+    if (!prefix.empty()) {
+        return shards[shardOf(prefix)]->predictCompletions(prefix,
+                                                           numCompletions);
+    }
+    vector<vector<idPairing>> lists;
+    for (const unique_ptr<DictionaryTrie>& shard : shards) {
+        lists.push_back(shard->completePrefix(prefix, numCompletions));
+    }
+    return mergeShards(lists, numCompletions);
+}
+
+/* Finds up to numCompletions of most frequent words matching a pattern.
+ * A pattern starting with a letter searches one shard, one starting with a
+ * wild card all of them.
+ * @param pattern Pattern with wild card to match to
+ * @param numCompletions Number of words to find
+ * @return vector of numCompletions words matching pattern with most freq
+ */
+vector<string> ShardedTrie::predictUnderscores(
+    string pattern, unsigned int numCompletions) const {
+    if (pattern.empty()) {
+        return vector<string>();
+    }
+    if (pattern[0] != '_') {
+        return shards[shardOf(pattern)]->predictUnderscores(pattern,
+                                                            numCompletions);
+    }
+    vector<vector<idPairing>> lists;
+    for (const unique_ptr<DictionaryTrie>& shard : shards) {
+        lists.push_back(shard->matchPattern(pattern, numCompletions));
+    }
+    return mergeShards(lists, numCompletions);
+}
+
+/* Returns the number of shards. */
+unsigned int ShardedTrie::numShards() const { return shards.size(); }
+
+/* Returns one of the shards. */
+const DictionaryTrie& ShardedTrie::shard(unsigned int index) const {
+    return *shards[index];
+}
+
+/* Returns the number of words in all the shards. */
+unsigned int ShardedTrie::wordCount() const {
+    unsigned int count = 0;
+    for (const unique_ptr<DictionaryTrie>& shard : shards) {
+        count += shard->wordCount();
+    }
+    return count;
+}
+
+/* Returns the number of nodes in all the shards. */
+unsigned int ShardedTrie::numNodes() const {
+    unsigned int count = 0;
+    for (const unique_ptr<DictionaryTrie>& shard : shards) {
+        count += shard->numNodes();
+    }
+    return count;
+}
+
+/* Returns the number of bytes used by all the shards. */
+size_t ShardedTrie::memoryUsage() const {
+    size_t bytes = 0;
+    for (const unique_ptr<DictionaryTrie>& shard : shards) {
+        bytes += shard->memoryUsage();
+    }
+    return bytes;
+}
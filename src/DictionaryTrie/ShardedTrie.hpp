@@ -0,0 +1,115 @@
+/**
+ * The header of a sharded dictionary: words are split across several
+ * dictionary tries by their first byte, so the tries can be built in
+ * parallel.
+ */
+#ifndef SHARDED_TRIE_HPP
+#define SHARDED_TRIE_HPP
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "DictionaryTrie.hpp"
+
+using namespace std;
+
+/**
+ * The class for a dictionary split into shards, each a DictionaryTrie. Every
+ * word lives in the shard its first byte is routed to, so a query for a
+ * prefix or a pattern starting with a letter goes to one shard. Queries that
+ * can match any first byte, such as the empty prefix or a pattern starting
+ * with '_', ask every shard and merge their top completions. The results
+ * are the same as those of one trie holding all the words.
+ */
+class ShardedTrie {
+  private:
+    static const unsigned int NUM_BYTES = 256;  // number of first bytes
+
+    vector<unique_ptr<DictionaryTrie>> shards;  // the shards, never empty
+    unsigned int route[NUM_BYTES];  // shard of the words with each first byte
+
+    /* Returns the shard a word or prefix belongs in. Must not be empty. */
+    unsigned int shardOf(string_view word) const;
+
+    /* Spreads the first bytes over the shards so each gets about as many
+     * words. Only called while every shard is empty.
+     * @param parts Lists of (word, freq) pairs that will be built
+     */
+    void balanceRoutes(const vector<vector<entry>>& parts);
+
+    /* Merges the (freq, id) lists of every shard into the overall top
+     * words, most frequent first, then alphabetical.
+     * @param lists Most frequent matches of each shard, indexed by shard
+     * @param numCompletions Number of words to keep
+     * @return the words of the top numCompletions matches
+     */
+    vector<string> mergeShards(const vector<vector<idPairing>>& lists,
+                               unsigned int numCompletions) const;
+
+  public:
+    /* Constructor.
+     * Initializes a dictionary with empty shards.
+     * @param numShards Number of shards. 0 is treated as 1.
+     */
+    explicit ShardedTrie(unsigned int numShards);
+
+    /* Bulk inserts lists of words, one thread per list to split them up by
+     * shard, then one thread per shard to build it. If the shards are empty
+     * the first bytes are first spread so the shards get even shares. As
+     * with DictionaryTrie::bulkInsert, duplicates are skipped and the first
+     * one wins, counting the lists in order.
+     * @param parts Lists of (word, freq) pairs, such as one per split of a
+     * dictionary file
+     * @return Number of words inserted
+     */
+    unsigned int build(const vector<vector<entry>>& parts);
+
+    /* Inserts a word into the shard it belongs in.
+     * @param word Word to insert
+     * @param freq Frequency of the word
+     * @return True if we successfully inserted. Otherwise, false.
+     */
+    bool insert(string_view word, unsigned int freq);
+
+    /* Finds a query word in the dictionary.
+     * @param word Query word to find
+     * @return True if we found the word. False otherwise.
+     */
+    bool find(string word) const;
+
+    /* Finds up to numCompletions of most frequent completions given a prefix,
+     * the same as DictionaryTrie::predictCompletions.
+     * @param prefix Prefix to complete
+     * @param numCompletions Number of words to find
+     * @return vector of numCompletions words with most frequency with prefix
+     */
+    vector<string> predictCompletions(string prefix,
+                                      unsigned int numCompletions) const;
+
+    /* Finds up to numCompletions of most frequent words matching a pattern
+     * with wild cards, the same as DictionaryTrie::predictUnderscores.
+     * @param pattern Pattern with wild card to match to
+     * @param numCompletions Number of words to find
+     * @return vector of numCompletions words matching pattern with most freq
+     */
+    vector<string> predictUnderscores(string pattern,
+                                      unsigned int numCompletions) const;
+
+    /* Returns the number of shards. */
+    unsigned int numShards() const;
+
+    /* Returns one of the shards. */
+    const DictionaryTrie& shard(unsigned int index) const;
+
+    /* Returns the number of words in all the shards. */
+    unsigned int wordCount() const;
+
+    /* Returns the number of nodes in all the shards. */
+    unsigned int numNodes() const;
+
+    /* Returns the number of bytes used by all the shards. */
+    size_t memoryUsage() const;
+};
+
+#endif  // SHARDED_TRIE_HPP
@@ -0,0 +1,538 @@
+/**
+ * A read only, succinct copy of a dictionary trie. The trie's shape is stored
+ * as a LOUDS bit vector, with the letters, word flags, frequencies and subtree
+ * max frequencies in packed arrays beside it.
+ */
+#include "SuccinctTrie.hpp"
+#include <algorithm>
+
+const unsigned int BitVector::WORDS_PER_BLOCK;
+const unsigned int BitVector::SELECT_STRIDE;
+
+/* Constructor. Initializes an empty bit vector. */
+BitVector::BitVector() : numBits(0) {}
+
+/* Appends a bit. Must not be called after build(). */
+void BitVector::push_back(bool bit) {
+    if (numBits % 64 == 0) {
+        words.push_back(0);
+    }
+    if (bit) {
+        words.back() |= 1ULL << (numBits % 64);
+    }
+    numBits++;
+}
+
+/* Computes the rank samples. Call once after the last push_back. */
+void BitVector::build() {
+    words.shrink_to_fit();
+    blockRanks.clear();
+    uint32_t ones = 0;
+    for (size_t i = 0; i < words.size(); i++) {
+        if (i % WORDS_PER_BLOCK == 0) {
+            blockRanks.push_back(ones);
+        }
+        ones += __builtin_popcountll(words[i]);
+    }
+    blockRanks.push_back(ones);  // total, so select can search past the end
+    blockRanks.shrink_to_fit();
+
+    // sample the blocks holding every SELECT_STRIDE-th one and zero
+    oneBlocks.clear();
+    zeroBlocks.clear();
+    for (size_t block = 0; block + 1 < blockRanks.size(); block++) {
+        while (oneBlocks.size() * SELECT_STRIDE < bitsBefore(block + 1, true)) {
+            oneBlocks.push_back(block);
+        }
+        while (zeroBlocks.size() * SELECT_STRIDE <
+               bitsBefore(block + 1, false)) {
+            zeroBlocks.push_back(block);
+        }
+    }
+    oneBlocks.push_back(blockRanks.size() - 2);
+    zeroBlocks.push_back(blockRanks.size() - 2);
+}
+
+/* Returns the bit at a position. */
+bool BitVector::get(size_t pos) const {
+    return (words[pos / 64] >> (pos % 64)) & 1;
+}
+
+/* Returns the number of bits. */
+size_t BitVector::size() const { return numBits; }
+
+/* Returns the number of ones before a position. */
+size_t BitVector::rank1(size_t pos) const {
+    size_t word = pos / 64;
+    size_t ones = blockRanks[word / WORDS_PER_BLOCK];
+    for (size_t i = word - word % WORDS_PER_BLOCK; i < word; i++) {
+        ones += __builtin_popcountll(words[i]);
+    }
+    if (pos % 64 != 0) {
+        ones += __builtin_popcountll(words[word] << (64 - pos % 64));
+    }
+    return ones;
+}
+
+/* Returns the position of the one with the given 0 based rank. */
+size_t BitVector::select1(size_t rank) const {
+    size_t block = selectBlock(rank, true);
+    rank -= blockRanks[block];
+    size_t word = block * WORDS_PER_BLOCK;
+    for (;; word++) {
+        size_t ones = __builtin_popcountll(words[word]);
+        if (rank < ones) {
+            break;
+        }
+        rank -= ones;
+    }
+    uint64_t bits = words[word];
+    for (; rank > 0; rank--) {
+        bits &= bits - 1;  // clear the lowest one
+    }
+    return word * 64 + __builtin_ctzll(bits);
+}
+
+/* Returns the position of the zero with the given 0 based rank. */
+size_t BitVector::select0(size_t rank) const {
+    size_t block = selectBlock(rank, false);
+    rank -= bitsBefore(block, false);
+    size_t word = block * WORDS_PER_BLOCK;
+    for (;; word++) {
+        size_t zeros = 64 - __builtin_popcountll(words[word]);
+        if (rank < zeros) {
+            break;
+        }
+        rank -= zeros;
+    }
+    uint64_t bits = ~words[word];
+    for (; rank > 0; rank--) {
+        bits &= bits - 1;
+    }
+    return word * 64 + __builtin_ctzll(bits);
+}
+
+/* Returns the position of the first zero at or after a position. */
+size_t BitVector::nextZero(size_t pos) const {
+    size_t word = pos / 64;
+    uint64_t bits = ~words[word] >> (pos % 64);
+    if (bits != 0) {
+        return pos + __builtin_ctzll(bits);
+    }
+    for (word++; ~words[word] == 0; word++) {
+    }
+    return word * 64 + __builtin_ctzll(~words[word]);
+}
+
+/* Finds the last block with no more than rank ones, or zeros, before it.
+ * @param rank Rank of the bit to find
+ * @param ones True to count ones, false to count zeros
+ */
+size_t BitVector::selectBlock(size_t rank, bool ones) const {
+    // the samples narrow the search to the blocks between two of them
+    const vector<uint32_t>& samples = ones ? oneBlocks : zeroBlocks;
+    size_t lo = samples[std::min(rank / SELECT_STRIDE, samples.size() - 1)];
+    size_t hi = rank / SELECT_STRIDE + 1 < samples.size()
+                    ? samples[rank / SELECT_STRIDE + 1] + 1
+                    : blockRanks.size() - 1;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (bitsBefore(mid, ones) <= rank) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/* Returns the number of ones, or zeros, before a block. */
+size_t BitVector::bitsBefore(size_t block, bool ones) const {
+    return ones ? blockRanks[block]
+                : block * WORDS_PER_BLOCK * 64 - blockRanks[block];
+}
+
+/* Returns the number of bytes reserved for the bits and samples. */
+size_t BitVector::memoryUsage() const {
+    return words.capacity() * sizeof(uint64_t) +
+           (blockRanks.capacity() + oneBlocks.capacity() +
+            zeroBlocks.capacity()) *
+               sizeof(uint32_t);
+}
+
+/* Constructor.
+ * @param bits Bits per value, from 1 to 64
+ */
+PackedArray::PackedArray(unsigned int bits) : width(bits), count(0) {}
+
+/* Appends a value. Bits above the width are dropped. */
+void PackedArray::push_back(uint64_t value) {
+    if (width < 64) {
+        value &= (1ULL << width) - 1;
+    }
+    size_t bit = count * width;
+    while (words.size() * 64 < bit + width) {
+        words.push_back(0);
+    }
+    words[bit / 64] |= value << (bit % 64);
+    if (bit % 64 + width > 64) {  // spills into the next word
+        words[bit / 64 + 1] |= value >> (64 - bit % 64);
+    }
+    count++;
+}
+
+/* Returns the value at an index. */
+uint64_t PackedArray::get(size_t index) const {
+    size_t bit = index * width;
+    uint64_t value = words[bit / 64] >> (bit % 64);
+    if (bit % 64 + width > 64) {
+        value |= words[bit / 64 + 1] << (64 - bit % 64);
+    }
+    return width < 64 ? value & ((1ULL << width) - 1) : value;
+}
+
+/* Returns the number of bytes reserved for the values. */
+size_t PackedArray::memoryUsage() const {
+    return words.capacity() * sizeof(uint64_t);
+}
+
+/* Finds the number of bits needed to hold a value. */
+static unsigned int bitWidth(unsigned long long value) {
+    unsigned int bits = 1;
+    while (bits < 64 && (value >> bits) != 0) {
+        bits++;
+    }
+    return bits;
+}
+
+/* Constructor.
+ * Copies a finished dictionary trie. Later inserts into the trie are not seen
+ * by the copy.
+ * @param trie Trie to copy
+ */
+SuccinctTrie::SuccinctTrie(const DictionaryTrie& trie)
+    : freqs(bitWidth(trie.root == DictionaryTrie::NIL
+                         ? 0
+                         : trie.nodeData[trie.root].maxFreq)) {
+    const DictionaryTrie::TrieNode* trieNodes = trie.nodeData;
+    const unsigned int NIL = DictionaryTrie::NIL;
+
+    // breadth first over the multiway trie. Each multiway node is the
+    // ternary node ending its prefix, with NIL for the root, and its
+    // children are the sibling tree below it, in order.
+    vector<unsigned int> order(1, NIL);
+    vector<unsigned int> siblings;
+    labels.push_back(0);
+    maxes.push_back(encodeMax(trie.root == NIL ? 0
+                                               : trieNodes[trie.root].maxFreq));
+    wordNodes.push_back(false);
+    for (size_t i = 0; i < order.size(); i++) {
+        // in order walk of the sibling tree
+        unsigned int curr = i == 0 ? trie.root : trieNodes[order[i]].middle;
+        while (curr != NIL || !siblings.empty()) {
+            while (curr != NIL) {
+                siblings.push_back(curr);
+                curr = trieNodes[curr].left;
+            }
+            curr = siblings.back();
+            siblings.pop_back();
+
+            // the child's subtree is its word and the sibling tree below it
+            const DictionaryTrie::TrieNode& node = trieNodes[curr];
+            unsigned int maxFreq = node.word ? node.freq : 0;
+            if (node.middle != NIL) {
+                maxFreq = std::max(maxFreq, trieNodes[node.middle].maxFreq);
+            }
+            louds.push_back(true);
+            labels.push_back(node.data);
+            maxes.push_back(encodeMax(maxFreq));
+            wordNodes.push_back(node.word);
+            if (node.word) {
+                freqs.push_back(node.freq);
+            }
+            order.push_back(curr);
+            curr = node.right;
+        }
+        louds.push_back(false);
+    }
+
+    nodeCount = order.size();
+    louds.build();
+    wordNodes.build();
+    labels.shrink_to_fit();
+    maxes.shrink_to_fit();
+}
+
+/* Finds a query word in the trie.
+ * @param word Query word to find in trie
+ * @return True if we found the word. False otherwise.
+ */
+bool SuccinctTrie::find(string word) const {
+    if (word.empty()) {
+        return false;
+    }
+    unsigned int node = 0;
+    for (char letter : word) {
+        node = child(node, letter);
+        if (node == 0) {
+            return false;
+        }
+    }
+    return wordNodes.get(node);
+}
+
+/* Finds up to numCompletions of most frequent completions given a prefix, the
+ * same as DictionaryTrie::predictCompletions.
+ * @param prefix Prefix to complete
+ * @param numCompletions Number of words to find
+ * @return vector of numCompletions words with most frequency with prefix
+ */
+vector<string> SuccinctTrie::predictCompletions(
+    string prefix, unsigned int numCompletions) const {
+    Search search(numCompletions, this);
+    if (numCompletions == 0) {
+        return vector<string>();
+    }
+
+    unsigned int node = 0;
+    for (char letter : prefix) {
+        node = child(node, letter);
+        if (node == 0) {
+            return vector<string>();
+        }
+    }
+    if (node != 0 && wordNodes.get(node)) {
+        offerWord(search, node);
+    }
+    completeSubtree(search, node);
+    return takeResults(search);
+}
+
+/* Finds up to numCompletions of most frequent words matching a pattern with
+ * wild cards, the same as DictionaryTrie::predictUnderscores.
+ * @param pattern Pattern with wild card to match to
+ * @param numCompletions Number of words to find
+ * @return vector of numCompletions words matching pattern with most freq
+ */
+vector<string> SuccinctTrie::predictUnderscores(
+    string pattern, unsigned int numCompletions) const {
+    Search search(numCompletions, this);
+    if (numCompletions == 0 || pattern.empty()) {
+        return vector<string>();
+    }
+    searchPattern(pattern, search);
+    return takeResults(search);
+}
+
+/* Returns the number of words in the trie. */
+unsigned int SuccinctTrie::wordCount() const {
+    return wordNodes.rank1(wordNodes.size());
+}
+
+/* Returns the number of nodes in the trie, not counting the root. */
+unsigned int SuccinctTrie::numNodes() const { return nodeCount - 1; }
+
+/* Returns the number of bytes reserved for the bit vectors and arrays. */
+size_t SuccinctTrie::memoryUsage() const {
+    return louds.memoryUsage() + wordNodes.memoryUsage() + labels.capacity() +
+           maxes.capacity() + freqs.memoryUsage();
+}
+
+/* Rounds a frequency up to the byte that stands for it in maxes. */
+uint8_t SuccinctTrie::encodeMax(unsigned long long freq) {
+    // smallest code standing for at least freq
+    unsigned int lo = 0;
+    unsigned int hi = 255;
+    while (lo < hi) {
+        unsigned int mid = (lo + hi) / 2;
+        if (decodeMax(mid) < freq) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/* Returns the frequency a byte of maxes stands for. Codes below 8 are exact,
+ * the rest hold a 3 bit mantissa and a 5 bit exponent.
+ */
+unsigned long long SuccinctTrie::decodeMax(uint8_t code) {
+    if (code < 8) {
+        return code;
+    }
+    return (8ULL + (code & 7)) << ((code >> 3) - 1);
+}
+
+/* Returns the calling thread's memory for search steps. A search leaves nothing
+ * on its stack, so the searches of a thread take turns with it.
+ */
+vector<SuccinctTrie::ListStep>& SuccinctTrie::threadSteps() {
+    thread_local vector<ListStep> steps;
+    return steps;
+}
+
+/* Returns the position of a node's list of children in louds. */
+size_t SuccinctTrie::listStart(unsigned int node) const {
+    // the list follows the 0 bit ending the list of the node before
+    return node == 0 ? 0 : louds.select0(node - 1) + 1;
+}
+
+/* Returns the first child of a node and sets end to one past its last.
+ * @param node Node whose children to find
+ * @param end Set to one past the last child
+ */
+unsigned int SuccinctTrie::children(unsigned int node,
+                                    unsigned int& end) const {
+    // the child of the 1 bit at pos is the node after the pos - node ones
+    // before it, counting the root
+    size_t start = listStart(node);
+    end = louds.nextZero(start) - node + 1;
+    return start - node + 1;
+}
+
+/* Returns the child of a node with the given letter, or 0 if none. */
+unsigned int SuccinctTrie::child(unsigned int node, char letter) const {
+    unsigned int end;
+    unsigned int first = children(node, end);
+    for (unsigned int curr = first; curr < end; curr++) {
+        if (labels[curr] == letter) {
+            return curr;
+        }
+    }
+    return 0;
+}
+
+/* Returns the parent of a node other than the root. */
+unsigned int SuccinctTrie::parent(unsigned int node) const {
+    // count the lists ended before the node's 1 bit
+    size_t pos = louds.select1(node - 1);
+    return pos - (node - 1);
+}
+
+/* Returns the word spelled out from the root to a node. */
+string SuccinctTrie::wordOf(unsigned int node) const {
+    string word;
+    for (; node != 0; node = parent(node)) {
+        word.push_back(labels[node]);
+    }
+    std::reverse(word.begin(), word.end());
+    return word;
+}
+
+/* Offers a word node to a search. The word goes in the heap if the heap is not
+ * full yet or the word beats the least frequent word in it.
+ * @param search State of the search
+ * @param node Word node to offer
+ */
+void SuccinctTrie::offerWord(Search& search, unsigned int node) const {
+    unsigned int freq = freqs.get(wordNodes.rank1(node));
+    if (search.pq.size() == search.numCompletions) {
+        if (freq > search.pq.top().first) {
+            search.pq.pop();
+            search.pq.push(make_pair(freq, node));
+            search.threshold = search.pq.top().first;
+        }
+    } else {
+        search.pq.push(make_pair(freq, node));
+        if (search.pq.size() == search.numCompletions) {
+            search.threshold = search.pq.top().first;
+        }
+    }
+}
+
+/* Moves the words left in a search out of its heap.
+ * @param search State of a finished search
+ * @return the words, most frequent first
+ */
+vector<string> SuccinctTrie::takeResults(Search& search) const {
+    vector<string> words(search.pq.size());
+    for (unsigned int i = words.size(); i > 0; i--) {  // most frequent last
+        words[i - 1] = wordOf(search.pq.top().second);
+        search.pq.pop();
+    }
+    return words;
+}
+
+/* Helper method for predictCompletions to offer the descendants of a node in
+ * alphabetical order, skipping subtrees with nothing frequent enough. Keeps
+ * its steps on an explicit stack.
+ * @param search State of this search
+ * @param node Node whose descendants to search
+ */
+void SuccinctTrie::completeSubtree(Search& search, unsigned int node) const {
+    vector<ListStep>& steps = threadSteps();
+    size_t start = listStart(node);
+    steps.emplace_back(node, 0, start, louds.nextZero(start));
+    while (!steps.empty()) {
+        ListStep& step = steps.back();
+        if (step.pos == step.end) {  // every child of the node is done
+            steps.pop_back();
+            continue;
+        }
+
+        // siblings are numbered in a row, and so are their lists
+        unsigned int curr = step.pos - step.node + 1;
+        step.childStart = step.childStart == 0
+                              ? listStart(curr)
+                              : louds.nextZero(step.childStart) + 1;
+        step.pos++;
+        size_t childStart = step.childStart;
+
+        // skip subtrees with nothing frequent enough, and take the word
+        // before the words below it
+        if (decodeMax(maxes[curr]) <= search.threshold) {
+            continue;
+        }
+        if (wordNodes.get(curr)) {
+            offerWord(search, curr);
+        }
+        size_t childEnd = louds.nextZero(childStart);
+        if (childStart < childEnd) {
+            steps.emplace_back(curr, 0, childStart, childEnd);
+        }
+    }
+}
+
+/* Helper method for predictUnderscores to offer the words matching a pattern
+ * in alphabetical order. Keeps its steps on an explicit stack.
+ * @param pattern Pattern that the word should match
+ * @param search State of this search
+ */
+void SuccinctTrie::searchPattern(string_view pattern, Search& search) const {
+    vector<ListStep>& steps = threadSteps();
+    steps.emplace_back(0, 0, 0, louds.nextZero(0));
+    while (!steps.empty()) {
+        ListStep& step = steps.back();
+        if (step.pos == step.end) {  // every child of the node is done
+            steps.pop_back();
+            continue;
+        }
+        unsigned int curr = step.pos - step.node + 1;
+        unsigned int index = step.index;
+        bool last = index == pattern.length() - 1;
+        if (!last) {  // lists are only needed to go further down
+            step.childStart = step.childStart == 0
+                                  ? listStart(curr)
+                                  : louds.nextZero(step.childStart) + 1;
+        }
+        step.pos++;
+        size_t childStart = step.childStart;
+
+        if ((pattern[index] != '_' && pattern[index] != labels[curr]) ||
+            (search.pq.size() == search.numCompletions &&
+             decodeMax(maxes[curr]) <= search.threshold)) {
+            continue;
+        }
+        if (last) {
+            if (wordNodes.get(curr)) {
+                offerWord(search, curr);
+            }
+        } else {
+            size_t childEnd = louds.nextZero(childStart);
+            if (childStart < childEnd) {
+                steps.emplace_back(curr, index + 1, childStart, childEnd);
+            }
+        }
+    }
+}
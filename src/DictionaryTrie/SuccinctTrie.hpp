@@ -0,0 +1,280 @@
+/**
+ * The header of a read only, succinct copy of a dictionary trie. The trie's
+ * shape is stored as a LOUDS bit vector, with the letters, word flags,
+ * frequencies and subtree max frequencies in packed arrays beside it.
+ */
+#ifndef SUCCINCT_TRIE_HPP
+#define SUCCINCT_TRIE_HPP
+
+#include <cstdint>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "DictionaryTrie.hpp"
+
+using namespace std;
+
+/**
+ * A bit vector with rank and select support. Bits are pushed one at a time,
+ * then build() adds the rank samples the queries need.
+ */
+class BitVector {
+  private:
+    static const unsigned int WORDS_PER_BLOCK = 8;  // 64 bit words per sample
+    static const unsigned int SELECT_STRIDE = 512;  // bits per select sample
+
+    vector<uint64_t> words;       // the bits, 64 per word
+    vector<uint32_t> blockRanks;  // number of ones before each block
+    vector<uint32_t> oneBlocks;   // block holding every SELECT_STRIDE-th one
+    vector<uint32_t> zeroBlocks;  // block holding every SELECT_STRIDE-th zero
+    size_t numBits;               // number of bits pushed
+
+    /* Finds the last block with no more than rank ones, or zeros, before it.
+     * @param rank Rank of the bit to find
+     * @param ones True to count ones, false to count zeros
+     */
+    size_t selectBlock(size_t rank, bool ones) const;
+
+    /* Returns the number of ones, or zeros, before a block. */
+    size_t bitsBefore(size_t block, bool ones) const;
+
+  public:
+    /* Constructor. Initializes an empty bit vector. */
+    BitVector();
+
+    /* Appends a bit. Must not be called after build(). */
+    void push_back(bool bit);
+
+    /* Computes the rank samples. Call once after the last push_back. */
+    void build();
+
+    /* Returns the bit at a position. */
+    bool get(size_t pos) const;
+
+    /* Returns the number of bits. */
+    size_t size() const;
+
+    /* Returns the number of ones before a position. */
+    size_t rank1(size_t pos) const;
+
+    /* Returns the position of the one with the given 0 based rank. */
+    size_t select1(size_t rank) const;
+
+    /* Returns the position of the zero with the given 0 based rank. */
+    size_t select0(size_t rank) const;
+
+    /* Returns the position of the first zero at or after a position. */
+    size_t nextZero(size_t pos) const;
+
+    /* Returns the number of bytes reserved for the bits and samples. */
+    size_t memoryUsage() const;
+};
+
+/**
+ * An array of unsigned values packed into a fixed number of bits each.
+ */
+class PackedArray {
+  private:
+    vector<uint64_t> words;  // the values, back to back
+    unsigned int width;      // bits per value
+    size_t count;            // number of values
+
+  public:
+    /* Constructor.
+     * @param bits Bits per value, from 1 to 64
+     */
+    explicit PackedArray(unsigned int bits);
+
+    /* Appends a value. Bits above the width are dropped. */
+    void push_back(uint64_t value);
+
+    /* Returns the value at an index. */
+    uint64_t get(size_t index) const;
+
+    /* Returns the number of bytes reserved for the values. */
+    size_t memoryUsage() const;
+};
+
+/**
+ * The class for an immutable, succinct multiway trie built from a finished
+ * DictionaryTrie. Nodes are numbered in breadth first order, the root being
+ * 0, and each node lists its children in the LOUDS bit vector as one 1 bit
+ * per child followed by a 0 bit. It answers the same queries with the same
+ * results as the trie it was built from.
+ */
+class SuccinctTrie {
+  private:
+    /* Comparator class to sort (freq, node) pairs in the priority queue,
+     * spelling out the words of the nodes to break ties.
+     */
+    class Comp {
+      public:
+        const SuccinctTrie* trie;  // trie the nodes belong to
+
+        /* Constructor.
+         * @param t Trie the nodes belong to
+         */
+        explicit Comp(const SuccinctTrie* t) : trie(t) {}
+
+        /* Compare function. In order of first in pair and reverse
+         * alphabetical order of the words if tied.
+         * @param a First pair to compare with second pair
+         * @param b Second pair to compare with first pair
+         * @return True if a > b, false if a < b.
+         */
+        bool operator()(const idPairing& a, const idPairing& b) const {
+            if (a.first == b.first) {
+                return trie->wordOf(a.second) < trie->wordOf(b.second);
+            }
+            return a.first > b.first;
+        }
+    };
+
+    /* State of one top completions search: the heap of the best words found
+     * so far and the frequency a word must beat to get in.
+     */
+    class Search {
+      public:
+        const unsigned int numCompletions;  // number of completions we need
+        unsigned int threshold;  // min frequency in the heap once it is full
+        std::priority_queue<idPairing, vector<idPairing>, Comp>
+            pq;  // (freq, node) of the best words so far
+
+        /* Constructor.
+         * @param k Number of completions we need. Max size of heap.
+         * @param trie Trie the nodes belong to
+         */
+        Search(unsigned int k, const SuccinctTrie* trie)
+            : numCompletions(k), threshold(0), pq(Comp(trie)) {}
+    };
+
+    /* A step of an iterative search: the list of a node's children, walked
+     * one child at a time. Searches keep their steps on an explicit stack,
+     * so deep tries can not overflow the call stack.
+     */
+    class ListStep {
+      public:
+        unsigned int node;   // node whose children are walked
+        unsigned int index;  // index in the pattern the children match
+        size_t pos;          // position of the next child's 1 bit in louds
+        size_t end;          // position of the 0 bit ending the list
+        size_t childStart;   // list of the child before pos, or 0 if none
+
+        /* Constructor.
+         * @param n Node whose children to walk
+         * @param i Index in the pattern the children match
+         * @param start Position of the node's list of children in louds
+         * @param e Position of the 0 bit ending the list
+         */
+        ListStep(unsigned int n, unsigned int i, size_t start, size_t e)
+            : node(n), index(i), pos(start), end(e), childStart(0) {}
+    };
+
+    BitVector louds;        // children of each node, 1 per child then 0
+    BitVector wordNodes;    // set for nodes ending a word
+    vector<char> labels;    // letter of each node, empty for the root
+    vector<uint8_t> maxes;  // max frequency in each subtree, rounded up
+    PackedArray freqs;      // frequency of each word, by rank in wordNodes
+    unsigned int nodeCount;  // number of nodes, including the root
+
+    /* Rounds a frequency up to the byte that stands for it in maxes. */
+    static uint8_t encodeMax(unsigned long long freq);
+
+    /* Returns the frequency a byte of maxes stands for. */
+    static unsigned long long decodeMax(uint8_t code);
+
+    /* Returns the calling thread's memory for search steps. A search leaves
+     * nothing on its stack, so the searches of a thread take turns with it.
+     */
+    static vector<ListStep>& threadSteps();
+
+    /* Returns the position of a node's list of children in louds. */
+    size_t listStart(unsigned int node) const;
+
+    /* Returns the first child of a node and sets end to one past its last.
+     * @param node Node whose children to find
+     * @param end Set to one past the last child
+     */
+    unsigned int children(unsigned int node, unsigned int& end) const;
+
+    /* Returns the child of a node with the given letter, or 0 if none. */
+    unsigned int child(unsigned int node, char letter) const;
+
+    /* Returns the parent of a node other than the root. */
+    unsigned int parent(unsigned int node) const;
+
+    /* Returns the word spelled out from the root to a node. */
+    string wordOf(unsigned int node) const;
+
+    /* Offers a word node to a search. The word goes in the heap if the heap
+     * is not full yet or the word beats the least frequent word in it.
+     * @param search State of the search
+     * @param node Word node to offer
+     */
+    void offerWord(Search& search, unsigned int node) const;
+
+    /* Moves the words left in a search out of its heap.
+     * @param search State of a finished search
+     * @return the words, most frequent first
+     */
+    vector<string> takeResults(Search& search) const;
+
+    /* Helper method for predictCompletions to offer the descendants of a
+     * node in alphabetical order, skipping subtrees with nothing frequent
+     * enough. Keeps its steps on an explicit stack.
+     * @param search State of this search
+     * @param node Node whose descendants to search
+     */
+    void completeSubtree(Search& search, unsigned int node) const;
+
+    /* Helper method for predictUnderscores to offer the words matching a
+     * pattern in alphabetical order. Keeps its steps on an explicit stack.
+     * @param pattern Pattern that the word should match
+     * @param search State of this search
+     */
+    void searchPattern(string_view pattern, Search& search) const;
+
+  public:
+    /* Constructor.
+     * Copies a finished dictionary trie. Later inserts into the trie are not
+     * seen by the copy.
+     * @param trie Trie to copy
+     */
+    explicit SuccinctTrie(const DictionaryTrie& trie);
+
+    /* Finds a query word in the trie.
+     * @param word Query word to find in trie
+     * @return True if we found the word. False otherwise.
+     */
+    bool find(string word) const;
+
+    /* Finds up to numCompletions of most frequent completions given a prefix,
+     * the same as DictionaryTrie::predictCompletions.
+     * @param prefix Prefix to complete
+     * @param numCompletions Number of words to find
+     * @return vector of numCompletions words with most frequency with prefix
+     */
+    vector<string> predictCompletions(string prefix,
+                                      unsigned int numCompletions) const;
+
+    /* Finds up to numCompletions of most frequent words matching a pattern
+     * with wild cards, the same as DictionaryTrie::predictUnderscores.
+     * @param pattern Pattern with wild card to match to
+     * @param numCompletions Number of words to find
+     * @return vector of numCompletions words matching pattern with most freq
+     */
+    vector<string> predictUnderscores(string pattern,
+                                      unsigned int numCompletions) const;
+
+    /* Returns the number of words in the trie. */
+    unsigned int wordCount() const;
+
+    /* Returns the number of nodes in the trie, not counting the root. */
+    unsigned int numNodes() const;
+
+    /* Returns the number of bytes reserved for the bit vectors and arrays. */
+    size_t memoryUsage() const;
+};
+
+#endif  // SUCCINCT_TRIE_HPP
@@ -0,0 +1,216 @@
+/**
+ * The query statistics of dictionary tries. Every thread that finishes a
+ * query gets a block of counters only it writes. The blocks are listed in a
+ * registry that collect() reads, and a thread's counts move to a shared
+ * block when it exits.
+ */
+#include "TrieStats.hpp"
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+const unsigned int TrieStats::NUM_BUCKETS;
+
+thread_local TrieStats::QueryCounts TrieStats::current = {{0}, 0};
+
+/* Counters of one thread. Only the owning thread writes them, so it adds
+ * with a plain load and store, and readers see each value whole.
+ */
+class StatsBlock {
+  public:
+    atomic<unsigned long long> queries;  // number of queries
+    atomic<unsigned long long> totals[TrieStats::NUM_COUNTERS];  // sums
+    atomic<unsigned long long>
+        histograms[TrieStats::NUM_COUNTERS]
+                  [TrieStats::NUM_BUCKETS];  // queries per count bucket
+
+    /* Constructor. Initializes all counts to 0. */
+    StatsBlock() : queries(0) {
+        for (unsigned int c = 0; c < TrieStats::NUM_COUNTERS; c++) {
+            totals[c] = 0;
+            for (unsigned int b = 0; b < TrieStats::NUM_BUCKETS; b++) {
+                histograms[c][b] = 0;
+            }
+        }
+    }
+
+    /* Adds to a count. Only the owning thread may call it. */
+    static void bump(atomic<unsigned long long>& count,
+                     unsigned long long amount) {
+        count.store(count.load(memory_order_relaxed) + amount,
+                    memory_order_relaxed);
+    }
+
+    /* Adds the counts of the block to a statistics summary. */
+    void addTo(TrieStats& stats) const {
+        stats.queries += queries.load(memory_order_relaxed);
+        for (unsigned int c = 0; c < TrieStats::NUM_COUNTERS; c++) {
+            stats.totals[c] += totals[c].load(memory_order_relaxed);
+            for (unsigned int b = 0; b < TrieStats::NUM_BUCKETS; b++) {
+                stats.histograms[c][b] +=
+                    histograms[c][b].load(memory_order_relaxed);
+            }
+        }
+    }
+};
+
+/* The blocks of the live threads, and the counts of exited threads and of
+ * everything before the last reset. Guarded by registryLock, which queries
+ * only take the first time their thread records one.
+ */
+static mutex registryLock;
+static vector<StatsBlock*>& registry() {
+    static vector<StatsBlock*> blocks;
+    return blocks;
+}
+static TrieStats& exited() {
+    static TrieStats stats;
+    return stats;
+}
+static TrieStats& baseline() {
+    static TrieStats stats;
+    return stats;
+}
+
+/* Owns a thread's block, listing it while the thread runs and folding its
+ * counts into the exited counts when the thread ends.
+ */
+class StatsOwner {
+  public:
+    StatsBlock block;  // the thread's counters
+
+    /* Constructor. Lists the block. */
+    StatsOwner() {
+        lock_guard<mutex> lock(registryLock);
+        registry().push_back(&block);
+    }
+
+    /* Destructor. Keeps the counts, then drops the block from the list. */
+    ~StatsOwner() {
+        lock_guard<mutex> lock(registryLock);
+        block.addTo(exited());
+        vector<StatsBlock*>& blocks = registry();
+        for (unsigned int i = 0; i < blocks.size(); i++) {
+            if (blocks[i] == &block) {
+                blocks[i] = blocks.back();
+                blocks.pop_back();
+                break;
+            }
+        }
+    }
+};
+
+/* Constructor. Initializes all counts to 0. */
+TrieStats::TrieStats() : queries(0) {
+    for (unsigned int c = 0; c < NUM_COUNTERS; c++) {
+        totals[c] = 0;
+        for (unsigned int b = 0; b < NUM_BUCKETS; b++) {
+            histograms[c][b] = 0;
+        }
+    }
+}
+
+/* Returns true if the library was compiled with TRIE_STATS. */
+bool TrieStats::enabled() {
+#ifdef TRIE_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+/* Returns the statistics of every query since the last reset, from all
+ * threads, including ones that have exited.
+ */
+TrieStats TrieStats::collect() {
+    lock_guard<mutex> lock(registryLock);
+    TrieStats stats = exited();
+    for (const StatsBlock* block : registry()) {
+        block->addTo(stats);
+    }
+
+    // counts only grow, so the baseline is never more than the sum
+    const TrieStats& before = baseline();
+    stats.queries -= before.queries;
+    for (unsigned int c = 0; c < NUM_COUNTERS; c++) {
+        stats.totals[c] -= before.totals[c];
+        for (unsigned int b = 0; b < NUM_BUCKETS; b++) {
+            stats.histograms[c][b] -= before.histograms[c][b];
+        }
+    }
+    return stats;
+}
+
+/* Starts the statistics over from 0. The threads' own counters are left
+ * alone, since only they may write them, and the current sums are kept as
+ * a baseline to subtract instead.
+ */
+void TrieStats::reset() {
+    TrieStats now = collect();
+    lock_guard<mutex> lock(registryLock);
+    TrieStats& before = baseline();
+    before.queries += now.queries;
+    for (unsigned int c = 0; c < NUM_COUNTERS; c++) {
+        before.totals[c] += now.totals[c];
+        for (unsigned int b = 0; b < NUM_BUCKETS; b++) {
+            before.histograms[c][b] += now.histograms[c][b];
+        }
+    }
+}
+
+/* Returns the name of a counter. */
+const char* TrieStats::counterName(Counter counter) {
+    static const char* const NAMES[NUM_COUNTERS] = {
+        "nodes visited", "subtrees pruned", "heap pushes", "heap pops",
+        "prefix walk nodes"};
+    return NAMES[counter];
+}
+
+/* Returns the bucket of the histograms a count falls in. */
+unsigned int TrieStats::bucketOf(unsigned long long count) {
+    unsigned int bucket = 0;
+    while (count > 0 && bucket < NUM_BUCKETS - 1) {
+        count >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+/* Folds the counters of this thread's query into its histograms. */
+void TrieStats::finishQuery() {
+    thread_local StatsOwner owner;
+    StatsBlock& block = owner.block;
+    StatsBlock::bump(block.queries, 1);
+    for (unsigned int c = 0; c < NUM_COUNTERS; c++) {
+        unsigned long long count = current.counts[c];
+        StatsBlock::bump(block.totals[c], count);
+        StatsBlock::bump(block.histograms[c][bucketOf(count)], 1);
+        current.counts[c] = 0;
+    }
+}
+
+/* Prints the totals, averages and non-empty histogram buckets.
+ * @param out Stream to print to
+ */
+void TrieStats::print(ostream& out) const {
+    out << "Queries: " << queries << endl;
+    for (unsigned int c = 0; c < NUM_COUNTERS; c++) {
+        out << "\t" << counterName((Counter)c) << ": total " << totals[c]
+            << ", average " << (queries > 0 ? (double)totals[c] / queries : 0)
+            << endl;
+        for (unsigned int b = 0; b < NUM_BUCKETS; b++) {
+            if (histograms[c][b] == 0) {
+                continue;
+            }
+            unsigned long long low = b == 0 ? 0 : 1ULL << (b - 1);
+            unsigned long long high = b == 0 ? 0 : (1ULL << b) - 1;
+            out << "\t\t" << low;
+            if (b == NUM_BUCKETS - 1) {
+                out << " and up";
+            } else if (high > low) {
+                out << " to " << high;
+            }
+            out << ": " << histograms[c][b] << endl;
+        }
+    }
+}
@@ -0,0 +1,111 @@
+/**
+ * The header of the query statistics of dictionary tries: counters of the
+ * work each completion and wildcard query does, compiled in only when
+ * TRIE_STATS is defined.
+ */
+#ifndef TRIE_STATS_HPP
+#define TRIE_STATS_HPP
+
+#include <ostream>
+
+using namespace std;
+
+// Hooks on the query paths. Without TRIE_STATS they expand to nothing, so
+// their arguments are not even evaluated.
+#ifdef TRIE_STATS
+#define TRIE_STAT_ADD(counter, n) TrieStats::add(TrieStats::counter, (n))
+#define TRIE_STAT_QUERY() TrieStats::QueryScope trieStatsQuery
+#else
+#define TRIE_STAT_ADD(counter, n) ((void)0)
+#define TRIE_STAT_QUERY() ((void)0)
+#endif
+
+/**
+ * The class for the statistics of the queries run so far. Each thread adds
+ * up the counters of its current query, then folds them into totals and
+ * power of two histograms of its own that only it writes, so queries never
+ * wait on each other. collect() sums the histograms of every thread.
+ */
+class TrieStats {
+  public:
+    /* What is counted for each query. */
+    enum Counter {
+        NODES_VISITED,    // nodes looked at below the prefix
+        SUBTREES_PRUNED,  // subtrees skipped by maxFreq or length
+        HEAP_PUSHES,      // pushes onto the result heap or frontier
+        HEAP_POPS,        // pops off the result heap or frontier
+        WALK_NODES,       // nodes looked at walking the prefix
+        NUM_COUNTERS
+    };
+
+    // bucket 0 counts queries with a count of 0, bucket b > 0 those with a
+    // count from 2^(b-1) up to 2^b - 1, and the last bucket everything above
+    static const unsigned int NUM_BUCKETS = 33;
+
+    unsigned long long queries;                 // number of queries
+    unsigned long long totals[NUM_COUNTERS];    // sum over all queries
+    unsigned long long histograms[NUM_COUNTERS]
+                                 [NUM_BUCKETS];  // queries per count bucket
+
+    /* Constructor. Initializes all counts to 0. */
+    TrieStats();
+
+    /* Returns true if the library was compiled with TRIE_STATS. */
+    static bool enabled();
+
+    /* Returns the statistics of every query since the last reset, from all
+     * threads, including ones that have exited.
+     */
+    static TrieStats collect();
+
+    /* Starts the statistics over from 0. */
+    static void reset();
+
+    /* Returns the name of a counter. */
+    static const char* counterName(Counter counter);
+
+    /* Returns the bucket of the histograms a count falls in. */
+    static unsigned int bucketOf(unsigned long long count);
+
+    /* Prints the totals, averages and non-empty histogram buckets.
+     * @param out Stream to print to
+     */
+    void print(ostream& out) const;
+
+    /* Adds to a counter of the current query of this thread. */
+    static void add(Counter counter, unsigned long long count) {
+        current.counts[counter] += count;
+    }
+
+    /**
+     * Marks the span of a query. Queries that run inside another, such as
+     * the prefix search of a wildcard query, count as part of it.
+     */
+    class QueryScope {
+      public:
+        /* Constructor. Starts a query unless one is running. */
+        QueryScope() { current.depth++; }
+
+        /* Ends the query, recording it if it was the outermost. */
+        ~QueryScope() {
+            if (--current.depth == 0) {
+                finishQuery();
+            }
+        }
+    };
+
+  private:
+    /* Counters of the query a thread is running. */
+    class QueryCounts {
+      public:
+        unsigned long long counts[NUM_COUNTERS];  // counts so far
+        unsigned int depth;                       // nested query scopes
+    };
+
+    static thread_local QueryCounts current;  // this thread's query
+
+    /* Folds the counters of this thread's query into its histograms. */
+    static void finishQuery();
+};
+
+#endif  // TRIE_STATS_HPP
@@ -0,0 +1,110 @@
+/**
+ * The autocomplete client: a blocking connection to an autocomplete server
+ * that can pipeline its requests.
+ */
+#include "AutocompleteClient.hpp"
+#include <cerrno>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+
+const size_t AutocompleteClient::READ_SIZE;
+
+/* Constructor. Initializes a client that is not connected. */
+AutocompleteClient::AutocompleteClient() : fd(-1), inStart(0) {}
+
+/* Connects to a server.
+ * @param address "unix:<path>" or "tcp:<port>", see Protocol::resolve
+ * @return True if connected. Otherwise, false.
+ */
+bool AutocompleteClient::connect(const string& address) {
+    sockaddr_storage addr;
+    socklen_t length;
+    if (fd != -1 || !Protocol::resolve(address, addr, length)) {
+        return false;
+    }
+    fd = socket(addr.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        return false;
+    }
+    if (::connect(fd, (sockaddr*)&addr, length) != 0) {
+        close(fd);
+        fd = -1;
+        return false;
+    }
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    return true;
+}
+
+/* Queues a request to send.
+ * @param op Protocol::PREFIX or Protocol::PATTERN
+ * @param numCompletions Number of words wanted
+ * @param query Prefix or pattern
+ */
+void AutocompleteClient::sendRequest(unsigned char op,
+                                     unsigned int numCompletions,
+                                     string_view query) {
+    Protocol::appendRequest(out, op, numCompletions, query);
+}
+
+/* Sends every queued request, waiting until the socket takes them.
+ * @return False if the connection failed. Otherwise, true.
+ */
+bool AutocompleteClient::flush() {
+    size_t start = 0;
+    while (start < out.size()) {
+        ssize_t sent =
+            send(fd, out.data() + start, out.size() - start, MSG_NOSIGNAL);
+        if (sent > 0) {
+            start += sent;
+        } else if (errno != EINTR) {
+            return false;
+        }
+    }
+    out.clear();
+    return true;
+}
+
+/* Waits for the response to the oldest request not answered yet.
+ * @param status Set to the status of the response
+ * @param words Set to the words of the response
+ * @return False if the connection failed or closed. Otherwise, true.
+ */
+bool AutocompleteClient::receiveResponse(unsigned char& status,
+                                         vector<string>& words) {
+    while (true) {
+        size_t used;
+        Protocol::Parse parse = Protocol::parseResponse(
+            string_view(in).substr(inStart), status, words, used);
+        if (parse == Protocol::COMPLETE) {
+            inStart += used;
+            if (inStart == in.size()) {
+                in.clear();
+                inStart = 0;
+            }
+            return true;
+        }
+        if (parse == Protocol::INVALID || fd == -1) {
+            return false;
+        }
+
+        // drop the parsed responses before reading more
+        in.erase(0, inStart);
+        inStart = 0;
+        char block[READ_SIZE];
+        ssize_t received = recv(fd, block, sizeof(block), 0);
+        if (received > 0) {
+            in.append(block, received);
+        } else if (received == 0 || errno != EINTR) {
+            return false;
+        }
+    }
+}
+
+/* Closes the connection. */
+AutocompleteClient::~AutocompleteClient() {
+    if (fd != -1) {
+        close(fd);
+    }
+}
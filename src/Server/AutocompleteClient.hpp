@@ -0,0 +1,68 @@
+/**
+ * The header of the autocomplete client: a blocking connection to an
+ * autocomplete server that can pipeline its requests.
+ */
+#ifndef AUTOCOMPLETE_CLIENT_HPP
+#define AUTOCOMPLETE_CLIENT_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Protocol.hpp"
+
+using namespace std;
+
+/**
+ * The class for a client of an autocomplete server. Requests are queued
+ * until flush() sends them, so many can be in flight at once, and responses
+ * are received in the order the requests were sent. The server stops reading
+ * a connection whose answers are not received, so a client should bound the
+ * requests it has in flight rather than send them all before receiving.
+ */
+class AutocompleteClient {
+  private:
+    static const size_t READ_SIZE = 1 << 16;  // bytes read at a time
+
+    int fd;          // socket of the connection, or -1
+    string out;      // requests not yet sent
+    string in;       // bytes received, not yet parsed
+    size_t inStart;  // start of the unparsed bytes in in
+
+  public:
+    /* Constructor. Initializes a client that is not connected. */
+    AutocompleteClient();
+
+    /* Connects to a server.
+     * @param address "unix:<path>" or "tcp:<port>", see Protocol::resolve
+     * @return True if connected. Otherwise, false.
+     */
+    bool connect(const string& address);
+
+    /* Queues a request to send.
+     * @param op Protocol::PREFIX or Protocol::PATTERN
+     * @param numCompletions Number of words wanted
+     * @param query Prefix or pattern
+     */
+    void sendRequest(unsigned char op, unsigned int numCompletions,
+                     string_view query);
+
+    /* Sends every queued request, waiting until the socket takes them.
+     * @return False if the connection failed. Otherwise, true.
+     */
+    bool flush();
+
+    /* Waits for the response to the oldest request not answered yet.
+     * @param status Set to the status of the response
+     * @param words Set to the words of the response
+     * @return False if the connection failed or closed. Otherwise, true.
+     */
+    bool receiveResponse(unsigned char& status, vector<string>& words);
+
+    /* Closes the connection. */
+    ~AutocompleteClient();
+
+    AutocompleteClient(const AutocompleteClient&) = delete;
+    AutocompleteClient& operator=(const AutocompleteClient&) = delete;
+};
+
+#endif  // AUTOCOMPLETE_CLIENT_HPP
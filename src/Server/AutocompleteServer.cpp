@@ -0,0 +1,313 @@
+/**
+ * The autocomplete server: an epoll event loop over non-blocking sockets
+ * that answers pipelined completion requests against one dictionary.
+ */
+#include "AutocompleteServer.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const size_t AutocompleteServer::READ_SIZE;
+const size_t AutocompleteServer::MAX_PENDING;
+const unsigned int AutocompleteServer::MAX_EVENTS;
+
+/* Constructor.
+ * @param d Dictionary to answer from. Must outlive the server, and not change
+ * while the server runs.
+ */
+AutocompleteServer::AutocompleteServer(const Dictionary& d)
+    : dict(d), listenFd(-1), served(0) {
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = wakeFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+}
+
+/* Starts listening on an address.
+ * @param address "unix:<path>" or "tcp:<port>", see Protocol::resolve. Port 0
+ * picks a free port.
+ * @return True if the server listens. Otherwise, false.
+ */
+bool AutocompleteServer::listen(const string& address) {
+    sockaddr_storage addr;
+    socklen_t length;
+    if (listenFd != -1 || epollFd == -1 || wakeFd == -1 ||
+        !Protocol::resolve(address, addr, length)) {
+        return false;
+    }
+    int fd = socket(addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                    0);
+    if (fd == -1) {
+        return false;
+    }
+    string path;
+    if (addr.ss_family == AF_UNIX) {
+        // a socket file left by an earlier server would fail the bind
+        path = address.substr(5);
+        struct stat info;
+        if (stat(path.c_str(), &info) == 0 && S_ISSOCK(info.st_mode)) {
+            unlink(path.c_str());
+        }
+    } else {
+        int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    }
+
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (bind(fd, (sockaddr*)&addr, length) != 0 ||
+        ::listen(fd, SOMAXCONN) != 0 ||
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+        close(fd);
+        return false;
+    }
+    listenFd = fd;
+    unixPath = path;
+    return true;
+}
+
+/* Returns the TCP port the server listens on, or 0 if not TCP. */
+unsigned short AutocompleteServer::port() const {
+    sockaddr_storage addr;
+    socklen_t length = sizeof(addr);
+    if (listenFd == -1 ||
+        getsockname(listenFd, (sockaddr*)&addr, &length) != 0 ||
+        addr.ss_family != AF_INET) {
+        return 0;
+    }
+    return ntohs(((sockaddr_in*)&addr)->sin_port);
+}
+
+/* Runs the event loop until stop() is called. */
+void AutocompleteServer::run() {
+    epoll_event events[MAX_EVENTS];
+    bool stopping = false;
+    while (!stopping) {
+        int ready = epoll_wait(epollFd, events, MAX_EVENTS, -1);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        for (int i = 0; i < ready; i++) {
+            int fd = events[i].data.fd;
+            if (fd == wakeFd) {
+                uint64_t count;
+                stopping = read(wakeFd, &count, sizeof(count)) > 0;
+            } else if (fd == listenFd) {
+                acceptConnections();
+            } else {
+                handle(fd, events[i].events);
+            }
+        }
+    }
+}
+
+/* Makes run() return. Safe to call from any thread or a signal handler. */
+void AutocompleteServer::stop() {
+    uint64_t one = 1;
+    ssize_t written = write(wakeFd, &one, sizeof(one));
+    (void)written;  // only fails if stop was called 2^64 - 1 times
+}
+
+/* Returns the number of requests answered so far. */
+unsigned long long AutocompleteServer::requestsServed() const {
+    return served.load(memory_order_relaxed);
+}
+
+/* Accepts every pending connection. */
+void AutocompleteServer::acceptConnections() {
+    while (true) {
+        int fd = accept4(listenFd, nullptr, nullptr,
+                         SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd == -1) {
+            return;  // none left, or out of descriptors until one closes
+        }
+
+        // answers are small, so send each as soon as it is ready. Unix
+        // sockets have no Nagle delay and just refuse the option.
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            close(fd);
+            continue;
+        }
+        connections[fd].events = EPOLLIN;
+    }
+}
+
+/* Handles the events of a connection.
+ * @param fd Socket of the connection
+ * @param events Events epoll reported
+ */
+void AutocompleteServer::handle(int fd, unsigned int events) {
+    unordered_map<int, Connection>::iterator found = connections.find(fd);
+    if (found == connections.end()) {
+        return;
+    }
+    Connection& conn = found->second;
+    if (events & EPOLLERR) {
+        closeConnection(fd);
+        return;
+    }
+
+    // one read per event, so busy connections take turns. Nothing is read
+    // while requests already received wait on unsent responses.
+    if ((events & (EPOLLIN | EPOLLHUP)) && conn.open && !conn.paused &&
+        conn.out.size() - conn.outStart < MAX_PENDING) {
+        char block[READ_SIZE];
+        ssize_t received = recv(fd, block, sizeof(block), 0);
+        if (received > 0) {
+            conn.in.append(block, received);
+        } else if (received == 0) {
+            conn.open = false;  // answer what came, then close
+        } else if (errno != EAGAIN && errno != EINTR) {
+            closeConnection(fd);
+            return;
+        }
+    }
+
+    // answer and send in turns while the socket takes the responses, so
+    // requests paused by a full buffer go on once it drains
+    do {
+        if (!answer(conn) || !flush(fd, conn)) {
+            closeConnection(fd);
+            return;
+        }
+    } while (conn.paused && conn.out.size() - conn.outStart < MAX_PENDING);
+    watch(fd, conn);
+}
+
+/* Answers the whole requests received on a connection, until MAX_PENDING
+ * bytes of responses are unsent.
+ * @param conn Connection to answer
+ * @return False if a request was invalid and the connection must close
+ */
+bool AutocompleteServer::answer(Connection& conn) {
+    Request request;
+    size_t start = 0;
+    size_t used;
+    Protocol::Parse parse = Protocol::INCOMPLETE;
+    conn.paused = false;
+    while (true) {
+        if (conn.out.size() - conn.outStart >= MAX_PENDING) {
+            conn.paused = start < conn.in.size();  // the rest waits
+            break;
+        }
+        parse = Protocol::parseRequest(string_view(conn.in).substr(start),
+                                       request, used);
+        if (parse != Protocol::COMPLETE) {
+            break;
+        }
+        start += used;
+        unsigned int numCompletions =
+            std::min(request.numCompletions, Protocol::MAX_COMPLETIONS);
+        if (request.op == Protocol::PREFIX) {
+            Protocol::appendResponse(
+                conn.out, Protocol::OK,
+                dict.predictCompletions(request.query, numCompletions));
+        } else if (request.op == Protocol::PATTERN) {
+            Protocol::appendResponse(
+                conn.out, Protocol::OK,
+                dict.predictUnderscores(request.query, numCompletions));
+        } else {
+            Protocol::appendResponse(conn.out, Protocol::BAD_REQUEST,
+                                     vector<string>());
+        }
+        served.fetch_add(1, memory_order_relaxed);
+    }
+    conn.in.erase(0, start);  // only part of a frame, or paused requests
+    return parse != Protocol::INVALID;
+}
+
+/* Sends as much of a connection's responses as the socket takes.
+ * @param fd Socket of the connection
+ * @param conn Connection to send
+ * @return False if the socket failed and the connection must close
+ */
+bool AutocompleteServer::flush(int fd, Connection& conn) {
+    while (conn.outStart < conn.out.size()) {
+        ssize_t sent = send(fd, conn.out.data() + conn.outStart,
+                            conn.out.size() - conn.outStart, MSG_NOSIGNAL);
+        if (sent > 0) {
+            conn.outStart += sent;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        } else if (errno != EINTR) {
+            return false;
+        }
+    }
+    if (conn.outStart == conn.out.size()) {
+        conn.out.clear();
+        conn.outStart = 0;
+    } else if (conn.outStart > conn.out.size() / 2) {
+        conn.out.erase(0, conn.outStart);
+        conn.outStart = 0;
+    }
+    return true;
+}
+
+/* Sets the events epoll watches a connection for from its buffers, or closes
+ * it once it is done.
+ * @param fd Socket of the connection
+ * @param conn Connection to watch
+ */
+void AutocompleteServer::watch(int fd, Connection& conn) {
+    size_t pending = conn.out.size() - conn.outStart;
+    if (!conn.open && pending == 0) {
+        closeConnection(fd);
+        return;
+    }
+    unsigned int events = 0;
+    if (conn.open && pending < MAX_PENDING) {
+        events |= EPOLLIN;
+    }
+    if (pending > 0) {
+        events |= EPOLLOUT;
+    }
+    if (events != conn.events) {
+        epoll_event event = {};
+        event.events = events;
+        event.data.fd = fd;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event);
+        conn.events = events;
+    }
+}
+
+/* Closes a connection.
+ * @param fd Socket of the connection
+ */
+void AutocompleteServer::closeConnection(int fd) {
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    connections.erase(fd);
+}
+
+/* Closes every connection and the listening socket. */
+AutocompleteServer::~AutocompleteServer() {
+    for (const pair<const int, Connection>& conn : connections) {
+        close(conn.first);
+    }
+    if (listenFd != -1) {
+        close(listenFd);
+    }
+    if (!unixPath.empty()) {
+        unlink(unixPath.c_str());
+    }
+    close(epollFd);
+    close(wakeFd);
+}
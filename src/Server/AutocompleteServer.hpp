@@ -0,0 +1,124 @@
+/**
+ * The header of the autocomplete server: an epoll event loop that answers
+ * pipelined completion requests from many connections against one shared
+ * dictionary.
+ */
+#ifndef AUTOCOMPLETE_SERVER_HPP
+#define AUTOCOMPLETE_SERVER_HPP
+
+#include <atomic>
+#include <string>
+#include <unordered_map>
+#include "Dictionary.hpp"
+#include "Protocol.hpp"
+
+using namespace std;
+
+/**
+ * The class for a server that listens on a Unix domain socket or a loopback
+ * TCP port and speaks Protocol. One thread runs the event loop over
+ * non-blocking sockets: each readable connection has every whole request in
+ * its input answered in order, and the responses are written out as the
+ * socket takes them. A connection whose responses pile up unsent is neither
+ * read nor answered until they drain, so a client that never reads can not
+ * grow the server without bound.
+ */
+class AutocompleteServer {
+  private:
+    static const size_t READ_SIZE = 1 << 16;    // bytes read at a time
+    static const size_t MAX_PENDING = 1 << 20;  // unsent bytes before pausing
+    static const unsigned int MAX_EVENTS = 64;  // events taken per wait
+
+    /* Buffers of one connection. */
+    class Connection {
+      public:
+        string in;            // bytes received, not yet answered
+        string out;           // responses not yet sent
+        size_t outStart;      // start of the unsent bytes in out
+        bool open;            // false once the client has finished sending
+        bool paused;          // true if in holds requests left unanswered
+                              // until out drains
+        unsigned int events;  // events epoll watches the socket for
+
+        /* Constructor. Initializes empty buffers. */
+        Connection() : outStart(0), open(true), paused(false), events(0) {}
+    };
+
+    const Dictionary& dict;  // dictionary every request is answered from
+    int listenFd;            // listening socket, or -1
+    int epollFd;             // epoll instance of the event loop
+    int wakeFd;              // eventfd that stop() writes to
+    string unixPath;         // socket file to remove, if listening on one
+    unordered_map<int, Connection> connections;  // open connections by fd
+    atomic<unsigned long long> served;           // requests answered
+
+    /* Accepts every pending connection. */
+    void acceptConnections();
+
+    /* Handles the events of a connection.
+     * @param fd Socket of the connection
+     * @param events Events epoll reported
+     */
+    void handle(int fd, unsigned int events);
+
+    /* Answers the whole requests received on a connection, until
+     * MAX_PENDING bytes of responses are unsent.
+     * @param conn Connection to answer
+     * @return False if a request was invalid and the connection must close
+     */
+    bool answer(Connection& conn);
+
+    /* Sends as much of a connection's responses as the socket takes.
+     * @param fd Socket of the connection
+     * @param conn Connection to send
+     * @return False if the socket failed and the connection must close
+     */
+    bool flush(int fd, Connection& conn);
+
+    /* Sets the events epoll watches a connection for from its buffers, or
+     * closes it once it is done.
+     * @param fd Socket of the connection
+     * @param conn Connection to watch
+     */
+    void watch(int fd, Connection& conn);
+
+    /* Closes a connection.
+     * @param fd Socket of the connection
+     */
+    void closeConnection(int fd);
+
+  public:
+    /* Constructor.
+     * @param d Dictionary to answer from. Must outlive the server, and not
+     * change while the server runs.
+     */
+    explicit AutocompleteServer(const Dictionary& d);
+
+    /* Starts listening on an address.
+     * @param address "unix:<path>" or "tcp:<port>", see Protocol::resolve.
+     * Port 0 picks a free port.
+     * @return True if the server listens. Otherwise, false.
+     */
+    bool listen(const string& address);
+
+    /* Returns the TCP port the server listens on, or 0 if not TCP. */
+    unsigned short port() const;
+
+    /* Runs the event loop until stop() is called. */
+    void run();
+
+    /* Makes run() return. Safe to call from any thread or a signal handler.
+     */
+    void stop();
+
+    /* Returns the number of requests answered so far. */
+    unsigned long long requestsServed() const;
+
+    /* Closes every connection and the listening socket. */
+    ~AutocompleteServer();
+
+    AutocompleteServer(const AutocompleteServer&) = delete;
+    AutocompleteServer& operator=(const AutocompleteServer&) = delete;
+};
+
+#endif  // AUTOCOMPLETE_SERVER_HPP
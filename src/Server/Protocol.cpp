@@ -0,0 +1,179 @@
+/**
+ * The autocomplete wire protocol: encoding and parsing of request and
+ * response frames, and resolving of the addresses servers listen on.
+ */
+#include "Protocol.hpp"
+#include <arpa/inet.h>
+#include <cstdlib>
+#include <cstring>
+#include <netinet/in.h>
+#include <sys/un.h>
+
+const unsigned char Protocol::PREFIX;
+const unsigned char Protocol::PATTERN;
+const unsigned char Protocol::OK;
+const unsigned char Protocol::BAD_REQUEST;
+const unsigned int Protocol::HEADER_SIZE;
+const unsigned int Protocol::MAX_FRAME;
+const unsigned int Protocol::MAX_COMPLETIONS;
+
+/* Appends a 4 byte big endian number to a buffer. */
+static void appendNumber(string& out, unsigned int number) {
+    char bytes[4] = {(char)(number >> 24), (char)(number >> 16),
+                     (char)(number >> 8), (char)number};
+    out.append(bytes, sizeof(bytes));
+}
+
+/* Reads a 4 byte big endian number from a buffer holding at least 4 bytes.
+ */
+static unsigned int readNumber(const char* in) {
+    const unsigned char* bytes = (const unsigned char*)in;
+    return (unsigned int)bytes[0] << 24 | (unsigned int)bytes[1] << 16 |
+           (unsigned int)bytes[2] << 8 | (unsigned int)bytes[3];
+}
+
+/* Appends a request frame to a buffer.
+ * @param out Buffer to append to
+ * @param op PREFIX or PATTERN
+ * @param numCompletions Number of words wanted
+ * @param query Prefix or pattern
+ */
+void Protocol::appendRequest(string& out, unsigned char op,
+                             unsigned int numCompletions, string_view query) {
+    appendNumber(out, 1 + 4 + query.size());
+    out.push_back(op);
+    appendNumber(out, numCompletions);
+    out.append(query.data(), query.size());
+}
+
+/* Parses the request frame at the front of a buffer.
+ * @param in Bytes received so far
+ * @param request Set to the request, if COMPLETE
+ * @param used Set to the bytes of the frame, if COMPLETE
+ * @return COMPLETE, INCOMPLETE if more bytes are needed, or INVALID if the
+ * frame is too large or too short to be a request
+ */
+Protocol::Parse Protocol::parseRequest(string_view in, Request& request,
+                                       size_t& used) {
+    if (in.size() < HEADER_SIZE) {
+        return INCOMPLETE;
+    }
+    unsigned int body = readNumber(in.data());
+    if (body < 1 + 4 || body > MAX_FRAME) {
+        return INVALID;
+    }
+    if (in.size() < HEADER_SIZE + body) {
+        return INCOMPLETE;
+    }
+    const char* data = in.data() + HEADER_SIZE;
+    request.op = data[0];
+    request.numCompletions = readNumber(data + 1);
+    request.query.assign(data + 1 + 4, body - 1 - 4);
+    used = HEADER_SIZE + body;
+    return COMPLETE;
+}
+
+/* Appends a response frame to a buffer.
+ * @param out Buffer to append to
+ * @param status OK or BAD_REQUEST
+ * @param words Words of the answer, most frequent first
+ */
+void Protocol::appendResponse(string& out, unsigned char status,
+                              const vector<string>& words) {
+    size_t body = 1 + 4;
+    for (const string& word : words) {
+        body += 4 + word.size();
+    }
+    out.reserve(out.size() + HEADER_SIZE + body);
+    appendNumber(out, body);
+    out.push_back(status);
+    appendNumber(out, words.size());
+    for (const string& word : words) {
+        appendNumber(out, word.size());
+        out.append(word);
+    }
+}
+
+/* Parses the response frame at the front of a buffer.
+ * @param in Bytes received so far
+ * @param status Set to the status, if COMPLETE
+ * @param words Set to the words, if COMPLETE
+ * @param used Set to the bytes of the frame, if COMPLETE
+ * @return COMPLETE, INCOMPLETE if more bytes are needed, or INVALID if the
+ * frame does not hold the words it says
+ */
+Protocol::Parse Protocol::parseResponse(string_view in, unsigned char& status,
+                                        vector<string>& words, size_t& used) {
+    if (in.size() < HEADER_SIZE) {
+        return INCOMPLETE;
+    }
+    size_t body = readNumber(in.data());
+    if (body < 1 + 4) {
+        return INVALID;
+    }
+    if (in.size() < HEADER_SIZE + body) {
+        return INCOMPLETE;
+    }
+
+    // every word must lie inside the body, and the body must end with them
+    const char* data = in.data() + HEADER_SIZE;
+    size_t pos = 1 + 4;
+    unsigned int count = readNumber(data + 1);
+    words.clear();
+    for (unsigned int i = 0; i < count; i++) {
+        if (body - pos < 4) {
+            return INVALID;
+        }
+        size_t length = readNumber(data + pos);
+        pos += 4;
+        if (body - pos < length) {
+            return INVALID;
+        }
+        words.emplace_back(data + pos, length);
+        pos += length;
+    }
+    if (pos != body) {
+        return INVALID;
+    }
+    status = data[0];
+    used = HEADER_SIZE + body;
+    return COMPLETE;
+}
+
+/* Resolves an address: "unix:<path>" for a Unix domain socket, or
+ * "tcp:<port>" for a port of the loopback interface.
+ * @param address Address to resolve
+ * @param addr Set to the socket address
+ * @param length Set to the length of the socket address
+ * @return True if the address is valid. Otherwise, false.
+ */
+bool Protocol::resolve(const string& address, sockaddr_storage& addr,
+                       socklen_t& length) {
+    memset(&addr, 0, sizeof(addr));
+    if (address.compare(0, 5, "unix:") == 0) {
+        string path = address.substr(5);
+        sockaddr_un* unixAddr = (sockaddr_un*)&addr;
+        if (path.empty() || path.size() >= sizeof(unixAddr->sun_path)) {
+            return false;
+        }
+        unixAddr->sun_family = AF_UNIX;
+        memcpy(unixAddr->sun_path, path.c_str(), path.size() + 1);
+        length = sizeof(sockaddr_un);
+        return true;
+    }
+    if (address.compare(0, 4, "tcp:") == 0) {
+        string port = address.substr(4);
+        char* end;
+        unsigned long number = strtoul(port.c_str(), &end, 10);
+        if (port.empty() || *end != '\0' || number > 65535) {
+            return false;
+        }
+        sockaddr_in* inAddr = (sockaddr_in*)&addr;
+        inAddr->sin_family = AF_INET;
+        inAddr->sin_port = htons(number);
+        inAddr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        length = sizeof(sockaddr_in);
+        return true;
+    }
+    return false;
+}
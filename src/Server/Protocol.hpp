@@ -0,0 +1,98 @@
+/**
+ * The header of the autocomplete wire protocol: length prefixed frames of
+ * completion requests and their responses, and the addresses servers listen
+ * on.
+ */
+#ifndef PROTOCOL_HPP
+#define PROTOCOL_HPP
+
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <vector>
+
+using namespace std;
+
+/**
+ * A completion request: complete a prefix or match a wildcard pattern, with
+ * up to numCompletions words.
+ */
+class Request {
+  public:
+    unsigned char op;             // Protocol::PREFIX or Protocol::PATTERN
+    unsigned int numCompletions;  // number of words wanted
+    string query;                 // prefix or pattern
+};
+
+/**
+ * Encoding of the protocol. Every message is a frame of a 4 byte big endian
+ * body length followed by the body. A request body is the op byte, the
+ * number of completions as 4 bytes and the query. A response body is the
+ * status byte, the number of words as 4 bytes and each word as its 4 byte
+ * length and bytes. Requests on a connection may be pipelined: the client
+ * sends as many as it likes and the responses come back in the same order.
+ */
+class Protocol {
+  public:
+    static const unsigned char PREFIX = 'P';   // op to complete a prefix
+    static const unsigned char PATTERN = 'W';  // op to match a pattern
+
+    static const unsigned char OK = 0;           // status of an answer
+    static const unsigned char BAD_REQUEST = 1;  // status of an unknown op
+
+    static const unsigned int HEADER_SIZE = 4;  // bytes of the body length
+    static const unsigned int MAX_FRAME = 1 << 16;  // largest request body
+    static const unsigned int MAX_COMPLETIONS = 1000;  // most words answered
+
+    /* The outcome of parsing the front of a buffer. */
+    enum Parse { COMPLETE, INCOMPLETE, INVALID };
+
+    /* Appends a request frame to a buffer.
+     * @param out Buffer to append to
+     * @param op PREFIX or PATTERN
+     * @param numCompletions Number of words wanted
+     * @param query Prefix or pattern
+     */
+    static void appendRequest(string& out, unsigned char op,
+                              unsigned int numCompletions, string_view query);
+
+    /* Parses the request frame at the front of a buffer.
+     * @param in Bytes received so far
+     * @param request Set to the request, if COMPLETE
+     * @param used Set to the bytes of the frame, if COMPLETE
+     * @return COMPLETE, INCOMPLETE if more bytes are needed, or INVALID if
+     * the frame is too large or too short to be a request
+     */
+    static Parse parseRequest(string_view in, Request& request, size_t& used);
+
+    /* Appends a response frame to a buffer.
+     * @param out Buffer to append to
+     * @param status OK or BAD_REQUEST
+     * @param words Words of the answer, most frequent first
+     */
+    static void appendResponse(string& out, unsigned char status,
+                               const vector<string>& words);
+
+    /* Parses the response frame at the front of a buffer.
+     * @param in Bytes received so far
+     * @param status Set to the status, if COMPLETE
+     * @param words Set to the words, if COMPLETE
+     * @param used Set to the bytes of the frame, if COMPLETE
+     * @return COMPLETE, INCOMPLETE if more bytes are needed, or INVALID if
+     * the frame does not hold the words it says
+     */
+    static Parse parseResponse(string_view in, unsigned char& status,
+                               vector<string>& words, size_t& used);
+
+    /* Resolves an address: "unix:<path>" for a Unix domain socket, or
+     * "tcp:<port>" for a port of the loopback interface.
+     * @param address Address to resolve
+     * @param addr Set to the socket address
+     * @param length Set to the length of the socket address
+     * @return True if the address is valid. Otherwise, false.
+     */
+    static bool resolve(const string& address, sockaddr_storage& addr,
+                        socklen_t& length);
+};
+
+#endif  // PROTOCOL_HPP
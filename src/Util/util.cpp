@@ -3,8 +3,10 @@
  * benchmarking DictionaryTrie
  */
 #include "util.hpp"
+#include <algorithm>
+#include <cstring>
 #include <iostream>
-#include <sstream>
+#include <thread>
 
 /* Starts the timer. Saves the current time. */
 void Timer::begin_timer() { start = std::chrono::high_resolution_clock::now(); }
@@ -21,93 +23,427 @@ long long Timer::end_timer() {
         .count();
 }
 
-/* Load all the words in word stream into the dictionary trie */
-void Utils::loadDict(DictionaryTrie& dict, istream& words) {
+/* Constructor. Sorts the latencies.
+ * @param latencies Latencies to summarize, at least one
+ */
+LatencySummary::LatencySummary(vector<long long>& latencies)
+    : count(latencies.size()) {
+    sort(latencies.begin(), latencies.end());
+    long long total = 0;
+    for (long long latency : latencies) {
+        total += latency;
+    }
+    mean = total / (long long)count;
+    p50 = at(latencies, 0.5);
+    p95 = at(latencies, 0.95);
+    p99 = at(latencies, 0.99);
+    p999 = at(latencies, 0.999);
+    max = latencies.back();
+}
+
+/* Returns the latency a given fraction of the way into a sorted list. */
+long long LatencySummary::at(const vector<long long>& sorted,
+                             double fraction) {
+    return sorted[(size_t)(fraction * (sorted.size() - 1))];
+}
+
+/* Returns true for the characters istream treats as whitespace. */
+static inline bool isSpace(char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+/* Constructor.
+ * @param words Stream to read the dictionary from
+ */
+DictReader::DictReader(istream& words)
+    : in(&words), buffer(BLOCK_SIZE), pos(0), end(0), bytesRead(0) {
+    data = buffer.data();
+}
+
+/* Constructor. Parses a dictionary already in memory, normalizing the phrases
+ * in place, so nothing is copied.
+ * @param text Start of the dictionary text. Overwritten by the reader.
+ * @param size Bytes of the dictionary text
+ */
+DictReader::DictReader(char* text, size_t size)
+    : in(nullptr), data(text), pos(0), end(size), bytesRead(size) {}
+
+/* Finds the end of the next line, reading more of the stream if the line is
+ * not complete in the buffer yet.
+ * @return Offset of the '\n' ending the line, or end at end of stream
+ */
+size_t DictReader::nextLineEnd() {
+    size_t scanned = pos;
+    while (true) {
+        const char* newline = static_cast<const char*>(
+            memchr(data + scanned, '\n', end - scanned));
+        if (newline != nullptr) {
+            return newline - data;
+        }
+        if (in == nullptr || !*in) {
+            return end;  // last line without a newline
+        }
+
+        // move the partial line to the front, growing for very long lines
+        memmove(data, data + pos, end - pos);
+        end -= pos;
+        scanned = end;
+        pos = 0;
+        if (buffer.size() - end < BLOCK_SIZE / 2) {
+            buffer.resize(buffer.size() * 2);
+            data = buffer.data();
+        }
+        in->read(data + end, buffer.size() - end);
+        end += in->gcount();
+        bytesRead += in->gcount();
+    }
+}
+
+/* Reads the next entry of the dictionary. Lines without a frequency are
+ * skipped.
+ * @param freq Set to the frequency of the entry
+ * @param phrase Set to the normalized phrase. When reading a stream, only valid
+ * until the next call, as it points into the reader's buffer. When reading
+ * text in memory, valid as long as the text.
+ * @return True if an entry was read. False at the end of the stream.
+ */
+bool DictReader::next(unsigned int& freq, string_view& phrase) {
+    while (true) {
+        size_t lineEnd = nextLineEnd();
+        if (pos == lineEnd && lineEnd == end) {
+            return false;  // nothing left
+        }
+        char* curr = data + pos;
+        char* const last = data + lineEnd;
+        pos = lineEnd < end ? lineEnd + 1 : end;
+
+        // frequency, parsed like istream's unsigned extraction
+        while (curr < last && isSpace(*curr)) curr++;
+        bool negative = curr < last && *curr == '-';
+        if (curr < last && (*curr == '-' || *curr == '+')) curr++;
+        if (curr == last || *curr < '0' || *curr > '9') {
+            continue;  // no frequency on this line
+        }
+        unsigned long long value = 0;
+        while (curr < last && *curr >= '0' && *curr <= '9' &&
+               value <= 0xFFFFFFFFULL) {
+            value = value * 10 + (*curr - '0');
+            curr++;
+        }
+        if (value > 0xFFFFFFFFULL) {
+            continue;  // frequency out of range
+        }
+        freq = negative ? 0U - (unsigned int)value : (unsigned int)value;
+
+        // phrase, compacted in place to single spaced tokens
+        char* const start = curr;
+        char* out = curr;
+        while (true) {
+            while (curr < last && isSpace(*curr)) curr++;
+            char* token = curr;
+            while (curr < last && !isSpace(*curr)) curr++;
+            if (curr == token || (curr - token == 1 && *token == '.')) {
+                break;  // end of line or a lone "."
+            }
+            if (out != start) {
+                *out++ = ' ';
+            }
+            if (out != token) {
+                memmove(out, token, curr - token);
+            }
+            out += curr - token;
+        }
+        phrase = string_view(start, out - start);
+        return true;
+    }
+}
+
+/* Returns the number of bytes read from the stream so far. */
+size_t DictReader::bytes() const { return bytesRead; }
+
+const unsigned int BatchRunner::CHUNK_LINES;
+
+/* Constructor.
+ * @param d Dictionary to answer from. Must not change while run runs.
+ * @param f Format of the answers
+ * @param threads Number of chunks to answer at once, at least 1
+ */
+BatchRunner::BatchRunner(const Dictionary& d, Format f, unsigned int threads)
+    : dict(d),
+      format(f),
+      numThreads(std::max(1U, threads)),
+      answered(0),
+      skipped(0) {}
+
+/* Answers every query of a stream. Reads a round of one chunk per thread,
+ * answers the chunks at once and writes their answers in order, so memory
+ * stays bounded however long the stream is.
+ * @param queries Stream of query lines
+ * @param out Stream to write the answers to
+ */
+void BatchRunner::run(istream& queries, ostream& out) {
+    vector<string> chunks(numThreads);
+    vector<string> outputs(numThreads);
+    vector<unsigned long long> counts(2 * numThreads);
+    string line;
+    bool more = true;
+    while (more) {
+        unsigned int used = 0;  // chunks read this round
+        for (; used < numThreads && more; used++) {
+            chunks[used].clear();
+            for (unsigned int i = 0; i < CHUNK_LINES; i++) {
+                if (!getline(queries, line)) {
+                    more = false;
+                    break;
+                }
+                chunks[used].append(line).push_back('\n');
+            }
+        }
+
+        // the first chunk is answered on this thread, the rest on their own
+        vector<thread> workers;
+        for (unsigned int t = 0; t < used; t++) {
+            outputs[t].clear();
+            counts[2 * t] = counts[2 * t + 1] = 0;
+            auto work = [this, &chunks, &outputs, &counts, t]() {
+                answerChunk(chunks[t], outputs[t], counts[2 * t],
+                            counts[2 * t + 1]);
+            };
+            if (t > 0) {
+                workers.emplace_back(work);
+            } else {
+                work();
+            }
+        }
+        for (thread& worker : workers) {
+            worker.join();
+        }
+        for (unsigned int t = 0; t < used; t++) {
+            out.write(outputs[t].data(), outputs[t].size());
+            answered += counts[2 * t];
+            skipped += counts[2 * t + 1];
+        }
+    }
+    out.flush();
+}
+
+/* Answers the lines of a chunk.
+ * @param chunk Lines, each ending in '\n'
+ * @param out Buffer to append the answers to
+ * @param numAnswered Incremented for each query answered
+ * @param numSkipped Incremented for each invalid line skipped
+ */
+void BatchRunner::answerChunk(const string& chunk, string& out,
+                              unsigned long long& numAnswered,
+                              unsigned long long& numSkipped) const {
+    size_t start = 0;
+    while (start < chunk.size()) {
+        size_t end = chunk.find('\n', start);
+        string_view line(chunk.data() + start, end - start);
+        start = end + 1;
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        string_view query;
+        unsigned int numCompletions;
+        if (line.empty()) {
+            continue;
+        }
+        if (!parseLine(line, query, numCompletions)) {
+            numSkipped++;
+            continue;
+        }
+        string text(query);
+        appendAnswer(out, format, query,
+                     text.find('_') != string::npos
+                         ? dict.predictUnderscores(text, numCompletions)
+                         : dict.predictCompletions(text, numCompletions));
+        numAnswered++;
+    }
+}
+
+/* Returns the number of queries answered by run. */
+unsigned long long BatchRunner::queriesAnswered() const { return answered; }
+
+/* Returns the number of non-blank lines run skipped for having no valid
+ * number of completions.
+ */
+unsigned long long BatchRunner::linesSkipped() const { return skipped; }
+
+/* Splits a query line into its query and number of completions.
+ * @param line Line without its '\n'
+ * @param query Set to the prefix or pattern
+ * @param numCompletions Set to the number of completions
+ * @return False if the line has no valid number. Otherwise, true.
+ */
+bool BatchRunner::parseLine(string_view line, string_view& query,
+                            unsigned int& numCompletions) {
+    size_t split = line.rfind('\t');
+    if (split == string_view::npos) {
+        split = line.rfind(' ');
+    }
+    if (split == string_view::npos || split + 1 == line.size()) {
+        return false;
+    }
+    unsigned long long number = 0;
+    for (char c : line.substr(split + 1)) {
+        if (c < '0' || c > '9' || number > 0xFFFFFFFFULL / 10) {
+            return false;
+        }
+        number = number * 10 + (c - '0');
+    }
+    if (number > 0xFFFFFFFFULL) {
+        return false;
+    }
+    query = line.substr(0, split);
+    numCompletions = number;
+    return true;
+}
+
+/* Appends a string as a JSON string, escaping quotes, backslashes and
+ * control characters.
+ */
+static void appendJson(string& out, string_view text) {
+    static const char HEX[] = "0123456789abcdef";
+    out.push_back('"');
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out.push_back('\\');
+            out.push_back(c);
+        } else if ((unsigned char)c < 0x20) {
+            out.append("\\u00");
+            out.push_back(HEX[c >> 4]);
+            out.push_back(HEX[c & 0xF]);
+        } else {
+            out.push_back(c);
+        }
+    }
+    out.push_back('"');
+}
+
+/* Appends the answer to one query in a format.
+ * @param out Buffer to append to
+ * @param format Format of the answer
+ * @param query Prefix or pattern asked
+ * @param completions Completions found, most frequent first
+ */
+void BatchRunner::appendAnswer(string& out, Format format, string_view query,
+                               const vector<string>& completions) {
+    if (format == TSV) {
+        out.append(query.data(), query.size());
+        for (const string& completion : completions) {
+            out.push_back('\t');
+            out.append(completion);
+        }
+        out.push_back('\n');
+        return;
+    }
+    out.append("{\"query\": ");
+    appendJson(out, query);
+    out.append(", \"completions\": [");
+    for (unsigned int i = 0; i < completions.size(); i++) {
+        if (i > 0) {
+            out.append(", ");
+        }
+        appendJson(out, completions[i]);
+    }
+    out.append("]}\n");
+}
+
+/* Reads up to numWords entries of the stream, copying the phrases into one
+ * buffer.
+ * @param text Set to the phrases, back to back. The entries point into it.
+ * @return the (word, freq) entries in file order
+ */
+static vector<entry> readEntries(istream& words, unsigned int numWords,
+                                 string& text) {
+    DictReader reader(words);
     unsigned int freq;
-    string data = "";
-    string tempWord;
-    string word;
-    vector<string> wordString;
-    unsigned int i;
-    while (getline(words, data)) {
-        tempWord = "";
-        word = "";
-        data = data + " .";
-        istringstream iss(data);
-        iss >> freq;
-        while (1) {
-            iss >> tempWord;
-            if (tempWord == ".") break;
-            if (tempWord.length() > 0) wordString.push_back(tempWord);
-        }
-        for (i = 0; i < wordString.size(); i++) {
-            if (i > 0) word = word + " ";
-            word = word + wordString[i];
-        }
-        dict.insert(word, freq);
-        wordString.clear();
-        if (words.eof()) break;
-    }
-}
-
-/* Load numWords from words stream into the dictionary trie */
-void Utils::loadDict(DictionaryTrie& dict, istream& words,
+    string_view word;
+
+    // copy the phrases into one buffer, then point the entries into it
+    vector<pair<size_t, unsigned int>> ends;  // (end in text, freq)
+    while (ends.size() < numWords && reader.next(freq, word)) {
+        text.append(word.data(), word.size());
+        ends.push_back(make_pair(text.size(), freq));
+    }
+    vector<entry> entries;
+    entries.reserve(ends.size());
+    size_t start = 0;
+    for (const pair<size_t, unsigned int>& end : ends) {
+        entries.push_back(make_pair(
+            string_view(text.data() + start, end.first - start), end.second));
+        start = end.first;
+    }
+    return entries;
+}
+
+/* Reads up to numWords entries of the stream and bulk inserts them, so the
+ * trie is built balanced rather than in file order.
+ */
+static void bulkLoad(Dictionary& dict, istream& words,
                      unsigned int numWords) {
-    unsigned int freq;
-    string data = "";
-    string tempWord;
-    string word;
-    vector<string> wordString;
-    unsigned int i;
-    unsigned int j = 0;
-    for (; j < numWords; j++) {
-        getline(words, data);
-        tempWord = "";
-        word = "";
-        data = data + " .";
-        istringstream iss(data);
-        iss >> freq;
-        while (1) {
-            iss >> tempWord;
-            if (tempWord == ".") break;
-            if (tempWord.length() > 0) wordString.push_back(tempWord);
-        }
-        for (i = 0; i < wordString.size(); i++) {
-            if (i > 0) word = word + " ";
-            word = word + wordString[i];
-        }
-        dict.insert(word, freq);
-        wordString.clear();
-        if (words.eof()) break;
+    string text;
+    dict.bulkInsert(readEntries(words, numWords, text));
+}
+
+/* Load all the words in word stream into the dictionary */
+void Utils::loadDict(Dictionary& dict, istream& words) {
+    bulkLoad(dict, words, 0xFFFFFFFF);
+}
+
+/* Load numWords from words stream into the dictionary */
+void Utils::loadDict(Dictionary& dict, istream& words,
+                     unsigned int numWords) {
+    bulkLoad(dict, words, numWords);
+}
+
+/* Load the words in the file into a sharded dictionary. The file is read
+ * whole, cut into numThreads splits at line ends and each split is parsed by
+ * its own thread before the shards are built.
+ */
+void Utils::loadDict(ShardedTrie& dict, istream& words,
+                     unsigned int numThreads) {
+    numThreads = std::max(1U, numThreads);
+    string data;
+    char block[1 << 16];
+    while (words.read(block, sizeof(block)) || words.gcount() > 0) {
+        data.append(block, words.gcount());
+    }
+
+    vector<size_t> cuts(1, 0);
+    for (unsigned int t = 1; t < numThreads; t++) {
+        size_t cut = std::max(cuts.back(), data.size() * t / numThreads);
+        cut = data.find('\n', cut);
+        cuts.push_back(cut == string::npos ? data.size() : cut + 1);
+    }
+    cuts.push_back(data.size());
+
+    // each split is parsed in place, and its entries point into data
+    vector<vector<entry>> parts(numThreads);
+    vector<thread> workers;
+    for (unsigned int t = 0; t < numThreads; t++) {
+        workers.emplace_back([&data, &cuts, &parts, t]() {
+            DictReader reader(&data[cuts[t]], cuts[t + 1] - cuts[t]);
+            unsigned int freq;
+            string_view word;
+            while (reader.next(freq, word)) {
+                parts[t].push_back(make_pair(word, freq));
+            }
+        });
+    }
+    for (thread& worker : workers) {
+        worker.join();
     }
+    dict.build(parts);
 }
 
 /* Load all the words in word stream into a vector */
 void Utils::loadDict(vector<string>& dict, istream& words) {
+    DictReader reader(words);
     unsigned int junk;
-    string data = "";
-    string tempWord;
-    string word;
-    vector<string> wordString;
-    unsigned int i;
-
-    while (getline(words, data)) {
-        tempWord = "";
-        word = "";
-        data = data + " .";
-        istringstream iss(data);
-        iss >> junk;
-        while (1) {
-            iss >> tempWord;
-            if (tempWord == ".") break;
-            if (tempWord.length() > 0) wordString.push_back(tempWord);
-        }
-        for (i = 0; i < wordString.size(); i++) {
-            if (i > 0) word = word + " ";
-            word = word + wordString[i];
-        }
-        dict.push_back(word);
-        wordString.clear();
-        if (words.eof()) break;
+    string_view word;
+    while (reader.next(junk, word)) {
+        dict.emplace_back(word);
     }
 }
@@ -8,8 +8,10 @@
 
 #include <chrono>
 #include <iostream>
+#include <string_view>
 #include <vector>
-#include "DictionaryTrie.hpp"
+#include "Dictionary.hpp"
+#include "ShardedTrie.hpp"
 
 using namespace std;
 
@@ -28,18 +30,170 @@ class Timer {
     long long end_timer();
 };
 
+/**
+ * Summary of a list of latencies, in nanoseconds.
+ */
+class LatencySummary {
+  public:
+    size_t count;    // number of latencies
+    long long mean;  // average latency
+    long long p50;   // median latency
+    long long p95;   // 95th percentile
+    long long p99;   // 99th percentile
+    long long p999;  // 99.9th percentile
+    long long max;   // slowest latency
+
+    /* Constructor. Sorts the latencies.
+     * @param latencies Latencies to summarize, at least one
+     */
+    explicit LatencySummary(vector<long long>& latencies);
+
+  private:
+    /* Returns the latency a given fraction of the way into a sorted list. */
+    static long long at(const vector<long long>& sorted, double fraction);
+};
+
+/** Streams the entries of a dictionary file (in format like freq_dict.txt)
+ * block by block, or parses a dictionary already in memory in place. Each
+ * line holds a frequency followed by a phrase; runs of whitespace in the
+ * phrase collapse to a single space and a lone "." ends it.
+ */
+class DictReader {
+  private:
+    static const size_t BLOCK_SIZE = 1 << 20;  // bytes read from the stream
+
+    istream* in;          // stream the dictionary is read from, or nullptr
+    vector<char> buffer;  // block of the stream holding the current line
+    char* data;           // bytes being parsed: buffer, or the text in memory
+    size_t pos;           // start of the next unread line in data
+    size_t end;           // end of the valid bytes in data
+    size_t bytesRead;     // total bytes read from the stream so far
+
+    /* Finds the end of the next line, reading more of the stream if the
+     * line is not complete in the buffer yet.
+     * @return Offset of the '\n' ending the line, or end at end of stream
+     */
+    size_t nextLineEnd();
+
+  public:
+    /* Constructor.
+     * @param words Stream to read the dictionary from
+     */
+    explicit DictReader(istream& words);
+
+    /* Constructor. Parses a dictionary already in memory, normalizing the
+     * phrases in place, so nothing is copied.
+     * @param text Start of the dictionary text. Overwritten by the reader.
+     * @param size Bytes of the dictionary text
+     */
+    DictReader(char* text, size_t size);
+
+    /* Reads the next entry of the dictionary. Lines without a frequency are
+     * skipped.
+     * @param freq Set to the frequency of the entry
+     * @param phrase Set to the normalized phrase. When reading a stream, only
+     * valid until the next call, as it points into the reader's buffer. When
+     * reading text in memory, valid as long as the text.
+     * @return True if an entry was read. False at the end of the stream.
+     */
+    bool next(unsigned int& freq, string_view& phrase);
+
+    /* Returns the number of bytes read from the stream so far. */
+    size_t bytes() const;
+};
+
+/** Answers a file of queries without prompting, streaming the answers out
+ * in the order of the queries. Each line of the file is a prefix or a
+ * pattern with underscores, then a tab and the number of completions. Lines
+ * without a tab split at their last space instead. The file is taken in
+ * chunks of lines, and the chunks of a round are answered on their own
+ * threads into their own buffers, then written out in order with no flush
+ * in between.
+ */
+class BatchRunner {
+  public:
+    /* Output formats: one line per query of the query and its completions
+     * separated by tabs, or one JSON object per line.
+     */
+    enum Format { TSV, JSONL };
+
+    static const unsigned int CHUNK_LINES = 4096;  // lines per chunk
+
+  private:
+    const Dictionary& dict;       // dictionary the queries are answered from
+    Format format;                // format of the answers
+    unsigned int numThreads;      // chunks answered at once
+    unsigned long long answered;  // queries answered by run
+    unsigned long long skipped;   // invalid lines skipped by run
+
+    /* Answers the lines of a chunk.
+     * @param chunk Lines, each ending in '\n'
+     * @param out Buffer to append the answers to
+     * @param numAnswered Incremented for each query answered
+     * @param numSkipped Incremented for each invalid line skipped
+     */
+    void answerChunk(const string& chunk, string& out,
+                     unsigned long long& numAnswered,
+                     unsigned long long& numSkipped) const;
+
+  public:
+    /* Constructor.
+     * @param d Dictionary to answer from. Must not change while run runs.
+     * @param f Format of the answers
+     * @param threads Number of chunks to answer at once, at least 1
+     */
+    BatchRunner(const Dictionary& d, Format f, unsigned int threads);
+
+    /* Answers every query of a stream.
+     * @param queries Stream of query lines
+     * @param out Stream to write the answers to
+     */
+    void run(istream& queries, ostream& out);
+
+    /* Returns the number of queries answered by run. */
+    unsigned long long queriesAnswered() const;
+
+    /* Returns the number of non-blank lines run skipped for having no valid
+     * number of completions.
+     */
+    unsigned long long linesSkipped() const;
+
+    /* Splits a query line into its query and number of completions.
+     * @param line Line without its '\n'
+     * @param query Set to the prefix or pattern
+     * @param numCompletions Set to the number of completions
+     * @return False if the line has no valid number. Otherwise, true.
+     */
+    static bool parseLine(string_view line, string_view& query,
+                          unsigned int& numCompletions);
+
+    /* Appends the answer to one query in a format.
+     * @param out Buffer to append to
+     * @param format Format of the answer
+     * @param query Prefix or pattern asked
+     * @param completions Completions found, most frequent first
+     */
+    static void appendAnswer(string& out, Format format, string_view query,
+                             const vector<string>& completions);
+};
+
 /** Contains useful functions to parse input file */
 class Utils {
   public:
     /* Load the words in the file into the dictionary */
-    void static loadDict(DictionaryTrie& dict, istream& words);
+    void static loadDict(Dictionary& dict, istream& words);
 
     /* Load numWords from words stream into the dictionary */
-    void static loadDict(DictionaryTrie& dict, istream& words,
+    void static loadDict(Dictionary& dict, istream& words,
                          unsigned int numWords);
 
     /* Load all the words in word stream into a vector */
     void static loadDict(vector<string>& dict, istream& words);
+
+    /* Load the words in the file into a sharded dictionary, parsing splits
+     * of the file and building the shards on numThreads threads */
+    void static loadDict(ShardedTrie& dict, istream& words,
+                         unsigned int numThreads);
 };
 
 #endif  // UTIL_HPP
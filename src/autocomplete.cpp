@@ -5,11 +5,17 @@
  * Email: atshao@ucsd.edu
  * Resources: UCSD CSE100 PA2 starter code, PA2 Implementation Guide
  */
+#include <csignal>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <vector>
+#include "AutocompleteServer.hpp"
+#include "Dictionary.hpp"
 #include "DictionaryTrie.hpp"
+#include "TrieStats.hpp"
 #include "util.hpp"
 
 using namespace std;
@@ -36,6 +42,106 @@ bool fileValid(const char* fileName) {
     return true;
 }
 
+/* Build a snapshot file from a dictionary file so later runs can map it
+ * instead of parsing the dictionary.
+ * @param dictFile Dictionary file to load (in format like freq_dict.txt)
+ * @param snapshotFile Snapshot file to write
+ * @return 0 on success, -1 otherwise
+ */
+int buildSnapshot(const char* dictFile, const char* snapshotFile) {
+    if (!fileValid(dictFile)) return -1;
+
+    DictionaryTrie dt;
+    ifstream in;
+    in.open(dictFile, ios::binary);
+    Utils::loadDict(dt, in);
+    in.close();
+
+    if (!dt.saveSnapshot(snapshotFile)) {
+        cout << "Could not write snapshot file: " << snapshotFile << endl;
+        return -1;
+    }
+    cout << "Wrote snapshot of " << dt.wordCount() << " words to "
+         << snapshotFile << endl;
+    return 0;
+}
+
+/* Print the query statistics, if compiled in. On stderr, so the answers on
+ * stdout stay the same.
+ */
+void printQueryStats() {
+    if (TrieStats::enabled()) {
+        cerr << "Query statistics:" << endl;
+        TrieStats::collect().print(cerr);
+    }
+}
+
+/* Server stopped by SIGINT and SIGTERM, or nullptr */
+static AutocompleteServer* runningServer = nullptr;
+
+/* Signal handler that stops the running server. */
+static void stopServer(int) {
+    if (runningServer != nullptr) {
+        runningServer->stop();
+    }
+}
+
+/* Answer requests on an address until interrupted, instead of prompting.
+ * @param dict Dictionary to answer from
+ * @param address Address to listen on, "unix:<path>" or "tcp:<port>"
+ * @return 0 once stopped, -1 if the address could not be listened on
+ */
+int serve(const Dictionary& dict, const string& address) {
+    AutocompleteServer server(dict);
+    if (!server.listen(address)) {
+        cout << "Could not listen on: " << address << endl;
+        return -1;
+    }
+    cout << "Serving on: " << address << endl;
+    runningServer = &server;
+    signal(SIGINT, stopServer);
+    signal(SIGTERM, stopServer);
+    server.run();
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    runningServer = nullptr;
+    cout << "Served " << server.requestsServed() << " requests" << endl;
+    return 0;
+}
+
+/* Answer a file of queries without prompting, streaming the answers to
+ * stdout in the order of the queries.
+ * @param dict Dictionary to answer from
+ * @param queryFile File of query lines, or "-" for stdin
+ * @param format "tsv" or "jsonl"
+ * @param numThreads Number of chunks of the file to answer at once
+ * @return 0 on success, -1 if the query file could not be opened
+ */
+int runBatch(const Dictionary& dict, const string& queryFile,
+             const string& format, unsigned int numThreads) {
+    ifstream file;
+    if (queryFile != "-") {
+        file.open(queryFile, ios::binary);
+        if (!file.is_open()) {
+            cerr << "Could not open query file: " << queryFile << endl;
+            return -1;
+        }
+    }
+    BatchRunner batch(
+        dict, format == "jsonl" ? BatchRunner::JSONL : BatchRunner::TSV,
+        numThreads);
+    batch.run(queryFile == "-" ? cin : file, cout);
+
+    // on stderr, so only answers go to stdout
+    cerr << "Answered " << batch.queriesAnswered() << " queries";
+    if (batch.linesSkipped() > 0) {
+        cerr << ", skipped " << batch.linesSkipped()
+             << " lines without a number of completions";
+    }
+    cerr << endl;
+    return 0;
+}
+
 /* IMPORTANT! You should use the following lines of code to match the correct
  * output:
  *
@@ -46,28 +152,98 @@ bool fileValid(const char* fileName) {
  * cout << completion << endl;
  * cout << "Continue? (y/n)" << endl;
  *
- * arg 1 - Input file name (in format like freq_dict.txt)
+ * arg 1 - Input file name (in format like freq_dict.txt, or a snapshot)
+ * Optionally followed by any of:
+ * --backend <backend> - Dictionary backend to use, one of
+ * Dictionary::backends(). Only the default tst backend maps snapshots.
+ * --serve <address> - Answer requests of the Protocol on "unix:<path>" or
+ * "tcp:<port>" until interrupted, instead of prompting.
+ * --batch <file> - Answer the query lines of a file, or "-" for stdin,
+ * instead of prompting. Each line is a prefix or pattern, a tab and a number
+ * of completions.
+ * --format <format> - Format of the batch answers, "tsv" (default) or
+ * "jsonl".
+ * --threads <number> - Number of chunks of the batch answered at once.
+ *
+ * Alternatively, with --build-snapshot:
+ * arg 2 - Input file name (in format like freq_dict.txt)
+ * arg 3 - Snapshot file name to write
  */
 int main(int argc, char** argv) {
     const int NUM_ARG = 2;
-    if (argc != NUM_ARG) {
+    const int NUM_SNAPSHOT_ARG = 4;
+    if (argc == NUM_SNAPSHOT_ARG && string(argv[1]) == "--build-snapshot") {
+        return buildSnapshot(argv[2], argv[3]);
+    }
+
+    // options come in (name, value) pairs after the file
+    string backend = Dictionary::backends()[0];
+    string address;
+    string queryFile;
+    string format = "tsv";
+    int numThreads = 1;
+    bool valid = argc >= NUM_ARG && (argc - NUM_ARG) % 2 == 0;
+    for (int i = NUM_ARG; valid && i < argc; i += 2) {
+        string option = argv[i];
+        if (option == "--backend") {
+            backend = argv[i + 1];
+        } else if (option == "--serve") {
+            address = argv[i + 1];
+        } else if (option == "--batch") {
+            queryFile = argv[i + 1];
+        } else if (option == "--format") {
+            format = argv[i + 1];
+            valid = format == "tsv" || format == "jsonl";
+        } else if (option == "--threads") {
+            numThreads = atoi(argv[i + 1]);
+            valid = numThreads > 0;
+        } else {
+            valid = false;
+        }
+    }
+    if (!valid || (!address.empty() && !queryFile.empty())) {
         cout << "Invalid number of arguments.\n"
-             << "Usage: ./autocomplete <dictionary filename>" << endl;
+             << "Usage: ./autocomplete <dictionary or snapshot filename> "
+             << "[--backend <backend>]\n"
+             << "       [--serve <address> | --batch <query file or -> "
+             << "[--format tsv|jsonl] [--threads <number>]]\n"
+             << "       ./autocomplete --build-snapshot <dictionary filename> "
+             << "<snapshot filename>\n"
+             << "Addresses: unix:<path> or tcp:<port>" << endl;
+        return -1;
+    }
+    unique_ptr<Dictionary> dt = Dictionary::create(backend);
+    if (!dt) {
+        cout << "Unknown backend: " << backend << ". Backends:";
+        for (const string& name : Dictionary::backends()) {
+            cout << " " << name;
+        }
+        cout << endl;
         return -1;
     }
     if (!fileValid(argv[1])) return -1;
 
-    DictionaryTrie* dt = new DictionaryTrie();
-
-    // Read all the tokens of the file in order to get every word
-    cout << "Reading file: " << argv[1] << endl;
+    // Read all the tokens of the file in order to get every word. Batch
+    // answers go to stdout, so then it is logged to stderr.
+    (queryFile.empty() ? cout : cerr) << "Reading file: " << argv[1] << endl;
 
-    ifstream in;
-    in.open(argv[1], ios::binary);
     string word;
 
-    Utils::loadDict(*dt, in);
-    in.close();
+    // snapshots are mapped as is, anything else is parsed as a dictionary
+    DictionaryTrie* trie = dynamic_cast<DictionaryTrie*>(dt.get());
+    if (trie == nullptr || !trie->loadSnapshot(argv[1])) {
+        ifstream in;
+        in.open(argv[1], ios::binary);
+        Utils::loadDict(*dt, in);
+        in.close();
+    }
+    if (!address.empty() || !queryFile.empty()) {
+        int status = address.empty()
+                         ? runBatch(*dt, queryFile, format, numThreads)
+                         : serve(*dt, address);
+        printQueryStats();
+        return status;
+    }
 
     char cont = 'y';
     unsigned int numberOfCompletions;
@@ -100,6 +276,7 @@ int main(int argc, char** argv) {
         cin >> cont;
         cin.ignore();
     }
-    delete dt;
+
+    printQueryStats();
     return 0;
 }
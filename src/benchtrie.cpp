@@ -1,17 +1,38 @@
 /**
  * Benchmark the autocomplete function in DictionaryTrie
  */
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
 #include <fstream>
+#include <functional>
+#include <shared_mutex>
 #include <sstream>
+#include <thread>
+#include <unistd.h>
+#include <unordered_set>
+#include "AdaptiveRadixTree.hpp"
+#include "CompactTrie.hpp"
+#include "CompletionSession.hpp"
 #include "DictionaryTrie.hpp"
+#include "LiveDictionary.hpp"
+#include "QueryCache.hpp"
+#include "ShardedTrie.hpp"
+#include "SuccinctTrie.hpp"
+#include "TrieStats.hpp"
 #include "util.hpp"
 using namespace std;
 
 /* Test the runtime of autocompelte using different prefix and number of
  * completions
+ * @param filename Dictionary file to load
+ * @param benchmark Name of the optional benchmark to run, or ""
  */
-void testRuntime(string filename) {
+void testRuntime(string filename, string benchmark) {
     const unsigned int NUM_COMP = 10;
+    const unsigned int CACHE_DEPTH = 3;
+    const size_t CACHE_BUDGET = 64 << 20;
 
     ifstream in;
     in.open(filename, ios::binary);
@@ -19,13 +40,49 @@ void testRuntime(string filename) {
     // Testing student's trie
     cout << "\nLoading dictionary..." << endl;
 
-    DictionaryTrie* trie = new DictionaryTrie();
-    Utils::loadDict(*trie, in);
-
     Timer timer;
     vector<string> results;
     long long time = 0;
 
+    DictionaryTrie* trie = new DictionaryTrie();
+    timer.begin_timer();
+    Utils::loadDict(*trie, in);
+    time = timer.end_timer();
+    cout << "\tTime taken: " << time << " nanoseconds." << endl;
+    cout << "\tNodes: " << trie->numNodes() << endl;
+    cout << "\tNode memory: " << trie->memoryUsage() << " bytes." << endl;
+
+    // Run the tests against a mapped snapshot of the dictionary
+    if (benchmark == "snapshot") {
+        const string snapshotFile = "benchtrie.snapshot";
+        cout << "\nMapping snapshot: " << snapshotFile << endl;
+        if (!trie->saveSnapshot(snapshotFile)) {
+            cout << "\tCould not write snapshot." << endl;
+        } else {
+            DictionaryTrie* mapped = new DictionaryTrie();
+            timer.begin_timer();
+            mapped->loadSnapshot(snapshotFile);
+            time = timer.end_timer();
+            remove(snapshotFile.c_str());  // stays readable while mapped
+            cout << "\tTime taken: " << time << " nanoseconds." << endl;
+            cout << "\tMapped bytes: " << mapped->memoryUsage() << endl;
+            delete trie;
+            trie = mapped;
+        }
+    }
+
+    // Precompute top completions for short prefixes before the tests
+    if (benchmark == "cache") {
+        cout << "\nBuilding completion cache: depth = " << CACHE_DEPTH
+             << ", numCompletions = " << NUM_COMP << endl;
+        timer.begin_timer();
+        trie->enableCompletionCache(CACHE_DEPTH, NUM_COMP, CACHE_BUDGET);
+        time = timer.end_timer();
+        cout << "\tTime taken: " << time << " nanoseconds." << endl;
+        cout << "\tCache memory: " << trie->completionCacheMemory()
+             << " bytes." << endl;
+    }
+
     // Test 1: iterate through alphabet prefix
     cout << "\nTest 1: prefix = \"iterating through alphabet\", "
          << "numCompletions = " << NUM_COMP << endl;
@@ -71,10 +128,12 @@ void testRuntime(string filename) {
     cout << "\tTime taken: " << time << " nanoseconds." << endl;
     cout << "\tResults found: " << results.size() << endl;
 
-    // Addtional tests
-    cout << "\nWould you like to run additional tests? (y/n) ";
+    // Addtional tests, asked for only when run from a terminal
     string response;
-    getline(cin, response);
+    if (isatty(STDIN_FILENO)) {
+        cout << "\nWould you like to run additional tests? (y/n) ";
+        getline(cin, response);
+    }
 
     if (response.compare("y") == 0) {
         string prefix;
@@ -100,6 +159,1305 @@ void testRuntime(string filename) {
     delete trie;
 }
 
+/* Test the throughput of parsing and loading the dictionary file
+ * @param filename Dictionary file to load
+ */
+void testLoader(string filename) {
+    const unsigned int NUM_RUNS = 5;
+    Timer timer;
+    long long parseTime = 0;
+    long long loadTime = 0;
+    size_t bytes = 0;
+    size_t entries = 0;
+    size_t phraseBytes = 0;
+
+    for (unsigned int run = 0; run < NUM_RUNS; run++) {
+        // parse only, touching every phrase so nothing is optimized away
+        ifstream in;
+        in.open(filename, ios::binary);
+        timer.begin_timer();
+        DictReader reader(in);
+        unsigned int freq;
+        string_view phrase;
+        entries = 0;
+        phraseBytes = 0;
+        while (reader.next(freq, phrase)) {
+            phraseBytes += phrase.size();
+            entries++;
+        }
+        parseTime += timer.end_timer();
+        bytes = reader.bytes();
+        in.close();
+
+        // full load into a trie
+        in.open(filename, ios::binary);
+        DictionaryTrie trie;
+        timer.begin_timer();
+        Utils::loadDict(trie, in);
+        loadTime += timer.end_timer();
+        in.close();
+    }
+
+    double megabytes = bytes / 1e6;
+    cout << "\nLoader: " << entries << " entries, " << phraseBytes
+         << " phrase bytes, " << bytes << " file bytes, " << NUM_RUNS
+         << " runs" << endl;
+    cout << "\tParse only: " << parseTime / NUM_RUNS << " nanoseconds, "
+         << megabytes / (parseTime / 1e9 / NUM_RUNS) << " MB/s" << endl;
+    cout << "\tLoad into trie: " << loadTime / NUM_RUNS << " nanoseconds, "
+         << megabytes / (loadTime / 1e9 / NUM_RUNS) << " MB/s" << endl;
+}
+
+/* Compare the shape and speed of a trie inserted in file order with a bulk
+ * built one
+ * @param filename Dictionary file to load
+ */
+void testBalance(string filename) {
+    const unsigned int NUM_COMP = 10;
+    const unsigned int NUM_RUNS = 20;
+    Timer timer;
+    long long time = 0;
+
+    DictionaryTrie sequential;
+    DictionaryTrie bulk;
+    for (DictionaryTrie* trie : {&sequential, &bulk}) {
+        ifstream in;
+        in.open(filename, ios::binary);
+        timer.begin_timer();
+        if (trie == &bulk) {
+            cout << "\nBulk build:" << endl;
+            Utils::loadDict(*trie, in);
+        } else {
+            cout << "\nInsert in file order:" << endl;
+            DictReader reader(in);
+            unsigned int freq;
+            string_view word;
+            while (reader.next(freq, word)) {
+                trie->insert(word, freq);
+            }
+        }
+        time = timer.end_timer();
+        in.close();
+        cout << "\tTime taken: " << time << " nanoseconds." << endl;
+        cout << "\tNodes: " << trie->numNodes() << endl;
+        cout << "\tHeight: " << trie->height() << endl;
+        cout << "\tAverage probe depth: " << trie->averageProbeDepth()
+             << endl;
+
+        // Test 1 workload, repeated to smooth out noise
+        unsigned int count = 0;
+        timer.begin_timer();
+        for (unsigned int run = 0; run < NUM_RUNS; run++) {
+            for (char c = 'a'; c <= 'z'; c++) {
+                count +=
+                    trie->predictCompletions(string(1, c), NUM_COMP).size();
+            }
+        }
+        time = timer.end_timer();
+        cout << "\tAlphabet prefixes: " << time / NUM_RUNS
+             << " nanoseconds per pass." << endl;
+        cout << "\tResults found: " << count / NUM_RUNS << endl;
+    }
+}
+
+/* Test how query throughput scales with threads sharing one trie
+ * @param filename Dictionary file to load
+ */
+void testThreads(string filename) {
+    const unsigned int NUM_COMP = 10;
+    const unsigned int NUM_ROUNDS = 20;
+    const unsigned int PREFIX_STRIDE = 100;
+    const unsigned int PREFIX_LENGTH = 3;
+    Timer timer;
+
+    ifstream in;
+    in.open(filename, ios::binary);
+    DictionaryTrie trie;
+    Utils::loadDict(trie, in);
+    in.close();
+
+    // alphabet prefixes plus short prefixes of a sample of the words
+    vector<string> prefixes;
+    for (char c = 'a'; c <= 'z'; c++) {
+        prefixes.push_back(string(1, c));
+    }
+    in.open(filename, ios::binary);
+    vector<string> words;
+    Utils::loadDict(words, in);
+    in.close();
+    for (unsigned int i = 0; i < words.size(); i += PREFIX_STRIDE) {
+        prefixes.push_back(words[i].substr(0, PREFIX_LENGTH));
+    }
+
+    unsigned int maxThreads = std::max(4U, thread::hardware_concurrency());
+    cout << "\nThreads: " << prefixes.size() << " prefixes x " << NUM_ROUNDS
+         << " rounds per thread, numCompletions = " << NUM_COMP
+         << ", hardware threads = " << thread::hardware_concurrency() << endl;
+    for (unsigned int numThreads = 1; numThreads <= maxThreads;
+         numThreads *= 2) {
+        vector<thread> workers;
+        vector<unsigned int> counts(numThreads, 0);
+        timer.begin_timer();
+        for (unsigned int t = 0; t < numThreads; t++) {
+            workers.emplace_back([&trie, &prefixes, &counts, t]() {
+                unsigned int count = 0;  // local, so threads share no line
+                for (unsigned int round = 0; round < NUM_ROUNDS; round++) {
+                    for (const string& prefix : prefixes) {
+                        count +=
+                            trie.predictCompletions(prefix, NUM_COMP).size();
+                    }
+                }
+                counts[t] = count;
+            });
+        }
+        for (thread& worker : workers) {
+            worker.join();
+        }
+        long long time = timer.end_timer();
+        double queries = (double)numThreads * NUM_ROUNDS * prefixes.size();
+        cout << "\t" << numThreads << " threads: " << time
+             << " nanoseconds, " << queries / (time / 1e9)
+             << " queries/second, results found: " << counts[0] << endl;
+    }
+}
+
+/* Compare answering the Test 1 alphabet prefixes, and a larger sample of
+ * prefixes, with a loop of queries and with one batch query
+ * @param filename Dictionary file to load
+ */
+void testBatch(string filename) {
+    const unsigned int NUM_COMP = 10;
+    const unsigned int NUM_RUNS = 20;
+    const unsigned int PREFIX_STRIDE = 100;
+    const unsigned int PREFIX_LENGTH = 3;
+    Timer timer;
+
+    ifstream in;
+    in.open(filename, ios::binary);
+    DictionaryTrie trie;
+    Utils::loadDict(trie, in);
+    in.close();
+
+    vector<string> alphabet;
+    for (char c = 'a'; c <= 'z'; c++) {
+        alphabet.push_back(string(1, c));
+    }
+    in.open(filename, ios::binary);
+    vector<string> words;
+    Utils::loadDict(words, in);
+    in.close();
+    vector<string> sample;
+    for (unsigned int i = 0; i < words.size(); i += PREFIX_STRIDE) {
+        sample.push_back(words[i].substr(0, PREFIX_LENGTH));
+    }
+
+    for (const vector<string>* prefixes : {&alphabet, &sample}) {
+        cout << "\nBatch: " << prefixes->size()
+             << " prefixes, numCompletions = " << NUM_COMP << endl;
+        vector<string_view> views(prefixes->begin(), prefixes->end());
+
+        unsigned int count = 0;
+        timer.begin_timer();
+        for (unsigned int run = 0; run < NUM_RUNS; run++) {
+            for (const string& prefix : *prefixes) {
+                count += trie.predictCompletions(prefix, NUM_COMP).size();
+            }
+        }
+        long long time = timer.end_timer();
+        cout << "\tLoop: " << time / NUM_RUNS << " nanoseconds, "
+             << count / NUM_RUNS << " results" << endl;
+
+        for (unsigned int numThreads : {1U, 0U}) {
+            count = 0;
+            timer.begin_timer();
+            for (unsigned int run = 0; run < NUM_RUNS; run++) {
+                CompletionBatch batch =
+                    trie.predictCompletionsBatch(views, NUM_COMP, numThreads);
+                for (unsigned int i = 0; i < batch.size(); i++) {
+                    count += batch.count(i);
+                }
+            }
+            time = timer.end_timer();
+            cout << "\tBatch, "
+                 << (numThreads == 0 ? "all cores" : "one thread") << ": "
+                 << time / NUM_RUNS << " nanoseconds, " << count / NUM_RUNS
+                 << " results" << endl;
+        }
+    }
+}
+
+/* Time wildcard queries whose patterns start with many underscores
+ * @param filename Dictionary file to load
+ */
+void testUnderscores(string filename) {
+    const unsigned int NUM_COMP = 10;
+    const unsigned int NUM_RUNS = 20;
+    Timer timer;
+
+    ifstream in;
+    in.open(filename, ios::binary);
+    DictionaryTrie trie;
+    Utils::loadDict(trie, in);
+    in.close();
+
+    vector<string> patterns = {"____",     "_____",     "________",
+                               "___e",     "____s",     "______ing",
+                               "__a__",    "_________", "_______________",
+                               "_________________________"};
+    for (const string& pattern : patterns) {
+        unsigned int count = 0;
+        timer.begin_timer();
+        for (unsigned int run = 0; run < NUM_RUNS; run++) {
+            count += trie.predictUnderscores(pattern, NUM_COMP).size();
+        }
+        long long time = timer.end_timer();
+        cout << "pattern = \"" << pattern << "\", numCompletions = " << NUM_COMP
+             << "\n\tTime taken: " << time / NUM_RUNS << " nanoseconds, "
+             << count / NUM_RUNS << " results" << endl;
+    }
+}
+
+/* Compare exact prefix completion with fuzzy completion, on sampled prefixes
+ * as typed and with one letter mistyped
+ * @param filename Dictionary file to load
+ */
+void testFuzzy(string filename) {
+    const unsigned int NUM_COMP = 10;
+    const unsigned int NUM_RUNS = 5;
+    const unsigned int PREFIX_STRIDE = 100;
+    const unsigned int PREFIX_LENGTH = 4;
+    Timer timer;
+
+    ifstream in;
+    in.open(filename, ios::binary);
+    DictionaryTrie trie;
+    Utils::loadDict(trie, in);
+    in.close();
+
+    // short prefixes of a sample of the words, and the same prefixes with
+    // one letter swapped for the next one in the alphabet
+    in.open(filename, ios::binary);
+    vector<string> words;
+    Utils::loadDict(words, in);
+    in.close();
+    vector<string> prefixes;
+    vector<string> typos;
+    for (unsigned int i = 0; i < words.size(); i += PREFIX_STRIDE) {
+        string prefix = words[i].substr(0, PREFIX_LENGTH);
+        if (prefix.empty()) {
+            continue;  // no letter to swap in an empty word
+        }
+        string typo = prefix;
+        typo[i % typo.length()] = typo[i % typo.length()] == 'z'
+                                      ? 'a'
+                                      : typo[i % typo.length()] + 1;
+        prefixes.push_back(prefix);
+        typos.push_back(typo);
+    }
+
+    cout << "\nFuzzy: " << prefixes.size() << " prefixes of up to "
+         << PREFIX_LENGTH << " letters, numCompletions = " << NUM_COMP
+         << endl;
+    if (prefixes.empty()) {
+        return;
+    }
+    long long exactTime = 0;
+    for (unsigned int maxEdits : {0U, 1U, 2U}) {
+        for (const vector<string>* queries : {&prefixes, &typos}) {
+            unsigned int count = 0;
+            timer.begin_timer();
+            for (unsigned int run = 0; run < NUM_RUNS; run++) {
+                for (const string& query : *queries) {
+                    count += maxEdits == 0
+                                 ? trie.predictCompletions(query, NUM_COMP)
+                                       .size()
+                                 : trie.predictFuzzy(query, maxEdits, NUM_COMP)
+                                       .size();
+                }
+            }
+            long long time = timer.end_timer() / NUM_RUNS;
+            if (maxEdits == 0 && queries == &prefixes) {
+                exactTime = time;
+            }
+            cout << "\t" << (maxEdits == 0 ? "exact" : "fuzzy") << ", "
+                 << maxEdits << " edits, "
+                 << (queries == &prefixes ? "as typed" : "mistyped") << ": "
+                 << time / queries->size() << " nanoseconds per query, "
+                 << (double)time / exactTime << "x exact, "
+                 << count / NUM_RUNS << " results" << endl;
+        }
+    }
+}
+
+/* Compare the nodes visited and the time of depth first and best first
+ * completion searches on the Test 1 to 5 prefixes and a sample of prefixes
+ * @param filename Dictionary file to load
+ */
+void testBestFirst(string filename) {
+    const unsigned int NUM_COMP = 10;
+    const unsigned int NUM_RUNS = 20;
+    const unsigned int PREFIX_STRIDE = 100;
+    const unsigned int PREFIX_LENGTH = 3;
+    Timer timer;
+
+    ifstream in;
+    in.open(filename, ios::binary);
+    DictionaryTrie trie;
+    Utils::loadDict(trie, in);
+    in.close();
+
+    // the prefixes of Tests 1 to 5, then short prefixes of a sample of words
+    vector<string> named;
+    for (char c = 'a'; c <= 'z'; c++) {
+        named.push_back(string(1, c));
+    }
+    named.insert(named.end(), {"the", "app", "man"});
+    in.open(filename, ios::binary);
+    vector<string> words;
+    Utils::loadDict(words, in);
+    in.close();
+    vector<string> sample;
+    for (unsigned int i = 0; i < words.size(); i += PREFIX_STRIDE) {
+        sample.push_back(words[i].substr(0, PREFIX_LENGTH));
+    }
+
+    vector<vector<string>> depthFirstResults;
+    for (const string& prefix : sample) {
+        depthFirstResults.push_back(trie.predictCompletions(prefix, NUM_COMP));
+    }
+    for (bool bestFirst : {false, true}) {
+        trie.setBestFirst(bestFirst);
+        cout << "\n" << (bestFirst ? "Best first" : "Depth first")
+             << ": numCompletions = " << NUM_COMP << endl;
+        cout << "\tNodes visited:";
+        for (const char* prefix : {"a", "the", "app", "man"}) {
+            cout << " \"" << prefix
+                 << "\" = " << trie.completionVisits(prefix, NUM_COMP);
+        }
+        unsigned long long visits = 0;
+        for (const string& prefix : named) {
+            visits += trie.completionVisits(prefix, NUM_COMP);
+        }
+        cout << "\n\tAverage nodes visited, Test 1 to 5 prefixes: "
+             << (double)visits / named.size() << endl;
+
+        bool same = true;
+        visits = 0;
+        for (unsigned int i = 0; i < sample.size(); i++) {
+            visits += trie.completionVisits(sample[i], NUM_COMP);
+            same = same && trie.predictCompletions(sample[i], NUM_COMP) ==
+                               depthFirstResults[i];
+        }
+        cout << "\tAverage nodes visited, " << sample.size()
+             << " sampled prefixes: " << (double)visits / sample.size()
+             << ", same results: " << (same ? "yes" : "no") << endl;
+
+        for (const vector<string>* prefixes : {&named, &sample}) {
+            unsigned int count = 0;
+            timer.begin_timer();
+            for (unsigned int run = 0; run < NUM_RUNS; run++) {
+                for (const string& prefix : *prefixes) {
+                    count += trie.predictCompletions(prefix, NUM_COMP).size();
+                }
+            }
+            long long time = timer.end_timer();
+            cout << "\t" << (prefixes == &named ? "Test 1 to 5" : "Sampled")
+                 << " prefixes: " << time / NUM_RUNS / prefixes->size()
+                 << " nanoseconds per query, " << count / NUM_RUNS
+                 << " results" << endl;
+        }
+    }
+}
+
+/* Time a stream of queries mixed with frequency updates and erases, with and
+ * without the completion cache, and check the updated trie against one built
+ * from scratch with the final frequencies
+ * @param filename Dictionary file to load
+ */
+void testStream(string filename) {
+    const unsigned int NUM_COMP = 10;
+    const unsigned int NUM_OPS = 200000;
+    const unsigned int PREFIX_LENGTH = 3;
+    const unsigned int CACHE_DEPTH = 3;
+    const size_t CACHE_BUDGET = 64 << 20;
+    Timer timer;
+
+    // the distinct words of the file, first frequency wins
+    ifstream in;
+    in.open(filename, ios::binary);
+    DictReader reader(in);
+    vector<string> words;
+    vector<unsigned int> startFreqs;
+    unordered_set<string> seen;
+    unsigned int freq;
+    string_view phrase;
+    while (reader.next(freq, phrase)) {
+        if (!phrase.empty() && seen.insert(string(phrase)).second) {
+            words.push_back(string(phrase));
+            startFreqs.push_back(freq);
+        }
+    }
+    in.close();
+
+    for (bool cached : {false, true}) {
+        vector<entry> entries;
+        for (unsigned int i = 0; i < words.size(); i++) {
+            entries.push_back(entry(words[i], startFreqs[i]));
+        }
+        DictionaryTrie trie;
+        trie.bulkInsert(entries);
+        if (cached) {
+            trie.enableCompletionCache(CACHE_DEPTH, NUM_COMP, CACHE_BUDGET);
+        }
+        vector<unsigned int> freqs(startFreqs);
+
+        // 80% queries, 15% increments, 4% new frequencies and 1% erases of
+        // a word that is inserted back right away
+        long long times[4] = {0, 0, 0, 0};
+        unsigned int counts[4] = {0, 0, 0, 0};
+        unsigned int results = 0;
+        unsigned int seed = 3;
+        for (unsigned int op = 0; op < NUM_OPS; op++) {
+            seed = seed * 1103515245 + 12345;
+            unsigned int kind = (seed >> 8) % 100;
+            kind = kind < 80 ? 0 : (kind < 95 ? 1 : (kind < 99 ? 2 : 3));
+            seed = seed * 1103515245 + 12345;
+            unsigned int i = (seed >> 4) % words.size();
+            seed = seed * 1103515245 + 12345;
+            unsigned int amount = 1 + (seed >> 8) % 1000;
+
+            timer.begin_timer();
+            if (kind == 0) {
+                results += trie.predictCompletions(
+                                   words[i].substr(0, PREFIX_LENGTH), NUM_COMP)
+                               .size();
+            } else if (kind == 1) {
+                trie.incrementFrequency(words[i], amount);
+            } else if (kind == 2) {
+                trie.setFrequency(words[i], amount);
+            } else {
+                trie.erase(words[i]);
+                trie.insert(words[i], amount);
+            }
+            times[kind] += timer.end_timer();
+            counts[kind]++;
+            if (kind == 1) {
+                freqs[i] += amount;
+            } else if (kind > 1) {
+                freqs[i] = amount;
+            }
+        }
+
+        cout << "\nStream" << (cached ? ", completion cache" : "") << ": "
+             << NUM_OPS << " operations on " << words.size() << " words"
+             << endl;
+        const char* names[4] = {"Query", "Increment", "Set frequency",
+                                "Erase and insert"};
+        for (unsigned int kind = 0; kind < 4; kind++) {
+            cout << "\t" << names[kind] << ": " << counts[kind] << " x "
+                 << times[kind] / std::max(1U, counts[kind])
+                 << " nanoseconds" << endl;
+        }
+        long long total = times[0] + times[1] + times[2] + times[3];
+        cout << "\tThroughput: " << NUM_OPS / (total / 1e9)
+             << " operations/second, " << results << " results" << endl;
+
+        // a trie built from scratch must answer the same
+        entries.clear();
+        for (unsigned int i = 0; i < words.size(); i++) {
+            entries.push_back(entry(words[i], freqs[i]));
+        }
+        DictionaryTrie fresh;
+        timer.begin_timer();
+        fresh.bulkInsert(entries);
+        long long rebuild = timer.end_timer();
+        bool same = trie.numNodes() == fresh.numNodes();
+        for (unsigned int i = 0; i < words.size(); i += 100) {
+            string prefix = words[i].substr(0, PREFIX_LENGTH);
+            same = same && trie.predictCompletions(prefix, NUM_COMP) ==
+                               fresh.predictCompletions(prefix, NUM_COMP);
+        }
+        cout << "\tRebuild from scratch: " << rebuild
+             << " nanoseconds, same results: " << (same ? "yes" : "no")
+             << endl;
+    }
+}
+
+/* Print the memory of one trie backend and time it on a set of prefixes and
+ * wildcard patterns, checking it answers the same as the ternary trie
+ * @param name Name of the backend
+ * @param backend Trie to time
+ * @param trie Ternary trie the backend was built from
+ * @param prefixes Prefixes to complete
+ * @param patterns Wildcard patterns to match
+ */
+template <typename Trie>
+void timeBackend(const string& name, const Trie& backend,
+                 const DictionaryTrie& trie, const vector<string>& prefixes,
+                 const vector<string>& patterns) {
+    const unsigned int NUM_COMP = 10;
+    const unsigned int NUM_RUNS = 20;
+    Timer timer;
+
+    bool same = true;
+    for (const string& prefix : prefixes) {
+        same = same && backend.predictCompletions(prefix, NUM_COMP) ==
+                           trie.predictCompletions(prefix, NUM_COMP);
+    }
+    for (const string& pattern : patterns) {
+        same = same && backend.predictUnderscores(pattern, NUM_COMP) ==
+                           trie.predictUnderscores(pattern, NUM_COMP);
+    }
+    size_t bytes = backend.memoryUsage();
+    cout << "\t" << name << ": " << backend.numNodes() << " nodes, " << bytes
+         << " bytes, " << (double)bytes / trie.wordCount()
+         << " bytes per word, same results: " << (same ? "yes" : "no")
+         << endl;
+
+    unsigned int count = 0;
+    timer.begin_timer();
+    for (unsigned int run = 0; run < NUM_RUNS; run++) {
+        for (const string& prefix : prefixes) {
+            count += backend.find(prefix);
+        }
+    }
+    long long time = timer.end_timer();
+    cout << "\t\tFind: " << time / NUM_RUNS / prefixes.size()
+         << " nanoseconds per word" << endl;
+
+    timer.begin_timer();
+    for (unsigned int run = 0; run < NUM_RUNS; run++) {
+        for (const string& prefix : prefixes) {
+            count += backend.predictCompletions(prefix, NUM_COMP).size();
+        }
+    }
+    time = timer.end_timer();
+    cout << "\t\tPrefixes: " << time / NUM_RUNS / prefixes.size()
+         << " nanoseconds per query" << endl;
+
+    timer.begin_timer();
+    for (unsigned int run = 0; run < NUM_RUNS; run++) {
+        for (const string& pattern : patterns) {
+            count += backend.predictUnderscores(pattern, NUM_COMP).size();
+        }
+    }
+    time = timer.end_timer();
+    cout << "\t\tWildcard patterns: " << time / NUM_RUNS / patterns.size()
+         << " nanoseconds per query" << endl;
+}
+
+/* Print the percentiles of a list of query latencies
+ * @param name Name of the phase measured
+ * @param latencies Latency of each query in nanoseconds
+ */
+void printLatencies(string name, vector<long long>& latencies) {
+    LatencySummary stats(latencies);
+    cout << "\t" << name << ": " << stats.count << " queries, p50 "
+         << stats.p50 << ", p99 " << stats.p99 << ", p99.9 " << stats.p999
+         << ", max " << stats.max << " nanoseconds" << endl;
+}
+
+/* Compare query latency with no reload running, with reloads swapped in
+ * through a live dictionary, and with reloads that hold a lock while the
+ * new trie is built
+ * @param filename Dictionary file to load
+ */
+void testReload(string filename) {
+    const unsigned int NUM_COMP = 10;
+    const unsigned int NUM_READERS = 2;
+    const unsigned int NUM_RELOADS = 3;
+    const unsigned int PREFIX_STRIDE = 100;
+    const unsigned int PREFIX_LENGTH = 3;
+
+    ifstream in;
+    in.open(filename, ios::binary);
+    vector<string> words;
+    Utils::loadDict(words, in);
+    in.close();
+    vector<string> prefixes;
+    for (unsigned int i = 0; i < words.size(); i += PREFIX_STRIDE) {
+        prefixes.push_back(words[i].substr(0, PREFIX_LENGTH));
+    }
+    auto load = [&filename](DictionaryTrie& trie) {
+        ifstream file(filename, ios::binary);
+        Utils::loadDict(trie, file);
+        return true;
+    };
+
+    // runs the readers until the writer is done, timing every query
+    auto measure = [&](function<unsigned int(const string&)> query,
+                       function<void()> writer) {
+        atomic<bool> done(false);
+        vector<vector<long long>> latencies(NUM_READERS);
+        vector<thread> readers;
+        for (unsigned int t = 0; t < NUM_READERS; t++) {
+            readers.emplace_back([&, t]() {
+                Timer timer;
+                for (unsigned int i = t; !done.load(); i++) {
+                    timer.begin_timer();
+                    query(prefixes[i % prefixes.size()]);
+                    latencies[t].push_back(timer.end_timer());
+                }
+            });
+        }
+        writer();
+        done = true;
+        for (thread& reader : readers) {
+            reader.join();
+        }
+        vector<long long> all;
+        for (const vector<long long>& list : latencies) {
+            all.insert(all.end(), list.begin(), list.end());
+        }
+        return all;
+    };
+
+    cout << "\nReload: " << NUM_READERS << " reader threads, " << NUM_RELOADS
+         << " reloads of the dictionary, numCompletions = " << NUM_COMP
+         << endl;
+
+    LiveDictionary live;
+    unique_ptr<DictionaryTrie> first(new DictionaryTrie());
+    load(*first);
+    live.publish(std::move(first));
+    auto liveQuery = [&live](const string& prefix) {
+        LiveDictionary::Pin pin = live.pin();
+        return (unsigned int)pin->predictCompletions(prefix, NUM_COMP).size();
+    };
+
+    // as long as the reloads take, without reloading
+    Timer timer;
+    timer.begin_timer();
+    for (unsigned int i = 0; i < NUM_RELOADS; i++) {
+        DictionaryTrie trie;
+        load(trie);
+    }
+    long long reloadTime = timer.end_timer();
+    vector<long long> latencies = measure(liveQuery, [reloadTime]() {
+        this_thread::sleep_for(chrono::nanoseconds(reloadTime));
+    });
+    printLatencies("No reload", latencies);
+
+    latencies = measure(liveQuery, [&live, &load]() {
+        for (unsigned int i = 0; i < NUM_RELOADS; i++) {
+            live.reloadAsync(load);
+            live.finishReload();
+        }
+    });
+    printLatencies("Live dictionary reloads", latencies);
+
+    // the trie is rebuilt in place while readers wait on the lock
+    unique_ptr<DictionaryTrie> locked(new DictionaryTrie());
+    load(*locked);
+    shared_mutex lock;
+    latencies = measure(
+        [&locked, &lock](const string& prefix) {
+            shared_lock<shared_mutex> reading(lock);
+            return (unsigned int)locked->predictCompletions(prefix, NUM_COMP)
+                .size();
+        },
+        [&locked, &lock, &load]() {
+            for (unsigned int i = 0; i < NUM_RELOADS; i++) {
+                unique_lock<shared_mutex> writing(lock);
+                locked.reset(new DictionaryTrie());
+                load(*locked);
+            }
+        });
+    printLatencies("Reloads under a lock", latencies);
+}
+
+/* Compare building the trie with the current loader against building a
+ * sharded dictionary on 1 to N threads
+ * @param filename Dictionary file to load
+ */
+void testShards(string filename) {
+    const unsigned int NUM_COMP = 10;
+    const unsigned int NUM_RUNS = 3;
+    const unsigned int PREFIX_STRIDE = 100;
+    const unsigned int PREFIX_LENGTH = 3;
+    Timer timer;
+
+    ifstream in;
+    in.open(filename, ios::binary);
+    vector<string> words;
+    Utils::loadDict(words, in);
+    in.close();
+    vector<string> prefixes;
+    for (unsigned int i = 0; i < words.size(); i += PREFIX_STRIDE) {
+        prefixes.push_back(words[i].substr(0, PREFIX_LENGTH));
+    }
+
+    long long best = 0;
+    DictionaryTrie trie;
+    for (unsigned int run = 0; run < NUM_RUNS; run++) {
+        DictionaryTrie built;
+        in.open(filename, ios::binary);
+        timer.begin_timer();
+        Utils::loadDict(run + 1 < NUM_RUNS ? built : trie, in);
+        long long time = timer.end_timer();
+        in.close();
+        best = run == 0 ? time : std::min(best, time);
+    }
+    cout << "\nShards: best of " << NUM_RUNS
+         << " builds, hardware threads = " << thread::hardware_concurrency()
+         << "\n\tCurrent loader: " << best / 1000000 << " ms" << endl;
+
+    unsigned int maxThreads = std::max(8U, thread::hardware_concurrency());
+    for (unsigned int numThreads = 1; numThreads <= maxThreads;
+         numThreads *= 2) {
+        unique_ptr<ShardedTrie> sharded;
+        for (unsigned int run = 0; run < NUM_RUNS; run++) {
+            sharded.reset(new ShardedTrie(numThreads));
+            in.open(filename, ios::binary);
+            timer.begin_timer();
+            Utils::loadDict(*sharded, in, numThreads);
+            long long time = timer.end_timer();
+            in.close();
+            best = run == 0 ? time : std::min(best, time);
+        }
+
+        // the sharded answers must match those of the one trie
+        unsigned int mismatches = 0;
+        for (const string& prefix : prefixes) {
+            mismatches += sharded->predictCompletions(prefix, NUM_COMP) !=
+                          trie.predictCompletions(prefix, NUM_COMP);
+        }
+        mismatches += sharded->predictUnderscores("_a_", NUM_COMP) !=
+                      trie.predictUnderscores("_a_", NUM_COMP);
+        cout << "\t" << numThreads << " threads and shards: "
+             << best / 1000000 << " ms, " << sharded->wordCount()
+             << " words, mismatched queries: " << mismatches << endl;
+    }
+}
+
+/* Replay a Zipf distributed trace of prefix queries straight to the trie and
+ * through query caches of a few sizes, with and without frequency admission
+ * @param filename Dictionary file to load
+ */
+void testZipf(string filename) {
+    const unsigned int NUM_COMP = 10;
+    const unsigned int NUM_QUERIES = 300000;
+    const unsigned int PREFIX_STRIDE = 7;
+    const unsigned int MAX_PREFIX = 5;
+    const double SKEW = 0.99;
+    Timer timer;
+
+    ifstream in;
+    in.open(filename, ios::binary);
+    DictionaryTrie trie;
+    Utils::loadDict(trie, in);
+    in.close();
+    in.open(filename, ios::binary);
+    vector<string> words;
+    Utils::loadDict(words, in);
+    in.close();
+
+    // distinct prefixes in a shuffled order, so popularity is not tied to
+    // the length or letters of a prefix
+    unordered_set<string> seen;
+    vector<string> prefixes;
+    unsigned int seed = 7;
+    for (unsigned int i = 0; i < words.size(); i += PREFIX_STRIDE) {
+        seed = seed * 1103515245 + 12345;
+        string prefix = words[i].substr(0, 1 + (seed >> 16) % MAX_PREFIX);
+        if (seen.insert(prefix).second) {
+            prefixes.push_back(prefix);
+        }
+    }
+    for (unsigned int i = prefixes.size() - 1; i > 0; i--) {
+        seed = seed * 1103515245 + 12345;
+        swap(prefixes[i], prefixes[(seed >> 8) % (i + 1)]);
+    }
+
+    // the i-th prefix is asked in proportion to 1 / (i + 1)^SKEW
+    vector<double> cdf(prefixes.size());
+    double total = 0;
+    for (unsigned int i = 0; i < prefixes.size(); i++) {
+        total += 1 / pow(i + 1, SKEW);
+        cdf[i] = total;
+    }
+    vector<unsigned int> trace(NUM_QUERIES);
+    for (unsigned int& query : trace) {
+        seed = seed * 1103515245 + 12345;
+        double pick = (seed >> 8) / double(1 << 24) * total;
+        query = lower_bound(cdf.begin(), cdf.end(), pick) - cdf.begin();
+        query = std::min(query, (unsigned int)prefixes.size() - 1);
+    }
+
+    cout << "\nZipf: " << NUM_QUERIES << " queries over " << prefixes.size()
+         << " prefixes, skew = " << SKEW << ", numCompletions = " << NUM_COMP
+         << endl;
+    unsigned int count = 0;
+    timer.begin_timer();
+    for (unsigned int query : trace) {
+        count += trie.predictCompletions(prefixes[query], NUM_COMP).size();
+    }
+    long long time = timer.end_timer();
+    cout << "\tNo cache: " << time / NUM_QUERIES
+         << " nanoseconds per query, results found: " << count << endl;
+
+    for (size_t capacity : {1000, 10000}) {
+        for (bool admission : {false, true}) {
+            QueryCache cache(trie, capacity, 16, admission);
+            count = 0;
+            timer.begin_timer();
+            for (unsigned int query : trace) {
+                count +=
+                    cache.predictCompletions(prefixes[query], NUM_COMP).size();
+            }
+            time = timer.end_timer();
+            cout << "\t" << (admission ? "TinyLFU" : "LRU") << " cache of "
+                 << capacity << ": " << time / NUM_QUERIES
+                 << " nanoseconds per query, hit rate "
+                 << 100.0 * cache.hits() / NUM_QUERIES
+                 << "%, results found: " << count << endl;
+        }
+    }
+}
+
+/* Simulate typing sampled words a letter at a time, with a typo fixed by
+ * backspace in every fourth word, asking for completions after each
+ * keystroke: from the root every time, and through a completion session.
+ * Runs without and with the completion cache.
+ * @param filename Dictionary file to load
+ */
+void testTyping(string filename) {
+    const unsigned int NUM_COMP = 10;
+    const unsigned int WORD_STRIDE = 50;
+    const unsigned int TYPO_EVERY = 4;
+    const unsigned int CACHE_DEPTH = 3;
+    const size_t CACHE_BUDGET = 64 << 20;
+    Timer timer;
+
+    ifstream in;
+    in.open(filename, ios::binary);
+    DictionaryTrie trie;
+    Utils::loadDict(trie, in);
+    in.close();
+    in.open(filename, ios::binary);
+    vector<string> words;
+    Utils::loadDict(words, in);
+    in.close();
+
+    // the keystrokes of each sampled word, '\b' standing for backspace
+    vector<string> typing;
+    unsigned int keystrokes = 0;
+    for (unsigned int i = 0; i < words.size(); i += WORD_STRIDE) {
+        string keys = words[i];
+        if (typing.size() % TYPO_EVERY == 0 && keys.length() > 2) {
+            keys.insert(keys.length() / 2, "q\b");
+        }
+        typing.push_back(keys);
+        keystrokes += keys.length();
+    }
+    cout << "\nTyping: " << typing.size() << " words, " << keystrokes
+         << " keystrokes, numCompletions = " << NUM_COMP << endl;
+
+    for (bool cached : {false, true}) {
+        if (cached) {
+            trie.enableCompletionCache(CACHE_DEPTH, NUM_COMP, CACHE_BUDGET);
+        }
+        cout << (cached ? "\tCompletion cache on:" : "\tNo completion cache:")
+             << endl;
+
+        unsigned int count = 0;
+        timer.begin_timer();
+        for (const string& keys : typing) {
+            string typed;
+            for (char key : keys) {
+                if (key == '\b') {
+                    typed.pop_back();
+                } else {
+                    typed.push_back(key);
+                }
+                count += trie.predictCompletionViews(typed, NUM_COMP).size();
+            }
+        }
+        long long time = timer.end_timer();
+        cout << "\t\tFrom the root: " << time / keystrokes
+             << " nanoseconds per keystroke, results found: " << count
+             << endl;
+
+        count = 0;
+        CompletionSession session(trie, NUM_COMP);
+        timer.begin_timer();
+        for (const string& keys : typing) {
+            session.clear();
+            for (char key : keys) {
+                if (key == '\b') {
+                    session.backspace();
+                } else {
+                    session.append(key);
+                }
+                count += session.completionViews().size();
+            }
+        }
+        time = timer.end_timer();
+        cout << "\t\tSession: " << time / keystrokes
+             << " nanoseconds per keystroke, results found: " << count
+             << endl;
+    }
+}
+
+/* Time the hot prefix walk with and without wide nodes: find of sampled
+ * words and of their first letters, and cached completions, where the walk
+ * is most of the work.
+ * @param filename Dictionary file to load
+ */
+void testWide(string filename) {
+    const unsigned int NUM_COMP = 10;
+    const unsigned int WORD_STRIDE = 10;
+    const unsigned int NUM_ROUNDS = 5;
+    const unsigned int MIN_CHILDREN = 8;
+    const unsigned int CACHE_DEPTH = 3;
+    const size_t CACHE_BUDGET = 64 << 20;
+    Timer timer;
+
+    ifstream in;
+    in.open(filename, ios::binary);
+    DictionaryTrie trie;
+    Utils::loadDict(trie, in);
+    in.close();
+    in.open(filename, ios::binary);
+    vector<string> words;
+    Utils::loadDict(words, in);
+    in.close();
+    trie.enableCompletionCache(CACHE_DEPTH, NUM_COMP, CACHE_BUDGET);
+
+    vector<string> sampled;
+    vector<string> prefixes;
+    for (unsigned int i = 0; i < words.size(); i += WORD_STRIDE) {
+        sampled.push_back(words[i]);
+        prefixes.push_back(words[i].substr(0, 1 + i % CACHE_DEPTH));
+    }
+    cout << "\nWide nodes: " << sampled.size() << " words, "
+         << NUM_ROUNDS << " rounds, at least " << MIN_CHILDREN
+         << " children per wide node" << endl;
+
+    for (unsigned int depth = 0; depth <= CACHE_DEPTH; depth++) {
+        trie.enableWideNodes(depth, MIN_CHILDREN);
+        cout << "\tDepth " << depth << ", " << trie.wideNodeMemory()
+             << " bytes:" << endl;
+
+        unsigned int count = 0;
+        timer.begin_timer();
+        for (unsigned int round = 0; round < NUM_ROUNDS; round++) {
+            for (const string& word : sampled) {
+                count += trie.find(word);
+            }
+        }
+        long long time = timer.end_timer();
+        cout << "\t\tfind words: "
+             << time / (NUM_ROUNDS * sampled.size())
+             << " nanoseconds per word, found: " << count << endl;
+
+        count = 0;
+        timer.begin_timer();
+        for (unsigned int round = 0; round < NUM_ROUNDS; round++) {
+            for (const string& prefix : prefixes) {
+                count += trie.find(prefix);
+            }
+        }
+        time = timer.end_timer();
+        cout << "\t\tfind prefixes: "
+             << time / (NUM_ROUNDS * prefixes.size())
+             << " nanoseconds per prefix, found: " << count << endl;
+
+        count = 0;
+        timer.begin_timer();
+        for (unsigned int round = 0; round < NUM_ROUNDS; round++) {
+            for (const string& prefix : prefixes) {
+                count += trie.predictCompletionViews(prefix, NUM_COMP).size();
+            }
+        }
+        time = timer.end_timer();
+        cout << "\t\tcached completions: "
+             << time / (NUM_ROUNDS * prefixes.size())
+             << " nanoseconds per prefix, results found: " << count << endl;
+    }
+}
+
+/* Dump the query statistics of completions of sampled prefixes, depth first
+ * and best first, and of wildcard patterns. Needs the library built with
+ * TRIE_STATS.
+ * @param filename Dictionary file to load
+ */
+void testStats(string filename) {
+    const unsigned int NUM_COMP = 10;
+    const unsigned int WORD_STRIDE = 50;
+    const unsigned int MAX_PREFIX = 3;
+    if (!TrieStats::enabled()) {
+        cout << "\nQuery statistics are compiled out. Rebuild with "
+             << "-Dtrie_stats=true (TRIE_STATS) to collect them." << endl;
+        return;
+    }
+
+    ifstream in;
+    in.open(filename, ios::binary);
+    DictionaryTrie trie;
+    Utils::loadDict(trie, in);
+    in.close();
+    in.open(filename, ios::binary);
+    vector<string> words;
+    Utils::loadDict(words, in);
+    in.close();
+
+    vector<string> prefixes;
+    vector<string> patterns;
+    for (unsigned int i = 0; i < words.size(); i += WORD_STRIDE) {
+        prefixes.push_back(words[i].substr(0, MAX_PREFIX));
+        string pattern = words[i];
+        pattern[0] = '_';
+        patterns.push_back(pattern);
+    }
+
+    for (bool bestFirst : {false, true}) {
+        trie.setBestFirst(bestFirst);
+        TrieStats::reset();
+        for (const string& prefix : prefixes) {
+            trie.predictCompletionViews(prefix, NUM_COMP);
+        }
+        cout << "\nCompletions, " << (bestFirst ? "best" : "depth")
+             << " first, numCompletions = " << NUM_COMP << endl;
+        TrieStats::collect().print(cout);
+    }
+
+    TrieStats::reset();
+    for (const string& pattern : patterns) {
+        trie.predictUnderscores(pattern, NUM_COMP);
+    }
+    cout << "\nWildcard patterns, numCompletions = " << NUM_COMP << endl;
+    TrieStats::collect().print(cout);
+}
+
+/* Compare the memory and query speed of the ternary trie with its path
+ * compressed and succinct copies, and with an adaptive radix tree
+ * @param filename Dictionary file to load
+ */
+void testMemory(string filename) {
+    const unsigned int PREFIX_STRIDE = 100;
+    const unsigned int PREFIX_LENGTH = 3;
+    Timer timer;
+
+    ifstream in;
+    in.open(filename, ios::binary);
+    in.seekg(0, ios_base::end);
+    size_t fileBytes = in.tellg();
+    in.seekg(0, ios_base::beg);
+    DictionaryTrie trie;
+    Utils::loadDict(trie, in);
+    in.close();
+
+    // alphabet prefixes plus short prefixes of a sample of the words
+    vector<string> prefixes;
+    for (char c = 'a'; c <= 'z'; c++) {
+        prefixes.push_back(string(1, c));
+    }
+    in.open(filename, ios::binary);
+    vector<string> words;
+    Utils::loadDict(words, in);
+    in.close();
+    for (unsigned int i = 0; i < words.size(); i += PREFIX_STRIDE) {
+        prefixes.push_back(words[i].substr(0, PREFIX_LENGTH));
+    }
+    vector<string> patterns = {"____", "___e", "__a__", "______ing"};
+
+    cout << "\nMemory: " << trie.wordCount() << " words, " << fileBytes
+         << " file bytes, " << prefixes.size() << " prefixes" << endl;
+    timeBackend("Ternary trie", trie, trie, prefixes, patterns);
+
+    timer.begin_timer();
+    CompactTrie compact(trie);
+    long long time = timer.end_timer();
+    cout << "\tCompact trie built in " << time << " nanoseconds" << endl;
+    timeBackend("Compact trie", compact, trie, prefixes, patterns);
+
+    timer.begin_timer();
+    SuccinctTrie succinct(trie);
+    time = timer.end_timer();
+    cout << "\tSuccinct trie built in " << time << " nanoseconds" << endl;
+    timeBackend("Succinct trie", succinct, trie, prefixes, patterns);
+
+    AdaptiveRadixTree art;
+    in.open(filename, ios::binary);
+    timer.begin_timer();
+    Utils::loadDict(art, in);
+    time = timer.end_timer();
+    in.close();
+    cout << "\tAdaptive radix tree loaded in " << time << " nanoseconds"
+         << endl;
+    timeBackend("Adaptive radix tree", art, trie, prefixes, patterns);
+}
+
+/* Run a workload of the suite: warmup operations that are not timed, then
+ * timed operations one at a time
+ * @param warmup Number of untimed operations
+ * @param iterations Number of timed operations
+ * @param op Operation to run, given its index
+ * @return the latency of each timed operation, in nanoseconds
+ */
+vector<long long> runWorkload(unsigned int warmup, unsigned int iterations,
+                              const function<void(unsigned int)>& op) {
+    Timer timer;
+    for (unsigned int i = 0; i < warmup; i++) {
+        op(i);
+    }
+    vector<long long> latencies(iterations);
+    for (unsigned int i = 0; i < iterations; i++) {
+        timer.begin_timer();
+        op(warmup + i);
+        latencies[i] = timer.end_timer();
+    }
+    return latencies;
+}
+
+/* Run every workload of the suite without prompting, and print the latency
+ * percentiles of each as a table, JSON or CSV
+ * @param filename Dictionary file to load
+ * @param format "text", "json" or "csv"
+ * @param backend Dictionary backend to run against, one of
+ * Dictionary::backends()
+ */
+void testSuite(string filename, string format, string backend) {
+    const unsigned int NUM_COMP = 10;
+    const unsigned int LOAD_WARMUP = 1;
+    const unsigned int LOAD_ITERATIONS = 5;
+    const unsigned int WARMUP = 1000;
+    const unsigned int ITERATIONS = 20000;
+    const unsigned int MAX_PREFIX = 5;
+    Timer timer;
+
+    vector<pair<string, LatencySummary>> results;
+    auto loadOnce = [&filename, &backend]() {
+        ifstream in(filename, ios::binary);
+        unique_ptr<Dictionary> dict = Dictionary::create(backend);
+        Utils::loadDict(*dict, in);
+    };
+    vector<long long> loads;
+    for (unsigned int i = 0; i < LOAD_WARMUP + LOAD_ITERATIONS; i++) {
+        timer.begin_timer();
+        loadOnce();  // times freeing the dictionary too
+        long long time = timer.end_timer();
+        if (i >= LOAD_WARMUP) {
+            loads.push_back(time);
+        }
+    }
+    results.push_back(make_pair("load", LatencySummary(loads)));
+
+    ifstream in;
+    in.open(filename, ios::binary);
+    unique_ptr<Dictionary> dict = Dictionary::create(backend);
+    Utils::loadDict(*dict, in);
+    in.close();
+    in.open(filename, ios::binary);
+    vector<string> words;
+    Utils::loadDict(words, in);
+    in.close();
+
+    // blank lines load as empty words, which have no letter to replace
+    words.erase(std::remove(words.begin(), words.end(), string()),
+                words.end());
+    if (words.empty()) {
+        cout << "No words to sample queries from in: " << filename << endl;
+        return;
+    }
+
+    // the same pseudo random queries on every run, so runs can be compared
+    unsigned int seed = 42;
+    auto next = [&seed]() {
+        seed = seed * 1103515245 + 12345;
+        return seed >> 8;
+    };
+    vector<string> found;
+    vector<string> missing;
+    vector<string> prefixes;
+    vector<string> patterns;
+    for (unsigned int i = 0; i < WARMUP + ITERATIONS; i++) {
+        const string& word = words[next() % words.size()];
+        found.push_back(word);
+        missing.push_back(word + "#");
+        string prefix = word.substr(0, 1 + next() % MAX_PREFIX);
+        prefixes.push_back(prefix);
+        prefix[next() % prefix.length()] = '_';
+        patterns.push_back(prefix);
+    }
+    vector<string> fixed = {"a", "the", "app", "man"};
+    for (char c = 'a'; c <= 'z'; c++) {
+        fixed.push_back(string(1, c));
+    }
+
+    unsigned int count = 0;  // keeps the queries from being optimized out
+    vector<long long> latencies =
+        runWorkload(WARMUP, ITERATIONS, [&](unsigned int i) {
+            count += dict->find(i % 2 ? found[i] : missing[i]);
+        });
+    results.push_back(make_pair("find", LatencySummary(latencies)));
+    latencies = runWorkload(WARMUP, ITERATIONS, [&](unsigned int i) {
+        count += dict->predictCompletions(fixed[i % fixed.size()], NUM_COMP)
+                     .size();
+    });
+    results.push_back(
+        make_pair("predictCompletions", LatencySummary(latencies)));
+    latencies = runWorkload(WARMUP, ITERATIONS, [&](unsigned int i) {
+        count += dict->predictCompletions(prefixes[i], NUM_COMP).size();
+    });
+    results.push_back(make_pair("randomPrefixes", LatencySummary(latencies)));
+    latencies = runWorkload(WARMUP, ITERATIONS, [&](unsigned int i) {
+        count += dict->predictUnderscores(patterns[i], NUM_COMP).size();
+    });
+    results.push_back(
+        make_pair("predictUnderscores", LatencySummary(latencies)));
+
+    if (format == "json") {
+        string name;
+        for (char c : filename) {
+            if (c == '"' || c == '\\') {
+                name.push_back('\\');
+            }
+            name.push_back(c);
+        }
+        cout << "{\"dictionary\": \"" << name << "\", \"backend\": \""
+             << backend << "\", \"words\": " << dict->wordCount()
+             << ", \"numCompletions\": " << NUM_COMP
+             << ", \"resultsFound\": " << count << ", \"workloads\": [";
+        for (unsigned int i = 0; i < results.size(); i++) {
+            const LatencySummary& stats = results[i].second;
+            cout << (i == 0 ? "" : ", ") << "{\"name\": \""
+                 << results[i].first << "\", \"iterations\": " << stats.count
+                 << ", \"mean_ns\": " << stats.mean
+                 << ", \"p50_ns\": " << stats.p50
+                 << ", \"p95_ns\": " << stats.p95
+                 << ", \"p99_ns\": " << stats.p99
+                 << ", \"max_ns\": " << stats.max << "}";
+        }
+        cout << "]}" << endl;
+    } else if (format == "csv") {
+        cout << "workload,iterations,mean_ns,p50_ns,p95_ns,p99_ns,max_ns"
+             << endl;
+        for (const pair<string, LatencySummary>& result : results) {
+            const LatencySummary& stats = result.second;
+            cout << result.first << "," << stats.count << "," << stats.mean
+                 << "," << stats.p50 << "," << stats.p95 << "," << stats.p99
+                 << "," << stats.max << endl;
+        }
+    } else {
+        cout << "\nSuite: " << backend << " backend, " << dict->wordCount()
+             << " words, "
+             << "numCompletions = " << NUM_COMP << ", " << WARMUP
+             << " warmup and " << ITERATIONS
+             << " timed queries per workload, results found: " << count
+             << endl;
+        for (const pair<string, LatencySummary>& result : results) {
+            const LatencySummary& stats = result.second;
+            cout << "\t" << result.first << ": " << stats.count
+                 << " iterations, mean " << stats.mean << ", p50 "
+                 << stats.p50 << ", p95 " << stats.p95 << ", p99 "
+                 << stats.p99 << ", max " << stats.max << " nanoseconds"
+                 << endl;
+        }
+    }
+}
+
 /* Check if a given data file is valid */
 bool fileValid(const char* fileName) {
     ifstream in;
@@ -126,12 +1484,106 @@ bool fileValid(const char* fileName) {
 int main(int argc, char* argv[]) {
     const int NUM_ARG = 2;
 
-    if (argc != NUM_ARG) {
+    bool suite = argc > NUM_ARG && string(argv[NUM_ARG]) == "suite";
+    string backend = argc > NUM_ARG + 2 ? argv[NUM_ARG + 2]
+                                        : Dictionary::backends()[0];
+    if ((argc != NUM_ARG && argc != NUM_ARG + 1 &&
+         !(suite && argc <= NUM_ARG + 3)) ||
+        !Dictionary::create(backend)) {
         cout << "Invalid number of arguments.\n"
-             << "Usage: ./benchtrie <dictionary filename>" << endl;
+             << "Usage: ./benchtrie <dictionary filename> [benchmark]\n"
+             << "       ./benchtrie <dictionary filename> suite "
+             << "[text|json|csv] [tst|art]\n"
+             << "Benchmarks:\n"
+             << "\tsuite\tlatency percentiles of every workload, no prompt\n"
+             << "\tcache\tprecompute top completions of short prefixes\n"
+             << "\tsnapshot\trun against a mapped binary snapshot\n"
+             << "\tloader\tthroughput of parsing the dictionary file\n"
+             << "\tbalance\tfile order inserts against the bulk build\n"
+             << "\tthreads\tquery throughput of threads sharing one trie\n"
+             << "\tbatch\tloop of queries against one batch query\n"
+             << "\tunderscores\twildcard patterns with leading underscores\n"
+             << "\tfuzzy\tfuzzy completion of prefixes with typos\n"
+             << "\tbestfirst\tdepth first against best first completion\n"
+             << "\tstream\tqueries mixed with frequency updates and erases\n"
+             << "\treload\tquery latency while the dictionary is reloaded\n"
+             << "\tshards\tparallel build of a sharded dictionary\n"
+             << "\tzipf\tskewed query trace through the query cache\n"
+             << "\ttyping\tcompletions after every keystroke of typed words\n"
+             << "\tstats\tnodes, prunes and heap work per query\n"
+             << "\twide\tprefix walk with and without wide nodes\n"
+             << "\tmemory\tmemory and speed of the compact and succinct tries "
+             << "and the adaptive radix tree"
+             << endl;
         return -1;
     }
 
     if (!fileValid(argv[1])) return -1;
-    testRuntime(argv[1]);
+    string benchmark = argc > NUM_ARG ? argv[NUM_ARG] : "";
+    if (suite) {
+        testSuite(argv[1], argc > NUM_ARG + 1 ? argv[NUM_ARG + 1] : "text",
+                  backend);
+        return 0;
+    }
+    if (benchmark == "loader") {
+        testLoader(argv[1]);
+        return 0;
+    }
+    if (benchmark == "balance") {
+        testBalance(argv[1]);
+        return 0;
+    }
+    if (benchmark == "threads") {
+        testThreads(argv[1]);
+        return 0;
+    }
+    if (benchmark == "batch") {
+        testBatch(argv[1]);
+        return 0;
+    }
+    if (benchmark == "underscores") {
+        testUnderscores(argv[1]);
+        return 0;
+    }
+    if (benchmark == "fuzzy") {
+        testFuzzy(argv[1]);
+        return 0;
+    }
+    if (benchmark == "bestfirst") {
+        testBestFirst(argv[1]);
+        return 0;
+    }
+    if (benchmark == "stream") {
+        testStream(argv[1]);
+        return 0;
+    }
+    if (benchmark == "reload") {
+        testReload(argv[1]);
+        return 0;
+    }
+    if (benchmark == "shards") {
+        testShards(argv[1]);
+        return 0;
+    }
+    if (benchmark == "zipf") {
+        testZipf(argv[1]);
+        return 0;
+    }
+    if (benchmark == "typing") {
+        testTyping(argv[1]);
+        return 0;
+    }
+    if (benchmark == "stats") {
+        testStats(argv[1]);
+        return 0;
+    }
+    if (benchmark == "wide") {
+        testWide(argv[1]);
+        return 0;
+    }
+    if (benchmark == "memory") {
+        testMemory(argv[1]);
+        return 0;
+    }
+    testRuntime(argv[1], benchmark);
 }
\ No newline at end of file
@@ -0,0 +1,184 @@
+/**
+ * Load generator for the autocomplete server. Keeps a number of pipelined
+ * requests in flight on each of several connections for a while, then
+ * reports the throughput and the latency percentiles of the requests.
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "AutocompleteClient.hpp"
+#include "util.hpp"
+
+using namespace std;
+
+/* Counts of one connection's run. */
+class ConnectionResult {
+  public:
+    vector<long long> latencies;  // latency of each answer, in nanoseconds
+    unsigned long long words;     // words in the answers
+    bool failed;                  // true if the connection failed
+
+    /* Constructor. Initializes an empty result. */
+    ConnectionResult() : words(0), failed(false) {}
+};
+
+/* Run one connection: keep depth requests in flight until the time is up,
+ * then wait for the last answers
+ * @param address Address of the server
+ * @param queries (op, query) pairs to send in turn
+ * @param first Index of the first query to send
+ * @param depth Number of requests in flight
+ * @param numCompletions Number of words each request asks for
+ * @param end Time to stop sending
+ * @param result Set to the counts of the run
+ */
+void runConnection(const string& address,
+                   const vector<pair<unsigned char, string>>& queries,
+                   size_t first, unsigned int depth,
+                   unsigned int numCompletions,
+                   chrono::steady_clock::time_point end,
+                   ConnectionResult& result) {
+    AutocompleteClient client;
+    if (!client.connect(address)) {
+        result.failed = true;
+        return;
+    }
+    deque<chrono::steady_clock::time_point> sent;  // send time of each
+    size_t next = first;
+    unsigned char status;
+    vector<string> words;
+    while (true) {
+        bool sending = chrono::steady_clock::now() < end;
+        while (sending && sent.size() < depth) {
+            const pair<unsigned char, string>& query =
+                queries[next++ % queries.size()];
+            client.sendRequest(query.first, numCompletions, query.second);
+            sent.push_back(chrono::steady_clock::now());
+        }
+        if (sent.empty()) {
+            return;
+        }
+        if (!client.flush() || !client.receiveResponse(status, words) ||
+            status != Protocol::OK) {
+            result.failed = true;
+            return;
+        }
+        result.latencies.push_back(
+            chrono::duration_cast<chrono::nanoseconds>(
+                chrono::steady_clock::now() - sent.front())
+                .count());
+        result.words += words.size();
+        sent.pop_front();
+    }
+}
+
+/* The main function that drives the program
+ * arg 1 - Address of the server, "unix:<path>" or "tcp:<port>"
+ * arg 2 - Dictionary file to take the queries from
+ * arg 3 - Optional number of connections, 4 by default
+ * arg 4 - Optional number of seconds to run, 5 by default
+ * arg 5 - Optional number of requests in flight per connection, 8 by default
+ */
+int main(int argc, char* argv[]) {
+    const int MIN_ARG = 3;
+    const int MAX_ARG = 6;
+    const unsigned int NUM_COMP = 10;
+    const unsigned int NUM_QUERIES = 100000;
+    const unsigned int MAX_PREFIX = 5;
+    const unsigned int PATTERN_EVERY = 10;  // one query in 10 is a pattern
+    if (argc < MIN_ARG || argc > MAX_ARG) {
+        cout << "Invalid number of arguments.\n"
+             << "Usage: ./loadgen <address> <dictionary filename> "
+             << "[connections] [seconds] [depth]\n"
+             << "Addresses: unix:<path> or tcp:<port>" << endl;
+        return -1;
+    }
+    string address = argv[1];
+    unsigned int connections = argc > 3 ? atoi(argv[3]) : 4;
+    unsigned int seconds = argc > 4 ? atoi(argv[4]) : 5;
+    unsigned int depth = argc > 5 ? atoi(argv[5]) : 8;
+    if (connections == 0 || seconds == 0 || depth == 0) {
+        cout << "Connections, seconds and depth must be positive." << endl;
+        return -1;
+    }
+
+    ifstream in(argv[2], ios::binary);
+    vector<string> words;
+    Utils::loadDict(words, in);
+
+    // blank lines load as empty words, which have no letter to replace
+    words.erase(std::remove(words.begin(), words.end(), string()),
+                words.end());
+    if (words.empty()) {
+        cout << "No words in dictionary file: " << argv[2] << endl;
+        return -1;
+    }
+
+    // the same pseudo random prefixes and patterns on every run
+    unsigned int seed = 42;
+    auto next = [&seed]() {
+        seed = seed * 1103515245 + 12345;
+        return seed >> 8;
+    };
+    vector<pair<unsigned char, string>> queries;
+    for (unsigned int i = 0; i < NUM_QUERIES; i++) {
+        const string& word = words[next() % words.size()];
+        string query = word.substr(0, 1 + next() % MAX_PREFIX);
+        if (i % PATTERN_EVERY == 0) {
+            query[next() % query.length()] = '_';
+            queries.push_back(make_pair(Protocol::PATTERN, query));
+        } else {
+            queries.push_back(make_pair(Protocol::PREFIX, query));
+        }
+    }
+
+    vector<ConnectionResult> results(connections);
+    vector<thread> threads;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    chrono::steady_clock::time_point end = start + chrono::seconds(seconds);
+    for (unsigned int c = 0; c < connections; c++) {
+        threads.emplace_back(runConnection, cref(address), cref(queries),
+                             c * (NUM_QUERIES / connections), depth, NUM_COMP,
+                             end, ref(results[c]));
+    }
+    for (thread& t : threads) {
+        t.join();
+    }
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() -
+                                              start)
+                         .count();
+
+    vector<long long> latencies;
+    unsigned long long found = 0;
+    unsigned int failed = 0;
+    for (const ConnectionResult& result : results) {
+        latencies.insert(latencies.end(), result.latencies.begin(),
+                         result.latencies.end());
+        found += result.words;
+        failed += result.failed;
+    }
+    cout << "Load: " << connections << " connections, " << depth
+         << " requests in flight each, " << seconds << " seconds" << endl;
+    if (failed > 0) {
+        cout << "\t" << failed << " connections failed" << endl;
+    }
+    if (latencies.empty()) {
+        cout << "\tNo requests answered." << endl;
+        return -1;
+    }
+    LatencySummary stats(latencies);
+    cout << "\tRequests: " << stats.count << ", words found: " << found
+         << endl;
+    cout << "\tThroughput: " << (unsigned long long)(stats.count / elapsed)
+         << " requests per second" << endl;
+    cout << "\tLatency: mean " << stats.mean << ", p50 " << stats.p50
+         << ", p95 " << stats.p95 << ", p99 " << stats.p99 << ", p99.9 "
+         << stats.p999 << ", max " << stats.max << " nanoseconds" << endl;
+    return failed > 0 ? -1 : 0;
+}
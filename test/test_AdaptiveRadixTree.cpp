@@ -0,0 +1,110 @@
+/**
+ * Testing class to make unit tests for the adaptive radix tree class.
+ */
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "AdaptiveRadixTree.hpp"
+#include "Dictionary.hpp"
+
+using namespace std;
+using namespace testing;
+
+/* Empty tree test */
+TEST(AdaptiveRadixTreeTests, EMPTY_TEST) {
+    AdaptiveRadixTree art;
+    ASSERT_EQ(art.numNodes(), 0);
+    ASSERT_EQ(art.wordCount(), 0);
+    ASSERT_FALSE(art.find("a"));
+    ASSERT_TRUE(art.predictCompletions("", 10).empty());
+    ASSERT_TRUE(art.predictUnderscores("_", 10).empty());
+}
+
+/* Paths compress into the node below them test */
+TEST(AdaptiveRadixTreeTests, PATH_COMPRESSION_TEST) {
+    AdaptiveRadixTree art;
+    art.insert("word", 10);
+    ASSERT_EQ(art.numNodes(), 1);
+
+    // Assert "wor" splits the path, leaving "d" below it
+    art.insert("wor", 1);
+    ASSERT_EQ(art.numNodes(), 2);
+
+    // Assert "wa" splits it again at "w"
+    art.insert("wa", 5);
+    ASSERT_EQ(art.numNodes(), 4);
+    ASSERT_TRUE(art.find("wor"));
+    ASSERT_FALSE(art.find("wo"));
+    ASSERT_FALSE(art.find("words"));
+
+    // Assert prefixes ending inside a path still complete
+    vector<string> answer = {"word", "wa", "wor"};
+    ASSERT_EQ(art.predictCompletions("w", 3), answer);
+    answer = {"word", "wor"};
+    ASSERT_EQ(art.predictCompletions("wo", 3), answer);
+    answer = {"word"};
+    ASSERT_EQ(art.predictCompletions("word", 3), answer);
+    ASSERT_TRUE(art.predictCompletions("wox", 3).empty());
+    answer = {"word"};
+    ASSERT_EQ(art.predictUnderscores("w__d", 3), answer);
+    answer = {"wor"};
+    ASSERT_EQ(art.predictUnderscores("w__", 3), answer);
+}
+
+/* Nodes grow through every child block kind test */
+TEST(AdaptiveRadixTreeTests, NODE_GROWTH_TEST) {
+    AdaptiveRadixTree art;
+    art.insert("a", 1000);
+    size_t before = art.memoryUsage();
+    for (unsigned int c = 1; c < 256; c++) {
+        ASSERT_TRUE(art.insert(string("a") + (char)c, c));
+
+        // Assert every child is still found after each growth
+        for (unsigned int d = 1; d <= c; d++) {
+            ASSERT_TRUE(art.find(string("a") + (char)d));
+        }
+        ASSERT_FALSE(art.find(string("a") + (char)(c + 1)));
+    }
+
+    // Assert one branching node holds all 255 leaves
+    ASSERT_EQ(art.numNodes(), 256);
+    ASSERT_EQ(art.wordCount(), 256);
+    ASSERT_GT(art.memoryUsage(), before);
+
+    // Assert the most frequent come first, and ties are alphabetical
+    vector<string> answer = {"a", string("a") + (char)255,
+                             string("a") + (char)254};
+    ASSERT_EQ(art.predictCompletions("a", 3), answer);
+    answer = {string("a") + (char)255, string("a") + (char)254};
+    ASSERT_EQ(art.predictUnderscores("__", 2), answer);
+    ASSERT_FALSE(art.insert(string("a") + (char)200, 1));
+}
+
+/* Bulk insert test */
+TEST(AdaptiveRadixTreeTests, BULK_INSERT_TEST) {
+    AdaptiveRadixTree art;
+    vector<entry> entries = {{"cat", 3}, {"car", 5}, {"", 9},
+                             {"cat", 7}, {"dog", 1}, {"ca", 2}};
+
+    // Assert empty and duplicate words are skipped, the first one kept
+    ASSERT_EQ(art.bulkInsert(entries), 4);
+    ASSERT_EQ(art.wordCount(), 4);
+    vector<string> answer = {"car", "cat", "ca"};
+    ASSERT_EQ(art.predictCompletions("c", 5), answer);
+}
+
+/* Backend factory test */
+TEST(AdaptiveRadixTreeTests, CREATE_TEST) {
+    ASSERT_EQ(Dictionary::backends()[0], "tst");
+    for (const string& backend : Dictionary::backends()) {
+        unique_ptr<Dictionary> dict = Dictionary::create(backend);
+        ASSERT_TRUE(dict != nullptr);
+        ASSERT_TRUE(dict->insert("art", 1));
+        ASSERT_TRUE(dict->find("art"));
+    }
+    ASSERT_TRUE(dynamic_cast<AdaptiveRadixTree*>(
+                    Dictionary::create("art").get()) != nullptr);
+    ASSERT_EQ(Dictionary::create("btree"), nullptr);
+}
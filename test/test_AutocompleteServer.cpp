@@ -0,0 +1,189 @@
+/**
+ * Testing class to make unit tests for the autocomplete server and client.
+ */
+
+#include <chrono>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "AutocompleteClient.hpp"
+#include "AutocompleteServer.hpp"
+#include "DictionaryTrie.hpp"
+
+using namespace std;
+using namespace testing;
+
+/* Returns a socket path no other test run uses */
+static string socketAddress() {
+    return "unix:/tmp/test_autocomplete_" + to_string(getpid()) + ".sock";
+}
+
+/* Fills a dictionary with a few words */
+static void insertWords(DictionaryTrie& dict) {
+    dict.insert("cat", 5);
+    dict.insert("car", 9);
+    dict.insert("cart", 2);
+    dict.insert("dog", 7);
+    dict.insert("cot", 1);
+}
+
+/* Pipelined requests test */
+TEST(AutocompleteServerTests, PIPELINE_TEST) {
+    DictionaryTrie dict;
+    insertWords(dict);
+    AutocompleteServer server(dict);
+    string address = socketAddress();
+    ASSERT_TRUE(server.listen(address));
+    thread loop(&AutocompleteServer::run, &server);
+
+    // Assert many requests sent at once are answered in order
+    const unsigned int NUM_ROUNDS = 200;
+    AutocompleteClient client;
+    ASSERT_TRUE(client.connect(address));
+    for (unsigned int i = 0; i < NUM_ROUNDS; i++) {
+        client.sendRequest(Protocol::PREFIX, 2, "ca");
+        client.sendRequest(Protocol::PATTERN, 10, "c_t");
+        client.sendRequest('?', 10, "ca");
+    }
+    ASSERT_TRUE(client.flush());
+    unsigned char status;
+    vector<string> words;
+    for (unsigned int i = 0; i < NUM_ROUNDS; i++) {
+        ASSERT_TRUE(client.receiveResponse(status, words));
+        ASSERT_EQ(status, Protocol::OK);
+        ASSERT_EQ(words, dict.predictCompletions("ca", 2));
+        ASSERT_TRUE(client.receiveResponse(status, words));
+        ASSERT_EQ(status, Protocol::OK);
+        ASSERT_EQ(words, dict.predictUnderscores("c_t", 10));
+        ASSERT_TRUE(client.receiveResponse(status, words));
+        ASSERT_EQ(status, Protocol::BAD_REQUEST);
+        ASSERT_TRUE(words.empty());
+    }
+
+    server.stop();
+    loop.join();
+    ASSERT_EQ(server.requestsServed(), NUM_ROUNDS * 3);
+}
+
+/* Client that pipelines without reading test */
+TEST(AutocompleteServerTests, BACKPRESSURE_TEST) {
+    // every answer to the empty prefix holds all the words, about 24 KB
+    const unsigned int NUM_WORDS = 1000;
+    DictionaryTrie dict;
+    for (unsigned int i = 0; i < NUM_WORDS; i++) {
+        dict.insert(string(16, 'w') + to_string(i), i + 1);
+    }
+    AutocompleteServer server(dict);
+    string address = socketAddress();
+    ASSERT_TRUE(server.listen(address));
+    thread loop(&AutocompleteServer::run, &server);
+
+    // requests small enough to all reach the server in one read, with
+    // answers many times larger than the buffer it keeps unsent
+    const unsigned int NUM_REQUESTS = 2000;
+    AutocompleteClient client;
+    ASSERT_TRUE(client.connect(address));
+    for (unsigned int i = 0; i < NUM_REQUESTS; i++) {
+        client.sendRequest(Protocol::PREFIX, NUM_WORDS, "");
+    }
+    ASSERT_TRUE(client.flush());
+
+    // Assert the server stops answering while the client does not read
+    this_thread::sleep_for(chrono::milliseconds(300));
+    ASSERT_LT(server.requestsServed(), NUM_REQUESTS / 10);
+
+    // Assert every request is answered, in order, once the client reads
+    vector<string> answer = dict.predictCompletions("", NUM_WORDS);
+    unsigned char status;
+    vector<string> words;
+    for (unsigned int i = 0; i < NUM_REQUESTS; i++) {
+        ASSERT_TRUE(client.receiveResponse(status, words));
+        ASSERT_EQ(status, Protocol::OK);
+        ASSERT_EQ(words, answer);
+    }
+
+    server.stop();
+    loop.join();
+    ASSERT_EQ(server.requestsServed(), NUM_REQUESTS);
+}
+
+/* Many connections over TCP test */
+TEST(AutocompleteServerTests, CONNECTIONS_TEST) {
+    DictionaryTrie dict;
+    insertWords(dict);
+    AutocompleteServer server(dict);
+    ASSERT_TRUE(server.listen("tcp:0"));
+    ASSERT_NE(server.port(), 0);
+    string address = "tcp:" + to_string(server.port());
+    thread loop(&AutocompleteServer::run, &server);
+
+    // Assert clients on their own threads each get their own answers
+    const unsigned int NUM_CLIENTS = 8;
+    vector<thread> clients;
+    vector<bool> passed(NUM_CLIENTS, false);
+    for (unsigned int c = 0; c < NUM_CLIENTS; c++) {
+        clients.emplace_back([&, c]() {
+            AutocompleteClient client;
+            if (!client.connect(address)) {
+                return;
+            }
+            string prefix = c % 2 ? "c" : "d";
+            bool same = true;
+            unsigned char status;
+            vector<string> words;
+            for (unsigned int i = 0; i < 50 && same; i++) {
+                client.sendRequest(Protocol::PREFIX, 1 + c, prefix);
+                same = client.flush() &&
+                       client.receiveResponse(status, words) &&
+                       words == dict.predictCompletions(prefix, 1 + c);
+            }
+            passed[c] = same;
+        });
+    }
+    for (thread& t : clients) {
+        t.join();
+    }
+    server.stop();
+    loop.join();
+    for (unsigned int c = 0; c < NUM_CLIENTS; c++) {
+        ASSERT_TRUE(passed[c]) << c;
+    }
+}
+
+/* Invalid frame and half closed connection test */
+TEST(AutocompleteServerTests, CLOSE_TEST) {
+    DictionaryTrie dict;
+    insertWords(dict);
+    AutocompleteServer server(dict);
+    string address = socketAddress();
+    ASSERT_TRUE(server.listen(address));
+    thread loop(&AutocompleteServer::run, &server);
+
+    // Assert a frame too large to be a request closes the connection
+    AutocompleteClient bad;
+    ASSERT_TRUE(bad.connect(address));
+    bad.sendRequest(Protocol::PREFIX, 1, string(Protocol::MAX_FRAME, 'a'));
+    bad.flush();
+    unsigned char status;
+    vector<string> words;
+    ASSERT_FALSE(bad.receiveResponse(status, words));
+
+    // Assert requests sent before the client stops sending are answered
+    AutocompleteClient good;
+    ASSERT_TRUE(good.connect(address));
+    good.sendRequest(Protocol::PREFIX, 3, "c");
+    ASSERT_TRUE(good.flush());
+    ASSERT_TRUE(good.receiveResponse(status, words));
+    vector<string> answer = {"car", "cat", "cart"};
+    ASSERT_EQ(words, answer);
+
+    // Assert stop before run returns right away
+    server.stop();
+    loop.join();
+    server.stop();
+    server.run();
+}
@@ -0,0 +1,130 @@
+/**
+ * Testing class to make unit tests for the path compressed trie class.
+ */
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "CompactTrie.hpp"
+#include "DictionaryTrie.hpp"
+
+using namespace std;
+using namespace testing;
+
+/* Empty trie test */
+TEST(CompactTrieTests, EMPTY_TEST) {
+    DictionaryTrie dict;
+    CompactTrie compact(dict);
+    ASSERT_EQ(compact.numNodes(), 0);
+    ASSERT_FALSE(compact.find("a"));
+    ASSERT_TRUE(compact.predictCompletions("", 10).empty());
+    ASSERT_TRUE(compact.predictUnderscores("_", 10).empty());
+}
+
+/* Chains merge into segments test */
+TEST(CompactTrieTests, SEGMENT_TEST) {
+    DictionaryTrie dict;
+    dict.insert("international", 5);
+    dict.insert("internet", 9);
+    dict.insert("in", 1);
+    CompactTrie compact(dict);
+
+    // Assert the nodes hold the segments "in", "tern", "ational" and "et"
+    ASSERT_EQ(dict.numNodes(), 15);
+    ASSERT_EQ(compact.numNodes(), 4);
+    ASSERT_EQ(compact.wordCount(), 3);
+
+    // Assert words are found only where a segment ends in a word
+    ASSERT_TRUE(compact.find("in"));
+    ASSERT_TRUE(compact.find("internet"));
+    ASSERT_FALSE(compact.find("inter"));
+    ASSERT_FALSE(compact.find("internets"));
+    ASSERT_FALSE(compact.find("i"));
+
+    // Assert a prefix ending inside a segment completes through it
+    vector<string> answer = {"internet", "international"};
+    ASSERT_EQ(compact.predictCompletions("inter", 10), answer);
+    ASSERT_EQ(compact.predictCompletions("internat", 10),
+              vector<string>{"international"});
+    ASSERT_TRUE(compact.predictCompletions("intx", 10).empty());
+
+    // Assert a pattern must cover whole segments
+    ASSERT_EQ(compact.predictUnderscores("inte_ne_", 10),
+              vector<string>{"internet"});
+    ASSERT_TRUE(compact.predictUnderscores("inte_", 10).empty());
+}
+
+/* Patterns matching words of frequency 0 test */
+TEST(CompactTrieTests, UNDERSCORES_ZERO_FREQ_TEST) {
+    DictionaryTrie dict;
+    dict.insert("abc", 0);
+    dict.insert("abd", 5);
+    dict.insert("xyz", 0);
+    CompactTrie compact(dict);
+
+    // Assert words of frequency 0 fill the results until they are full
+    ASSERT_EQ(compact.predictUnderscores("xy_", 10), vector<string>{"xyz"});
+    ASSERT_EQ(compact.predictUnderscores("___", 10),
+              (vector<string>{"abd", "abc", "xyz"}));
+}
+
+/* Same answers as the trie it was built from test */
+TEST(CompactTrieTests, MATCHES_DICTIONARY_TRIE_TEST) {
+    DictionaryTrie inserted;
+    DictionaryTrie built;
+    vector<string> words;
+    vector<entry> entries;
+    unsigned int seed = 5;
+    for (unsigned int i = 0; i < 3000; i++) {
+        seed = seed * 1103515245 + 12345;
+        string word(1 + (seed >> 8) % 12, 'a');
+        for (char& c : word) {
+            seed = seed * 1103515245 + 12345;
+            c = 'a' + (seed >> 16) % 6;
+        }
+        words.push_back(word);
+    }
+    for (unsigned int i = 0; i < words.size(); i++) {
+        inserted.insert(words[i], 1 + i % 13);
+        entries.push_back(entry(words[i], 1 + i % 13));
+    }
+    built.bulkInsert(entries);
+
+    vector<string> queries = {"",   "a",    "b",   "ab",   "fff", "abcdef",
+                              "ca", "eeee", "zz",  "_",    "__",  "a_c",
+                              "___", "_b_d", "____", "_____f", "bb____"};
+    for (const DictionaryTrie* dict : {&inserted, &built}) {
+        CompactTrie compact(*dict);
+        ASSERT_LT(compact.numNodes(), dict->numNodes());
+        ASSERT_EQ(compact.wordCount(), dict->wordCount());
+        for (unsigned int i = 0; i < words.size(); i += 7) {
+            ASSERT_TRUE(compact.find(words[i]));
+            ASSERT_EQ(compact.find(words[i] + "a"),
+                      dict->find(words[i] + "a"));
+        }
+        for (const string& query : queries) {
+            for (unsigned int k : {1, 5, 50}) {
+                ASSERT_EQ(compact.predictCompletions(query, k),
+                          dict->predictCompletions(query, k));
+                ASSERT_EQ(compact.predictUnderscores(query, k),
+                          dict->predictUnderscores(query, k));
+            }
+        }
+    }
+}
+
+/* Erased words are left out of the copy test */
+TEST(CompactTrieTests, ERASE_TEST) {
+    DictionaryTrie dict;
+    dict.insert("internet", 9);
+    dict.insert("international", 5);
+    dict.insert("in", 1);
+    dict.erase("international");
+    CompactTrie compact(dict);
+
+    ASSERT_EQ(compact.wordCount(), 2);
+    ASSERT_FALSE(compact.find("international"));
+    vector<string> answer = {"internet", "in"};
+    ASSERT_EQ(compact.predictCompletions("i", 10), answer);
+}
@@ -0,0 +1,114 @@
+/**
+ * Testing class to make unit tests for the completion session class.
+ */
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "CompletionSession.hpp"
+#include "DictionaryTrie.hpp"
+
+using namespace std;
+using namespace testing;
+
+/* Typing and backspace test */
+TEST(CompletionSessionTests, TYPE_TEST) {
+    DictionaryTrie dict;
+    dict.insert("apple", 5);
+    dict.insert("apply", 3);
+    dict.insert("ape", 4);
+    dict.insert("bat", 9);
+    CompletionSession session(dict, 2);
+
+    vector<string> answer = {"bat", "apple"};
+    ASSERT_EQ(session.completions(), answer);
+    session.append('a');
+    session.append('p');
+    answer = {"apple", "ape"};
+    ASSERT_EQ(session.completions(), answer);
+    session.append('p');
+    answer = {"apple", "apply"};
+    ASSERT_EQ(session.completions(), answer);
+
+    // Assert typing past the words finds nothing, and backspace recovers
+    session.append('x');
+    session.append('y');
+    ASSERT_EQ(session.prefix(), "appxy");
+    ASSERT_TRUE(session.completions().empty());
+    session.backspace();
+    ASSERT_TRUE(session.completions().empty());
+    session.backspace();
+    ASSERT_EQ(session.completions(), answer);
+    session.backspace();
+    session.backspace();
+    session.backspace();
+    session.backspace();
+    ASSERT_EQ(session.prefix(), "");
+    answer = {"bat", "apple"};
+    ASSERT_EQ(session.completions(), answer);
+
+    session.append('b');
+    session.clear();
+    ASSERT_EQ(session.prefix(), "");
+    ASSERT_EQ(session.completionViews().size(), 2);
+}
+
+/* Same answers as predictCompletions on every keystroke test */
+TEST(CompletionSessionTests, MATCHES_PREDICT_TEST) {
+    DictionaryTrie dict;
+    vector<string> words;
+    unsigned int seed = 17;
+    for (unsigned int i = 0; i < 2000; i++) {
+        seed = seed * 1103515245 + 12345;
+        string word(1 + (seed >> 8) % 9, 'a');
+        for (char& c : word) {
+            seed = seed * 1103515245 + 12345;
+            c = 'a' + (seed >> 16) % 5;
+        }
+        words.push_back(word);
+        dict.insert(word, 1 + (seed >> 4) % 7);
+    }
+
+    for (unsigned int k : {1, 3, 10}) {
+        CompletionSession session(dict, k);
+        for (unsigned int i = 0; i < words.size(); i += 50) {
+            session.clear();
+            for (char c : words[i] + "ab") {
+                session.append(c);
+                ASSERT_EQ(session.completions(),
+                          dict.predictCompletions(session.prefix(), k));
+            }
+            for (unsigned int j = 0; j < 4; j++) {
+                session.backspace();
+                ASSERT_EQ(session.completions(),
+                          dict.predictCompletions(session.prefix(), k));
+            }
+        }
+    }
+}
+
+/* Changes to the trie are seen by the session test */
+TEST(CompletionSessionTests, TRIE_CHANGE_TEST) {
+    DictionaryTrie dict;
+    dict.insert("cat", 1);
+    dict.insert("car", 2);
+    CompletionSession session(dict, 5);
+    session.append('c');
+    session.append('a');
+    session.append('t');
+    ASSERT_EQ(session.completions(), vector<string>{"cat"});
+
+    // Assert an erase that unlinks the typed path empties the results
+    dict.erase("cat");
+    ASSERT_TRUE(session.completions().empty());
+    session.backspace();
+    ASSERT_EQ(session.completions(), vector<string>{"car"});
+
+    dict.insert("cab", 7);
+    vector<string> answer = {"cab", "car"};
+    ASSERT_EQ(session.completions(), answer);
+    session.append('t');
+    dict.insert("cat", 3);
+    ASSERT_EQ(session.completions(), vector<string>{"cat"});
+}
@@ -7,92 +7,105 @@
  */
 
 #include <algorithm>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <set>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <gtest/gtest.h>
+#include "AdaptiveRadixTree.hpp"
+#include "CompactTrie.hpp"
 #include "DictionaryTrie.hpp"
+#include "SuccinctTrie.hpp"
 #include "util.hpp"
 
 using namespace std;
 using namespace testing;
 
+/* The tests of the Dictionary interface run against every backend */
+template <class T>
+class DictTests : public Test {};
+typedef Types<DictionaryTrie, AdaptiveRadixTree> Backends;
+TYPED_TEST_SUITE(DictTests, Backends);
+
 /* Empty test */
-TEST(DictTrieTests, EMPTY_TEST) {
-    DictionaryTrie dict;
+TYPED_TEST(DictTests, EMPTY_TEST) {
+    TypeParam dict;
     ASSERT_EQ(dict.find("abrakadabra"), false);
 }
 
 /* Empty predict completion test */
-TEST(DictTrieTests, EMPTY_PREDICT_TEST) {
-    DictionaryTrie dict;
+TYPED_TEST(DictTests, EMPTY_PREDICT_TEST) {
+    TypeParam dict;
     ASSERT_EQ(dict.predictCompletions("ea", 5), vector<string>());
 }
 
 /* small word insert Test */
-TEST(DictTrieTests, SMALL_WORD_INSERT_TEST) {
-    DictionaryTrie dict;
+TYPED_TEST(DictTests, SMALL_WORD_INSERT_TEST) {
+    TypeParam dict;
     ASSERT_TRUE(dict.insert("a", 10));
 }
 
 /* small insert Test */
-TEST(DictTrieTests, SMALL_INSERT_TEST) {
-    DictionaryTrie dict;
+TYPED_TEST(DictTests, SMALL_INSERT_TEST) {
+    TypeParam dict;
     ASSERT_TRUE(dict.insert("word", 10));
 }
 
 /* small insert similar Test */
-TEST(DictTrieTests, SMALL_INSERT_SIMILAR_TEST) {
-    DictionaryTrie dict;
+TYPED_TEST(DictTests, SMALL_INSERT_SIMILAR_TEST) {
+    TypeParam dict;
     dict.insert("word", 10);
     // Assert we can insert word in middle of another word
     ASSERT_TRUE(dict.insert("wor", 1));
 }
 
 /* small word duplicate insert Test */
-TEST(DictTrieTests, SMALL_WORD_INSERT_DUP_TEST) {
-    DictionaryTrie dict;
+TYPED_TEST(DictTests, SMALL_WORD_INSERT_DUP_TEST) {
+    TypeParam dict;
     dict.insert("a", 10);
     // Assert small word duplicate insert fails
     ASSERT_FALSE(dict.insert("a", 1));
 }
 
 /* small find Test */
-TEST(DictTrieTests, SMALL_FIND_TEST) {
-    DictionaryTrie dict;
+TYPED_TEST(DictTests, SMALL_FIND_TEST) {
+    TypeParam dict;
     dict.insert("word", 10);
     ASSERT_TRUE(dict.find("word"));
 }
 
 /* small insert fail Test */
-TEST(DictTrieTests, SMALL_INSERT_FAIL_TEST) {
-    DictionaryTrie dict;
+TYPED_TEST(DictTests, SMALL_INSERT_FAIL_TEST) {
+    TypeParam dict;
     dict.insert("word", 1);
     // Assert inserting duplicate word is false
     ASSERT_FALSE(dict.insert("word", 10));
 }
 
 /* Insert empty Test */
-TEST(DictTrieTests, INSERT_EMPTY_TEST) {
-    DictionaryTrie dict;
+TYPED_TEST(DictTests, INSERT_EMPTY_TEST) {
+    TypeParam dict;
     // Assert inserting empty string is false
     ASSERT_FALSE(dict.insert("", 10));
 }
 
 /* small find fail Test */
-TEST(DictTrieTests, SMALL_FIND_FAIL_TEST) {
-    DictionaryTrie dict;
+TYPED_TEST(DictTests, SMALL_FIND_FAIL_TEST) {
+    TypeParam dict;
     dict.insert("word", 10);
     // Assert cant find word
     ASSERT_FALSE(dict.find("wor"));
 }
 
 /* Large Insert and find Test */
-TEST(DictTrieTests, LARGE_TEST) {
-    DictionaryTrie dict;
+TYPED_TEST(DictTests, LARGE_TEST) {
+    TypeParam dict;
     dict.insert("call", 5);
     dict.insert("me", 20);
     dict.insert("mind", 2);
@@ -102,8 +115,8 @@ TEST(DictTrieTests, LARGE_TEST) {
 }
 
 /* Large find false Test */
-TEST(DictTrieTests, LARGE_FIND_FALSE_TEST) {
-    DictionaryTrie dict;
+TYPED_TEST(DictTests, LARGE_FIND_FALSE_TEST) {
+    TypeParam dict;
     dict.insert("call", 5);
     dict.insert("me", 20);
     dict.insert("mind", 2);
@@ -113,8 +126,8 @@ TEST(DictTrieTests, LARGE_FIND_FALSE_TEST) {
 }
 
 /* Predict Completions same frequency test */
-TEST(DictTrieTests, PREDICT_COMPLETIONS_SAME_TEST) {
-    DictionaryTrie dict;
+TYPED_TEST(DictTests, PREDICT_COMPLETIONS_SAME_TEST) {
+    TypeParam dict;
     dict.insert("and", 1);
     dict.insert("ant", 1);
     dict.insert("ana", 1);
@@ -128,8 +141,8 @@ TEST(DictTrieTests, PREDICT_COMPLETIONS_SAME_TEST) {
 }
 
 /* Predict Completions test */
-TEST(DictTrieTests, PREDICT_COMPLETIONS_TEST) {
-    DictionaryTrie dict;
+TYPED_TEST(DictTests, PREDICT_COMPLETIONS_TEST) {
+    TypeParam dict;
     dict.insert("call", 5);
     dict.insert("me", 20);
     dict.insert("mind", 2);
@@ -145,8 +158,8 @@ TEST(DictTrieTests, PREDICT_COMPLETIONS_TEST) {
 }
 
 /* Large Predict Completions test */
-TEST(DictTrieTests, LARGE_PREDICT_COMPLETIONS_TEST) {
-    DictionaryTrie dict;
+TYPED_TEST(DictTests, LARGE_PREDICT_COMPLETIONS_TEST) {
+    TypeParam dict;
     dict.insert("a", 5);
     dict.insert("at", 5);
     dict.insert("ate", 5);
@@ -168,8 +181,8 @@ TEST(DictTrieTests, LARGE_PREDICT_COMPLETIONS_TEST) {
 }
 
 /* Large Predict Underscores test */
-TEST(DictTrieTests, LARGE_PREDICT_UNDERSCORES_TEST) {
-    DictionaryTrie dict;
+TYPED_TEST(DictTests, LARGE_PREDICT_UNDERSCORES_TEST) {
+    TypeParam dict;
     dict.insert("hi", 3);
     dict.insert("wrong", 3);
     dict.insert("gato", 5);
@@ -204,4 +217,906 @@ TEST(DictTrieTests, LARGE_PREDICT_UNDERSCORES_TEST) {
 
     // Assert that predict underscores works correctly
     ASSERT_EQ(dict.predictUnderscores("g_t_", 12), answer);
-}
\ No newline at end of file
+}
+
+/* Predict Underscores with words of frequency 0 test */
+TYPED_TEST(DictTests, PREDICT_UNDERSCORES_ZERO_FREQ_TEST) {
+    TypeParam dict;
+    dict.insert("abc", 0);
+    dict.insert("abd", 5);
+    dict.insert("xyz", 0);
+
+    // Assert words of frequency 0 fill the results until they are full
+    ASSERT_EQ(dict.predictUnderscores("xy_", 10), vector<string>{"xyz"});
+    ASSERT_EQ(dict.predictUnderscores("ab_", 10),
+              (vector<string>{"abd", "abc"}));
+    ASSERT_EQ(dict.predictUnderscores("___", 10),
+              (vector<string>{"abd", "abc", "xyz"}));
+    ASSERT_EQ(dict.predictUnderscores("___", 1), vector<string>{"abd"});
+}
+
+/* Arena node count test */
+TEST(DictTrieTests, NUM_NODES_TEST) {
+    DictionaryTrie dict;
+    dict.insert("word", 10);
+    dict.insert("wor", 1);
+    // Assert prefix word reuses the existing nodes
+    ASSERT_EQ(dict.numNodes(), 4);
+    dict.insert("wa", 5);
+    ASSERT_EQ(dict.numNodes(), 5);
+}
+
+/* Predict Completions after inserting a prefix of a frequent word test */
+TYPED_TEST(DictTests, PREDICT_COMPLETIONS_PREFIX_WORD_TEST) {
+    TypeParam dict;
+    dict.insert("word", 10);
+    dict.insert("wor", 1);
+    dict.insert("wa", 5);
+
+    vector<string> answer;
+    answer.emplace_back("word");
+
+    // Assert low freq prefix word does not hide its frequent completion
+    ASSERT_EQ(dict.predictCompletions("w", 1), answer);
+}
+
+/* Test views and ids of completions match the copied words */
+TEST(DictTrieTests, PREDICT_COMPLETION_VIEWS_TEST) {
+    DictionaryTrie dict;
+    dict.insert("car", 3);
+    dict.insert("cat", 7);
+    dict.insert("cab", 7);
+    dict.insert("dog", 9);
+
+    vector<string> words = dict.predictCompletions("ca", 10);
+    vector<string_view> views = dict.predictCompletionViews("ca", 10);
+    vector<unsigned int> ids = dict.predictCompletionIds("ca", 10);
+    ASSERT_EQ(views.size(), words.size());
+    ASSERT_EQ(ids.size(), words.size());
+    for (unsigned int i = 0; i < words.size(); i++) {
+        ASSERT_EQ(views[i], words[i]);
+        ASSERT_EQ(dict.wordAt(ids[i]), words[i]);
+    }
+    ASSERT_EQ(views[0], "cab");
+
+    // Assert ids follow insertion order
+    ASSERT_EQ(dict.wordAt(0), "car");
+    ASSERT_EQ(dict.wordAt(3), "dog");
+
+    vector<string_view> matches = dict.predictUnderscoreViews("_a_", 2);
+    ASSERT_EQ(matches.size(), 2);
+    ASSERT_EQ(matches[0], "cab");
+    ASSERT_EQ(matches[1], "cat");
+    ASSERT_TRUE(dict.predictCompletionViews("x", 10).empty());
+}
+
+/* Fills a dictionary with a pseudo random set of short words */
+static void insertRandomWords(Dictionary& dict, unsigned int numWords) {
+    unsigned int seed = 7;
+    for (unsigned int i = 0; i < numWords; i++) {
+        seed = seed * 1103515245 + 12345;
+        string word(1 + seed % 5, 'a');
+        for (char& c : word) {
+            seed = seed * 1103515245 + 12345;
+            c = 'a' + (seed >> 16) % 4;
+        }
+        dict.insert(word, 1 + (seed >> 8) % 20);
+    }
+}
+
+/* Backend matches the ternary trie on random words and queries test */
+TYPED_TEST(DictTests, RANDOM_BACKEND_TEST) {
+    DictionaryTrie expected;
+    TypeParam dict;
+    insertRandomWords(expected, 500);
+    insertRandomWords(dict, 500);
+
+    // words over a wide range of bytes, so nodes get many children
+    unsigned int seed = 11;
+    for (unsigned int i = 0; i < 2000; i++) {
+        seed = seed * 1103515245 + 12345;
+        string word(1 + seed % 4, 'a');
+        for (char& c : word) {
+            seed = seed * 1103515245 + 12345;
+            c = (char)(1 + (seed >> 16) % 255);
+        }
+        unsigned int freq = (seed >> 8) % 50;
+        ASSERT_EQ(dict.insert(word, freq), expected.insert(word, freq));
+    }
+    ASSERT_EQ(dict.wordCount(), expected.wordCount());
+
+    vector<string> queries = {"", "a", "ab", "ba", "dcb", "aaaa", "x"};
+    for (unsigned int c = 1; c < 256; c += 7) {
+        queries.push_back(string(1, (char)c));
+        queries.push_back(string(1, (char)c) + (char)(255 - c));
+    }
+    for (const string& query : queries) {
+        ASSERT_EQ(dict.find(query), expected.find(query)) << query;
+        for (unsigned int k : {1, 3, 10, 100}) {
+            ASSERT_EQ(dict.predictCompletions(query, k),
+                      expected.predictCompletions(query, k))
+                << query << " " << k;
+        }
+    }
+    for (const char* pattern : {"_", "__", "a_", "_b", "___", "_a_c",
+                                  "____", "d__a"}) {
+        for (unsigned int k : {1, 5, 50}) {
+            ASSERT_EQ(dict.predictUnderscores(pattern, k),
+                      expected.predictUnderscores(pattern, k))
+                << pattern << " " << k;
+        }
+    }
+}
+
+/* Completion cache matches search test */
+TEST(DictTrieTests, COMPLETION_CACHE_TEST) {
+    DictionaryTrie dict;
+    DictionaryTrie cached;
+    insertRandomWords(dict, 500);
+    insertRandomWords(cached, 500);
+    cached.enableCompletionCache(2, 5, 1 << 20);
+    ASSERT_GT(cached.completionCacheMemory(), 0);
+
+    // Assert cached answers match the search for every short prefix
+    vector<string> prefixes = {"", "a", "b", "ab", "dd", "abc", "zz"};
+    for (const string& prefix : prefixes) {
+        for (unsigned int k = 1; k <= 6; k++) {
+            ASSERT_EQ(cached.predictCompletions(prefix, k),
+                      dict.predictCompletions(prefix, k));
+        }
+    }
+}
+
+/* Completion cache updated by insert test */
+TEST(DictTrieTests, COMPLETION_CACHE_INSERT_TEST) {
+    DictionaryTrie dict;
+    dict.insert("ear", 3);
+    dict.insert("eat", 4);
+    dict.insert("east", 1);
+    dict.enableCompletionCache(2, 2, 1 << 20);
+    dict.insert("eager", 10);
+    dict.insert("eb", 3);
+
+    vector<string> answer;
+    answer.emplace_back("eager");
+    answer.emplace_back("eat");
+
+    // Assert new words show up in the cached lists
+    ASSERT_EQ(dict.predictCompletions("ea", 2), answer);
+    answer[1] = "eat";
+    ASSERT_EQ(dict.predictCompletions("e", 2), answer);
+}
+
+/* Completion cache without budget test */
+TEST(DictTrieTests, COMPLETION_CACHE_BUDGET_TEST) {
+    DictionaryTrie dict;
+    insertRandomWords(dict, 200);
+    vector<string> answer = dict.predictCompletions("a", 3);
+    dict.enableCompletionCache(3, 3, 0);
+
+    // Assert nothing is cached and queries still work
+    ASSERT_EQ(dict.completionCacheMemory(), 0);
+    ASSERT_EQ(dict.predictCompletions("a", 3), answer);
+}
+
+/* Snapshot save and load test */
+TEST(DictTrieTests, SNAPSHOT_TEST) {
+    const string file = "test_DictionaryTrie.snapshot";
+    DictionaryTrie dict;
+    insertRandomWords(dict, 300);
+    dict.insert("gate", 5);
+    dict.insert("goto", 10);
+    ASSERT_TRUE(dict.saveSnapshot(file));
+
+    DictionaryTrie mapped;
+    mapped.insert("other", 1);
+    ASSERT_TRUE(mapped.loadSnapshot(file));
+    remove(file.c_str());
+
+    // Assert the mapped trie answers exactly like the original
+    ASSERT_TRUE(mapped.isReadOnly());
+    ASSERT_EQ(mapped.numNodes(), dict.numNodes());
+    ASSERT_EQ(mapped.wordCount(), dict.wordCount());
+    ASSERT_TRUE(mapped.find("goto"));
+    ASSERT_FALSE(mapped.find("other"));
+    vector<string> prefixes = {"", "a", "ab", "g", "dd"};
+    for (const string& prefix : prefixes) {
+        ASSERT_EQ(mapped.predictCompletions(prefix, 5),
+                  dict.predictCompletions(prefix, 5));
+    }
+    ASSERT_EQ(mapped.predictUnderscores("g_t_", 5),
+              dict.predictUnderscores("g_t_", 5));
+
+    // Assert the mapped trie is read only
+    ASSERT_FALSE(mapped.insert("new", 1));
+}
+
+/* Snapshot load of an invalid file test */
+TEST(DictTrieTests, SNAPSHOT_INVALID_TEST) {
+    const string file = "test_DictionaryTrie.invalid";
+    ofstream out(file, ios::binary);
+    out << "10 not a snapshot\n";
+    out.close();
+
+    DictionaryTrie dict;
+    dict.insert("word", 10);
+    // Assert text files and missing files are rejected
+    ASSERT_FALSE(dict.loadSnapshot(file));
+    ASSERT_FALSE(dict.loadSnapshot("missing.snapshot"));
+    remove(file.c_str());
+
+    // Assert the trie is left unchanged
+    ASSERT_FALSE(dict.isReadOnly());
+    ASSERT_TRUE(dict.find("word"));
+}
+
+/* Snapshot load of a snapshot with corrupted fields test */
+TEST(DictTrieTests, SNAPSHOT_CORRUPT_TEST) {
+    const string file = "test_DictionaryTrie.corrupt";
+    DictionaryTrie dict;
+    insertRandomWords(dict, 100);
+    ASSERT_TRUE(dict.saveSnapshot(file));
+    ifstream in(file, ios::binary);
+    string saved((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    in.close();
+
+    // header fields: nodeSize at 12, root at 16, poolSize at 40 and
+    // nodesOffset at 48. A node's middle child follows left and right.
+    unsigned int nodeSize;
+    unsigned int root;
+    uint64_t nodesOffset;
+    memcpy(&nodeSize, &saved[12], sizeof(nodeSize));
+    memcpy(&root, &saved[16], sizeof(root));
+    memcpy(&nodesOffset, &saved[48], sizeof(nodesOffset));
+    size_t rootMiddle = nodesOffset + (size_t)root * nodeSize + 8;
+    vector<pair<size_t, uint64_t>> corruptions = {
+        {rootMiddle, 0x7fffffff}, {40, 0xfffffffffffffff0}};
+    for (const pair<size_t, uint64_t>& corruption : corruptions) {
+        string bytes = saved;
+        size_t width = corruption.first == rootMiddle ? 4 : 8;
+        memcpy(&bytes[corruption.first], &corruption.second, width);
+        ofstream out(file, ios::binary | ios::trunc);
+        out << bytes;
+        out.close();
+
+        // Assert the snapshot is rejected and the trie left unchanged
+        DictionaryTrie mapped;
+        mapped.insert("word", 10);
+        ASSERT_FALSE(mapped.loadSnapshot(file)) << corruption.first;
+        ASSERT_FALSE(mapped.isReadOnly());
+        ASSERT_EQ(mapped.predictCompletions("w", 1), vector<string>{"word"});
+    }
+
+    // Assert the untouched bytes still load
+    ofstream out(file, ios::binary | ios::trunc);
+    out << saved;
+    out.close();
+    DictionaryTrie mapped;
+    ASSERT_TRUE(mapped.loadSnapshot(file));
+    remove(file.c_str());
+}
+
+/* Bulk insert matches one at a time insert test */
+TEST(DictTrieTests, BULK_INSERT_TEST) {
+    DictionaryTrie dict;
+    DictionaryTrie bulk;
+    vector<entry> entries;
+    vector<string> words = {"gato", "gote", "geit", "gu",   "gut",
+                             "gute", "gits", "gate", "a",    "ab",
+                             "abc",  "gu",   "",     "geta", "zeta"};
+    for (unsigned int i = 0; i < words.size(); i++) {
+        dict.insert(words[i], i + 1);
+        entries.push_back(make_pair(string_view(words[i]), i + 1));
+    }
+
+    // Assert duplicates and empty words are skipped
+    ASSERT_EQ(bulk.bulkInsert(entries), 13);
+    ASSERT_EQ(bulk.numNodes(), dict.numNodes());
+    for (const string& word : words) {
+        ASSERT_EQ(bulk.find(word), dict.find(word));
+    }
+    vector<string> prefixes = {"", "g", "gu", "a", "z"};
+    for (const string& prefix : prefixes) {
+        ASSERT_EQ(bulk.predictCompletions(prefix, 20),
+                  dict.predictCompletions(prefix, 20));
+    }
+    ASSERT_EQ(bulk.predictUnderscores("g_t_", 20),
+              dict.predictUnderscores("g_t_", 20));
+}
+
+/* Bulk insert balances sorted input test */
+TEST(DictTrieTests, BULK_INSERT_BALANCED_TEST) {
+    DictionaryTrie dict;
+    DictionaryTrie bulk;
+    vector<string> words;
+    for (char c = 'a'; c <= 'z'; c++) {
+        words.push_back(string(1, c));
+    }
+    vector<entry> entries;
+    for (const string& word : words) {
+        dict.insert(word, 1);
+        entries.push_back(make_pair(string_view(word), 1));
+    }
+    bulk.bulkInsert(entries);
+
+    // Assert sorted inserts chain up while the bulk build is balanced
+    ASSERT_EQ(dict.height(), 26);
+    ASSERT_EQ(bulk.height(), 5);
+    ASSERT_LT(bulk.averageProbeDepth(), dict.averageProbeDepth());
+}
+
+/* Bulk insert into a trie holding words test */
+TEST(DictTrieTests, BULK_INSERT_EXISTING_TEST) {
+    DictionaryTrie dict;
+    dict.insert("me", 20);
+    vector<entry> entries;
+    entries.push_back(make_pair("me", 1));
+    entries.push_back(make_pair("mid", 10));
+    entries.push_back(make_pair("mind", 2));
+
+    vector<string> answer;
+    answer.emplace_back("me");
+    answer.emplace_back("mid");
+    answer.emplace_back("mind");
+
+    // Assert existing words keep their frequency
+    ASSERT_EQ(dict.bulkInsert(entries), 2);
+    ASSERT_EQ(dict.predictCompletions("m", 3), answer);
+}
+
+/* Concurrent queries on a shared trie test */
+TEST(DictTrieTests, CONCURRENT_PREDICT_TEST) {
+    DictionaryTrie dict;
+    insertRandomWords(dict, 2000);
+    const DictionaryTrie& shared = dict;
+    vector<string> prefixes = {"", "a", "b", "ab", "dd", "abc"};
+    vector<vector<string>> answers;
+    for (const string& prefix : prefixes) {
+        answers.push_back(shared.predictCompletions(prefix, 7));
+    }
+    vector<string> underscores = shared.predictUnderscores("a_c_", 7);
+
+    // Assert every thread sees the same answers as a lone query
+    vector<thread> workers;
+    vector<int> mismatches(4, 0);
+    for (unsigned int t = 0; t < mismatches.size(); t++) {
+        workers.emplace_back([&, t]() {
+            for (unsigned int round = 0; round < 200; round++) {
+                for (unsigned int i = 0; i < prefixes.size(); i++) {
+                    if (shared.predictCompletions(prefixes[i], 7) !=
+                        answers[i]) {
+                        mismatches[t]++;
+                    }
+                }
+                if (shared.predictUnderscores("a_c_", 7) != underscores) {
+                    mismatches[t]++;
+                }
+            }
+        });
+    }
+    for (thread& worker : workers) {
+        worker.join();
+    }
+    ASSERT_EQ(mismatches, vector<int>(4, 0));
+}
+
+/* Batch of prefixes matches one query per prefix test */
+TEST(DictTrieTests, PREDICT_COMPLETIONS_BATCH_TEST) {
+    DictionaryTrie dict;
+    insertRandomWords(dict, 2000);
+    vector<string> prefixes = {"ab", "", "a", "abc", "ab", "zz",
+                               "dcb", "d", "abd", "aa", "ab", "abcd"};
+    for (unsigned int i = 0; i < 500; i++) {  // enough to use threads
+        prefixes.push_back(prefixes[i % 12].substr(0, i % 3) + "c");
+    }
+    vector<string_view> views(prefixes.begin(), prefixes.end());
+
+    // Assert every query gets what predictCompletions gives, in order
+    for (unsigned int numThreads : {1, 3}) {
+        CompletionBatch batch =
+            dict.predictCompletionsBatch(views, 5, numThreads);
+        ASSERT_EQ(batch.size(), prefixes.size());
+        for (unsigned int i = 0; i < prefixes.size(); i++) {
+            vector<string> answer = dict.predictCompletions(prefixes[i], 5);
+            ASSERT_EQ(batch.count(i), answer.size());
+            for (unsigned int j = 0; j < answer.size(); j++) {
+                ASSERT_EQ(batch.at(i, j), answer[j]);
+            }
+        }
+    }
+}
+
+/* Test pruned wildcard search against a scan of every word */
+TEST(DictTrieTests, PREDICT_UNDERSCORES_PRUNING_TEST) {
+    // random words of 1 to 8 letters, the first frequency of each wins
+    map<string, unsigned int> words;
+    vector<entry> entries;
+    unsigned int seed = 11;
+    for (unsigned int i = 0; i < 2000; i++) {
+        seed = seed * 1103515245 + 12345;
+        string word(1 + (seed >> 8) % 8, 'a');
+        for (char& c : word) {
+            seed = seed * 1103515245 + 12345;
+            c = 'a' + (seed >> 16) % 4;
+        }
+        words.emplace(word, 1 + (seed >> 4) % 30);
+    }
+
+    DictionaryTrie inserted;
+    DictionaryTrie built;
+    for (const auto& word : words) {
+        inserted.insert(word.first, word.second);
+        entries.push_back(entry(word.first, word.second));
+    }
+    built.bulkInsert(entries);
+
+    vector<string> patterns = {"_",      "__",       "___",       "____",
+                               "___d",   "__a_",     "a_b_c",     "b",
+                               "______", "_______c", "_________"};
+    for (const string& pattern : patterns) {
+        // most frequent first, alphabetical if tied
+        vector<pair<unsigned int, string>> matches;
+        for (const auto& word : words) {
+            bool match = word.first.length() == pattern.length();
+            for (unsigned int i = 0; match && i < pattern.length(); i++) {
+                match = pattern[i] == '_' || pattern[i] == word.first[i];
+            }
+            if (match) {
+                matches.push_back(make_pair(word.second, word.first));
+            }
+        }
+        std::sort(matches.begin(), matches.end(),
+                  [](const pair<unsigned int, string>& a,
+                     const pair<unsigned int, string>& b) {
+                      return a.first != b.first ? a.first > b.first
+                                                : a.second < b.second;
+                  });
+
+        for (unsigned int k : {1, 3, 10, 100}) {
+            vector<string> answer;
+            for (unsigned int i = 0; i < k && i < matches.size(); i++) {
+                answer.push_back(matches[i].second);
+            }
+            ASSERT_EQ(inserted.predictUnderscores(pattern, k), answer);
+            ASSERT_EQ(built.predictUnderscores(pattern, k), answer);
+        }
+    }
+}
+
+/* Fuzzy completion with a typo in the prefix test */
+TEST(DictTrieTests, PREDICT_FUZZY_TEST) {
+    DictionaryTrie dict;
+    dict.insert("cat", 5);
+    dict.insert("cart", 9);
+    dict.insert("cast", 2);
+    dict.insert("dog", 20);
+    dict.insert("ct", 1);
+
+    // Assert exact completions rank before words needing an edit
+    vector<string> matches = dict.predictFuzzy("cas", 1, 10);
+    ASSERT_EQ(matches.size(), 3);
+    ASSERT_EQ(matches[0], "cast");
+    ASSERT_EQ(matches[1], "cart");
+    ASSERT_EQ(matches[2], "cat");
+
+    // Assert a second edit lets in words further away
+    matches = dict.predictFuzzy("cas", 2, 10);
+    ASSERT_EQ(matches.size(), 4);
+    ASSERT_EQ(matches[3], "ct");
+
+    // Assert a typo still finds the word and no edits finds nothing
+    ASSERT_EQ(dict.predictFuzzy("dpg", 1, 10), vector<string>{"dog"});
+    ASSERT_TRUE(dict.predictFuzzy("dpg", 0, 10).empty());
+    ASSERT_EQ(dict.predictFuzzy("cat", 0, 10),
+              dict.predictCompletions("cat", 10));
+    ASSERT_TRUE(dict.predictFuzzy("cat", 1, 0).empty());
+}
+
+/* Fuzzy completion against a scan of every word */
+TEST(DictTrieTests, PREDICT_FUZZY_SCAN_TEST) {
+    map<string, unsigned int> words;
+    unsigned int seed = 3;
+    for (unsigned int i = 0; i < 1500; i++) {
+        seed = seed * 1103515245 + 12345;
+        string word(1 + (seed >> 8) % 7, 'a');
+        for (char& c : word) {
+            seed = seed * 1103515245 + 12345;
+            c = 'a' + (seed >> 16) % 5;
+        }
+        words.emplace(word, 1 + (seed >> 4) % 20);
+    }
+    DictionaryTrie dict;
+    for (const auto& word : words) {
+        dict.insert(word.first, word.second);
+    }
+
+    vector<string> prefixes = {"", "a", "e", "ab", "ba", "cde", "eeee",
+                               "abcab", "zz", "aazzc"};
+    for (const string& prefix : prefixes) {
+        for (unsigned int maxEdits : {0, 1, 2}) {
+            // fewest edits of the prefix to any prefix of each word
+            vector<pair<pair<unsigned int, int>, string>> matches;
+            for (const auto& word : words) {
+                vector<unsigned int> row(prefix.length() + 1);
+                for (unsigned int j = 0; j < row.size(); j++) {
+                    row[j] = j;
+                }
+                unsigned int edits = row.back();
+                for (unsigned int i = 0; i < word.first.length(); i++) {
+                    vector<unsigned int> next(row.size(), i + 1);
+                    for (unsigned int j = 1; j < row.size(); j++) {
+                        next[j] = std::min(
+                            {row[j] + 1, next[j - 1] + 1,
+                             row[j - 1] + (prefix[j - 1] != word.first[i])});
+                    }
+                    row = next;
+                    edits = std::min(edits, row.back());
+                }
+                if (edits <= maxEdits) {
+                    matches.push_back(make_pair(
+                        make_pair(edits, -(int)word.second), word.first));
+                }
+            }
+            std::sort(matches.begin(), matches.end());
+
+            for (unsigned int k : {1, 4, 15, 200}) {
+                vector<string> answer;
+                for (unsigned int i = 0; i < k && i < matches.size(); i++) {
+                    answer.push_back(matches[i].second);
+                }
+                ASSERT_EQ(dict.predictFuzzy(prefix, maxEdits, k), answer);
+            }
+        }
+    }
+}
+
+/* Very long keys and sorted inserts do not overflow the stack test */
+TEST(DictTrieTests, STACK_SAFETY_TEST) {
+    const unsigned int LENGTH = 1000000;
+    string chain(LENGTH, 'a');
+
+    // words sharing a chain of a million middle children, in reverse order
+    // so the letters ending them grow a left leaning sibling chain
+    vector<string> words;
+    for (char c = 'f'; c >= 'b'; c--) {
+        words.push_back(chain + c);
+    }
+    words.push_back(chain);
+    words.push_back(string(LENGTH, 'z'));
+
+    // short words in sorted order grow a right leaning chain of every letter
+    for (unsigned int c = 1; c < 256; c++) {
+        words.push_back(string(1, (char)c) + "x");
+    }
+
+    DictionaryTrie inserted;
+    DictionaryTrie built;
+    vector<entry> entries;
+    for (unsigned int i = 0; i < words.size(); i++) {
+        ASSERT_TRUE(inserted.insert(words[i], i + 1));
+        entries.push_back(entry(words[i], i + 1));
+    }
+    ASSERT_FALSE(inserted.insert(chain, 1));
+    ASSERT_EQ(built.bulkInsert(entries), words.size());
+
+    string allUnderscores(LENGTH, '_');
+    for (const DictionaryTrie* dict : {&inserted, &built}) {
+        ASSERT_EQ(dict->wordCount(), words.size());
+        ASSERT_GT(dict->height(), LENGTH);
+        for (const string& word : words) {
+            ASSERT_TRUE(dict->find(word));
+        }
+        ASSERT_FALSE(dict->find(chain + "g"));
+        ASSERT_FALSE(dict->find(string(LENGTH - 1, 'a')));
+
+        // the chain itself is the most frequent of its completions
+        vector<string> answer = {chain, chain + "b", chain + "c"};
+        ASSERT_EQ(dict->predictCompletions(chain, 3), answer);
+        ASSERT_EQ(dict->predictCompletions("aaaa", 3), answer);
+
+        answer = {string(LENGTH, 'z'), chain};
+        ASSERT_EQ(dict->predictUnderscores(allUnderscores, 5), answer);
+        answer = {chain + "b", chain + "c"};
+        ASSERT_EQ(dict->predictUnderscores(allUnderscores + "_", 2), answer);
+
+        // every word down the chain is one edit away from the prefix
+        answer = {chain, chain + "b"};
+        ASSERT_EQ(dict->predictFuzzy("aaab", 1, 2), answer);
+    }
+    ASSERT_EQ(inserted.predictCompletions("", 20),
+              built.predictCompletions("", 20));
+
+    // Assert the compact and succinct copies walk the chain as deep
+    CompactTrie compact(inserted);
+    SuccinctTrie succinct(inserted);
+    vector<string> answer = {chain, chain + "b", chain + "c"};
+    ASSERT_EQ(compact.predictCompletions("aaaa", 3), answer);
+    ASSERT_EQ(succinct.predictCompletions("aaaa", 3), answer);
+    answer = {string(LENGTH, 'z'), chain};
+    ASSERT_EQ(compact.predictUnderscores(allUnderscores, 5), answer);
+    ASSERT_EQ(succinct.predictUnderscores(allUnderscores, 5), answer);
+    answer = {chain + "b", chain + "c"};
+    ASSERT_EQ(compact.predictUnderscores(allUnderscores + "_", 2), answer);
+    ASSERT_EQ(succinct.predictUnderscores(allUnderscores + "_", 2), answer);
+    ASSERT_EQ(compact.predictCompletions("", 20),
+              inserted.predictCompletions("", 20));
+    ASSERT_EQ(succinct.predictCompletions("", 20),
+              inserted.predictCompletions("", 20));
+}
+
+/* Best first completion search matches depth first search test */
+TEST(DictTrieTests, BEST_FIRST_TEST) {
+    DictionaryTrie depthFirst;
+    DictionaryTrie bestFirst;
+    insertRandomWords(depthFirst, 500);
+    insertRandomWords(bestFirst, 500);
+    bestFirst.setBestFirst(true);
+
+    // Assert the same words, ties broken alphabetically, for every prefix
+    vector<string> prefixes = {""};
+    for (char a = 'a'; a <= 'e'; a++) {
+        prefixes.push_back(string(1, a));
+        for (char b = 'a'; b <= 'e'; b++) {
+            prefixes.push_back(string(1, a) + b);
+            prefixes.push_back(string(1, a) + b + "a");
+        }
+    }
+    for (const string& prefix : prefixes) {
+        for (unsigned int k : {1, 2, 3, 10, 100}) {
+            ASSERT_EQ(bestFirst.predictCompletions(prefix, k),
+                      depthFirst.predictCompletions(prefix, k));
+        }
+    }
+    bestFirst.enableCompletionCache(2, 5, 1 << 20);
+    ASSERT_EQ(bestFirst.predictCompletions("ab", 5),
+              depthFirst.predictCompletions("ab", 5));
+
+    // frequencies rising in alphabetical order: the depth first search only
+    // finds the best words at the end, while best first goes right to them
+    DictionaryTrie rising;
+    for (unsigned int i = 0; i < 1000; i++) {
+        string word = "x";
+        for (unsigned int digit = 100; digit > 0; digit /= 10) {
+            word += (char)('a' + i / digit % 10);
+        }
+        rising.insert(word, i + 1);
+    }
+    vector<string> answer = {"xjjj", "xjji", "xjjh"};
+    ASSERT_EQ(rising.predictCompletions("x", 3), answer);
+    unsigned int depthFirstVisits = rising.completionVisits("x", 3);
+    rising.setBestFirst(true);
+    ASSERT_EQ(rising.predictCompletions("x", 3), answer);
+    ASSERT_LT(rising.completionVisits("x", 3) * 10, depthFirstVisits);
+    ASSERT_EQ(rising.completionVisits("y", 3), 0);
+}
+
+/* Set and increment frequency test */
+TEST(DictTrieTests, SET_FREQUENCY_TEST) {
+    DictionaryTrie dict;
+    dict.insert("ear", 3);
+    dict.insert("eat", 4);
+    dict.insert("east", 1);
+    dict.insert("eagle", 10);
+
+    // Assert only words in the trie can be updated
+    ASSERT_FALSE(dict.setFrequency("ea", 5));
+    ASSERT_FALSE(dict.setFrequency("eats", 5));
+    ASSERT_FALSE(dict.incrementFrequency("", 5));
+
+    // Assert a lowered word gives way on the whole path
+    ASSERT_TRUE(dict.setFrequency("eagle", 2));
+    vector<string> answer = {"eat", "ear"};
+    ASSERT_EQ(dict.predictCompletions("e", 2), answer);
+    ASSERT_EQ(dict.predictUnderscores("e_g__", 1), vector<string>{"eagle"});
+
+    // Assert a raised word moves up, and the frequency saturates
+    ASSERT_TRUE(dict.incrementFrequency("east", 3));
+    answer = {"east", "eat"};
+    ASSERT_EQ(dict.predictCompletions("ea", 2), answer);
+    ASSERT_TRUE(dict.incrementFrequency("ear", 0xFFFFFFFF));
+    answer = {"ear", "east"};
+    ASSERT_EQ(dict.predictCompletions("", 2), answer);
+    ASSERT_EQ(dict.wordCount(), 4);
+}
+
+/* Erase test */
+TEST(DictTrieTests, ERASE_TEST) {
+    DictionaryTrie dict;
+    dict.insert("ear", 3);
+    dict.insert("eat", 4);
+    dict.insert("east", 1);
+    dict.insert("eas", 2);
+    ASSERT_EQ(dict.numNodes(), 6);
+
+    // Assert a missing word can not be erased
+    ASSERT_FALSE(dict.erase("ea"));
+    ASSERT_FALSE(dict.erase("eats"));
+
+    // Assert erasing a prefix word keeps its nodes for the longer word
+    ASSERT_TRUE(dict.erase("eas"));
+    ASSERT_FALSE(dict.find("eas"));
+    ASSERT_TRUE(dict.find("east"));
+    ASSERT_FALSE(dict.erase("eas"));
+    ASSERT_EQ(dict.numNodes(), 6);
+
+    // Assert erasing a leaf reclaims the nodes only it used
+    ASSERT_TRUE(dict.erase("east"));
+    ASSERT_EQ(dict.numNodes(), 4);
+    vector<string> answer = {"eat", "ear"};
+    ASSERT_EQ(dict.predictCompletions("e", 10), answer);
+    ASSERT_TRUE(dict.predictUnderscores("e___", 10).empty());
+
+    // Assert an insert reuses the reclaimed nodes
+    size_t memory = dict.memoryUsage();
+    dict.insert("ease", 5);
+    ASSERT_EQ(dict.numNodes(), 6);
+    ASSERT_EQ(dict.wordCount(), 3);
+    ASSERT_EQ(dict.predictCompletions("eas", 1), vector<string>{"ease"});
+
+    // Assert erasing every word empties the trie
+    for (const char* word : {"ear", "eat", "ease"}) {
+        ASSERT_TRUE(dict.erase(word));
+    }
+    ASSERT_EQ(dict.numNodes(), 0);
+    ASSERT_EQ(dict.wordCount(), 0);
+    ASSERT_TRUE(dict.predictCompletions("", 10).empty());
+    dict.insert("b", 1);
+    ASSERT_EQ(dict.predictCompletions("", 10), vector<string>{"b"});
+    ASSERT_LE(dict.memoryUsage(), memory + 64);
+}
+
+/* Erase a node with siblings on both sides test */
+TEST(DictTrieTests, ERASE_SIBLINGS_TEST) {
+    DictionaryTrie dict;
+    vector<string> letters = {"d", "b", "f", "a", "c", "e", "g"};
+    for (unsigned int i = 0; i < letters.size(); i++) {
+        dict.insert(letters[i], 10 + i);
+    }
+    dict.insert("ex", 50);
+
+    // Assert the leftmost node on the right, "e", takes the root's place
+    // and the node above it no longer counts its words
+    ASSERT_TRUE(dict.erase("d"));
+    ASSERT_TRUE(dict.erase("ex"));
+    ASSERT_EQ(dict.numNodes(), 6);
+    vector<string> answer = {"g", "e", "c", "a"};
+    ASSERT_EQ(dict.predictUnderscores("_", 4), answer);
+    ASSERT_TRUE(dict.setFrequency("e", 1));
+    answer = {"g", "c", "a", "f"};
+    ASSERT_EQ(dict.predictCompletions("", 4), answer);
+
+    // Assert the right child takes the place when it has no left child
+    ASSERT_TRUE(dict.erase("b"));
+    ASSERT_FALSE(dict.find("b"));
+    ASSERT_TRUE(dict.find("a"));
+    ASSERT_TRUE(dict.find("c"));
+    answer = {"g", "c", "a", "f", "e"};
+    ASSERT_EQ(dict.predictCompletions("", 10), answer);
+    ASSERT_EQ(dict.numNodes(), 5);
+}
+
+/* Random updates match a trie built from the final frequencies test */
+TEST(DictTrieTests, RANDOM_UPDATE_TEST) {
+    DictionaryTrie dict;
+    DictionaryTrie cached;
+    map<string, unsigned int> model;
+    cached.enableCompletionCache(2, 4, 1 << 20);
+    unsigned int seed = 11;
+    for (unsigned int step = 0; step < 4000; step++) {
+        seed = seed * 1103515245 + 12345;
+        string word(1 + (seed >> 8) % 5, 'a');
+        for (char& c : word) {
+            seed = seed * 1103515245 + 12345;
+            c = 'a' + (seed >> 16) % 4;
+        }
+        seed = seed * 1103515245 + 12345;
+        unsigned int freq = 1 + (seed >> 8) % 30;
+        bool present = model.count(word) > 0;
+        for (DictionaryTrie* trie : {&dict, &cached}) {
+            switch (step % 4) {
+                case 0:
+                    ASSERT_EQ(trie->insert(word, freq), !present);
+                    break;
+                case 1:
+                    ASSERT_EQ(trie->setFrequency(word, freq), present);
+                    break;
+                case 2:
+                    ASSERT_EQ(trie->incrementFrequency(word, freq), present);
+                    break;
+                default:
+                    ASSERT_EQ(trie->erase(word), present);
+            }
+        }
+        if (step % 4 == 0 && !present) {
+            model[word] = freq;
+        } else if (step % 4 == 1 && present) {
+            model[word] = freq;
+        } else if (step % 4 == 2 && present) {
+            model[word] += freq;
+        } else if (step % 4 == 3) {
+            model.erase(word);
+        }
+    }
+
+    DictionaryTrie fresh;
+    for (const auto& word : model) {
+        fresh.insert(word.first, word.second);
+    }
+    vector<string> queries = {"", "a", "b", "ab", "dd", "abc", "_", "__",
+                              "a_c", "___", "____d", "_____"};
+    for (DictionaryTrie* trie : {&dict, &cached}) {
+        // Assert no node was left behind that the fresh trie does not need
+        ASSERT_EQ(trie->wordCount(), model.size());
+        ASSERT_EQ(trie->numNodes(), fresh.numNodes());
+        for (const string& query : queries) {
+            for (unsigned int k : {1, 3, 4, 50}) {
+                ASSERT_EQ(trie->predictCompletions(query, k),
+                          fresh.predictCompletions(query, k));
+                ASSERT_EQ(trie->predictUnderscores(query, k),
+                          fresh.predictUnderscores(query, k));
+            }
+        }
+    }
+
+    // Assert a snapshot keeps the counts of the updated trie
+    const string filename = "erase_test.snapshot";
+    ASSERT_TRUE(dict.saveSnapshot(filename));
+    DictionaryTrie mapped;
+    ASSERT_TRUE(mapped.loadSnapshot(filename));
+    remove(filename.c_str());
+    ASSERT_EQ(mapped.wordCount(), model.size());
+    ASSERT_EQ(mapped.numNodes(), fresh.numNodes());
+    ASSERT_FALSE(mapped.erase(model.begin()->first));
+    ASSERT_EQ(mapped.predictCompletions("a", 10),
+              fresh.predictCompletions("a", 10));
+}
+
+/* Wide nodes kept in step with inserts and erases test */
+TEST(DictTrieTests, WIDE_NODES_TEST) {
+    DictionaryTrie dict;
+    DictionaryTrie wide;
+    insertRandomWords(dict, 300);
+    insertRandomWords(wide, 300);
+    wide.enableWideNodes(3, 2);
+    ASSERT_GT(wide.wideNodeMemory(), 0);
+
+    vector<string> queries = {"", "a", "b", "ab", "dd", "abc", "zz", "abcd"};
+    unsigned int seed = 5;
+    for (unsigned int step = 0; step < 2000; step++) {
+        seed = seed * 1103515245 + 12345;
+        string word(1 + (seed >> 8) % 4, 'a');
+        for (char& c : word) {
+            seed = seed * 1103515245 + 12345;
+            c = 'a' + (seed >> 16) % 26;
+        }
+        if (step % 3 == 2) {
+            ASSERT_EQ(wide.erase(word), dict.erase(word));
+        } else {
+            ASSERT_EQ(wide.insert(word, step), dict.insert(word, step));
+        }
+
+        // Assert finds and completions match the ternary walk throughout
+        if (step % 100 == 0) {
+            queries.push_back(word);
+            for (const string& query : queries) {
+                ASSERT_EQ(wide.find(query), dict.find(query));
+                ASSERT_EQ(wide.predictCompletions(query, 5),
+                          dict.predictCompletions(query, 5));
+            }
+        }
+    }
+
+    // Assert a mapped snapshot gets its wide nodes built again
+    const string filename = "wide_test.snapshot";
+    ASSERT_TRUE(dict.saveSnapshot(filename));
+    ASSERT_TRUE(wide.loadSnapshot(filename));
+    remove(filename.c_str());
+    ASSERT_GT(wide.wideNodeMemory(), 0);
+    for (const string& query : queries) {
+        ASSERT_EQ(wide.find(query), dict.find(query));
+        ASSERT_EQ(wide.predictCompletions(query, 5),
+                  dict.predictCompletions(query, 5));
+    }
+    wide.disableWideNodes();
+    ASSERT_EQ(wide.wideNodeMemory(), 0);
+}
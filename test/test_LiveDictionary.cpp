@@ -0,0 +1,143 @@
+/**
+ * Testing class to make unit tests for the live dictionary class.
+ */
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "DictionaryTrie.hpp"
+#include "LiveDictionary.hpp"
+
+using namespace std;
+using namespace testing;
+
+/* Returns a trie holding one word */
+static unique_ptr<DictionaryTrie> oneWord(string word, unsigned int freq) {
+    unique_ptr<DictionaryTrie> trie(new DictionaryTrie());
+    trie->insert(word, freq);
+    return trie;
+}
+
+/* Empty live dictionary test */
+TEST(LiveDictionaryTests, EMPTY_TEST) {
+    LiveDictionary live;
+    ASSERT_EQ(live.version(), 0);
+    LiveDictionary::Pin pin = live.pin();
+    ASSERT_EQ(pin.version(), 0);
+    ASSERT_EQ(pin->wordCount(), 0);
+    ASSERT_FALSE(pin->find("a"));
+}
+
+/* A pin keeps its snapshot across a publish test */
+TEST(LiveDictionaryTests, PUBLISH_TEST) {
+    LiveDictionary live;
+    ASSERT_EQ(live.publish(oneWord("old", 1)), 1);
+    LiveDictionary::Pin before = live.pin();
+
+    ASSERT_EQ(live.publish(oneWord("new", 2)), 2);
+    ASSERT_EQ(live.version(), 2);
+
+    // Assert the old pin still sees the old trie, and a new pin the new one
+    ASSERT_EQ(before.version(), 1);
+    ASSERT_TRUE(before->find("old"));
+    ASSERT_FALSE(before->find("new"));
+    LiveDictionary::Pin after = live.pin();
+    ASSERT_EQ(after.version(), 2);
+    ASSERT_TRUE(after->find("new"));
+    ASSERT_EQ((*after).predictCompletions("n", 5), vector<string>{"new"});
+}
+
+/* A replaced snapshot is freed after its last pin test */
+TEST(LiveDictionaryTests, RECLAIM_TEST) {
+    LiveDictionary live(4);
+    live.publish(oneWord("a", 1));
+    {
+        LiveDictionary::Pin first = live.pin();
+        LiveDictionary::Pin moved = std::move(first);
+        live.publish(oneWord("b", 1));
+
+        // Assert the snapshot stays while the moved pin holds it
+        ASSERT_EQ(live.reclaim(), 1);
+        ASSERT_TRUE(moved->find("a"));
+    }
+    ASSERT_EQ(live.reclaim(), 0);
+
+    // Assert more pins than slots can be held one after another
+    for (unsigned int i = 0; i < 10; i++) {
+        LiveDictionary::Pin pin = live.pin();
+        ASSERT_TRUE(pin->find("b"));
+    }
+}
+
+/* Background reload test */
+TEST(LiveDictionaryTests, RELOAD_TEST) {
+    LiveDictionary live;
+    live.reloadAsync([](DictionaryTrie& trie) {
+        trie.insert("apple", 5);
+        trie.insert("apply", 3);
+        return true;
+    });
+    live.finishReload();
+    ASSERT_EQ(live.version(), 1);
+    vector<string> answer = {"apple", "apply"};
+    ASSERT_EQ(live.pin()->predictCompletions("app", 10), answer);
+
+    // Assert a failed build leaves the current snapshot in place
+    live.reloadAsync([](DictionaryTrie& trie) {
+        trie.insert("broken", 1);
+        return false;
+    });
+    live.finishReload();
+    ASSERT_EQ(live.version(), 1);
+    ASSERT_FALSE(live.pin()->find("broken"));
+}
+
+/* Readers query while reloads run test */
+TEST(LiveDictionaryTests, CONCURRENT_RELOAD_TEST) {
+    const unsigned int NUM_READERS = 4;
+    const unsigned int NUM_RELOADS = 20;
+    LiveDictionary live(NUM_READERS);
+    live.publish(oneWord("w0", 1));
+
+    // every version holds the words w0 to w<version>, so a reader can check
+    // that a snapshot is whole and never goes back to an older one
+    atomic<bool> done(false);
+    atomic<unsigned int> errors(0);
+    vector<thread> readers;
+    for (unsigned int t = 0; t < NUM_READERS; t++) {
+        readers.emplace_back([&live, &done, &errors]() {
+            unsigned long long last = 0;
+            while (!done.load()) {
+                LiveDictionary::Pin pin = live.pin();
+                unsigned long long version = pin.version();
+                if (version < last ||
+                    pin->wordCount() != version ||
+                    !pin->find("w" + to_string(version - 1))) {
+                    errors++;
+                }
+                last = version;
+            }
+        });
+    }
+    for (unsigned int i = 2; i <= NUM_RELOADS; i++) {
+        live.reloadAsync([i](DictionaryTrie& trie) {
+            for (unsigned int w = 0; w < i; w++) {
+                trie.insert("w" + to_string(w), w + 1);
+            }
+            return true;
+        });
+    }
+    live.finishReload();
+    done = true;
+    for (thread& reader : readers) {
+        reader.join();
+    }
+
+    ASSERT_EQ(errors.load(), 0);
+    ASSERT_EQ(live.version(), NUM_RELOADS);
+    ASSERT_EQ(live.reclaim(), 0);
+}
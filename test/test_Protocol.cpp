@@ -0,0 +1,103 @@
+/**
+ * Testing class to make unit tests for the autocomplete wire protocol.
+ */
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "Protocol.hpp"
+
+using namespace std;
+using namespace testing;
+
+/* Request round trip test */
+TEST(ProtocolTests, REQUEST_TEST) {
+    string buffer;
+    Protocol::appendRequest(buffer, Protocol::PREFIX, 10, "ca");
+    Protocol::appendRequest(buffer, Protocol::PATTERN, 3, "c_t");
+    ASSERT_EQ(buffer.size(), 2 * (4 + 1 + 4) + 2 + 3);
+
+    // Assert pipelined requests parse one after the other
+    Request request;
+    size_t used;
+    ASSERT_EQ(Protocol::parseRequest(buffer, request, used),
+              Protocol::COMPLETE);
+    ASSERT_EQ(request.op, Protocol::PREFIX);
+    ASSERT_EQ(request.numCompletions, 10);
+    ASSERT_EQ(request.query, "ca");
+    string_view rest = string_view(buffer).substr(used);
+    ASSERT_EQ(Protocol::parseRequest(rest, request, used),
+              Protocol::COMPLETE);
+    ASSERT_EQ(request.op, Protocol::PATTERN);
+    ASSERT_EQ(request.numCompletions, 3);
+    ASSERT_EQ(request.query, "c_t");
+    ASSERT_EQ(used, rest.size());
+
+    // Assert every cut short frame waits for more bytes
+    for (size_t length = 0; length < rest.size(); length++) {
+        ASSERT_EQ(Protocol::parseRequest(rest.substr(0, length), request,
+                                         used),
+                  Protocol::INCOMPLETE);
+    }
+}
+
+/* Invalid request test */
+TEST(ProtocolTests, INVALID_REQUEST_TEST) {
+    Request request;
+    size_t used;
+
+    // Assert a body shorter than op and count, or too large, is invalid
+    string shortBody("\0\0\0\4Pabc", 8);
+    ASSERT_EQ(Protocol::parseRequest(shortBody, request, used),
+              Protocol::INVALID);
+    string huge("\0\1\0\1", 4);
+    ASSERT_EQ(Protocol::parseRequest(huge, request, used), Protocol::INVALID);
+}
+
+/* Response round trip test */
+TEST(ProtocolTests, RESPONSE_TEST) {
+    string buffer;
+    vector<string> words = {"cat", "", "car"};
+    Protocol::appendResponse(buffer, Protocol::OK, words);
+    Protocol::appendResponse(buffer, Protocol::BAD_REQUEST, vector<string>());
+
+    unsigned char status;
+    vector<string> parsed;
+    size_t used;
+    ASSERT_EQ(Protocol::parseResponse(buffer, status, parsed, used),
+              Protocol::COMPLETE);
+    ASSERT_EQ(status, Protocol::OK);
+    ASSERT_EQ(parsed, words);
+    string_view rest = string_view(buffer).substr(used);
+    ASSERT_EQ(Protocol::parseResponse(rest, status, parsed, used),
+              Protocol::COMPLETE);
+    ASSERT_EQ(status, Protocol::BAD_REQUEST);
+    ASSERT_TRUE(parsed.empty());
+
+    for (size_t length = 0; length < used; length++) {
+        ASSERT_EQ(Protocol::parseResponse(string_view(buffer).substr(0, length),
+                                          status, parsed, used),
+                  Protocol::INCOMPLETE);
+    }
+
+    // Assert a word running past the body is invalid
+    string bad("\0\0\0\x0A\0\0\0\0\1\0\0\0\7x", 14);
+    ASSERT_EQ(Protocol::parseResponse(bad, status, parsed, used),
+              Protocol::INVALID);
+}
+
+/* Address test */
+TEST(ProtocolTests, RESOLVE_TEST) {
+    sockaddr_storage addr;
+    socklen_t length;
+    ASSERT_TRUE(Protocol::resolve("unix:/tmp/autocomplete.sock", addr, length));
+    ASSERT_EQ(addr.ss_family, AF_UNIX);
+    ASSERT_TRUE(Protocol::resolve("tcp:7000", addr, length));
+    ASSERT_EQ(addr.ss_family, AF_INET);
+    ASSERT_FALSE(Protocol::resolve("tcp:70000", addr, length));
+    ASSERT_FALSE(Protocol::resolve("tcp:", addr, length));
+    ASSERT_FALSE(Protocol::resolve("unix:", addr, length));
+    ASSERT_FALSE(Protocol::resolve("unix:" + string(200, 'a'), addr, length));
+    ASSERT_FALSE(Protocol::resolve("7000", addr, length));
+}
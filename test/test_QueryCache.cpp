@@ -0,0 +1,145 @@
+/**
+ * Testing class to make unit tests for the query cache class.
+ */
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "DictionaryTrie.hpp"
+#include "QueryCache.hpp"
+
+using namespace std;
+using namespace testing;
+
+/* Repeated queries hit the cache test */
+TEST(QueryCacheTests, HIT_MISS_TEST) {
+    DictionaryTrie dict;
+    dict.insert("apple", 5);
+    dict.insert("apply", 3);
+    dict.insert("bat", 2);
+    QueryCache cache(dict, 8, 1);
+
+    vector<string> answer = {"apple", "apply"};
+    ASSERT_EQ(cache.predictCompletions("ap", 10), answer);
+    ASSERT_EQ(cache.predictCompletions("ap", 10), answer);
+    ASSERT_EQ(cache.hits(), 1);
+    ASSERT_EQ(cache.misses(), 1);
+
+    // Assert the number of completions and the kind are part of the key
+    ASSERT_EQ(cache.predictCompletions("ap", 1), vector<string>{"apple"});
+    ASSERT_EQ(cache.predictUnderscores("ap", 10), vector<string>());
+    ASSERT_EQ(cache.predictUnderscores("_at", 10), vector<string>{"bat"});
+    ASSERT_EQ(cache.predictUnderscores("_at", 10), vector<string>{"bat"});
+    ASSERT_EQ(cache.hits(), 2);
+    ASSERT_EQ(cache.misses(), 4);
+    ASSERT_EQ(cache.size(), 4);
+
+    cache.clear();
+    ASSERT_EQ(cache.size(), 0);
+    ASSERT_EQ(cache.predictCompletions("ap", 10), answer);
+    ASSERT_EQ(cache.misses(), 5);
+}
+
+/* Changes to the trie drop the cached results test */
+TEST(QueryCacheTests, INVALIDATE_TEST) {
+    DictionaryTrie dict;
+    dict.insert("apple", 5);
+    QueryCache cache(dict, 8);
+    ASSERT_EQ(cache.predictCompletions("a", 10), vector<string>{"apple"});
+
+    dict.insert("ant", 9);
+    vector<string> answer = {"ant", "apple"};
+    ASSERT_EQ(cache.predictCompletions("a", 10), answer);
+    dict.setFrequency("apple", 10);
+    answer = {"apple", "ant"};
+    ASSERT_EQ(cache.predictCompletions("a", 10), answer);
+    dict.erase("apple");
+    ASSERT_EQ(cache.predictCompletions("a", 10), vector<string>{"ant"});
+    ASSERT_EQ(cache.hits(), 0);
+
+    // Assert a failed change keeps the cached results
+    ASSERT_FALSE(dict.insert("ant", 1));
+    ASSERT_EQ(cache.predictCompletions("a", 10), vector<string>{"ant"});
+    ASSERT_EQ(cache.hits(), 1);
+}
+
+/* A query asked once does not push out a popular one test */
+TEST(QueryCacheTests, ADMISSION_TEST) {
+    DictionaryTrie dict;
+    for (char c = 'a'; c <= 'z'; c++) {
+        dict.insert(string(1, c) + "x", c);
+    }
+    QueryCache tinyLfu(dict, 1, 1);
+    QueryCache lru(dict, 1, 1, false);
+    for (QueryCache* cache : {&tinyLfu, &lru}) {
+        for (unsigned int i = 0; i < 5; i++) {
+            cache->predictCompletions("a", 1);
+        }
+        cache->predictCompletions("b", 1);
+        cache->predictCompletions("a", 1);
+    }
+
+    // Assert only the frequency admission keeps "a" cached
+    ASSERT_EQ(tinyLfu.hits(), 5);
+    ASSERT_EQ(tinyLfu.rejections(), 1);
+    ASSERT_EQ(lru.hits(), 4);
+    ASSERT_EQ(lru.rejections(), 0);
+
+    // Assert a query asked more often than the cached one gets in
+    tinyLfu.predictCompletions("b", 1);
+    for (unsigned int i = 0; i < 10; i++) {
+        tinyLfu.predictCompletions("c", 1);
+    }
+    ASSERT_EQ(tinyLfu.predictCompletions("c", 1), vector<string>{"cx"});
+    unsigned long long hits = tinyLfu.hits();
+    tinyLfu.predictCompletions("c", 1);
+    ASSERT_EQ(tinyLfu.hits(), hits + 1);
+}
+
+/* No capacity caches nothing test */
+TEST(QueryCacheTests, ZERO_CAPACITY_TEST) {
+    DictionaryTrie dict;
+    dict.insert("a", 1);
+    QueryCache cache(dict, 0);
+    for (unsigned int i = 0; i < 3; i++) {
+        ASSERT_EQ(cache.predictCompletions("a", 1), vector<string>{"a"});
+    }
+    ASSERT_EQ(cache.hits(), 0);
+    ASSERT_EQ(cache.misses(), 3);
+    ASSERT_EQ(cache.size(), 0);
+}
+
+/* Threads share the cache test */
+TEST(QueryCacheTests, CONCURRENT_TEST) {
+    DictionaryTrie dict;
+    for (unsigned int i = 0; i < 500; i++) {
+        dict.insert("w" + to_string(i), i);
+    }
+    QueryCache cache(dict, 32, 4);
+    const unsigned int NUM_THREADS = 4;
+    const unsigned int NUM_QUERIES = 2000;
+    vector<thread> threads;
+    vector<unsigned int> errors(NUM_THREADS, 0);
+    for (unsigned int t = 0; t < NUM_THREADS; t++) {
+        threads.emplace_back([&dict, &cache, &errors, t]() {
+            for (unsigned int i = 0; i < NUM_QUERIES; i++) {
+                string prefix = "w" + to_string((i * 7 + t) % 60);
+                if (cache.predictCompletions(prefix, 3) !=
+                    dict.predictCompletions(prefix, 3)) {
+                    errors[t]++;
+                }
+            }
+        });
+    }
+    for (thread& t : threads) {
+        t.join();
+    }
+    for (unsigned int count : errors) {
+        ASSERT_EQ(count, 0);
+    }
+    ASSERT_EQ(cache.hits() + cache.misses(), NUM_THREADS * NUM_QUERIES);
+    ASSERT_GT(cache.hits(), 0);
+    ASSERT_LE(cache.size(), 32);
+}
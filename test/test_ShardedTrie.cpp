@@ -0,0 +1,98 @@
+/**
+ * Testing class to make unit tests for the sharded dictionary class.
+ */
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "DictionaryTrie.hpp"
+#include "ShardedTrie.hpp"
+
+using namespace std;
+using namespace testing;
+
+/* Empty sharded dictionary test */
+TEST(ShardedTrieTests, EMPTY_TEST) {
+    ShardedTrie sharded(0);
+    ASSERT_EQ(sharded.numShards(), 1);
+    ASSERT_EQ(sharded.wordCount(), 0);
+    ASSERT_FALSE(sharded.find(""));
+    ASSERT_FALSE(sharded.insert("", 1));
+    ASSERT_TRUE(sharded.predictCompletions("", 10).empty());
+    ASSERT_TRUE(sharded.predictUnderscores("", 10).empty());
+}
+
+/* Words are routed to one shard by first byte test */
+TEST(ShardedTrieTests, ROUTE_TEST) {
+    ShardedTrie sharded(3);
+    vector<vector<entry>> parts = {
+        {entry("apple", 5), entry("bat", 9), entry("apply", 3)},
+        {entry("cat", 7), entry("bat", 1), entry("", 4), entry("ant", 5)}};
+    ASSERT_EQ(sharded.build(parts), 5);
+
+    // Assert the words sharing a first letter share a shard
+    unsigned int total = 0;
+    for (unsigned int s = 0; s < sharded.numShards(); s++) {
+        const DictionaryTrie& shard = sharded.shard(s);
+        ASSERT_EQ(shard.find("apple"), shard.find("ant"));
+        total += shard.wordCount();
+    }
+    ASSERT_EQ(total, 5);
+
+    // Assert the first duplicate wins across parts
+    vector<string> answer = {"bat", "cat", "ant", "apple", "apply"};
+    ASSERT_EQ(sharded.predictCompletions("", 10), answer);
+    ASSERT_EQ(sharded.predictUnderscores("_at", 10),
+              (vector<string>{"bat", "cat"}));
+    ASSERT_EQ(sharded.predictCompletions("ap", 1), vector<string>{"apple"});
+
+    // Assert later inserts go to the shard of their first byte
+    ASSERT_TRUE(sharded.insert("axe", 20));
+    ASSERT_FALSE(sharded.insert("axe", 20));
+    ASSERT_TRUE(sharded.find("axe"));
+    ASSERT_EQ(sharded.predictCompletions("a", 1), vector<string>{"axe"});
+}
+
+/* Same answers as one trie holding every word test */
+TEST(ShardedTrieTests, MATCHES_DICTIONARY_TRIE_TEST) {
+    DictionaryTrie dict;
+    vector<string> words;
+    unsigned int seed = 11;
+    for (unsigned int i = 0; i < 3000; i++) {
+        seed = seed * 1103515245 + 12345;
+        string word(1 + (seed >> 8) % 10, 'a');
+        for (char& c : word) {
+            seed = seed * 1103515245 + 12345;
+            c = 'a' + (seed >> 16) % 6;
+        }
+        words.push_back(word);
+    }
+    vector<vector<entry>> parts(4);
+    for (unsigned int i = 0; i < words.size(); i++) {
+        dict.insert(words[i], 1 + i % 13);
+        parts[i * parts.size() / words.size()].push_back(
+            entry(words[i], 1 + i % 13));
+    }
+
+    vector<string> queries = {"",   "a",    "b",   "ab",   "fff", "abcdef",
+                              "ca", "eeee", "zz",  "_",    "__",  "a_c",
+                              "___", "_b_d", "____", "_____f", "bb____"};
+    for (unsigned int numShards : {1, 2, 5}) {
+        ShardedTrie sharded(numShards);
+        sharded.build(parts);
+        ASSERT_EQ(sharded.wordCount(), dict.wordCount());
+        for (unsigned int i = 0; i < words.size(); i += 7) {
+            ASSERT_TRUE(sharded.find(words[i]));
+            ASSERT_EQ(sharded.find(words[i] + "a"), dict.find(words[i] + "a"));
+        }
+        for (const string& query : queries) {
+            for (unsigned int k : {1, 5, 50}) {
+                ASSERT_EQ(sharded.predictCompletions(query, k),
+                          dict.predictCompletions(query, k));
+                ASSERT_EQ(sharded.predictUnderscores(query, k),
+                          dict.predictUnderscores(query, k));
+            }
+        }
+    }
+}
@@ -0,0 +1,138 @@
+/**
+ * Testing class to make unit tests for the succinct trie class and its bit
+ * vectors.
+ */
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "DictionaryTrie.hpp"
+#include "SuccinctTrie.hpp"
+
+using namespace std;
+using namespace testing;
+
+/* Rank and select against counting bit by bit test */
+TEST(SuccinctTrieTests, BIT_VECTOR_TEST) {
+    BitVector bits;
+    vector<bool> plain;
+    unsigned int seed = 9;
+    for (unsigned int i = 0; i < 5000; i++) {
+        seed = seed * 1103515245 + 12345;
+        // long runs of each bit, so some blocks are all ones or all zeros
+        bool bit = (i / 700) % 3 == 0 ? true
+                   : (i / 700) % 3 == 1 ? false
+                                        : (seed >> 16) % 3 == 0;
+        bits.push_back(bit);
+        plain.push_back(bit);
+    }
+    bits.build();
+    ASSERT_EQ(bits.size(), plain.size());
+
+    size_t ones = 0;
+    size_t zeros = 0;
+    for (size_t i = 0; i < plain.size(); i++) {
+        ASSERT_EQ(bits.get(i), plain[i]);
+        ASSERT_EQ(bits.rank1(i), ones);
+        if (plain[i]) {
+            ASSERT_EQ(bits.select1(ones++), i);
+        } else {
+            ASSERT_EQ(bits.select0(zeros++), i);
+        }
+    }
+    ASSERT_EQ(bits.rank1(plain.size()), ones);
+}
+
+/* Packed values spanning words test */
+TEST(SuccinctTrieTests, PACKED_ARRAY_TEST) {
+    for (unsigned int width : {1, 7, 24, 33, 64}) {
+        PackedArray packed(width);
+        vector<uint64_t> values;
+        for (uint64_t i = 0; i < 300; i++) {
+            uint64_t value = i * 0x9E3779B97F4A7C15ULL;
+            if (width < 64) {
+                value &= (1ULL << width) - 1;
+            }
+            packed.push_back(value);
+            values.push_back(value);
+        }
+        for (unsigned int i = 0; i < values.size(); i++) {
+            ASSERT_EQ(packed.get(i), values[i]);
+        }
+    }
+}
+
+/* Small trie test */
+TEST(SuccinctTrieTests, SMALL_TEST) {
+    DictionaryTrie dict;
+    ASSERT_EQ(SuccinctTrie(dict).numNodes(), 0);
+    ASSERT_TRUE(SuccinctTrie(dict).predictCompletions("", 3).empty());
+
+    dict.insert("mid", 10);
+    dict.insert("me", 20);
+    dict.insert("mind", 2);
+    dict.insert("call", 5);
+    SuccinctTrie succinct(dict);
+    ASSERT_EQ(succinct.wordCount(), 4);
+    ASSERT_EQ(succinct.numNodes(), 10);  // one per distinct prefix
+
+    ASSERT_TRUE(succinct.find("mind"));
+    ASSERT_FALSE(succinct.find("min"));
+    ASSERT_FALSE(succinct.find("middle"));
+    ASSERT_FALSE(succinct.find(""));
+
+    vector<string> answer = {"me", "mid", "mind"};
+    ASSERT_EQ(succinct.predictCompletions("m", 10), answer);
+    ASSERT_EQ(succinct.predictUnderscores("_i_", 10), vector<string>{"mid"});
+}
+
+/* Patterns matching words of frequency 0 test */
+TEST(SuccinctTrieTests, UNDERSCORES_ZERO_FREQ_TEST) {
+    DictionaryTrie dict;
+    dict.insert("abc", 0);
+    dict.insert("abd", 5);
+    dict.insert("xyz", 0);
+    SuccinctTrie succinct(dict);
+
+    // Assert words of frequency 0 fill the results until they are full
+    ASSERT_EQ(succinct.predictUnderscores("xy_", 10), vector<string>{"xyz"});
+    ASSERT_EQ(succinct.predictUnderscores("___", 10),
+              (vector<string>{"abd", "abc", "xyz"}));
+}
+
+/* Same answers as the trie it was built from test */
+TEST(SuccinctTrieTests, MATCHES_DICTIONARY_TRIE_TEST) {
+    DictionaryTrie dict;
+    vector<string> words;
+    unsigned int seed = 13;
+    for (unsigned int i = 0; i < 3000; i++) {
+        seed = seed * 1103515245 + 12345;
+        string word(1 + (seed >> 8) % 10, 'a');
+        for (char& c : word) {
+            seed = seed * 1103515245 + 12345;
+            c = 'a' + (seed >> 16) % 6;
+        }
+        // equal frequencies, so ties are broken by the words
+        dict.insert(word, 1 + (seed >> 4) % 9);
+        words.push_back(word);
+    }
+    SuccinctTrie succinct(dict);
+    ASSERT_EQ(succinct.wordCount(), dict.wordCount());
+
+    for (unsigned int i = 0; i < words.size(); i += 7) {
+        ASSERT_TRUE(succinct.find(words[i]));
+        ASSERT_EQ(succinct.find(words[i] + "f"), dict.find(words[i] + "f"));
+    }
+    vector<string> queries = {"",    "a",    "b",    "ab",  "fff",
+                              "cab", "eeee", "zz",   "_",   "__",
+                              "a_c", "___",  "_b_d", "____f"};
+    for (const string& query : queries) {
+        for (unsigned int k : {1, 5, 50}) {
+            ASSERT_EQ(succinct.predictCompletions(query, k),
+                      dict.predictCompletions(query, k));
+            ASSERT_EQ(succinct.predictUnderscores(query, k),
+                      dict.predictUnderscores(query, k));
+        }
+    }
+}
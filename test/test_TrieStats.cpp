@@ -0,0 +1,94 @@
+/**
+ * Testing class to make unit tests for the query statistics class.
+ */
+
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "DictionaryTrie.hpp"
+#include "TrieStats.hpp"
+
+using namespace std;
+using namespace testing;
+
+/* Histogram bucket test */
+TEST(TrieStatsTests, BUCKET_TEST) {
+    ASSERT_EQ(TrieStats::bucketOf(0), 0);
+    ASSERT_EQ(TrieStats::bucketOf(1), 1);
+    ASSERT_EQ(TrieStats::bucketOf(2), 2);
+    ASSERT_EQ(TrieStats::bucketOf(3), 2);
+    ASSERT_EQ(TrieStats::bucketOf(4), 3);
+    ASSERT_EQ(TrieStats::bucketOf(1000), 10);
+    ASSERT_EQ(TrieStats::bucketOf(~0ULL), TrieStats::NUM_BUCKETS - 1);
+}
+
+/* Counts of one completion test */
+TEST(TrieStatsTests, COMPLETION_TEST) {
+    DictionaryTrie dict;
+    dict.insert("ab", 5);
+    dict.insert("ac", 3);
+    TrieStats::reset();
+    vector<string> answer = {"ab"};
+    ASSERT_EQ(dict.predictCompletions("a", 1), answer);
+    TrieStats stats = TrieStats::collect();
+
+    // Assert nothing is counted when compiled out
+    if (!TrieStats::enabled()) {
+        ASSERT_EQ(stats.queries, 0);
+        return;
+    }
+
+    // "a" is found at the root, "ab" fills the heap and "ac" is pruned
+    ASSERT_EQ(stats.queries, 1);
+    ASSERT_EQ(stats.totals[TrieStats::WALK_NODES], 1);
+    ASSERT_EQ(stats.totals[TrieStats::NODES_VISITED], 1);
+    ASSERT_EQ(stats.totals[TrieStats::SUBTREES_PRUNED], 1);
+    ASSERT_EQ(stats.totals[TrieStats::HEAP_PUSHES], 1);
+    ASSERT_EQ(stats.totals[TrieStats::HEAP_POPS], 1);
+    ASSERT_EQ(stats.histograms[TrieStats::WALK_NODES][1], 1);
+
+    stringstream out;
+    stats.print(out);
+    ASSERT_NE(out.str().find("subtrees pruned: total 1"), string::npos);
+}
+
+/* Counts from several threads, and reset test */
+TEST(TrieStatsTests, THREADS_TEST) {
+    const unsigned int NUM_THREADS = 4;
+    const unsigned int NUM_QUERIES = 100;
+    DictionaryTrie dict;
+    dict.insert("cat", 2);
+    dict.insert("car", 4);
+    dict.insert("dog", 1);
+    TrieStats::reset();
+
+    vector<thread> threads;
+    for (unsigned int i = 0; i < NUM_THREADS; i++) {
+        threads.emplace_back([&dict]() {
+            for (unsigned int q = 0; q < NUM_QUERIES; q++) {
+                dict.predictCompletions("ca", 2);
+                dict.predictUnderscores("d_g", 1);
+            }
+        });
+    }
+    for (thread& t : threads) {
+        t.join();
+    }
+
+    // Assert the counts of exited threads are kept
+    unsigned long long expected =
+        TrieStats::enabled() ? NUM_THREADS * NUM_QUERIES * 2 : 0;
+    TrieStats stats = TrieStats::collect();
+    ASSERT_EQ(stats.queries, expected);
+    unsigned long long bucketed = 0;
+    for (unsigned int b = 0; b < TrieStats::NUM_BUCKETS; b++) {
+        bucketed += stats.histograms[TrieStats::HEAP_PUSHES][b];
+    }
+    ASSERT_EQ(bucketed, expected);
+
+    TrieStats::reset();
+    ASSERT_EQ(TrieStats::collect().queries, 0);
+}
@@ -0,0 +1,211 @@
+/**
+ * Testing class to make unit tests for the dictionary file parsing.
+ *
+ * Author: Aimee T Shao
+ * Email: atshao@ucsd.edu
+ * Resources: UCSD CSE100 PA2 starter code, PA2 Implementation Guide
+ */
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "DictionaryTrie.hpp"
+#include "util.hpp"
+
+using namespace std;
+using namespace testing;
+
+/* Whitespace in phrases collapses test */
+TEST(UtilTests, LOAD_DICT_WHITESPACE_TEST) {
+    istringstream in("10   hello   world \r\n\t7\tx\ty\n12 last line");
+    vector<string> words;
+    Utils::loadDict(words, in);
+
+    vector<string> answer;
+    answer.emplace_back("hello world");
+    answer.emplace_back("x y");
+    answer.emplace_back("last line");
+
+    // Assert phrases are single spaced and the last line needs no newline
+    ASSERT_EQ(words, answer);
+}
+
+/* Lone period ends a phrase test */
+TEST(UtilTests, LOAD_DICT_PERIOD_TEST) {
+    istringstream in("5 a . b\n8 .x y.\n");
+    vector<string> words;
+    Utils::loadDict(words, in);
+
+    vector<string> answer;
+    answer.emplace_back("a");
+    answer.emplace_back(".x y.");
+
+    // Assert only a lone "." token ends the phrase
+    ASSERT_EQ(words, answer);
+}
+
+/* Frequencies and skipped lines test */
+TEST(UtilTests, DICT_READER_FREQ_TEST) {
+    istringstream in("\n+3 z\nnofreq here\n1abc def\n");
+    DictReader reader(in);
+    unsigned int freq;
+    string_view phrase;
+
+    // Assert signs are accepted and lines without frequency skipped
+    ASSERT_TRUE(reader.next(freq, phrase));
+    ASSERT_EQ(freq, 3);
+    ASSERT_EQ(phrase, "z");
+    ASSERT_TRUE(reader.next(freq, phrase));
+    ASSERT_EQ(freq, 1);
+    ASSERT_EQ(phrase, "abc def");
+    ASSERT_FALSE(reader.next(freq, phrase));
+}
+
+/* Dictionary text parsed in place test */
+TEST(UtilTests, DICT_READER_IN_MEMORY_TEST) {
+    string text = "5  new   york . x\nnofreq\n7 z\r\n2 last";
+    DictReader reader(&text[0], text.size());
+    unsigned int freq;
+    string_view first;
+    string_view phrase;
+
+    // Assert phrases are normalized in place and stay valid
+    ASSERT_TRUE(reader.next(freq, first));
+    ASSERT_EQ(freq, 5);
+    ASSERT_TRUE(reader.next(freq, phrase));
+    ASSERT_EQ(freq, 7);
+    ASSERT_EQ(phrase, "z");
+    ASSERT_TRUE(reader.next(freq, phrase));
+    ASSERT_EQ(freq, 2);
+    ASSERT_EQ(phrase, "last");
+    ASSERT_FALSE(reader.next(freq, phrase));
+    ASSERT_EQ(first, "new york");
+    ASSERT_GE(first.data(), text.data());
+    ASSERT_LT(first.data(), text.data() + text.size());
+    ASSERT_EQ(reader.bytes(), text.size());
+}
+
+/* Line longer than one block test */
+TEST(UtilTests, DICT_READER_LONG_LINE_TEST) {
+    string longWord(3 << 20, 'q');
+    istringstream in("1 " + longWord + "  tail\n2 x");
+    vector<string> words;
+    Utils::loadDict(words, in);
+
+    vector<string> answer;
+    answer.push_back(longWord + " tail");
+    answer.emplace_back("x");
+
+    // Assert lines spanning several blocks are read whole
+    ASSERT_EQ(words, answer);
+}
+
+/* Load a limited number of words test */
+TEST(UtilTests, LOAD_DICT_NUM_WORDS_TEST) {
+    istringstream in("1 a\n2 b\n3 c\n");
+    DictionaryTrie dict;
+    Utils::loadDict(dict, in, 2);
+
+    // Assert only the first two words are loaded
+    ASSERT_TRUE(dict.find("b"));
+    ASSERT_FALSE(dict.find("c"));
+}
+
+/* Load into a sharded dictionary on several threads test */
+TEST(UtilTests, LOAD_DICT_SHARDED_TEST) {
+    string file;
+    for (unsigned int i = 0; i < 500; i++) {
+        file += to_string(i % 37) + " " + char('a' + i % 26) +
+                to_string(i % 200) + "\n";
+    }
+    for (unsigned int numThreads : {1, 3, 8}) {
+        istringstream in(file);
+        istringstream again(file);
+        ShardedTrie sharded(4);
+        DictionaryTrie dict;
+        Utils::loadDict(sharded, in, numThreads);
+        Utils::loadDict(dict, again);
+
+        // Assert the splits lose no line and the first duplicate wins
+        ASSERT_EQ(sharded.wordCount(), dict.wordCount());
+        ASSERT_EQ(sharded.predictCompletions("", 20),
+                  dict.predictCompletions("", 20));
+        ASSERT_EQ(sharded.predictCompletions("b1", 5),
+                  dict.predictCompletions("b1", 5));
+    }
+}
+
+/* Batch query line parsing test */
+TEST(UtilTests, BATCH_PARSE_LINE_TEST) {
+    string_view query;
+    unsigned int numCompletions;
+
+    // Assert the count follows the last tab, or the last space without one
+    ASSERT_TRUE(BatchRunner::parseLine("new york\t5", query, numCompletions));
+    ASSERT_EQ(query, "new york");
+    ASSERT_EQ(numCompletions, 5);
+    ASSERT_TRUE(BatchRunner::parseLine("c_t 12", query, numCompletions));
+    ASSERT_EQ(query, "c_t");
+    ASSERT_EQ(numCompletions, 12);
+    ASSERT_TRUE(BatchRunner::parseLine("\t3", query, numCompletions));
+    ASSERT_EQ(query, "");
+
+    ASSERT_FALSE(BatchRunner::parseLine("cat", query, numCompletions));
+    ASSERT_FALSE(BatchRunner::parseLine("cat\t", query, numCompletions));
+    ASSERT_FALSE(BatchRunner::parseLine("cat\tx1", query, numCompletions));
+    ASSERT_FALSE(
+        BatchRunner::parseLine("cat\t4294967296", query, numCompletions));
+}
+
+/* Batch answer formats test */
+TEST(UtilTests, BATCH_FORMAT_TEST) {
+    string out;
+    vector<string> completions = {"can", "cat"};
+    BatchRunner::appendAnswer(out, BatchRunner::TSV, "ca", completions);
+    ASSERT_EQ(out, "ca\tcan\tcat\n");
+
+    // Assert quotes, backslashes and control characters are escaped
+    out.clear();
+    completions = {"say \"hi\"", "a\\b\x01"};
+    BatchRunner::appendAnswer(out, BatchRunner::JSONL, "s", completions);
+    ASSERT_EQ(out,
+              "{\"query\": \"s\", \"completions\": "
+              "[\"say \\\"hi\\\"\", \"a\\\\b\\u0001\"]}\n");
+}
+
+/* Batch run keeps the order of the queries across threads test */
+TEST(UtilTests, BATCH_RUN_TEST) {
+    DictionaryTrie dict;
+    dict.insert("cat", 5);
+    dict.insert("car", 9);
+    dict.insert("dog", 7);
+
+    // more lines than fit in one round of chunks, with a few invalid ones
+    string queries;
+    string expected;
+    const unsigned int NUM_LINES = BatchRunner::CHUNK_LINES * 5 + 17;
+    for (unsigned int i = 0; i < NUM_LINES; i++) {
+        string query = i % 3 == 0 ? "c" : (i % 3 == 1 ? "d_g" : "x");
+        unsigned int k = i % 4;
+        queries += query + "\t" + to_string(k) + "\r\n";
+        vector<string> answer = query == "d_g"
+                                    ? dict.predictUnderscores(query, k)
+                                    : dict.predictCompletions(query, k);
+        BatchRunner::appendAnswer(expected, BatchRunner::TSV, query, answer);
+        if (i % 1000 == 0) {
+            queries += "no count\n\n";
+        }
+    }
+
+    for (unsigned int threads : {1, 3}) {
+        istringstream in(queries);
+        ostringstream out;
+        BatchRunner batch(dict, BatchRunner::TSV, threads);
+        batch.run(in, out);
+        ASSERT_EQ(out.str(), expected) << threads;
+        ASSERT_EQ(batch.queriesAnswered(), NUM_LINES);
+        ASSERT_EQ(batch.linesSkipped(), (NUM_LINES + 999) / 1000);
+    }
+}